@@ -0,0 +1,239 @@
+// Replay of captured PMD notifications through the BLE receive path.
+//
+// Connects one sensor session per session number of the capture over the mock BLE transport
+// (host/arduino/BLEDevice.h), then delivers every notification to its session's data
+// characteristic, so it runs through PolarBLEConnection::NotifyCallback, the PMD decoder and
+// the receive rings exactly as on the ESP32. After each notification the sessions are serviced
+// as ComputeTask does, so the beats also reach the HRV engines.
+//
+// Reports packets/s and beats/s over the whole replay, and the time spent in the callback (parse)
+// and in Sessions_Service (analysis) separately.
+//
+// Usage: ble_replay [capture.log ...] [--synthetic N] [--sessions K] [--realtime] [--repeat N]
+//                   [--save capture.log]
+//
+// Captures are serial logs recorded with the "capture" command (src/core/PMDCapture.h); lines
+// that are not PMD records are skipped. Without one, K sensors each send N synthetic beats in
+// PPI notifications of 5 beats. --realtime paces the notifications by their capture times
+// instead of replaying as fast as possible. --save writes the notifications (the synthetic ones,
+// for instance) as a capture.
+
+#include "../src/core/SensorSession.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int PER_PACKET = 5;
+
+// Sensor address of a session number
+static std::string address(uint8_t session) {
+  char text[20];
+  snprintf(text, sizeof(text), "a0:9e:1a:00:00:%02x", session);
+  return text;
+}
+
+static bool loadCapture(const char* path, std::vector<PMD_CaptureRecord>& records) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+  std::string line;
+  PMD_CaptureRecord record;
+  while (std::getline(file, line)) {
+    if (PMD_ParseCapture(line.c_str(), &record)) {
+      records.push_back(record);
+    }
+  }
+  return true;
+}
+
+// sessions sensors sending beats PPI notifications of PER_PACKET beats each, in time order
+static void syntheticCapture(int beats, int sessions, std::vector<PMD_CaptureRecord>& records) {
+  std::vector<uint32_t> seeds;
+  std::vector<double> times;
+  for (int s = 0; s < sessions; s++) {
+    seeds.push_back(17 + s);
+    times.push_back(0.0);
+  }
+
+  for (int b = 0; b < beats; b += PER_PACKET) {
+    for (int s = 0; s < sessions; s++) {
+      PMD_CaptureRecord record;
+      memset(record.data, 0, PPI_HEADER_SIZE);
+      record.data[0] = PMD_TYPE_PPI;
+      record.length = PPI_HEADER_SIZE;
+      for (int k = 0; k < PER_PACKET; k++) {
+        seeds[s] = seeds[s] * 1664525u + 1013904223u;
+        double noise = ((seeds[s] >> 8) / double(1 << 24) - 0.5) * 20.0;
+        double ppi = 700.0 + 100.0 * s + 30.0 * sin(2.0 * M_PI * 0.1 * times[s]) +
+                     20.0 * sin(2.0 * M_PI * 0.25 * times[s]) + noise;
+        times[s] += ppi / 1000.0;
+        uint16_t value = (uint16_t)ppi;
+        uint8_t frame[PPI_FRAME_SIZE] = { (uint8_t)(60000 / value), (uint8_t)(value & 0xFF), (uint8_t)(value >> 8), 10, 0, 0 };
+        memcpy(record.data + record.length, frame, PPI_FRAME_SIZE);
+        record.length += PPI_FRAME_SIZE;
+      }
+      record.session = s;
+      record.time = (uint32_t)(times[s] * 1000.0);
+      records.push_back(record);
+    }
+  }
+  std::stable_sort(records.begin(), records.end(),
+    [](const PMD_CaptureRecord& a, const PMD_CaptureRecord& b) { return a.time < b.time; });
+}
+
+static bool saveCapture(const char* path, const std::vector<PMD_CaptureRecord>& records) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Could not write %s\n", path);
+    return false;
+  }
+  static char line[PMD_CAPTURE_MAX_LINE];
+  for (const PMD_CaptureRecord& record : records) {
+    fwrite(line, 1, PMD_FormatCapture(record.session, record.time, record.data, record.length, line), file);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  std::vector<const char*> paths;
+  const char* savePath = nullptr;
+  int syntheticBeats = 2000;
+  int sessions = 1;
+  int repeat = 1;
+  bool realtime = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+      syntheticBeats = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--sessions") && i + 1 < argc) {
+      sessions = atoi(argv[++i]);
+      sessions = MIN(MAX(sessions, 1), MAX_SENSORS);
+    } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+      repeat = MAX(repeat, 1);
+    } else if (!strcmp(argv[i], "--save") && i + 1 < argc) {
+      savePath = argv[++i];
+    } else if (!strcmp(argv[i], "--realtime")) {
+      realtime = true;
+    } else if (argv[i][0] != '-') {
+      paths.push_back(argv[i]);
+    } else {
+      fprintf(stderr, "Usage: %s [capture.log ...] [--synthetic N] [--sessions K] [--realtime] [--repeat N] [--save capture.log]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<PMD_CaptureRecord> records;
+  for (const char* path : paths) {
+    if (!loadCapture(path, records)) {
+      return 1;
+    }
+  }
+  if (paths.empty()) {
+    syntheticCapture(syntheticBeats, sessions, records);
+  }
+  if (records.empty()) {
+    fprintf(stderr, "Capture contains no PMD notifications\n");
+    return 1;
+  }
+  if (savePath != nullptr && !saveCapture(savePath, records)) {
+    return 1;
+  }
+
+  // Notifications of sessions beyond MAX_SENSORS have no connection to go to
+  int used = 0;
+  size_t skipped = 0;
+  for (const PMD_CaptureRecord& record : records) {
+    used = MAX(used, record.session + 1);
+  }
+  if (used > MAX_SENSORS) {
+    fprintf(stderr, "Capture has %d sessions, only the first %d are replayed\n", used, MAX_SENSORS);
+    used = MAX_SENSORS;
+  }
+
+  Serial.muted = true;
+  hostSkipDelay = true;
+  MockBLE::reset();
+  Sessions_Init();
+  resetHRVParameters();
+  BLEDevice::init("");
+  PolarBLEConnection::MyAdvertisedDeviceCallbacks callbacks("Polar Sense", sensorConnections, MAX_SENSORS);
+  BLEDevice::getScan()->setAdvertisedDeviceCallbacks(&callbacks);
+  BLEDevice::getScan()->start(5, false);
+  std::vector<std::string> addresses;
+  for (int s = 0; s < used; s++) {
+    addresses.push_back(address(s));
+    MockBLE::advertise("Polar Sense 0A1B2C3D", addresses[s].c_str());
+  }
+  for (int s = 0; s < used; s++) {
+    PolarBLEConnection* connection = sensorConnections[s];
+    if (!connection->doConnect || !connection->ConnectToServer()) {
+      fprintf(stderr, "Session %d did not connect\n", s);
+      return 1;
+    }
+    connection->doConnect = false;
+  }
+
+  printf("Capture: %s, %zu notifications, %d sessions x %d repeats, %s\n\n",
+    paths.empty() ? "synthetic" : paths.size() == 1 ? paths[0] : "several files", records.size(), used, repeat,
+    realtime ? "real time" : "as fast as possible");
+
+  Clock::duration parse = Clock::duration::zero(), analysis = Clock::duration::zero();
+  uint64_t delivered = 0;
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < repeat; r++) {
+    Clock::time_point origin = Clock::now();
+    for (const PMD_CaptureRecord& record : records) {
+      if (record.session >= used) {
+        skipped++;
+        continue;
+      }
+      int64_t due = (int64_t)record.time - records[0].time;
+      if (realtime && due > 0) {
+        std::this_thread::sleep_until(origin + std::chrono::milliseconds(due));
+      }
+      Clock::time_point t0 = Clock::now();
+      MockBLE::notify(addresses[record.session].c_str(), DATA_CHAR_UUID, record.data, record.length);
+      Clock::time_point t1 = Clock::now();
+      Sessions_Service(SESSION_BATCH);
+      analysis += Clock::now() - t1;
+      parse += t1 - t0;
+      delivered++;
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  uint64_t packets = 0, processed = 0, dropped = 0;
+  printf("%-8s %10s %10s %10s %10s %10s\n", "session", "packets", "beats", "processed", "dropped", "LF/HF");
+  for (int s = 0; s < used; s++) {
+    SensorSession& session = sensorSessions[s];
+    printf("%-8d %10u %10u %10u %10u %10.3f\n", s, session.connection.getPackets(), session.connection.getBeats(),
+      session.getProcessed(), session.getDropped(), session.engine->snapshot().window[0].lf_hf_ratio);
+    packets += session.connection.getPackets();
+    processed += session.getProcessed();
+    dropped += session.getDropped();
+  }
+
+  double parseNs = std::chrono::duration<double, std::nano>(parse).count();
+  double analysisNs = std::chrono::duration<double, std::nano>(analysis).count();
+  printf("\nNotifications delivered: %" PRIu64 " (%" PRIu64 " not decoded, %zu without a session)\n", delivered,
+    delivered - packets, skipped);
+  printf("Throughput: %.0f packets/s, %.0f beats/s over %.3f s\n", delivered / seconds, processed / seconds, seconds);
+  printf("Parse (callback): %.0f ns/packet, %.0f packets/s\n", parseNs / MAX(delivered, (uint64_t)1),
+    delivered / (parseNs * 1e-9));
+  printf("Analysis (Sessions_Service): %.0f ns/beat, %.0f beats/s\n", analysisNs / MAX(processed, (uint64_t)1),
+    processed / (analysisNs * 1e-9));
+  if (dropped > 0) {
+    printf("%" PRIu64 " beats dropped by the receive rings\n", dropped);
+  }
+  return 0;
+}
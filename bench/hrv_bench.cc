@@ -0,0 +1,257 @@
+// Per-beat latency benchmark for the HRV pipeline (updateHRVParameters / ProcessNewPPI).
+//
+// Replays a recorded PPI trace through the same calls ComputeTask makes and reports the
+// cost of each pipeline stage in ns/beat, the p50/p99 latency per beat and beats/s.
+//
+// Usage: hrv_bench [trace.csv] [--repeat N] [--warmup N] [--synthetic N] [--ar burg|sliding]
+//                  [--psd scalar|sse|avx2] [--spectrum mem|lomb|sdft]
+//
+// The trace may be a raw serial capture (START,...,END lines) or the cleaned CSV produced by
+// tests/graphs.ipynb; the Current_PPI column is replayed. Without a trace a deterministic
+// synthetic PPI series with LF and HF modulation is used.
+
+#include "../src/core/Parameters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Column of the most recent PPI in the CSV output of printHRVParameters()
+static const int CURRENT_PPI_COLUMN = 2;
+static const int MAX_STAGES = 32;
+
+struct Stage {
+  const char* name;
+  std::vector<uint32_t> samples;  // ns spent in this stage for each measured beat
+  uint32_t lastBeat;              // Beat of the last sample, so repeated marks within a beat add up
+};
+
+static Stage stages[MAX_STAGES];
+static int numStages = 0;
+static Clock::time_point lastMark;
+static bool recording = false;
+static uint32_t beat = 0;
+
+void hrvProfileBegin(void) {
+  beat++;
+  lastMark = Clock::now();
+}
+
+void hrvProfileMark(const char* stage) {
+  Clock::time_point now = Clock::now();
+  if (recording) {
+    int i = 0;
+    while (i < numStages && strcmp(stages[i].name, stage) != 0) {
+      i++;
+    }
+    if (i == numStages && numStages < MAX_STAGES) {
+      stages[numStages++].name = stage;
+    }
+    if (i < MAX_STAGES) {
+      // Stages run once per window, so a beat's time in a stage is the sum over its marks
+      uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastMark).count();
+      if (!stages[i].samples.empty() && stages[i].lastBeat == beat) {
+        stages[i].samples.back() += ns;
+      } else {
+        stages[i].samples.push_back(ns);
+        stages[i].lastBeat = beat;
+      }
+    }
+  }
+  lastMark = Clock::now();  // Exclude the bookkeeping above from the next stage
+}
+
+// Split a CSV line into fields
+static std::vector<std::string> splitCsv(const std::string& line) {
+  std::vector<std::string> fields;
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, ',')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+// Load the Current_PPI column from a raw serial capture or a cleaned CSV
+static bool loadTrace(const char* path, std::vector<uint16_t>& trace) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  int column = CURRENT_PPI_COLUMN;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    // Raw serial capture: strip the START/END markers
+    if (line.rfind("START,", 0) == 0) {
+      if (line.size() < 10 || line.compare(line.size() - 4, 4, ",END") != 0) {
+        continue;  // Truncated record
+      }
+      line = line.substr(6, line.size() - 10);
+    }
+
+    std::vector<std::string> fields = splitCsv(line);
+    if (fields.empty()) {
+      continue;
+    }
+
+    // Header row: locate the PPI column by name
+    auto named = std::find(fields.begin(), fields.end(), "Current_PPI");
+    if (named != fields.end()) {
+      column = named - fields.begin();
+      continue;
+    }
+
+    if ((int)fields.size() <= column) {
+      continue;
+    }
+    char* end = nullptr;
+    long ppi = strtol(fields[column].c_str(), &end, 10);
+    if (end != fields[column].c_str() && ppi > 0 && ppi <= UINT16_MAX) {
+      trace.push_back((uint16_t)ppi);
+    }
+  }
+  return true;
+}
+
+// Deterministic PPI series: ~70 bpm with 0.1 Hz (LF) and 0.25 Hz (HF) modulation plus noise
+static void syntheticTrace(size_t beats, std::vector<uint16_t>& trace) {
+  uint32_t seed = 12345;
+  float t = 0.0f;
+  for (size_t i = 0; i < beats; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    float noise = ((seed >> 8) / float(1 << 24) - 0.5f) * 30.0f;
+    float ppi = 850.0f + 40.0f * sinf(2.0f * M_PI * 0.1f * t) + 25.0f * sinf(2.0f * M_PI * 0.25f * t) + noise;
+    trace.push_back((uint16_t)ppi);
+    t += ppi / 1000.0f;
+  }
+}
+
+static uint32_t percentile(std::vector<uint32_t> samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  size_t rank = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+static double mean(const std::vector<uint32_t>& samples) {
+  double sum = 0.0;
+  for (uint32_t s : samples) {
+    sum += s;
+  }
+  return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  int repeat = 1;
+  int warmup = -1;  // Default: until every window is full, since MEM only runs from then on
+  size_t syntheticBeats = 2000;
+  int arMethod = MEM_AR_METHOD;
+  int spectrum = SPECTRUM_METHOD;
+  int psdKernel = PSD_ActiveKernel();
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) {
+      warmup = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+      syntheticBeats = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "--ar") && i + 1 < argc) {
+      arMethod = !strcmp(argv[++i], "burg") ? MEM_AR_BURG : MEM_AR_SLIDING;
+    } else if (!strcmp(argv[i], "--spectrum") && i + 1 < argc) {
+      const char* name = argv[++i];
+      spectrum = !strcmp(name, "lomb") ? SPECTRUM_LOMB : !strcmp(name, "sdft") ? SPECTRUM_SDFT : SPECTRUM_MEM;
+      if (!SPECTRUM_ENABLED(spectrum)) {
+        fprintf(stderr, "Spectrum %s is not compiled in (SPECTRUM_METHODS)\n", name);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--psd") && i + 1 < argc) {
+      const char* name = argv[++i];
+      psdKernel = !strcmp(name, "avx2") ? PSD_KERNEL_AVX2 : !strcmp(name, "sse") ? PSD_KERNEL_SSE : PSD_KERNEL_SCALAR;
+      if (!PSD_SelectKernel(psdKernel)) {
+        fprintf(stderr, "PSD kernel %s is not supported on this CPU\n", name);
+        return 1;
+      }
+    } else if (argv[i][0] != '-') {
+      tracePath = argv[i];
+    } else {
+      fprintf(stderr, "Usage: %s [trace.csv] [--repeat N] [--warmup N] [--synthetic N] [--ar burg|sliding] [--psd scalar|sse|avx2] [--spectrum mem|lomb|sdft]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<uint16_t> trace;
+  if (tracePath != nullptr) {
+    if (!loadTrace(tracePath, trace)) {
+      return 1;
+    }
+  } else {
+    syntheticTrace(syntheticBeats, trace);
+  }
+  if (trace.empty()) {
+    fprintf(stderr, "Trace contains no PPI samples\n");
+    return 1;
+  }
+
+  printf("Configuration: NUM_SAMPLES=%d MODEL_ORDER=%d FREQ_BINS=%d NUM_BINS=%d WINDOWS=%d AR=%s PSD=%s SPECTRUM=%s\n",
+    NUM_SAMPLES, (int)MODEL_ORDER, FREQ_BINS, NUM_BINS, HRV_NUM_WINDOWS, arMethod == MEM_AR_BURG ? "burg" : "sliding",
+    PSD_KernelName(psdKernel), spectrum == SPECTRUM_LOMB ? "lomb" : spectrum == SPECTRUM_SDFT ? "sdft" : "mem");
+  if (warmup >= 0) {
+    printf("Trace: %s, %zu beats x %d repeats (%d warm-up beats per repeat excluded)\n\n",
+      tracePath != nullptr ? tracePath : "synthetic", trace.size(), repeat, warmup);
+  } else {
+    printf("Trace: %s, %zu beats x %d repeats (beats before every window is full excluded)\n\n",
+      tracePath != nullptr ? tracePath : "synthetic", trace.size(), repeat);
+  }
+
+  Serial.muted = true;
+  std::vector<uint32_t> total;
+  Clock::duration elapsed = Clock::duration::zero();
+
+  for (int r = 0; r < repeat; r++) {
+    resetHRVParameters();
+    hrvEngine.setARMethod(arMethod);
+    hrvEngine.setSpectrumMethod(spectrum);
+    for (size_t i = 0; i < trace.size(); i++) {
+      recording = warmup >= 0 ? (int)i >= warmup : hrvEngine.allWindowsFull();
+      Clock::time_point start = Clock::now();
+      updateHRVParameters(trace[i]);
+      Clock::duration beat = Clock::now() - start;
+      if (recording) {
+        total.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(beat).count());
+        elapsed += beat;
+      }
+    }
+  }
+
+  if (total.empty()) {
+    fprintf(stderr, "No beats measured; the trace is shorter than the warm-up\n");
+    return 1;
+  }
+
+  printf("%-18s %12s %10s %10s\n", "stage", "mean ns/beat", "p50 ns", "p99 ns");
+  for (int i = 0; i < numStages; i++) {
+    printf("%-18s %12.1f %10u %10u\n", stages[i].name, mean(stages[i].samples),
+      percentile(stages[i].samples, 0.50), percentile(stages[i].samples, 0.99));
+  }
+  printf("%-18s %12.1f %10u %10u\n", "total", mean(total), percentile(total, 0.50), percentile(total, 0.99));
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  printf("\n%zu beats measured, %.0f beats/s\n", total.size(), total.size() / seconds);
+  printf("Final: MeanPPI=%.2f SDPPI=%.2f RMSSD=%u LF=%.2f HF=%.2f LF/HF=%.3f\n",
+    HRV_MeanPPI, HRV_SDPPI, HRV_RMSSD, HRV_LF, HRV_HF, HRV_LF_HF_Ratio);
+  return 0;
+}
@@ -0,0 +1,269 @@
+// Accuracy and cost of the MEM numeric policies (MEM_Float, MEM_Double, MEM_Q31).
+//
+// Replays a PPI trace through one HRVEngine per policy and compares every window's LF, HF, total
+// power and LF/HF with the float engine, beat by beat once all windows are full (mean and max
+// relative deviation). It then times the spectral stages alone (AR estimate, PSD and the three
+// band integrals) on a 1 minute and a 5 minute window of the trace for each policy, in ns per
+// window, with the model order the order rule selected.
+//
+// Usage: mem_bench [trace.csv] [--synthetic N] [--ar burg|sliding] [--iterations N]
+//                  [--psd scalar|sse|avx2] [--order fixed|fpe|aic|mdl]
+//
+// The trace is read as by hrv_bench (Current_PPI column of a capture or cleaned CSV); without one
+// the same synthetic series is used. Host timings only rank the policies relative to each other
+// on this CPU: the ESP32-S3 has a single precision FPU, emulates double in software, and
+// multiplies 32x32->64 bits in one instruction.
+
+#include "../src/core/Parameters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Load the Current_PPI column from a raw serial capture or a cleaned CSV
+static bool loadTrace(const char* path, std::vector<uint16_t>& trace) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  int column = 2;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.rfind("START,", 0) == 0) {
+      if (line.size() < 10 || line.compare(line.size() - 4, 4, ",END") != 0) {
+        continue;  // Truncated record
+      }
+      line = line.substr(6, line.size() - 10);
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+      fields.push_back(field);
+    }
+    auto named = std::find(fields.begin(), fields.end(), "Current_PPI");
+    if (named != fields.end()) {
+      column = named - fields.begin();
+      continue;
+    }
+    if ((int)fields.size() <= column) {
+      continue;
+    }
+    char* end = nullptr;
+    long ppi = strtol(fields[column].c_str(), &end, 10);
+    if (end != fields[column].c_str() && ppi > 0 && ppi <= UINT16_MAX) {
+      trace.push_back((uint16_t)ppi);
+    }
+  }
+  return true;
+}
+
+// Deterministic PPI series: ~70 bpm with 0.1 Hz (LF) and 0.25 Hz (HF) modulation plus noise
+static void syntheticTrace(size_t beats, std::vector<uint16_t>& trace) {
+  uint32_t seed = 12345;
+  float t = 0.0f;
+  for (size_t i = 0; i < beats; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    float noise = ((seed >> 8) / float(1 << 24) - 0.5f) * 30.0f;
+    float ppi = 850.0f + 40.0f * sinf(2.0f * M_PI * 0.1f * t) + 25.0f * sinf(2.0f * M_PI * 0.25f * t) + noise;
+    trace.push_back((uint16_t)ppi);
+    t += ppi / 1000.0f;
+  }
+}
+
+template <typename Numeric>
+using BenchEngine = HRVEngine<NUM_SAMPLES, FREQ_BINS, MODEL_ORDER, Numeric>;
+
+struct Deviation {
+  double sum = 0.0;
+  double max = 0.0;
+  size_t count = 0;
+
+  void add(float value, float reference) {
+    double d = fabs(value - reference) / fmax(fabs(reference), 1e-3);
+    sum += d;
+    max = fmax(max, d);
+    count++;
+  }
+};
+
+// Deviations of LF, HF, total power and LF/HF from the float engine
+struct Accuracy {
+  Deviation lf, hf, total, ratio;
+
+  void add(const HRV_Metrics& m, const HRV_Metrics& reference) {
+    lf.add(m.lf, reference.lf);
+    hf.add(m.hf, reference.hf);
+    total.add(m.total_power, reference.total_power);
+    ratio.add(m.lf_hf_ratio, reference.lf_hf_ratio);
+  }
+};
+
+static void printAccuracy(const char* name, const Accuracy& a) {
+  auto cell = [](const Deviation& d) {
+    static char text[4][32];
+    static int next = 0;
+    char* out = text[next++ % 4];
+    snprintf(out, 32, "%.1e / %.1e", d.count ? d.sum / d.count : 0.0, d.max);
+    return out;
+  };
+  printf("%-8s %-20s %-20s %-20s %-20s\n", name, cell(a.lf), cell(a.hf), cell(a.total), cell(a.ratio));
+}
+
+static void accuracy(const std::vector<uint16_t>& trace, uint8_t method, uint8_t rule) {
+  static BenchEngine<MEM_Float> single;
+  static BenchEngine<MEM_Double> wide;
+  static BenchEngine<MEM_Q31> fixed;
+  single.setARMethod(method);
+  wide.setARMethod(method);
+  fixed.setARMethod(method);
+  single.setOrderRule(rule);
+  wide.setOrderRule(rule);
+  fixed.setOrderRule(rule);
+
+  Accuracy wideError, fixedError;
+  for (uint16_t ppi : trace) {
+    single.push(ppi);
+    wide.push(ppi);
+    fixed.push(ppi);
+    if (!single.allWindowsFull()) {
+      continue;
+    }
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      wideError.add(wide.snapshot().window[i], single.snapshot().window[i]);
+      fixedError.add(fixed.snapshot().window[i], single.snapshot().window[i]);
+    }
+  }
+  if (wideError.lf.count == 0) {
+    printf("Trace too short: the windows never filled\n\n");
+    return;
+  }
+
+  printf("Relative deviation from float, mean / max over %zu window results\n", wideError.lf.count);
+  printf("%-8s %-20s %-20s %-20s %-20s\n", "numeric", "LF", "HF", "total", "LF/HF");
+  printAccuracy("double", wideError);
+  printAccuracy("q31", fixedError);
+  printf("\n");
+}
+
+// ns per window of the spectral stages for the newest count tachogram samples of the trace
+template <typename Numeric>
+static double timeWindow(const HRVTachogram& tacho, uint16_t count, uint8_t method, uint8_t rule, int iterations,
+                         float* lfhf, uint16_t* order) {
+  static MEM_ContextT<MODEL_ORDER, FREQ_BINS, Numeric> ctx;
+  static MEM_WorkspaceT<Numeric> work;
+  const TachoHistory& history = tacho.history();
+  MEM_Init(&ctx);
+  ctx.ar_method = method;
+  ctx.order_rule = rule;
+  uint16_t first = history.size() - count;
+  for (uint16_t n = 1; n <= count; n++) {
+    MEM_AddNewest(&ctx, TachoWindow{ &history, first, n });
+  }
+
+  TachoWindow window = { &history, first, count };
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    ProcessWindow(&ctx, window, true, &work);
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+  *lfhf = ctx.LF_HF_Ratio;
+  *order = ctx.model_order;
+  return ns;
+}
+
+static void cost(const std::vector<uint16_t>& trace, uint8_t method, uint8_t rule, int iterations) {
+  static HRVTachogram tacho;
+  for (uint16_t ppi : trace) {
+    tacho.push(ppi);
+  }
+
+  printf("Spectral stages, ns per window (LF/HF, model order)\n");
+  printf("%-8s %-26s %-26s\n", "numeric", "1 min", "5 min");
+  const uint16_t sizes[2] = { 60 * TACHO_RATE_HZ, 300 * TACHO_RATE_HZ };
+  for (int policy = 0; policy < 3; policy++) {
+    printf("%-8s", policy == 0 ? MEM_Float::name : policy == 1 ? MEM_Double::name : MEM_Q31::name);
+    for (uint16_t count : sizes) {
+      if (count > tacho.history().size()) {
+        printf(" %-26s", "(trace too short)");
+        continue;
+      }
+      float lfhf = 0.0f;
+      uint16_t order = 0;
+      double ns = policy == 0 ? timeWindow<MEM_Float>(tacho, count, method, rule, iterations, &lfhf, &order)
+                : policy == 1 ? timeWindow<MEM_Double>(tacho, count, method, rule, iterations, &lfhf, &order)
+                              : timeWindow<MEM_Q31>(tacho, count, method, rule, iterations, &lfhf, &order);
+      char cell[40];
+      snprintf(cell, sizeof(cell), "%9.0f (%.3f, %u)", ns, lfhf, order);
+      printf(" %-26s", cell);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  size_t syntheticBeats = 2000;
+  int arMethod = MEM_AR_METHOD;
+  int orderRule = MEM_ORDER_RULE;
+  int iterations = 2000;
+  const char* ruleNames[4] = { "fixed", "fpe", "aic", "mdl" };
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+      syntheticBeats = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "--ar") && i + 1 < argc) {
+      arMethod = !strcmp(argv[++i], "burg") ? MEM_AR_BURG : MEM_AR_SLIDING;
+    } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+      iterations = MAX(1, iterations);
+    } else if (!strcmp(argv[i], "--psd") && i + 1 < argc) {
+      const char* name = argv[++i];
+      int kernel = !strcmp(name, "avx2") ? PSD_KERNEL_AVX2 : !strcmp(name, "sse") ? PSD_KERNEL_SSE : PSD_KERNEL_SCALAR;
+      if (!PSD_SelectKernel(kernel)) {
+        fprintf(stderr, "PSD kernel %s is not supported on this CPU\n", name);
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--order") && i + 1 < argc) {
+      const char* name = argv[++i];
+      orderRule = !strcmp(name, "fpe") ? MEM_ORDER_FPE : !strcmp(name, "aic") ? MEM_ORDER_AIC
+                : !strcmp(name, "mdl") ? MEM_ORDER_MDL : MEM_ORDER_FIXED;
+    } else if (argv[i][0] != '-') {
+      tracePath = argv[i];
+    } else {
+      fprintf(stderr, "Usage: %s [trace.csv] [--synthetic N] [--ar burg|sliding] [--iterations N] [--psd scalar|sse|avx2] [--order fixed|fpe|aic|mdl]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<uint16_t> trace;
+  if (tracePath != nullptr) {
+    if (!loadTrace(tracePath, trace)) {
+      return 1;
+    }
+  } else {
+    syntheticTrace(syntheticBeats, trace);
+  }
+  if (trace.empty()) {
+    fprintf(stderr, "Trace contains no PPI samples\n");
+    return 1;
+  }
+
+  printf("Configuration: MODEL_ORDER=%d FREQ_BINS=%d AR=%s PSD=%s ORDER=%s\n", (int)MODEL_ORDER, FREQ_BINS,
+    arMethod == MEM_AR_BURG ? "burg" : "sliding", PSD_KernelName(PSD_ActiveKernel()), ruleNames[orderRule]);
+  printf("Trace: %s, %zu beats\n\n", tracePath != nullptr ? tracePath : "synthetic", trace.size());
+
+  accuracy(trace, arMethod, orderRule);
+  cost(trace, arMethod, orderRule, arMethod == MEM_AR_BURG ? MAX(1, iterations / 10) : iterations);
+  return 0;
+}
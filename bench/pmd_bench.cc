@@ -0,0 +1,99 @@
+// Throughput benchmark for the PMD delta-frame decoder (PMD_DecodeDeltaFrames).
+//
+// Decodes MTU-sized PPG frames (four 22 bit channels) with several delta sizes and reports
+// samples/s, next to a bit-by-bit decoder that unpacks deltas the way the PPG callback used to.
+//
+// Usage: pmd_bench [--frames N]
+
+#include "../src/core/PolarBLEConnection.h"
+
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static uint32_t seed = 1;
+
+static uint32_t random32() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+// Payload (after the PMD header) of one PPG frame filled with deltaBits bit deltas
+static std::vector<uint8_t> makeFrame(uint8_t deltaBits) {
+  std::vector<uint8_t> data;
+  for (int i = 0; i < PPG_CHANNELS * PPG_REF_BYTES; i++) {
+    data.push_back(random32());
+  }
+  uint16_t count = (MTU - PMD_HEADER_SIZE - data.size() - 2) * 8 / (PPG_CHANNELS * deltaBits);
+  count = MIN(count, 255);
+  data.push_back(deltaBits);
+  data.push_back(count);
+  for (uint32_t i = 0; i < (uint32_t)(count * PPG_CHANNELS * deltaBits + 7) / 8; i++) {
+    data.push_back(random32());
+  }
+  return data;
+}
+
+// One bit at a time, as the decoder this replaced
+static uint16_t bitwiseDecode(const uint8_t* data, uint16_t length, int32_t* out, uint16_t maxSamples) {
+  const uint8_t refSize = PPG_CHANNELS * PPG_REF_BYTES;
+  for (int c = 0; c < PPG_CHANNELS; c++) {
+    uint32_t value = data[c * 3] | (data[c * 3 + 1] << 8) | ((uint32_t)data[c * 3 + 2] << 16);
+    out[c] = (int32_t)(value << 8) >> 8;
+  }
+  uint8_t frameSize = data[refSize];
+  uint16_t count = MIN(data[refSize + 1], maxSamples - 1);
+  const uint8_t* deltas = data + refSize + 2;
+  uint32_t bitIndex = 0;
+  for (int sample = 1; sample <= count; sample++) {
+    for (int c = 0; c < PPG_CHANNELS; c++) {
+      int32_t delta = 0;
+      for (int bit = 0; bit < frameSize; bit++, bitIndex++) {
+        delta |= ((deltas[bitIndex / 8] >> (bitIndex % 8)) & 0x01) << bit;
+      }
+      if (delta & (1u << (frameSize - 1))) {
+        delta -= (int32_t)(1u << frameSize);
+      }
+      out[sample * PPG_CHANNELS + c] = out[(sample - 1) * PPG_CHANNELS + c] + delta;
+    }
+  }
+  return count + 1;
+}
+
+template <typename Decode>
+static double samplesPerSecond(const std::vector<uint8_t>& frame, int frames, Decode decode, int32_t* checksum) {
+  static int32_t out[PPG_MAX_SAMPLES * PPG_CHANNELS];
+  uint64_t samples = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < frames; i++) {
+    samples += decode(frame.data(), (uint16_t)frame.size(), out, PPG_MAX_SAMPLES);
+    *checksum += out[(i * 7) % PPG_CHANNELS];
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return samples / seconds;
+}
+
+int main(int argc, char** argv) {
+  int frames = 200000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    }
+  }
+
+  printf("%-12s %8s %16s %16s %8s\n", "delta bits", "samples", "word samples/s", "bit samples/s", "speedup");
+  int32_t checksum = 0;
+  for (uint8_t bits : { 4, 8, 12, 16, 22 }) {
+    std::vector<uint8_t> frame = makeFrame(bits);
+    double word = samplesPerSecond(frame, frames, [](const uint8_t* data, uint16_t length, int32_t* out, uint16_t max) {
+      return PMD_DecodeDeltaFrames(data, length, PPG_CHANNELS, PPG_REF_BYTES, out, max);
+    }, &checksum);
+    double bitwise = samplesPerSecond(frame, frames, bitwiseDecode, &checksum);
+    printf("%-12u %8u %16.0f %16.0f %7.1fx\n", bits, frame[PPG_CHANNELS * PPG_REF_BYTES + 1] + 1, word, bitwise, word / bitwise);
+  }
+  printf("(checksum %d)\n", checksum);
+  return 0;
+}
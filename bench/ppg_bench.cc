@@ -0,0 +1,156 @@
+// Per-sample latency benchmark for the PPG beat detector (PPGBeatDetector).
+//
+// Replays a recorded PPG trace through the detector as ComputeTask does and reports the cost
+// per sample (mean, p50, p99, max ns), samples/s and the beats found. Without a trace a
+// synthetic 176 Hz PPG with known beat times is used, and the detected PPIs are also compared
+// with the true intervals.
+//
+// Usage: ppg_bench [ppg.csv] [--seconds N] [--column N]
+//
+// The trace is the CSV printed by processPpgData() (time,green,red,infrared,ambient); the green
+// column is replayed unless --column selects another.
+
+#include "../src/core/PPGBeatDetector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Load one column of a PPG capture
+static bool loadTrace(const char* path, int column, std::vector<int32_t>& trace) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    std::string field;
+    for (int i = 0; i <= column && std::getline(ss, field, ','); i++) {
+    }
+    char* end = nullptr;
+    double value = strtod(field.c_str(), &end);
+    if (end != field.c_str()) {
+      trace.push_back((int32_t)value);
+    }
+  }
+  return true;
+}
+
+// Inverted PPG of beats at known onsets (~75 bpm with LF and HF modulation), on a drifting
+// baseline with noise
+static void syntheticTrace(double seconds, std::vector<int32_t>& trace, std::vector<double>& onsets) {
+  uint32_t seed = 12345;
+  auto noise = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return ((seed >> 8) / double(1 << 24) - 0.5) * 20.0;
+  };
+  for (double t = 0.3; t < seconds + 2.0;) {
+    onsets.push_back(t);
+    t += 0.8 + 0.06 * sin(2.0 * M_PI * 0.1 * t) + 0.03 * sin(2.0 * M_PI * 0.25 * t) + noise() / 1000.0;
+  }
+
+  size_t first = 0;
+  for (uint32_t n = 0; n < seconds * PPG_SAMPLE_RATE; n++) {
+    double t = n / (double)PPG_SAMPLE_RATE;
+    while (first < onsets.size() && onsets[first] < t - 1.0) {
+      first++;
+    }
+    double pulse = 0.0;
+    for (size_t k = first; k < onsets.size() && onsets[k] < t + 0.5; k++) {
+      double dt = t - onsets[k];
+      pulse += exp(-pow(dt - 0.15, 2) / (2 * 0.045 * 0.045)) + 0.35 * exp(-pow(dt - 0.40, 2) / (2 * 0.07 * 0.07));
+    }
+    trace.push_back((int32_t)(1000000.0 - 4000.0 * pulse + 1500.0 * sin(2.0 * M_PI * 0.15 * t) + noise()));
+  }
+}
+
+static uint32_t percentile(std::vector<uint32_t> samples, double p) {
+  size_t rank = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  double seconds = 600.0;
+  int column = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--column") && i + 1 < argc) {
+      column = atoi(argv[++i]);
+    } else if (argv[i][0] != '-') {
+      tracePath = argv[i];
+    } else {
+      fprintf(stderr, "Usage: %s [ppg.csv] [--seconds N] [--column N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<int32_t> trace;
+  std::vector<double> onsets;
+  if (tracePath != nullptr) {
+    if (!loadTrace(tracePath, column, trace)) {
+      return 1;
+    }
+  } else {
+    syntheticTrace(seconds, trace, onsets);
+  }
+  if (trace.empty()) {
+    fprintf(stderr, "Trace contains no PPG samples\n");
+    return 1;
+  }
+
+  PPGBeatDetector detector;
+  std::vector<uint32_t> ns(trace.size());
+  std::vector<float> ppis;
+  Clock::time_point start = Clock::now();
+  for (size_t n = 0; n < trace.size(); n++) {
+    Clock::time_point before = Clock::now();
+    bool beat = detector.push(trace[n]);
+    ns[n] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count();
+    if (beat) {
+      ppis.push_back(detector.ppi());
+    }
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  double sum = 0.0;
+  for (uint32_t s : ns) {
+    sum += s;
+  }
+  printf("%zu samples (%.0f s at %d Hz), %u beats, %zu PPIs\n", trace.size(), trace.size() / (double)PPG_SAMPLE_RATE,
+    PPG_SAMPLE_RATE, detector.getBeats(), ppis.size());
+  printf("ns/sample: mean %.1f, p50 %u, p99 %u, max %u\n", sum / ns.size(), percentile(ns, 0.5), percentile(ns, 0.99),
+    *std::max_element(ns.begin(), ns.end()));
+  printf("%.0f samples/s (including timer overhead)\n", trace.size() / elapsed);
+
+  if (!onsets.empty() && ppis.size() > 20) {
+    // Match the detected PPIs to the true intervals, skipping the first ones while the filters settle
+    const size_t skip = 10;
+    double best = 1e9, worst = 0.0;
+    for (size_t shift = 0; shift < 20; shift++) {
+      double total = 0.0, maxError = 0.0;
+      size_t count = 0;
+      for (size_t i = skip; i < ppis.size() && i + shift < onsets.size(); i++, count++) {
+        double error = fabs(ppis[i] - 1000.0 * (onsets[i + shift] - onsets[i + shift - 1]));
+        total += error;
+        maxError = std::max(maxError, error);
+      }
+      if (count > 0 && total / count < best) {
+        best = total / count;
+        worst = maxError;
+      }
+    }
+    printf("PPI error vs true intervals: mean %.2f ms, max %.2f ms (sample period %.2f ms)\n", best, worst,
+      1000.0 / PPG_SAMPLE_RATE);
+  }
+  return 0;
+}
@@ -0,0 +1,228 @@
+// The alternative spectral estimators (Lomb-Scargle, sliding DFT) against MEM: band powers and
+// cost per beat.
+//
+// Replays a PPI trace through an HRVEngine with each estimator and compares every window's LF, HF,
+// total power and LF/HF with the MEM engine once all windows are full (mean and max relative
+// deviation). The synthetic trace has known band powers, 800 ms² at 0.1 Hz and 312 ms² at 0.25 Hz
+// plus the noise, which the longest window of each estimator is printed against. It then times
+// push() per beat for each estimator over the same trace (mean, p50 and p99 in ns), which includes
+// every other stage of the engine.
+//
+// Usage: spectrum_bench [trace.csv] [--synthetic N] [--ar burg|sliding] [--repeat N]
+//
+// The trace is read as by hrv_bench (Current_PPI column of a capture or cleaned CSV). Host timings
+// only rank the estimators relative to each other on this CPU.
+
+#include "../src/core/Parameters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Load the Current_PPI column from a raw serial capture or a cleaned CSV
+static bool loadTrace(const char* path, std::vector<uint16_t>& trace) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  int column = 2;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.rfind("START,", 0) == 0) {
+      if (line.size() < 10 || line.compare(line.size() - 4, 4, ",END") != 0) {
+        continue;  // Truncated record
+      }
+      line = line.substr(6, line.size() - 10);
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+      fields.push_back(field);
+    }
+    auto named = std::find(fields.begin(), fields.end(), "Current_PPI");
+    if (named != fields.end()) {
+      column = named - fields.begin();
+      continue;
+    }
+    if ((int)fields.size() <= column) {
+      continue;
+    }
+    char* end = nullptr;
+    long ppi = strtol(fields[column].c_str(), &end, 10);
+    if (end != fields[column].c_str() && ppi > 0 && ppi <= UINT16_MAX) {
+      trace.push_back((uint16_t)ppi);
+    }
+  }
+  return true;
+}
+
+// Deterministic PPI series: ~70 bpm with 0.1 Hz (LF) and 0.25 Hz (HF) modulation plus noise
+static void syntheticTrace(size_t beats, std::vector<uint16_t>& trace) {
+  uint32_t seed = 12345;
+  float t = 0.0f;
+  for (size_t i = 0; i < beats; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    float noise = ((seed >> 8) / float(1 << 24) - 0.5f) * 30.0f;
+    float ppi = 850.0f + 40.0f * sinf(2.0f * M_PI * 0.1f * t) + 25.0f * sinf(2.0f * M_PI * 0.25f * t) + noise;
+    trace.push_back((uint16_t)ppi);
+    t += ppi / 1000.0f;
+  }
+}
+
+struct Deviation {
+  double sum = 0.0;
+  double max = 0.0;
+  size_t count = 0;
+
+  void add(float value, float reference) {
+    double d = fabs(value - reference) / fmax(fabs(reference), 1e-3);
+    sum += d;
+    max = fmax(max, d);
+    count++;
+  }
+};
+
+static const char* cell(const Deviation& d) {
+  static char text[4][32];
+  static int next = 0;
+  char* out = text[next++ % 4];
+  snprintf(out, 32, "%.1e / %.1e", d.count ? d.sum / d.count : 0.0, d.max);
+  return out;
+}
+
+// Deviations of LF, HF, total power and LF/HF from the MEM engine
+struct Accuracy {
+  Deviation lf, hf, total, ratio;
+
+  void add(const HRV_Metrics& m, const HRV_Metrics& reference) {
+    lf.add(m.lf, reference.lf);
+    hf.add(m.hf, reference.hf);
+    total.add(m.total_power, reference.total_power);
+    ratio.add(m.lf_hf_ratio, reference.lf_hf_ratio);
+  }
+};
+
+static void accuracy(const std::vector<uint16_t>& trace, uint8_t method, bool synthetic) {
+  static DefaultHRVEngine mem, lomb, dft;
+  mem.setARMethod(method);
+  lomb.setSpectrumMethod(SPECTRUM_LOMB);
+  dft.setSpectrumMethod(SPECTRUM_SDFT);
+
+  Accuracy lombError, dftError;
+  for (uint16_t ppi : trace) {
+    mem.push(ppi);
+    lomb.push(ppi);
+    dft.push(ppi);
+    if (!mem.allWindowsFull()) {
+      continue;
+    }
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      lombError.add(lomb.snapshot().window[i], mem.snapshot().window[i]);
+      dftError.add(dft.snapshot().window[i], mem.snapshot().window[i]);
+    }
+  }
+  if (lombError.lf.count == 0) {
+    printf("Trace too short: the windows never filled\n\n");
+    return;
+  }
+
+  printf("Relative deviation from MEM, mean / max over %zu window results\n", lombError.lf.count);
+  printf("%-14s %-20s %-20s %-20s %-20s\n", "spectrum", "LF", "HF", "total", "LF/HF");
+  printf("%-14s %-20s %-20s %-20s %-20s\n", "Lomb-Scargle", cell(lombError.lf), cell(lombError.hf),
+    cell(lombError.total), cell(lombError.ratio));
+  printf("%-14s %-20s %-20s %-20s %-20s\n\n", "sliding DFT", cell(dftError.lf), cell(dftError.hf),
+    cell(dftError.total), cell(dftError.ratio));
+
+  const HRV_Metrics& a = mem.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& b = lomb.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& c = dft.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("Longest window (%u beats)%s\n", a.ppi_count, synthetic ? ", synthetic truth LF 800, HF 312 ms² plus noise" : "");
+  printf("%-14s LF %8.1f  HF %8.1f  LF/HF %.3f\n", "MEM", a.lf, a.hf, a.lf_hf_ratio);
+  printf("%-14s LF %8.1f  HF %8.1f  LF/HF %.3f\n", "Lomb-Scargle", b.lf, b.hf, b.lf_hf_ratio);
+  printf("%-14s LF %8.1f  HF %8.1f  LF/HF %.3f\n\n", "sliding DFT", c.lf, c.hf, c.lf_hf_ratio);
+}
+
+// ns per push() over the trace, repeated, with the engine reset between passes
+static void timePush(const char* name, const std::vector<uint16_t>& trace, uint8_t spectrum, uint8_t method,
+                     int repeat) {
+  static DefaultHRVEngine engine;
+  std::vector<double> samples;
+  samples.reserve(trace.size() * repeat);
+  for (int r = 0; r < repeat; r++) {
+    engine.reset();
+    engine.setARMethod(method);
+    engine.setSpectrumMethod(spectrum);
+    for (uint16_t ppi : trace) {
+      Clock::time_point start = Clock::now();
+      engine.push(ppi);
+      samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+  }
+  double sum = 0.0;
+  for (double s : samples) {
+    sum += s;
+  }
+  std::sort(samples.begin(), samples.end());
+  printf("%-20s %10.0f %10.0f %10.0f\n", name, sum / samples.size(), samples[samples.size() / 2],
+    samples[samples.size() * 99 / 100]);
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  size_t syntheticBeats = 2000;
+  int arMethod = MEM_AR_METHOD;
+  int repeat = 3;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+      syntheticBeats = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "--ar") && i + 1 < argc) {
+      arMethod = !strcmp(argv[++i], "burg") ? MEM_AR_BURG : MEM_AR_SLIDING;
+    } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+      repeat = MAX(1, repeat);
+    } else if (argv[i][0] != '-') {
+      tracePath = argv[i];
+    } else {
+      fprintf(stderr, "Usage: %s [trace.csv] [--synthetic N] [--ar burg|sliding] [--repeat N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<uint16_t> trace;
+  if (tracePath != nullptr) {
+    if (!loadTrace(tracePath, trace)) {
+      return 1;
+    }
+  } else {
+    syntheticTrace(syntheticBeats, trace);
+  }
+  if (trace.empty()) {
+    fprintf(stderr, "Trace contains no PPI samples\n");
+    return 1;
+  }
+
+  printf("Configuration: MODEL_ORDER=%d FREQ_BINS=%d LOMB_BINS=%d SDFT_BINS=%d WINDOWS=%d AR=%s\n", (int)MODEL_ORDER,
+    FREQ_BINS, LOMB_BINS, SDFT_BINS, HRV_NUM_WINDOWS, arMethod == MEM_AR_BURG ? "burg" : "sliding");
+  printf("Trace: %s, %zu beats\n\n", tracePath != nullptr ? tracePath : "synthetic", trace.size());
+
+  accuracy(trace, arMethod, tracePath == nullptr);
+
+  printf("push(), ns per beat over %d passes\n", repeat);
+  printf("%-20s %10s %10s %10s\n", "spectrum", "mean", "p50", "p99");
+  timePush(arMethod == MEM_AR_BURG ? "MEM (burg)" : "MEM (sliding)", trace, SPECTRUM_MEM, arMethod, repeat);
+  timePush("Lomb-Scargle", trace, SPECTRUM_LOMB, arMethod, repeat);
+  timePush("sliding DFT", trace, SPECTRUM_SDFT, arMethod, repeat);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+bool hostSkipDelay = false;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+unsigned long millis(void) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros(void) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(uint32_t ms) {
+  if (hostSkipDelay) {
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void neopixelWrite(uint8_t pin, uint8_t red, uint8_t green, uint8_t blue) {}
+
+String::String(int value, int base) {
+  char buf[34];
+  snprintf(buf, sizeof(buf), base == 16 ? "%x" : "%d", value);
+  assign(buf);
+}
+
+size_t HostSerial::write(const uint8_t* buffer, size_t size) {
+  if (capture != nullptr) {
+    capture->append((const char*)buffer, size);
+    return size;
+  }
+  return muted ? size : fwrite(buffer, 1, size, stdout);
+}
+
+size_t HostSerial::print(const char* s) {
+  return write((const uint8_t*)s, strlen(s));
+}
+
+size_t HostSerial::println(const char* s) {
+  return print(s) + print("\r\n");
+}
+
+size_t HostSerial::printf(const char* format, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+}
@@ -0,0 +1,82 @@
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+// Thin stand-in for the Arduino-ESP32 core so that the analysis modules in src/core
+// can be compiled and benchmarked on a Linux host. Only the subset used by the
+// firmware sources is provided; hardware calls are no-ops.
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+
+// Flash reads are plain memory reads on the host
+#define PROGMEM
+#define memcpy_P memcpy
+
+// Time since the process started
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+
+// Host only: when set, delay() and vTaskDelay() return at once so tests are not paced by the
+// firmware's waits
+extern bool hostSkipDelay;
+
+void neopixelWrite(uint8_t pin, uint8_t red, uint8_t green, uint8_t blue);
+
+// Minimal Arduino String built on std::string
+class String : public std::string {
+public:
+  String() {}
+  String(const char* s) : std::string(s) {}
+  String(const std::string& s) : std::string(s) {}
+  String(int value, int base = 10);
+
+  int indexOf(const String& needle) const {
+    size_t pos = find(needle);
+    return pos == npos ? -1 : (int)pos;
+  }
+
+  String operator+(const String& rhs) const { return String(std::string(*this) + std::string(rhs)); }
+  String operator+(const char* rhs) const { return String(std::string(*this) + rhs); }
+  friend String operator+(const char* lhs, const String& rhs) { return String(lhs + std::string(rhs)); }
+};
+
+// Serial port writes to stdout. Output can be muted so benchmarks are not I/O bound.
+class HostSerial {
+public:
+  bool muted = false;
+
+  // Host only: when set, writes are appended here instead of going to stdout
+  std::string* capture = nullptr;
+
+  // Host only: free space availableForWrite() reports, lowered by tests to model a slow port
+  int txRoom = 4096;
+
+  void begin(unsigned long baud) { (void)baud; }
+  int available(void) { return 0; }
+  String readStringUntil(char terminator) { (void)terminator; return String(); }
+
+  int availableForWrite(void) { return txRoom; }
+  size_t write(const uint8_t* buffer, size_t size);
+  size_t print(const char* s);
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t println(const char* s = "");
+  size_t println(const String& s) { return println(s.c_str()); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HostSerial Serial;
+
+#endif  // _HOST_ARDUINO_H
@@ -0,0 +1,137 @@
+#include "BLEDevice.h"
+
+#include <algorithm>
+#include <cctype>
+
+static BLEScan scan;
+static std::vector<BLEClient*> clients;
+
+BLEUUID::BLEUUID(const char* uuid) : value(uuid) {
+  std::transform(value.begin(), value.end(), value.begin(), ::toupper);
+}
+
+void BLERemoteCharacteristic::registerForNotify(notify_callback callback, bool notifications,
+                                                bool descriptorRequiresRegistration) {
+  this->callback = callback;
+}
+
+void BLERemoteCharacteristic::writeValue(uint8_t* data, size_t length, bool response) {
+  writes.push_back(std::vector<uint8_t>(data, data + length));
+}
+
+String BLERemoteCharacteristic::readValue() {
+  return String();
+}
+
+bool BLERemoteCharacteristic::deliver(const uint8_t* data, size_t length) {
+  if (!callback) {
+    return false;
+  }
+  // The BLE stack hands callbacks a mutable buffer
+  std::vector<uint8_t> copy(data, data + length);
+  callback(this, copy.data(), copy.size(), true);
+  return true;
+}
+
+BLERemoteService::~BLERemoteService() {
+  for (BLERemoteCharacteristic* c : characteristics) {
+    delete c;
+  }
+}
+
+BLERemoteCharacteristic* BLERemoteService::getCharacteristic(const BLEUUID& uuid) {
+  for (BLERemoteCharacteristic* c : characteristics) {
+    if (c->getUUID().equals(uuid)) {
+      return c;
+    }
+  }
+  characteristics.push_back(new BLERemoteCharacteristic(uuid, true, true, true));
+  return characteristics.back();
+}
+
+bool BLEClient::connect(BLEAdvertisedDevice* device) {
+  address = device->getAddress().toString();
+  connected = true;
+  if (callbacks != nullptr) {
+    callbacks->onConnect(this);
+  }
+  return true;
+}
+
+void BLEClient::disconnect() {
+  if (!connected) {
+    return;
+  }
+  connected = false;
+  if (callbacks != nullptr) {
+    callbacks->onDisconnect(this);
+  }
+}
+
+BLERemoteService* BLEClient::getService(const BLEUUID& uuid) {
+  return connected ? &service : nullptr;
+}
+
+BLEScan* BLEDevice::getScan() {
+  return &scan;
+}
+
+BLEClient* BLEDevice::createClient() {
+  clients.push_back(new BLEClient());
+  return clients.back();
+}
+
+namespace MockBLE {
+
+void reset() {
+  for (BLEClient* c : clients) {
+    delete c;
+  }
+  clients.clear();
+  scan.stop();
+  scan.callbacks = nullptr;
+}
+
+void advertise(const char* name, const char* address) {
+  if (scan.scanning && scan.callbacks != nullptr) {
+    scan.callbacks->onResult(BLEAdvertisedDevice(name, address));
+  }
+}
+
+BLEClient* client(const char* address) {
+  // The newest client wins if a device was reconnected
+  for (auto it = clients.rbegin(); it != clients.rend(); ++it) {
+    if ((*it)->isConnected() && (*it)->address == address) {
+      return *it;
+    }
+  }
+  return nullptr;
+}
+
+BLERemoteCharacteristic* characteristic(const char* address, const char* uuid) {
+  BLEClient* c = client(address);
+  if (c == nullptr) {
+    return nullptr;
+  }
+  BLEUUID wanted(uuid);
+  for (BLERemoteCharacteristic* ch : c->service.characteristics) {
+    if (ch->getUUID().equals(wanted)) {
+      return ch;
+    }
+  }
+  return nullptr;
+}
+
+bool notify(const char* address, const char* uuid, const uint8_t* data, size_t length) {
+  BLERemoteCharacteristic* ch = characteristic(address, uuid);
+  return ch != nullptr && ch->deliver(data, length);
+}
+
+void disconnect(const char* address) {
+  BLEClient* c = client(address);
+  if (c != nullptr) {
+    c->disconnect();
+  }
+}
+
+}  // namespace MockBLE
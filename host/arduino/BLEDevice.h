@@ -0,0 +1,170 @@
+#ifndef _HOST_BLE_DEVICE_H
+#define _HOST_BLE_DEVICE_H
+
+// Stand-in for the ESP32 BLE Arduino client API, backed by an in-process mock transport.
+// Only the calls made by src/core/PolarBLEConnection.cc are provided. Tests play the sensors
+// through the MockBLE functions at the bottom: advertise devices to the active scan, accept
+// connections and deliver notifications on the PMD data characteristic.
+
+#include "Arduino.h"
+
+#include <functional>
+#include <vector>
+
+class BLEUUID {
+public:
+  BLEUUID() {}
+  BLEUUID(const char* uuid);
+  bool equals(const BLEUUID& other) const { return value == other.value; }
+  String toString() const { return value; }
+
+private:
+  String value;  // Upper-case text form
+};
+
+class BLEAddress {
+public:
+  BLEAddress() {}
+  BLEAddress(const String& address) : value(address) {}
+  bool equals(const BLEAddress& other) const { return value == other.value; }
+  String toString() const { return value; }
+
+private:
+  String value;
+};
+
+class BLEAdvertisedDevice {
+public:
+  BLEAdvertisedDevice() {}
+  BLEAdvertisedDevice(const String& name, const String& address) : name(name), address(address) {}
+  String getName() const { return name; }
+  BLEAddress getAddress() const { return address; }
+  String toString() const { return "Name: " + name + ", Address: " + address.toString(); }
+
+private:
+  String name;
+  BLEAddress address;
+};
+
+class BLEAdvertisedDeviceCallbacks {
+public:
+  virtual ~BLEAdvertisedDeviceCallbacks() {}
+  virtual void onResult(BLEAdvertisedDevice advertisedDevice) = 0;
+};
+
+class BLEClient;
+
+class BLEClientCallbacks {
+public:
+  virtual ~BLEClientCallbacks() {}
+  virtual void onConnect(BLEClient* pclient) = 0;
+  virtual void onDisconnect(BLEClient* pclient) = 0;
+};
+
+class BLERemoteCharacteristic {
+public:
+  typedef std::function<void(BLERemoteCharacteristic*, uint8_t*, size_t, bool)> notify_callback;
+
+  BLERemoteCharacteristic(const BLEUUID& uuid, bool notify, bool indicate, bool read)
+    : uuid(uuid), notify(notify), indicate(indicate), read(read) {}
+
+  BLEUUID getUUID() const { return uuid; }
+  bool canNotify() const { return notify; }
+  bool canIndicate() const { return indicate; }
+  bool canRead() const { return read; }
+  void registerForNotify(notify_callback callback, bool notifications = true, bool descriptorRequiresRegistration = true);
+  void writeValue(uint8_t* data, size_t length, bool response = false);
+  String readValue();
+
+  // Mock side: commands written so far, and delivery of a notification to the registered callback
+  std::vector<std::vector<uint8_t>> writes;
+  bool deliver(const uint8_t* data, size_t length);
+
+private:
+  BLEUUID uuid;
+  bool notify;
+  bool indicate;
+  bool read;
+  notify_callback callback;
+};
+
+// Every service and characteristic asked for exists, and every characteristic can be read,
+// notified and indicated
+class BLERemoteService {
+public:
+  ~BLERemoteService();
+  BLERemoteCharacteristic* getCharacteristic(const BLEUUID& uuid);
+
+  std::vector<BLERemoteCharacteristic*> characteristics;
+};
+
+class BLEClient {
+public:
+  void setClientCallbacks(BLEClientCallbacks* callbacks) { this->callbacks = callbacks; }
+  bool connect(BLEAdvertisedDevice* device);
+  void disconnect();
+  bool isConnected() const { return connected; }
+  bool setMTU(uint16_t mtu) { this->mtu = mtu; return true; }
+  BLERemoteService* getService(const BLEUUID& uuid);
+
+  // Mock side
+  String address;
+  uint16_t mtu = 23;
+  BLERemoteService service;
+
+  // Deliver the disconnect event again, late, as the stack may after the link is gone
+  void replayDisconnect() {
+    if (callbacks != nullptr) {
+      callbacks->onDisconnect(this);
+    }
+  }
+
+private:
+  BLEClientCallbacks* callbacks = nullptr;
+  bool connected = false;
+};
+
+class BLEScan {
+public:
+  void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* callbacks) { this->callbacks = callbacks; }
+  void setInterval(uint16_t interval) {}
+  void setWindow(uint16_t window) {}
+  void setActiveScan(bool active) {}
+  void start(uint32_t duration, bool is_continue = false) { scanning = true; }
+  void stop() { scanning = false; }
+
+  // Mock side
+  bool scanning = false;
+  BLEAdvertisedDeviceCallbacks* callbacks = nullptr;
+};
+
+class BLEDevice {
+public:
+  static void init(const String& deviceName) {}
+  static BLEScan* getScan();
+  static BLEClient* createClient();
+};
+
+// Mock transport, driven by host tests
+namespace MockBLE {
+// Forget every client and stop scanning
+void reset();
+
+// Report an advertisement to the scan callbacks. Ignored unless a scan is running.
+void advertise(const char* name, const char* address);
+
+// Client connected to a device, or nullptr
+BLEClient* client(const char* address);
+
+// Characteristic of a connected device, or nullptr if the client never asked for it
+BLERemoteCharacteristic* characteristic(const char* address, const char* uuid);
+
+// Notification from a device on a characteristic. Returns false if the device is not
+// connected or nothing registered for notifications on that characteristic.
+bool notify(const char* address, const char* uuid, const uint8_t* data, size_t length);
+
+// Drop the connection to a device as if it had gone out of range
+void disconnect(const char* address);
+}  // namespace MockBLE
+
+#endif  // _HOST_BLE_DEVICE_H
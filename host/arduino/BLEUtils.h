@@ -0,0 +1,2 @@
+// Part of the host BLE stand-in, see BLEDevice.h
+#include "BLEDevice.h"
@@ -0,0 +1,10 @@
+#ifndef _HOST_ESP32_HAL_LEDC_H
+#define _HOST_ESP32_HAL_LEDC_H
+
+#include <cstdint>
+
+// PWM output is discarded on the host
+inline bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution) { return true; }
+inline bool ledcWrite(uint8_t pin, uint32_t duty) { return true; }
+
+#endif  // _HOST_ESP32_HAL_LEDC_H
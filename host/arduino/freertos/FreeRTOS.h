@@ -0,0 +1,19 @@
+#ifndef _HOST_FREERTOS_H
+#define _HOST_FREERTOS_H
+
+#include <cstdint>
+
+// FreeRTOS types and constants used by the firmware. Tasks are not scheduled on the host;
+// tests call the code the tasks run directly.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif  // _HOST_FREERTOS_H
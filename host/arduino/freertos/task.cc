@@ -0,0 +1,47 @@
+#include "task.h"
+#include "../Arduino.h"
+
+#include <thread>
+#include <chrono>
+
+static TaskHandle_t lastCreated = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  lastCreated = new HostTask();
+  lastCreated->notifications = 0;
+  if (handle != nullptr) {
+    *handle = lastCreated;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == lastCreated) {
+    lastCreated = nullptr;
+  }
+  delete task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (hostSkipDelay) {
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  task->notifications++;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  if (lastCreated == nullptr) {
+    return 0;
+  }
+  uint32_t count = lastCreated->notifications;
+  if (count > 0) {
+    lastCreated->notifications = clearOnExit ? 0 : count - 1;
+  }
+  return count;
+}
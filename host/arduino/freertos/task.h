@@ -0,0 +1,24 @@
+#ifndef _HOST_FREERTOS_TASK_H
+#define _HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// A task handle on the host only carries the task's notification count
+typedef struct HostTask {
+  uint32_t notifications;
+} *TaskHandle_t;
+
+typedef void (*TaskFunction_t)(void*);
+
+// Creates a handle but does not run the task
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+// Returns the pending notifications of the calling task without blocking. The host has no
+// current task, so this reads the handle last created.
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+
+#endif  // _HOST_FREERTOS_TASK_H
@@ -0,0 +1,208 @@
+"""Decode the binary HRV telemetry stream (see src/core/Telemetry.h) into CSV.
+
+The output has the same columns as the text records cleaned by tests/graphs.ipynb, so it can be
+loaded directly into the notebook.
+
+Usage:
+    python scripts/decode_telemetry.py capture.bin -o out/csv/cleaned_output.csv
+    python scripts/decode_telemetry.py --port /dev/ttyACM0 -o out/csv/cleaned_output.csv   # needs pyserial
+"""
+import argparse
+import sys
+
+TELEMETRY_VERSION = 7
+FLAG_KEYFRAME = 0x01
+
+# Mirrors TELEMETRY_WINDOW_SCHEMA in src/core/Telemetry.h: (column name, scale)
+WINDOW_SCHEMA = [
+    ("Mean_PPI", 100),
+    ("Median_PPI", 100),
+    ("Min_PPI", 1),
+    ("Max_PPI", 1),
+    ("SD_PPI", 100),
+    ("Prc20_PPI", 1),
+    ("Prc80_PPI", 1),
+    ("RMSSD", 1),
+    ("pPPI50", 100),
+    ("HTI", 100),
+    ("TIPPI", 1),
+    ("SD1", 100),
+    ("SD2", 100),
+    ("SD1_SD2", 1000),
+    ("Poincare_Area", 1),
+    ("Total_Power", 1),
+    ("LF", 100),
+    ("HF", 100),
+    ("LF_HF_Ratio", 1000),
+    ("DFA_Alpha1", 1000),
+    ("SampEn", 1000),
+    ("ApEn", 1000),
+]
+
+# Column suffixes of the windows after the short-term one (HRV_WINDOWS in src/utils/Constants.h)
+WINDOW_SUFFIXES = ["_1min", "_5min"]
+
+# Mirrors TELEMETRY_SCHEMA
+SCHEMA = [("Timestamp", 1), ("PPI_Count", 1), ("Current_PPI", 1)] + WINDOW_SCHEMA
+for suffix in WINDOW_SUFFIXES:
+    SCHEMA += [("PPI_Count" + suffix, 1)] + [(name + suffix, scale) for name, scale in WINDOW_SCHEMA]
+SCHEMA += [("Corrected_Beats", 1), ("Uncorrected_Beats", 1)]
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("Invalid COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def read_varints(data, count):
+    values = []
+    i = 0
+    for _ in range(count):
+        value = 0
+        shift = 0
+        while True:
+            if i >= len(data):
+                raise ValueError("Truncated record")
+            byte = data[i]
+            i += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        values.append((value >> 1) ^ -(value & 1))  # Undo zigzag
+    if i != len(data):
+        raise ValueError("Unexpected trailing bytes")
+    return values
+
+
+class Decoder:
+    def __init__(self):
+        # Delta and sequence state of each sensor session
+        self.previous = {}  # Quantized values of the last record decoded
+        self.sequence = {}
+        self.stats = {"records": 0, "crc_errors": 0, "gaps": 0, "skipped": 0}
+
+    def decode_frame(self, frame):
+        """Return (session, record as a list of floats), or None if it cannot be decoded"""
+        try:
+            payload = cobs_decode(frame)
+        except ValueError:
+            self.stats["crc_errors"] += 1
+            return None
+        if len(payload) < 7 or crc16(payload[:-2]) != int.from_bytes(payload[-2:], "little"):
+            self.stats["crc_errors"] += 1
+            return None
+
+        version, flags, session = payload[0], payload[1], payload[2]
+        sequence = int.from_bytes(payload[3:5], "little")
+        if version != TELEMETRY_VERSION:
+            self.stats["skipped"] += 1
+            return None
+
+        last = self.sequence.get(session)
+        if last is not None and sequence != (last + 1) & 0xFFFF:
+            self.stats["gaps"] += 1
+            self.previous.pop(session, None)  # Deltas are meaningless until the next keyframe
+        self.sequence[session] = sequence
+
+        try:
+            deltas = read_varints(payload[5:-2], len(SCHEMA))
+        except ValueError:
+            self.stats["crc_errors"] += 1
+            return None
+
+        if flags & FLAG_KEYFRAME:
+            values = deltas
+        elif session not in self.previous:
+            self.stats["skipped"] += 1
+            return None
+        else:
+            values = [(p + d + 2**31) % 2**32 - 2**31 for p, d in zip(self.previous[session], deltas)]
+        self.previous[session] = values
+        self.stats["records"] += 1
+        return session, [v / scale for v, (_, scale) in zip(values, SCHEMA)]
+
+    def feed(self, data, buffer):
+        """Split a byte stream on 0x00 delimiters and yield decoded records"""
+        buffer += data
+        while True:
+            end = buffer.find(b"\x00")
+            if end < 0:
+                break
+            frame = bytes(buffer[:end])
+            del buffer[:end + 1]
+            if frame:
+                record = self.decode_frame(frame)
+                if record is not None:
+                    yield record
+
+
+def format_record(session, record):
+    fields = ["%.2f" % (record[0] / 1000.0)]  # Timestamp in seconds, as in the CSV output
+    for value, (name, scale) in zip(record[1:], SCHEMA[1:]):
+        decimals = len(str(scale)) - 1
+        fields.append("%.*f" % (decimals, value))
+    fields.append("%d" % session)
+    return ",".join(fields)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary HRV telemetry into CSV")
+    parser.add_argument("input", nargs="?", help="Captured stream (default: stdin)")
+    parser.add_argument("--port", help="Read live from a serial port instead (requires pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="Output CSV (default: stdout)")
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        source = serial.Serial(args.port, args.baud, timeout=1)
+    elif args.input:
+        source = open(args.input, "rb")
+    else:
+        source = sys.stdin.buffer
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    out.write(",".join(name for name, _ in SCHEMA) + ",Session\n")
+
+    decoder = Decoder()
+    buffer = bytearray()
+    try:
+        while True:
+            data = source.read(4096)
+            if not data:
+                if args.port:
+                    continue
+                break
+            for session, record in decoder.feed(data, buffer):
+                out.write(format_record(session, record) + "\n")
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+
+    print("Decoded %(records)d records (%(crc_errors)d bad frames, %(gaps)d sequence gaps, "
+          "%(skipped)d skipped)" % decoder.stats, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,823 @@
+#ifndef _HRV_ENGINE_HPP
+#define _HRV_ENGINE_HPP
+
+#include "../utils/Constants.h"
+#include "../utils/BoundedQueue.hpp"
+#include "../utils/Histogram.hpp"
+#include "../utils/SlidingExtreme.hpp"
+#include "../utils/SlidingMedian.hpp"
+#include "../utils/SampleEntropy.hpp"
+#include "../utils/StreamingDFA.hpp"
+#include "../utils/LombScargle.hpp"
+#include "../utils/SlidingDFT.hpp"
+#include "../utils/Profile.h"
+#include "./MEM.h"
+
+#include <new>
+#include <type_traits>
+
+// Values computed for one analysis window
+typedef struct {
+  uint16_t ppi_count;   // Beats in the window
+  float mean_ppi;
+  float median_ppi;
+  uint16_t max_ppi;
+  uint16_t min_ppi;
+  float sd_ppi;
+  uint16_t prc20_ppi;
+  uint16_t prc80_ppi;
+  uint16_t rmssd;
+  float pppi50;
+  float hti;
+  uint16_t tippi;
+  float sd1;            // Poincaré plot spread across the identity line (short-term variability)
+  float sd2;            // Poincaré plot spread along the identity line (long-term variability)
+  float sd1_sd2;        // SD1 / SD2
+  float poincare_area;  // Area of the SD1 × SD2 ellipse, π · SD1 · SD2 (ms²)
+  float total_power;
+  float lf;
+  float hf;
+  float lf_hf_ratio;
+  float dfa_alpha1;     // Short-term DFA exponent, boxes of DFA_MIN_BOX to DFA_MAX_BOX beats
+  uint8_t model_order;  // AR model order behind the spectral values (0 for Lomb-Scargle and the DFT)
+  float sampen;         // Sample entropy, m = 2, r = the engine's entropy tolerance
+  float apen;           // Approximate entropy, same templates
+} HRV_Metrics;
+
+// Band of the Lomb-Scargle periodogram in Hz: the frequencies of the MEM spectrum
+struct HRV_LombBand {
+  static constexpr double low = FREQ_LOW;
+  static constexpr double high = FREQ_HIGH;
+};
+
+// Results after the latest beat, one entry per window in HRV_WINDOWS order
+typedef struct {
+  uint32_t beats;        // Beats received so far
+  uint32_t corrected;    // Beats replaced by the artifact median (beats - corrected passed unchanged)
+  uint16_t current_ppi;  // Most recent beat, after correction
+  HRV_Metrics window[HRV_NUM_WINDOWS];
+} HRV_Snapshot;
+
+// HRV analysis of one PPI stream.
+//
+// WindowSize is the beat count of the short-term window (the first entry of HRV_WINDOWS; the
+// longer windows keep their limits), Bins the number of PSD frequency bins, ModelOrder the
+// highest AR model order of the MEM path (see setOrderRule) and Numeric its arithmetic
+// (MEM_Float, MEM_Double, MEM_Q31). All state lives in the instance, so any number of engines,
+// with the same or different parameters, can run side by side. Nothing is allocated.
+//
+// Every beat first passes the artifact correction (ARTIFACT_WINDOW, ARTIFACT_TOLERANCE), so the
+// time-domain and spectral paths see the same corrected series.
+//
+// Sample and approximate entropy are counted over the windows' beats by one StreamingEntropy
+// (src/utils/SampleEntropy.hpp), whose tolerance (ENTROPY_TOLERANCE ms) is fixed so that the
+// template matches can be updated as beats enter and leave. DFA α1 comes from a StreamingDFA
+// (src/utils/StreamingDFA.hpp) whose boxes are aligned to the beat numbers, so each box's residual
+// is computed once and windows only add and retire whole boxes.
+//
+// The spectral estimates run on a 4 Hz tachogram (TACHO_RATE_HZ) resampled from the beats as they
+// arrive, shared by the windows: each window's MEM context covers the samples since its oldest
+// beat, so LF and HF are integrated over bands in Hz rather than cycles/beat. setSpectrumMethod()
+// selects the Lomb-Scargle periodogram of the beats at their own times instead (SlidingLomb,
+// src/utils/LombScargle.hpp), over the same frequencies and bands, or a Hann-windowed sliding DFT
+// of the same tachogram samples (SlidingDFT, src/utils/SlidingDFT.hpp).
+//
+// The state is laid out for locality: the per-window scalars touched by every beat come first,
+// followed by the larger rank and extreme structures and the spectral estimator, so one beat walks
+// each window front to back. Only the estimators in SPECTRUM_METHODS are compiled in, and they
+// share each window's storage. Burg's scratch space is shared by the windows of an engine.
+// An engine is not thread safe; drive each one from a single task.
+template <uint16_t WindowSize = NUM_SAMPLES, uint16_t Bins = FREQ_BINS, uint16_t ModelOrder = MODEL_ORDER,
+          typename Numeric = MEM_NUMERIC>
+class HRVEngine {
+  static_assert(WindowSize > ModelOrder, "The short-term window must hold more beats than the AR model order");
+  static_assert(WindowSize < HRV_HISTORY_SIZE, "The short-term window must fit in the PPI history");
+
+public:
+  typedef MEM_ContextT<ModelOrder, Bins, Numeric> Spectrum;
+  typedef SlidingLomb<LOMB_BINS, HRV_LombBand> Lomb;
+  typedef SlidingDFT<SDFT_BINS> DFT;
+  static_assert(std::is_trivially_destructible<Spectrum>::value && std::is_trivially_destructible<Lomb>::value &&
+                  std::is_trivially_destructible<DFT>::value,
+                "The spectral estimators share a union and are replaced without being destroyed");
+
+  // One analysis window over the shared PPI history.
+  // The window covers beats [start, end) by absolute beat number, end being the number of beats
+  // received. Every aggregate is updated incrementally as beats enter and leave, so the per-beat
+  // cost does not depend on the window length (except Burg's method, if selected). The spectral
+  // estimate follows the tachogram samples covering the same time, a few per beat.
+  struct Window {
+    uint32_t start;       // Absolute number of the oldest beat in the window
+    uint32_t next_start;  // Oldest beat once the beat being processed has been added
+    uint32_t span_ms;     // Sum of the PPIs in the window (after the current beat)
+    uint32_t max_ms;      // Duration limit in ms (0 = none)
+    uint16_t max_beats;   // Beat limit (0 = none)
+    bool full;            // The window has reached one of its limits (spectral estimates are valid)
+    uint32_t tacho_start; // Absolute number of the oldest tachogram sample in the lag sums
+    uint32_t tacho_end;   // Tachogram samples in the lag sums end here (exclusive)
+
+    uint32_t sum;             // Sum of the PPIs (exact, so no drift as beats leave)
+    uint64_t sumSquares;      // Sum of the squared PPIs
+    uint64_t sum2Diff;        // Sum of squared successive differences
+    uint32_t ppi50_count;     // Successive differences > 50 ms
+
+    FenwickHistogram<NUM_BINS, HRV_HISTORY_SIZE> hist;  // Rank-queryable histogram (median, percentiles)
+    SlidingMax<uint16_t, HRV_HISTORY_SIZE> ppiMax;      // Monotonic deques giving the exact extremes
+    SlidingMin<uint16_t, HRV_HISTORY_SIZE> ppiMin;
+    // State of the selected spectral estimator (initEstimator() switches it)
+    union {
+      Spectrum mem;           // Lag sums and spectrum, with SPECTRUM_MEM
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+      Lomb lomb;              // Periodogram sums of the beats, with SPECTRUM_LOMB
+#endif
+#if SPECTRUM_ENABLED(SPECTRUM_SDFT)
+      DFT dft;                // Bins of the tachogram samples, with SPECTRUM_SDFT
+#endif
+    };
+
+    Window() : mem() {}
+  };
+
+  HRVEngine() : correctArtifacts(true), spectrum(SPECTRUM_METHOD), arMethod(MEM_AR_METHOD), orderRule(MEM_ORDER_RULE) {
+    entropy.setTolerance(ENTROPY_TOLERANCE);
+    reset();
+  }
+
+  // Forget every beat and return all windows to their initial state
+  void reset() {
+    ppiHistory.clear();
+    ppiTotal = 0;
+    tachogram.reset();
+    artifactMedian.clear();
+    entropy.clear();
+    dfa.clear();
+
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      Window* w = &windows[i];
+      w->max_beats = i == 0 ? WindowSize : windowLimit(i).max_beats;
+      w->max_ms = windowLimit(i).max_ms;
+      w->start = 0;
+      w->next_start = 0;
+      w->span_ms = 0;
+      w->full = false;
+      w->tacho_start = 0;
+      w->tacho_end = 0;
+      w->hist.clear();
+      w->ppiMax.clear();
+      w->ppiMin.clear();
+      w->sum = 0;
+      w->sumSquares = 0;
+      w->sum2Diff = 0;
+      w->ppi50_count = 0;
+      initEstimator(w, spectrum);
+
+      HRV_Metrics& out = snap.window[i];
+      memset(&out, 0, sizeof(out));
+      out.min_ppi = UINT16_MAX;
+    }
+    snap.beats = 0;
+    snap.corrected = 0;
+    snap.current_ppi = 0;
+  }
+
+  // Add one beat and update every window
+  void push(uint16_t beat) {
+    HRV_PROFILE_BEGIN();
+    uint16_t measurement = correctArtifact(beat);
+    HRV_PROFILE_MARK("artifacts");
+    ppiHistory.enqueue(measurement);
+    ppiTotal++;
+    tachogram.push(measurement);
+    entropy.push(measurement);
+    dfa.push(measurement);
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateWindowBounds(i, measurement);
+    }
+    HRV_PROFILE_MARK("queue");
+
+    // Each stage runs over every window before the next, so the profile marks cover all windows
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHistogram(i, measurement);
+    }
+    HRV_PROFILE_MARK("histogram");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHRV_MaxPPI(i, measurement);
+      updateHRV_MinPPI(i, measurement);
+    }
+    HRV_PROFILE_MARK("min_max");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHRV_SDPPI_Mean(i, measurement);
+    }
+    HRV_PROFILE_MARK("mean_sd");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHRV_MedianPPI(i);
+      updateHRV_Prc20PPI(i);
+      updateHRV_Prc80PPI(i);
+    }
+    HRV_PROFILE_MARK("percentiles");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHRV_RMSSD(i, measurement);
+      updateHRV_pPPI50(i, measurement);
+      updateHRV_Poincare(i, measurement);
+    }
+    HRV_PROFILE_MARK("successive_diff");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      updateHRV_HTI(i, measurement);
+      updateHRV_TIPPI(i);
+    }
+    HRV_PROFILE_MARK("geometric");
+    updateHRV_Entropy();
+    HRV_PROFILE_MARK("entropy");
+    updateHRV_DFA();
+    HRV_PROFILE_MARK("dfa");
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+      if (spectrum == SPECTRUM_LOMB) {
+        updateLomb_Parameters(i, measurement);
+        continue;
+      }
+#endif
+#if SPECTRUM_ENABLED(SPECTRUM_SDFT)
+      if (spectrum == SPECTRUM_SDFT) {
+        updateDFT_Parameters(i);
+        continue;
+      }
+#endif
+      updateMEM_Parameters(i);
+    }
+
+    // The retired beats are gone from every aggregate
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      windows[i].start = windows[i].next_start;
+    }
+    snap.beats = ppiTotal;
+    snap.current_ppi = measurement;
+  }
+
+  // Results after the latest beat
+  const HRV_Snapshot& snapshot() const {
+    return snap;
+  }
+
+  const Window& window(int i) const {
+    return windows[i];
+  }
+
+  // Uniform tachogram the spectral estimates run on
+  const HRVTachogram& tacho() const {
+    return tachogram;
+  }
+
+  // Every window has reached its limit, so all spectral values are valid
+  bool allWindowsFull() const {
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      if (!windows[i].full) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Replace beats too far from the running median (on by default). Beats already received keep
+  // their correction.
+  void setArtifactCorrection(bool enabled) {
+    correctArtifacts = enabled;
+  }
+
+  // AR estimator of every window, MEM_AR_BURG or MEM_AR_SLIDING. Kept while another spectral
+  // estimator is selected.
+  void setARMethod(uint8_t method) {
+    arMethod = method;
+    for (int i = 0; spectrum == SPECTRUM_MEM && i < HRV_NUM_WINDOWS; i++) {
+      windows[i].mem.ar_method = method;
+    }
+  }
+
+  // Spectral estimator of every window, SPECTRUM_MEM, SPECTRUM_LOMB or SPECTRUM_SDFT. Only the
+  // selected one exists, so its sums are rebuilt from the beats and samples still in the windows;
+  // the spectral values follow from the next beat. Returns false, keeping the
+  // current estimator, if the method is not compiled in (SPECTRUM_METHODS).
+  bool setSpectrumMethod(uint8_t method) {
+    if (method > SPECTRUM_SDFT || !SPECTRUM_ENABLED(method)) {
+      return false;
+    }
+    if (method == spectrum) {
+      return true;
+    }
+    spectrum = method;
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      Window* w = &windows[i];
+      initEstimator(w, method);
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+      if (method == SPECTRUM_LOMB) {
+        uint32_t time = tachogram.now();
+        for (uint32_t b = ppiTotal; b-- > w->start;) {
+          w->lomb.add(time, historyBeat(b));
+          time -= historyBeat(b);
+        }
+        continue;
+      }
+#endif
+      // The update adds every stored sample of the window to the empty sums
+      w->tacho_start = w->tacho_end = 0;
+    }
+    return true;
+  }
+
+  uint8_t spectrumMethod() const {
+    return spectrum;
+  }
+
+  // AR model order selection of every window, MEM_ORDER_FIXED (ModelOrder) or a criterion
+  // choosing up to ModelOrder: MEM_ORDER_FPE, MEM_ORDER_AIC or MEM_ORDER_MDL. Kept while another
+  // spectral estimator is selected.
+  void setOrderRule(uint8_t rule) {
+    orderRule = rule;
+    for (int i = 0; spectrum == SPECTRUM_MEM && i < HRV_NUM_WINDOWS; i++) {
+      windows[i].mem.order_rule = rule;
+    }
+  }
+
+  // Tolerance r of the sample and approximate entropy in ms. The template matches of the beats
+  // still in the windows are recounted with it.
+  void setEntropyTolerance(uint16_t r) {
+    entropy.setTolerance(r);
+    uint32_t first = ppiTotal;
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      first = MIN(first, windows[i].start);
+    }
+    entropy.clear(first);
+    for (uint32_t b = first; b < ppiTotal; b++) {
+      entropy.push(historyBeat(b));
+    }
+    updateHRV_Entropy();
+  }
+
+  uint16_t entropyTolerance() const {
+    return entropy.getTolerance();
+  }
+
+  // Any percentile of a window (bin centre), 0 <= p <= 1
+  float percentilePPI(int i, float p) const {
+    // Find the bin where the cumulative count ≥ rank_p:
+    //    rank_p = ⌊ p * PPI_Count ⌋ + 1
+    // Percentile = center of that bin
+    //    p_ms = BIN_START + (p_bin + 0.5) * BIN_WIDTH
+    return BIN_TO_PPI(windows[i].hist.quantile(p));
+  }
+
+private:
+  struct Limit {
+    uint16_t max_beats;
+    uint32_t max_ms;
+  };
+
+  // Window limits from HRV_WINDOWS
+  static Limit windowLimit(int i) {
+#define HRV_WINDOW_LIMITS(suffix, beats, ms) { beats, ms },
+    static const Limit limits[HRV_NUM_WINDOWS] = {
+      HRV_WINDOWS(HRV_WINDOW_LIMITS)
+    };
+#undef HRV_WINDOW_LIMITS
+    return limits[i];
+  }
+
+  // The beat to analyze in place of the one received: the median of the previous ARTIFACT_WINDOW
+  // beats if it is more than ARTIFACT_TOLERANCE away from it. The median runs over the beats as
+  // received, so a lasting change of rate takes over the median instead of being corrected forever.
+  uint16_t correctArtifact(uint16_t beat) {
+    uint16_t corrected = beat;
+    if (correctArtifacts && artifactMedian.isFull()) {
+      float median = artifactMedian.median();
+      if (fabsf(beat - median) > ARTIFACT_TOLERANCE * median) {
+        corrected = (uint16_t)(median + 0.5f);
+        snap.corrected++;
+      }
+    }
+    artifactMedian.push(beat);
+    return corrected;
+  }
+
+  // PPI of an absolute beat number. The beat must still be in the history.
+  uint16_t historyBeat(uint32_t beat) const {
+    return ppiHistory[beat - (ppiTotal - ppiHistory.size())];
+  }
+
+  uint16_t tachoSample(uint32_t sample) const {
+    return tachogram.history()[sample - (tachogram.total() - tachogram.history().size())];
+  }
+
+  // Start the window's state for the spectral estimator over, empty. The estimators share the
+  // window's storage, so this ends the previous one. A DFT starts at the window's duration, or at
+  // four samples per beat for the short-term window until its length follows the heart rate.
+  void initEstimator(Window* w, uint8_t method) {
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+    if (method == SPECTRUM_LOMB) {
+      new (&w->lomb) Lomb();
+      return;
+    }
+#endif
+#if SPECTRUM_ENABLED(SPECTRUM_SDFT)
+    if (method == SPECTRUM_SDFT) {
+      new (&w->dft) DFT();
+      clearDFT(w, w->max_ms ? w->max_ms / TACHO_PERIOD_MS : WindowSize * TACHO_RATE_HZ);
+      return;
+    }
+#endif
+    new (&w->mem) Spectrum();
+    MEM_Init(&w->mem);
+    w->mem.ar_method = arMethod;
+    w->mem.order_rule = orderRule;
+  }
+
+#if SPECTRUM_ENABLED(SPECTRUM_SDFT)
+  // Empty the window's DFT and give it the length of length tachogram samples, with the bins up to
+  // FREQ_HIGH and one more
+  static void clearDFT(Window* w, uint32_t length) {
+    length = MAX(4u, MIN(length, (uint32_t)TACHO_HISTORY_SIZE));
+    w->dft.clear(length, (uint16_t)MIN(length * FREQ_HIGH / TACHO_RATE_HZ + 2, (double)SDFT_BINS));
+  }
+#endif
+
+  // Spectral values of a window, set the same way for every estimator: LF/HF only once both bands
+  // carry power, and no power at all while the window is not full (as ProcessWindow reports it)
+  static void setSpectralValues(HRV_Metrics& out, float total, float lf, float hf) {
+    out.total_power = total;
+    out.lf = lf;
+    out.hf = hf;
+    out.lf_hf_ratio = lf > MEM_MIN_POWER && hf > MEM_MIN_POWER ? lf / hf : 0.0f;
+  }
+
+  // Tachogram span of the samples [first, end) by absolute sample number
+  TachoWindow tachoWindow(uint32_t first, uint32_t end) const {
+    TachoWindow span;
+    span.history = &tachogram.history();
+    span.first = first - (tachogram.total() - tachogram.history().size());
+    span.count = end - first;
+    return span;
+  }
+
+  // Methods to update each HRV parameter of one window. updateWindowBounds() decides which beats
+  // leave the window; the methods taking the measurement then retire those beats ([start, next_start))
+  // from their aggregate and add the newest one, and the others read the updated aggregates.
+  void updateWindowBounds(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    const uint32_t newest = ppiTotal - 1;
+    uint32_t start = w->start;
+    uint32_t span = w->span_ms + measurement;
+
+    // Retire the oldest beats until the window fits its limits again, always keeping the newest.
+    // The history limit guarantees every beat of the previous window is still stored.
+    while (start < newest) {
+      uint32_t length = ppiTotal - start;
+      bool over = (w->max_beats > 0 && length > w->max_beats) ||
+                  (w->max_ms > 0 && span > w->max_ms) ||
+                  length > HRV_HISTORY_SIZE - 1;
+      if (!over) {
+        break;
+      }
+      span -= historyBeat(start);
+      start++;
+    }
+
+    w->next_start = start;
+    w->span_ms = span;
+    snap.window[i].ppi_count = ppiTotal - start;
+    if (start > w->start || (w->max_beats > 0 && snap.window[i].ppi_count >= w->max_beats)) {
+      w->full = true;
+    }
+  }
+
+  void updateHistogram(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+
+    // Decrement the hist bin count of each retired value
+    for (uint32_t b = w->start; b < w->next_start; b++) {
+      w->hist.remove(PPI_TO_BIN(historyBeat(b)));
+    }
+
+    // Increment the hist bin count
+    // The histogram tracks the height of its modal bin, so no rescan is needed on eviction
+    w->hist.add(PPI_TO_BIN(measurement));
+  }
+
+  void updateHRV_MedianPPI(int i) {
+    HRV_Metrics& out = snap.window[i];
+
+    // Calculate target position for median determination
+    uint32_t target = (out.ppi_count - 1) / 2;
+
+    // Find the median bin: the first bin whose cumulative count exceeds target
+    uint16_t median_bin = windows[i].hist.binAtRank(target + 1);
+
+    // Calculate and update median value
+    out.median_ppi = BIN_TO_PPI(median_bin);
+  }
+
+  void updateHRV_MaxPPI(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+
+    // Retire the old values before adding the new one so duplicates are handled exactly
+    for (uint32_t b = w->start; b < w->next_start; b++) {
+      w->ppiMax.evict(historyBeat(b));
+    }
+    w->ppiMax.push(measurement);
+    snap.window[i].max_ppi = w->ppiMax.extreme();
+  }
+
+  void updateHRV_MinPPI(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+
+    // Retire the old values before adding the new one so duplicates are handled exactly
+    for (uint32_t b = w->start; b < w->next_start; b++) {
+      w->ppiMin.evict(historyBeat(b));
+    }
+    w->ppiMin.push(measurement);
+    snap.window[i].min_ppi = w->ppiMin.extreme();
+  }
+
+  // The window sums are integers, so the mean and SD stay exact however long the window slides
+  void updateHRV_SDPPI_Mean(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+
+    for (uint32_t b = w->start; b < w->next_start; b++) {
+      uint16_t popped = historyBeat(b);
+      w->sum -= popped;
+      w->sumSquares -= (uint32_t)popped * popped;
+    }
+    w->sum += measurement;
+    w->sumSquares += (uint32_t)measurement * measurement;
+
+    // Population stddev from the sums, exact up to the final division:
+    //    n²σ² = n·Σx² − (Σx)²
+    int64_t n = out.ppi_count;
+    int64_t spread = n * (int64_t)w->sumSquares - (int64_t)w->sum * w->sum;
+    out.mean_ppi = (float)w->sum / n;
+    out.sd_ppi = sqrt((double)spread) / n;
+  }
+
+  void updateHRV_Prc20PPI(int i) {
+    snap.window[i].prc20_ppi = percentilePPI(i, 0.2f);
+  }
+
+  void updateHRV_Prc80PPI(int i) {
+    snap.window[i].prc80_ppi = percentilePPI(i, 0.8f);
+  }
+
+  void updateHRV_RMSSD(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+    const uint32_t newest = ppiTotal - 1;
+
+    // Remove the differences leaving the window: (popped, following value), if both were in it
+    for (uint32_t b = w->start; b < w->next_start && b + 1 < newest; b++) {
+      int32_t diff_old = int32_t(historyBeat(b + 1)) - int32_t(historyBeat(b));
+      w->sum2Diff -= (int64_t)diff_old * diff_old;
+    }
+
+    // A difference only exists once the window holds two values
+    if (out.ppi_count < 2) {
+      return;
+    }
+
+    // Add the difference entering the window: (second newest, newest)
+    int32_t diff = int32_t(measurement) - int32_t(historyBeat(newest - 1));
+    w->sum2Diff += (int64_t)diff * diff;
+    out.rmssd = sqrt(float(w->sum2Diff) / float(out.ppi_count - 1));
+  }
+
+  void updateHRV_pPPI50(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+    const uint32_t newest = ppiTotal - 1;
+
+    // Remove the differences leaving the window: (popped, following value), if both were in it
+    for (uint32_t b = w->start; b < w->next_start && b + 1 < newest; b++) {
+      if (abs(historyBeat(b + 1) - historyBeat(b)) > 50) {
+        w->ppi50_count--;
+      }
+    }
+
+    // A difference only exists once the window holds two values
+    if (out.ppi_count < 2) {
+      return;
+    }
+
+    // Add the difference entering the window: (second newest, newest)
+    if (abs(measurement - historyBeat(newest - 1)) > 50) {
+      w->ppi50_count++;
+    }
+    out.pppi50 = ((float)w->ppi50_count / (out.ppi_count - 1)) * 100;
+  }
+
+  // The Poincaré plot holds the p = n - 1 pairs (xₖ, xₖ₊₁) of the window's n beats. Rotated by
+  // 45°, its spreads across and along the identity line are
+  //    SD1² = Var(xₖ₊₁ - xₖ) / 2
+  //    SD2² = Var(xₖ₊₁ + xₖ) / 2 = Var(xₖ) + Var(xₖ₊₁) - SD1²
+  // and every sum they need is already kept, so the pairs cost no state of their own:
+  //    Σ (xₖ₊₁ - xₖ)² = sum2Diff,  Σ (xₖ₊₁ - xₖ) = newest - oldest
+  //    Σ xₖ, Σ xₖ² = the window sums without the newest beat, Σ xₖ₊₁, Σ xₖ₊₁² without the oldest
+  // p² times each variance is exact in 64 bits (population variances over the pairs, like SD_PPI).
+  void updateHRV_Poincare(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+    if (out.ppi_count < 2) {
+      out.sd1 = out.sd2 = out.sd1_sd2 = out.poincare_area = 0.0f;
+      return;
+    }
+
+    int64_t p = out.ppi_count - 1;
+    int64_t oldest = historyBeat(w->next_start), newest = measurement;
+    int64_t drift = newest - oldest;
+    int64_t across = p * (int64_t)w->sum2Diff - drift * drift;  // p²·Var(xₖ₊₁ - xₖ)
+    int64_t sumFirsts = w->sum - newest, sumSeconds = w->sum - oldest;
+    int64_t firsts = p * ((int64_t)w->sumSquares - newest * newest) - sumFirsts * sumFirsts;     // p²·Var(xₖ)
+    int64_t seconds = p * ((int64_t)w->sumSquares - oldest * oldest) - sumSeconds * sumSeconds;  // p²·Var(xₖ₊₁)
+
+    float scale = 1.0f / float(p * p);
+    out.sd1 = sqrtf(0.5f * float(across) * scale);
+    out.sd2 = sqrtf(float(2 * (firsts + seconds) - across) * 0.5f * scale);
+    out.sd1_sd2 = out.sd2 > 0.0f ? out.sd1 / out.sd2 : 0.0f;
+    out.poincare_area = (float)M_PI * out.sd1 * out.sd2;
+  }
+
+  void updateHRV_HTI(int i, uint16_t measurement) {
+    HRV_Metrics& out = snap.window[i];
+
+    // HTI is already based on the current histogram state
+    // which is updated by updateHistogram, so we just need to recalculate
+    // TODO: determine which measurement to use here... using most recent for now
+    out.hti = (float)out.ppi_count / windows[i].hist[PPI_TO_BIN(measurement)];
+  }
+
+  void updateHRV_TIPPI(int i) {
+    HRV_Metrics& out = snap.window[i];
+
+    // TIPPI is already based on the current histogram state and its modal bin height
+    // which are updated by updateHistogram, so we just need to recalculate
+    out.tippi = (2.0 * out.ppi_count * BIN_WIDTH) / float(windows[i].hist.maxCount());
+  }
+
+  // Runs over every window at once: the template the newest beat completed is matched against
+  // its neighbours in the template grid a single time for all of them
+  void updateHRV_Entropy() {
+    uint32_t starts[HRV_NUM_WINDOWS];
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      starts[i] = windows[i].next_start;
+    }
+    entropy.advance(starts);
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      snap.window[i].sampen = entropy.sampleEntropy(i);
+      snap.window[i].apen = entropy.approximateEntropy(i);
+    }
+  }
+
+  // Runs over every window at once, like the entropy: each box size adds the box the newest beat
+  // completed and retires the boxes that left a window
+  void updateHRV_DFA() {
+    uint32_t starts[HRV_NUM_WINDOWS];
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      starts[i] = windows[i].next_start;
+    }
+    dfa.advance(starts);
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      snap.window[i].dfa_alpha1 = dfa.alpha(i);
+    }
+  }
+
+  void updateMEM_Parameters(int i) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+    const uint32_t total = tachogram.total();
+    const uint32_t stored = total - tachogram.history().size();  // Oldest sample still stored
+
+    // The window's samples start where its oldest beat's interval began. That time only moves
+    // forward, and so does the start.
+    uint32_t start = MAX(tachogram.sampleAt(tachogram.now() - w->span_ms), w->tacho_start);
+    start = MAX(start, total - MIN(total, (uint32_t)TACHO_HISTORY_SIZE - 1));
+
+    // Keep the lag sums in step with the window. Samples overwritten before they could be
+    // retired (a very long beat) force a rebuild from the samples still stored.
+    if (w->tacho_start < stored) {
+      MEM_ClearSums(&w->mem);
+      w->tacho_start = w->tacho_end = start;
+    }
+    uint32_t retired = MIN(start, w->tacho_end);
+    for (uint32_t s = w->tacho_start; s < retired; s++) {
+      MEM_RemoveOldest(&w->mem, tachoWindow(s, w->tacho_end));
+    }
+    for (uint32_t s = MAX(w->tacho_end, start); s < total; s++) {
+      MEM_AddNewest(&w->mem, tachoWindow(start, s + 1));
+    }
+    w->tacho_start = start;
+    w->tacho_end = total;
+    HRV_PROFILE_MARK("mem.preprocess");
+
+    // The AR model needs a few samples per coefficient
+    TachoWindow span = tachoWindow(start, total);
+    ProcessWindow(&w->mem, span, w->full && span.count > 2 * ModelOrder, &workspace);
+    setSpectralValues(out, w->mem.total_power, w->mem.LF, w->mem.HF);
+    out.model_order = w->mem.model_order;
+    HRV_PROFILE_MARK("mem.bands");
+  }
+
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+  // Lomb-Scargle counterpart of updateMEM_Parameters: the window's beats enter and leave the
+  // periodogram sums at the times they occurred, Tₖ being the sum of the PPIs up to beat k
+  void updateLomb_Parameters(int i, uint16_t measurement) {
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+
+    // The oldest beat staying occurred the window's span before the newest, less its own PPI,
+    // and each beat before it one PPI earlier
+    uint32_t time = tachogram.now() - w->span_ms + historyBeat(w->next_start);
+    for (uint32_t b = w->next_start; b-- > w->start;) {
+      time -= historyBeat(b + 1);
+      w->lomb.remove(time, historyBeat(b));
+    }
+    w->lomb.add(tachogram.now(), measurement);
+    HRV_PROFILE_MARK("lomb.sums");
+
+    out.model_order = 0;
+    if (!w->full) {
+      setSpectralValues(out, 0.0f, 0.0f, 0.0f);
+      return;
+    }
+    w->lomb.compute(w->span_ms, lombSpectrum);
+    setSpectralValues(out, Lomb::integrate(lombSpectrum, FREQ_VLOW, FREQ_HIGH),
+      Lomb::integrate(lombSpectrum, FREQ_LOW, FREQ_MID), Lomb::integrate(lombSpectrum, FREQ_MID, FREQ_HIGH));
+    HRV_PROFILE_MARK("lomb.bands");
+  }
+#endif
+
+#if SPECTRUM_ENABLED(SPECTRUM_SDFT)
+  // Sliding DFT counterpart of updateMEM_Parameters over the same tachogram samples: each sample
+  // entering or leaving the window updates every bin once, and the bands are summed from the bins.
+  // The total power starts at FREQ_LOW, where the MEM spectrum and the periodogram start.
+  void updateDFT_Parameters(int i) {
+    static const SDFT_Band BANDS[3] = {
+      { MEM_CYCLES(FREQ_LOW), MEM_CYCLES(FREQ_HIGH) },
+      { MEM_CYCLES(FREQ_LOW), MEM_CYCLES(FREQ_MID) },
+      { MEM_CYCLES(FREQ_MID), MEM_CYCLES(FREQ_HIGH) },
+    };
+    Window* w = &windows[i];
+    HRV_Metrics& out = snap.window[i];
+    const uint32_t total = tachogram.total();
+    const uint32_t stored = total - tachogram.history().size();
+    uint32_t start = MAX(tachogram.sampleAt(tachogram.now() - w->span_ms), w->tacho_start);
+    start = MAX(start, total - MIN(total, (uint32_t)TACHO_HISTORY_SIZE - 1));
+
+    // The short-term window's length follows the heart rate, and its DFT length follows it once
+    // they differ by more than an eighth. That, or samples overwritten before they could be
+    // retired, rebuilds the bins from the samples still stored.
+    const uint32_t count = total - start, length = w->dft.length();
+    const bool drifted = w->max_ms == 0 && w->full && (count * 8 < length * 7 || count * 8 > length * 9);
+    if (w->tacho_start < stored || drifted) {
+      clearDFT(w, drifted ? count : length);
+      w->tacho_start = w->tacho_end = start;
+    }
+    uint32_t retired = MIN(start, w->tacho_end);
+    for (uint32_t s = w->tacho_start; s < retired; s++) {
+      w->dft.remove(s, tachoSample(s));
+    }
+    for (uint32_t s = MAX(w->tacho_end, start); s < total; s++) {
+      w->dft.add(s, tachoSample(s));
+    }
+    w->tacho_start = start;
+    w->tacho_end = total;
+    HRV_PROFILE_MARK("sdft.bins");
+
+    out.model_order = 0;
+    if (!w->full) {
+      setSpectralValues(out, 0.0f, 0.0f, 0.0f);
+      return;
+    }
+    float power[3];
+    w->dft.bandPowers(start, BANDS, 3, power);
+    setSpectralValues(out, power[0], power[1], power[2]);
+    HRV_PROFILE_MARK("sdft.bands");
+  }
+#endif
+
+  // Beats received so far, shared by every window
+  PPIHistory ppiHistory;
+  uint32_t ppiTotal;  // Absolute number of beats received (the next beat's number)
+  HRVTachogram tachogram;  // The beats resampled to TACHO_RATE_HZ
+  SlidingMedian<uint16_t, ARTIFACT_WINDOW> artifactMedian;  // Previous beats as received
+  bool correctArtifacts;
+  uint8_t spectrum;  // SPECTRUM_MEM, SPECTRUM_LOMB or SPECTRUM_SDFT
+  uint8_t arMethod;   // MEM_AR_BURG or MEM_AR_SLIDING, for the MEM contexts
+  uint8_t orderRule;  // MEM_ORDER_*, for the MEM contexts
+  StreamingEntropy<HRV_HISTORY_SIZE, HRV_NUM_WINDOWS> entropy;  // Template matches of every window
+  StreamingDFA<HRV_HISTORY_SIZE, HRV_NUM_WINDOWS, DFA_MIN_BOX, DFA_MAX_BOX> dfa;  // Box residuals of every window
+
+  Window windows[HRV_NUM_WINDOWS];    // Analysis windows, in HRV_WINDOWS order
+  HRV_Snapshot snap;                  // Their results
+  MEM_WorkspaceT<Numeric> workspace;  // Burg's prediction errors
+#if SPECTRUM_ENABLED(SPECTRUM_LOMB)
+  float lombSpectrum[LOMB_BINS];      // Periodogram of the window being updated
+#endif
+};
+
+#endif  // _HRV_ENGINE_HPP
@@ -3,17 +3,667 @@
 
 #include "../utils/Constants.h"
 #include "../utils/BoundedQueue.hpp"
-#include "../utils/exp_table.h"
+#include "../utils/ExpTable.hpp"
+#include "../utils/FixedPoint.hpp"
 #include "../utils/MEM_Types.h"
+#include "../utils/Profile.h"
+#include "./PSDKernel.h"
+
+// Frequency band over which the MEM power spectrum is evaluated (cycles/sample of the tachogram)
+struct MEM_Band {
+  static constexpr double low = FREQ_LOW / TACHO_RATE_HZ;
+  static constexpr double high = FREQ_HIGH / TACHO_RATE_HZ;
+};
+
+// Frequency in Hz as cycles/sample of the tachogram
+#define MEM_CYCLES(hz) ((float)(hz) / TACHO_RATE_HZ)
+
+// Band power below which the LF/HF ratio is reported as 0
+#define MEM_MIN_POWER 1e-8f
+
+// Fixed-point formats of the MEM_Q31 path
+#define MEM_Q31_SAMPLE_BITS 23  // Largest deviation from the mean in Burg's prediction errors
+#define MEM_Q31_LATTICE_FRAC 24 // Fraction bits of A(f) in the lattice recursion (|A| up to 64)
+
+// Complex exponentials for ComputePSD, generated at compile time for each model size
+template <uint16_t Order, uint16_t Bins>
+using MEM_ExpTableT = ExpTable<Order, Bins, MEM_Band>;
+
+typedef MEM_ExpTableT<MODEL_ORDER, FREQ_BINS> MEM_ExpTable;
 
 // Function declarations
-int compare_float(const void* a, const void* b);
-float Interpolate(float* buffer, float t);
-void MEM_Init(MEM_Context* ctx);
-void PreprocessPPI(MEM_Context* ctx, uint16_t measurement);
-void BurgsMethod(MEM_Context* ctx);
-void ComputePSD(MEM_Context* ctx);
-float IntegratePSD(const float* psd, float freq_start, float freq_end);
-void ProcessNewPPI(MEM_Context* ctx, uint16_t measurement);
+// The MEM stages are templates over the context size and numeric policy (MEM_ContextT), so
+// engines with different model orders, spectral resolutions and arithmetic can coexist. The
+// generic versions run in the policy's floating point type; MEM_Float and MEM_Q31 overload the
+// stages they implement differently. They are defined below.
+
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_Init(MEM_ContextT<Order, Bins, Numeric>* ctx);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_ClearSums(MEM_ContextT<Order, Bins, Numeric>* ctx);
+template <uint16_t Order, uint16_t Bins, typename Numeric>  // window still includes the oldest sample
+void MEM_RemoveOldest(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window);
+template <uint16_t Order, uint16_t Bins, typename Numeric>  // window already includes the newest sample
+void MEM_AddNewest(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void BurgsMethod(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window, MEM_WorkspaceT<Numeric>* work);
+template <uint16_t Order, uint16_t Bins>
+void BurgsMethod(MEM_ContextT<Order, Bins, MEM_Q31>* ctx, const TachoWindow& window, MEM_WorkspaceT<MEM_Q31>* work);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void SlidingYuleWalker(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window);
+template <uint16_t Order, uint16_t Bins>
+void SlidingYuleWalker(MEM_ContextT<Order, Bins, MEM_Q31>* ctx, const TachoWindow& window);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+float WindowVariance(const MEM_ContextT<Order, Bins, Numeric>* ctx, uint16_t count);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void ComputePSD(MEM_ContextT<Order, Bins, Numeric>* ctx);
+template <uint16_t Order, uint16_t Bins>
+void ComputePSD(MEM_ContextT<Order, Bins, MEM_Float>* ctx);
+template <uint16_t Order, uint16_t Bins>
+void ComputePSD(MEM_ContextT<Order, Bins, MEM_Q31>* ctx);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+float IntegratePSD(const MEM_ContextT<Order, Bins, Numeric>* ctx, float freq_start, float freq_end);
+template <uint16_t Order, uint16_t Bins>
+float IntegratePSD(const MEM_ContextT<Order, Bins, MEM_Q31>* ctx, float freq_start, float freq_end);
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void ProcessWindow(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window, bool full, MEM_WorkspaceT<Numeric>* work);
+
+// Sample `age` samples older than the newest one in the window (0 = newest)
+static inline int32_t SampleByAge(const TachoWindow& window, int age) {
+  return (int32_t)(*window.history)[window.first + window.count - 1 - age];
+}
+
+// 1. Initialization
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_Init(MEM_ContextT<Order, Bins, Numeric>* ctx) {
+  ctx->ar_method = MEM_AR_METHOD;
+  ctx->order_rule = MEM_ORDER_RULE;
+  ctx->model_order = Order;
+  MEM_ClearSums(ctx);
+  memset(ctx->ar_coeff, 0, sizeof(ctx->ar_coeff));
+  memset(ctx->psd, 0, sizeof(ctx->psd));
+  ctx->psd_exp = 0;
+  ctx->noise_var = 0.0f;
+}
+
+// Empty the window the lag sums cover, keeping the estimator and the last spectrum
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_ClearSums(MEM_ContextT<Order, Bins, Numeric>* ctx) {
+  ctx->window_sum = 0;
+  memset(ctx->lag_sum, 0, (Order + 1) * sizeof(int64_t));
+}
+
+// 2. Lag sum maintenance, O(Order) per tachogram sample.
+// The samples themselves live in the engine's tachogram; the context only keeps the sums
+//    Σₖ = Σ xₜ·xₜ₋ₖ
+// for the window. Tachogram samples are whole ms, so the sums are exact and never drift.
+
+// The oldest sample xₒ of the window is leaving, removing its pairs: Σₖ -= xₒ·xₒ₊ₖ
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_RemoveOldest(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window) {
+  int32_t oldest = SampleByAge(window, window.count - 1);
+  for (int k = 0; k <= Order && k < window.count; k++) {
+    ctx->lag_sum[k] -= (int64_t)oldest * SampleByAge(window, window.count - 1 - k);
+  }
+  ctx->window_sum -= oldest;
+}
+
+// The newest sample xₙ of the window has arrived, adding its pairs: Σₖ += xₙ·xₙ₋ₖ
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_AddNewest(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window) {
+  int32_t newest = SampleByAge(window, 0);
+  for (int k = 0; k <= Order && k < window.count; k++) {
+    ctx->lag_sum[k] += (int64_t)newest * SampleByAge(window, k);
+  }
+  ctx->window_sum += newest;
+}
+
+// Sample variance of the window from the lag sums: (N·Σx² - (Σx)²) / (N·(N - 1))
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+float WindowVariance(const MEM_ContextT<Order, Bins, Numeric>* ctx, uint16_t count) {
+  int64_t n = count;
+  if (n < 2) {
+    return 0.0f;
+  }
+  return (float)(n * ctx->lag_sum[0] - ctx->window_sum * ctx->window_sum) / (float)(n * (n - 1));
+}
+
+// Order selection. Stage m of each order recursion (Burg, Levinson-Durbin, Schur) scales the
+// prediction error power by 1 - kₘ², so the criteria are followed as the reflection
+// coefficients are found, without another pass over the window. For N samples and order p:
+//    FPE: N·ln(Eₚ) + N·ln((N + p + 1) / (N - p - 1))   (the logarithm of Akaike's FPE)
+//    AIC: N·ln(Eₚ) + 2p
+//    MDL: N·ln(Eₚ) + p·ln(N)
+// The recursion still runs to Order, keeping the model at the lowest criterion from
+// MEM_ORDER_MIN up; ComputePSD then evaluates only that many coefficients.
+struct MEM_OrderSelector {
+  uint8_t rule;
+  float n;
+  float log_n;
+  float log_error;   // N·ln(Eₚ / E₀) at the latest stage
+  float best_score;
+  uint16_t best;     // Selected order so far
+
+  MEM_OrderSelector(uint8_t rule, int n)
+      : rule(rule), n((float)n), log_n(logf((float)MAX(n, 1))), log_error(0.0f), best_score(0.0f), best(0) {}
+
+  // Stage m found kₘ, completing the model of order m + 1. Returns true if that model is the
+  // best so far (always, for MEM_ORDER_FIXED).
+  bool add(int m, float k) {
+    const float p = (float)(m + 1);
+    if (rule != MEM_ORDER_FIXED) {
+      log_error += n * log1pf(-fminf(k * k, 0.9999999f));
+      float penalty = rule == MEM_ORDER_FPE ? n * logf((n + p + 1.0f) / (n - p - 1.0f))
+                    : rule == MEM_ORDER_AIC ? 2.0f * p
+                                            : p * log_n;
+      float score = log_error + penalty;
+      if (p > MEM_ORDER_MIN && score >= best_score) {
+        return false;
+      }
+      best_score = score;
+    }
+    best = m + 1;
+    return true;
+  }
+};
+
+// 3. Burg's Method
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void BurgsMethod(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window, MEM_WorkspaceT<Numeric>* work) {
+  typedef typename Numeric::Error Real;
+  const int n = window.count;
+
+  // Forward/backward errors live in the workspace, reflection and AR coefficients on the stack
+  Real* f_error = work->f_error;  // Forward prediction errors
+  Real* b_error = work->b_error;  // Backward prediction errors
+  Real k[Order];       // Reflection coefficients
+  Real a[Order];       // AR coefficients
+  Real a_prev[Order];  // Previous AR coefficients
+  Real best[Order];    // AR coefficients of the selected order
+
+  // Initialize errors with the window, oldest to newest, less its mean (as the sliding
+  // estimator's autocovariance is)
+  const Real mean = n > 0 ? (Real)ctx->window_sum / n : (Real)0;
+  for (int t = 0; t < n; t++) {
+    f_error[t] = (*window.history)[window.first + t] - mean;
+  }
+  memcpy(b_error, f_error, n * sizeof(Real));
+
+  // Prediction error power, starting from the variance of the window
+  Real error = 0;
+  for (int t = 0; t < n; t++) {
+    error += f_error[t] * f_error[t];
+  }
+  error /= MAX(n, 1);
+
+  // Initialize AR coefficients
+  memset(a, 0, Order * sizeof(Real));
+  memset(a_prev, 0, Order * sizeof(Real));
+  memset(best, 0, Order * sizeof(Real));
+  MEM_OrderSelector selector(ctx->order_rule, n);
+  Real best_error = error;
+
+  // Main Burg recursion
+  for (int m = 0; m < Order; m++) {
+    Real numerator = 0;
+    Real denominator = 0;
+
+    // Compute reflection coefficient over the pairs (fₘ(t), bₘ(t-1)) that exist at this stage
+    for (int t = m + 1; t < n; t++) {
+      numerator += f_error[t] * b_error[t-1];
+      denominator += f_error[t] * f_error[t] + b_error[t-1] * b_error[t-1];
+    }
+    k[m] = -2 * numerator / (denominator + (Real)1e-9);  // Avoid division by zero
+    error *= (1 - k[m] * k[m]);
+
+    // Update AR coefficients using Levinson recursion
+    a[m] = k[m];
+    for (int i = 0; i < m; i++) {
+      a[i] = a_prev[i] + k[m] * a_prev[m - 1 - i];
+    }
+    if (selector.add(m, (float)k[m])) {
+      memcpy(best, a, (m + 1) * sizeof(Real));
+      best_error = error;
+    }
+
+    // Update forward/backward prediction errors
+    for (int t = n - 1; t > m; t--) {
+      Real temp = f_error[t];
+      f_error[t] = f_error[t] + k[m] * b_error[t-1];
+      b_error[t] = b_error[t-1] + k[m] * temp;
+    }
+
+    // Save current AR coefficients for next iteration
+    memcpy(a_prev, a, (m + 1) * sizeof(Real));
+  }
+
+  // Store the selected AR coefficients in context
+  for (int i = 0; i < Order; i++) {
+    ctx->ar_coeff[i] = best[i];
+  }
+  ctx->model_order = selector.best;
+  ctx->noise_var = (float)best_error;
+}
+
+// Burg's method in fixed point. The prediction errors start as the exact deviations N·xₜ - S,
+// normalized to MEM_Q31_SAMPLE_BITS; the sums over them fit 64 bits because the error energy
+// only decreases from stage to stage. Only the reflection coefficients are kept: they are
+// within ±1, where the AR coefficients can grow far beyond what Q31 holds.
+template <uint16_t Order, uint16_t Bins>
+void BurgsMethod(MEM_ContextT<Order, Bins, MEM_Q31>* ctx, const TachoWindow& window, MEM_WorkspaceT<MEM_Q31>* work) {
+  const int n = window.count;
+  int32_t* f_error = work->f_error;
+  int32_t* b_error = work->b_error;
+  const int64_t sum = ctx->window_sum;
+
+  int64_t largest = 0;
+  for (int t = 0; t < n; t++) {
+    int64_t deviation = (int64_t)n * (*window.history)[window.first + t] - sum;
+    largest = MAX(largest, deviation < 0 ? -deviation : deviation);
+  }
+  const int shift = Fixed_Bits64(largest) - MEM_Q31_SAMPLE_BITS;
+  for (int t = 0; t < n; t++) {
+    int64_t deviation = (int64_t)n * (*window.history)[window.first + t] - sum;
+    f_error[t] = (int32_t)(shift >= 0 ? deviation >> shift : deviation * ((int64_t)1 << -shift));
+  }
+  memcpy(b_error, f_error, n * sizeof(int32_t));
+
+  int32_t gain = Q31_ONE;  // Π (1 - kₘ²): prediction error power relative to the window's
+  int32_t best_gain = gain;
+  MEM_OrderSelector selector(ctx->order_rule, n);
+  for (int m = 0; m < Order; m++) {
+    int64_t numerator = 0;
+    int64_t denominator = 0;
+    for (int t = m + 1; t < n; t++) {
+      numerator += (int64_t)f_error[t] * b_error[t-1];
+      denominator += (int64_t)f_error[t] * f_error[t] + (int64_t)b_error[t-1] * b_error[t-1];
+    }
+    const int32_t k = denominator > 0 ? Q31_Ratio(-2 * numerator, denominator) : 0;
+    gain = Q31_Mul(gain, Q31_ONE - Q31_Mul(k, k));
+    if (selector.add(m, ldexpf((float)k, -31))) {
+      best_gain = gain;
+    }
+
+    for (int t = n - 1; t > m; t--) {
+      int32_t temp = f_error[t];
+      f_error[t] = f_error[t] + Q31_Mul(k, b_error[t-1]);
+      b_error[t] = b_error[t-1] + Q31_Mul(k, temp);
+    }
+    ctx->ar_coeff[m] = k;
+  }
+  memset(ctx->ar_coeff + selector.best, 0, (Order - selector.best) * sizeof(int32_t));
+  ctx->model_order = selector.best;
+
+  // Biased variance of the window, exactly from the lag sums: (N·Σx² - S²) / N²
+  float variance = n > 0 ? (float)(n * ctx->lag_sum[0] - sum * sum) / ((float)n * (float)n) : 0.0f;
+  ctx->noise_var = variance * ldexpf((float)best_gain, -31);
+}
+
+// 3b. Sliding Yule-Walker estimate (alternative to Burg's method)
+// Builds the mean-removed autocovariance of the window from the lag sums:
+//    N²·cₖ = N²·Σₖ - N·S·(Aₖ + Bₖ) + (N - k)·S²
+// where S is the window sum and Aₖ / Bₖ exclude the k oldest / newest samples,
+// then solves for the AR coefficients with the Levinson-Durbin recursion. O(Order²).
+//
+// The formula holds for samples shifted by any constant m. Written directly, its terms grow
+// like N³·x², which leaves 64 bits once the samples reach seconds. Shifting by the window's
+// rounded mean first bounds S by N/2 and N²·Σₖ by N³·(x - m)², so every term fits for any
+// uint16_t samples in the tachogram history.
+static_assert((double)TACHO_HISTORY_SIZE * TACHO_HISTORY_SIZE * TACHO_HISTORY_SIZE * 65535.0 * 65535.0 < 9.2e18,
+  "N²·cₖ of a full tachogram history may overflow 64 bits");
+
+// N²·cₖ for lags 0..Order, exact
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void MEM_Autocovariance(const MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window, int64_t (&r)[Order + 1]) {
+  const int64_t n = window.count;
+  if (n == 0) {
+    memset(r, 0, sizeof(r));
+    return;
+  }
+  const int64_t m = (ctx->window_sum + n / 2) / n;  // Shift: the rounded mean
+  const int64_t s = ctx->window_sum - n * m;        // Window sum of the shifted samples
+  int64_t oldest_sum = 0;  // Sum of the k oldest shifted samples
+  int64_t newest_sum = 0;  // Sum of the k newest shifted samples
+
+  for (int k = 0; k <= Order; k++) {
+    if (k > 0) {
+      oldest_sum += SampleByAge(window, n - k) - m;
+      newest_sum += SampleByAge(window, k - 1) - m;
+    }
+    // Σₖ of the shifted samples: each of the N - k pairs loses m·(xₜ + xₜ₋ₖ) and gains m²
+    int64_t pairs = 2 * ctx->window_sum - (oldest_sum + k * m) - (newest_sum + k * m);
+    int64_t lag = ctx->lag_sum[k] - m * pairs + (n - k) * m * m;
+    r[k] = n * n * lag - n * s * (2 * s - oldest_sum - newest_sum) + (n - k) * s * s;
+  }
+}
+
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void SlidingYuleWalker(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window) {
+  typedef typename Numeric::Coeff Real;
+  int64_t scaled[Order + 1];
+  Real r[Order + 1];    // Autocovariance (common scale factor is irrelevant)
+  Real a[Order];        // AR coefficients
+  Real a_prev[Order];   // Previous AR coefficients
+  Real best[Order];     // AR coefficients of the selected order
+
+  MEM_Autocovariance(ctx, window, scaled);
+  for (int k = 0; k <= Order; k++) {
+    r[k] = (Real)scaled[k];
+  }
+
+  memset(a, 0, Order * sizeof(Real));
+  memset(a_prev, 0, Order * sizeof(Real));
+  memset(best, 0, Order * sizeof(Real));
+  MEM_OrderSelector selector(ctx->order_rule, window.count);
+
+  // Levinson-Durbin recursion, same sign convention as BurgsMethod: A(z) = 1 + Σ aᵢ z⁻⁽ⁱ⁺¹⁾
+  Real error = r[0];
+  Real best_error = error;
+  for (int m = 0; m < Order && error > (Real)1e-9; m++) {
+    Real acc = r[m + 1];
+    for (int i = 0; i < m; i++) {
+      acc += a_prev[i] * r[m - i];
+    }
+    Real k = -acc / error;
+
+    a[m] = k;
+    for (int i = 0; i < m; i++) {
+      a[i] = a_prev[i] + k * a_prev[m - 1 - i];
+    }
+    error *= (1 - k * k);
+    if (selector.add(m, (float)k)) {
+      memcpy(best, a, (m + 1) * sizeof(Real));
+      best_error = error;
+    }
+
+    memcpy(a_prev, a, (m + 1) * sizeof(Real));
+  }
+
+  // r is N³ times the biased autocovariance, and so is the prediction error
+  memcpy(ctx->ar_coeff, best, Order * sizeof(Real));
+  ctx->model_order = selector.best;
+  const Real n = window.count;
+  ctx->noise_var = (float)(MAX(best_error, (Real)0) / (n * n * n));
+}
+
+// Fixed-point variant: the Schur recursion finds the reflection coefficients from the
+// autocovariance without forming the AR coefficients. Every intermediate value is bounded by
+// c₀, so after normalizing c₀ to 30 bits nothing can overflow (the method of the GSM 06.10 codec).
+template <uint16_t Order, uint16_t Bins>
+void SlidingYuleWalker(MEM_ContextT<Order, Bins, MEM_Q31>* ctx, const TachoWindow& window) {
+  int64_t r[Order + 1];
+  int32_t p[Order + 1];  // Forward generator, p[0] being the prediction error
+  int32_t q[Order + 1];  // Backward generator (q[1..Order-1])
+
+  MEM_Autocovariance(ctx, window, r);
+  memset(ctx->ar_coeff, 0, sizeof(ctx->ar_coeff));
+  ctx->model_order = 0;
+  ctx->noise_var = 0.0f;
+  if (r[0] <= 0) {
+    return;
+  }
+
+  const int shift = MAX(0, Fixed_Bits64(r[0]) - 30);
+  for (int i = 0; i <= Order; i++) {
+    p[i] = q[i] = (int32_t)(r[i] >> shift);
+  }
+  MEM_OrderSelector selector(ctx->order_rule, window.count);
+  int32_t best_error = p[0];
+
+  for (int m = 0; m < Order; m++) {
+    if (p[0] <= 0 || abs(p[1]) >= p[0]) {
+      break;  // Singular: the remaining coefficients stay zero
+    }
+    const int32_t k = Q31_Ratio(-(int64_t)p[1], p[0]);
+    ctx->ar_coeff[m] = k;
+
+    p[0] += Q31_Mul(p[1], k);
+    for (int i = 1; i < Order - m; i++) {
+      int32_t next = p[i + 1] + Q31_Mul(q[i], k);
+      q[i] += Q31_Mul(p[i + 1], k);
+      p[i] = next;
+    }
+    if (selector.add(m, ldexpf((float)k, -31))) {
+      best_error = p[0];
+    }
+  }
+  memset(ctx->ar_coeff + selector.best, 0, (Order - selector.best) * sizeof(int32_t));
+  ctx->model_order = selector.best;
+
+  const float n = window.count;
+  ctx->noise_var = ldexpf((float)MAX(best_error, 0), shift) / (n * n * n);
+}
+
+// 4. PSD Calculation (with precomputed exponents)
+// One-sided AR spectrum in ms² per cycle/sample: 2·σ²ₑ / |A(f)|², σ²ₑ being the variance of
+// the prediction error. Integrated over the band in cycles/sample it gives the band power in ms².
+// The tables cover Order; only the model_order coefficients of the selected model are evaluated.
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void ComputePSD(MEM_ContextT<Order, Bins, Numeric>* ctx) {
+  typedef MEM_ExpTableT<Order, Bins> Table;
+  typedef typename Numeric::Power Real;
+
+  const Real gain = 2 * (Real)ctx->noise_var;
+  for (int f = 0; f < Bins; f++) {
+    Real dr = 1, di = 0;
+    for (int i = 0; i < ctx->model_order; i++) {
+      dr += ctx->ar_coeff[i] * Table::table.real[i][f];
+      di += ctx->ar_coeff[i] * Table::table.imag[i][f];
+    }
+    ctx->psd[f] = gain / (dr * dr + di * di + (Real)1e-9);
+  }
+}
+
+template <uint16_t Order, uint16_t Bins>
+void ComputePSD(MEM_ContextT<Order, Bins, MEM_Float>* ctx) {
+  typedef MEM_ExpTableT<Order, Bins> Table;
+
+  ComputePSDKernel(&Table::table.real[0][0], &Table::table.imag[0][0], Bins,
+    ctx->ar_coeff, ctx->model_order, 2.0f * ctx->noise_var, ctx->psd);
+}
+
+// One lattice stage of A(f) in Q(MEM_Q31_LATTICE_FRAC): A += k·e^(-j2πfm)·conj(A), with the
+// exponential (c, s) in Q30 and k in Q31. Components of A are clamped to ±2³⁰, so the rotated
+// value fits 32 bits.
+static inline void MEM_Q31_LatticeStep(int32_t& ar, int32_t& ai, int64_t c, int64_t s, int64_t k) {
+  const int64_t LIMIT = (int64_t)1 << 30;
+  const int64_t tr = (c * ar + s * ai) >> 30;
+  const int64_t ti = (s * ar - c * ai) >> 30;
+  ar = (int32_t)MIN(MAX(ar + ((k * tr) >> 31), -LIMIT), LIMIT);
+  ai = (int32_t)MIN(MAX(ai + ((k * ti) >> 31), -LIMIT), LIMIT);
+}
+
+// 1/|A|² as a Q30 mantissa in (2³⁰, 2³¹] and its exponent. |A|² = x·2^(64 - lz - 2·FRAC) with x
+// in [0.5, 1), so 1/|A|² = (1/x)·2^(lz + 2·FRAC - 64).
+static inline uint32_t MEM_Q31_InversePower(int32_t ar, int32_t ai, int16_t* exponent) {
+  uint64_t magnitude = (uint64_t)((int64_t)ar * ar) + (uint64_t)((int64_t)ai * ai);
+  magnitude = MAX(magnitude, (uint64_t)1);
+  int lz = Fixed_CountLeadingZeros64(magnitude);
+  *exponent = lz + 2 * MEM_Q31_LATTICE_FRAC - 64 - 30;
+  return Fixed_Reciprocal((uint32_t)((magnitude << lz) >> 32));
+}
+
+// Fixed-point spectrum. A(f) is built from the reflection coefficients by the lattice recursion
+//    Aₘ(f) = Aₘ₋₁(f) + kₘ·e^(-j2πfm)·conj(Aₘ₋₁(f))
+// which never forms the AR coefficients. |A|² is normalized to a 32-bit mantissa and exponent,
+// the mantissa inverted by Newton-Raphson (no division), and the bins brought to the largest
+// exponent, stored in psd_exp. The gain 2·σ²ₑ is applied by IntegratePSD.
+// A saturates at 64, where the spectrum is 72 dB below the prediction error and contributes
+// nothing to the band powers. Each stage depends on the previous one, so four bins are carried
+// through the stages together to overlap their multiplies.
+template <uint16_t Order, uint16_t Bins>
+void ComputePSD(MEM_ContextT<Order, Bins, MEM_Q31>* ctx) {
+  typedef MEM_ExpTableT<Order, Bins> Table;
+  const int32_t ONE = 1 << MEM_Q31_LATTICE_FRAC;
+  int16_t exponent[Bins];
+
+  int f = 0;
+  for (; f + 4 <= Bins; f += 4) {
+    int32_t ar[4] = { ONE, ONE, ONE, ONE }, ai[4] = { 0, 0, 0, 0 };
+    for (int m = 0; m < ctx->model_order; m++) {
+      for (int j = 0; j < 4; j++) {
+        MEM_Q31_LatticeStep(ar[j], ai[j], Table::fixed.real[m][f + j], Table::fixed.imag[m][f + j], ctx->ar_coeff[m]);
+      }
+    }
+    for (int j = 0; j < 4; j++) {
+      ctx->psd[f + j] = MEM_Q31_InversePower(ar[j], ai[j], &exponent[f + j]);
+    }
+  }
+  for (; f < Bins; f++) {
+    int32_t ar = ONE, ai = 0;
+    for (int m = 0; m < ctx->model_order; m++) {
+      MEM_Q31_LatticeStep(ar, ai, Table::fixed.real[m][f], Table::fixed.imag[m][f], ctx->ar_coeff[m]);
+    }
+    ctx->psd[f] = MEM_Q31_InversePower(ar, ai, &exponent[f]);
+  }
+
+  int16_t top = exponent[0];
+  for (int f = 1; f < Bins; f++) {
+    top = MAX(top, exponent[f]);
+  }
+  for (int f = 0; f < Bins; f++) {
+    int shift = top - exponent[f];
+    ctx->psd[f] = shift < 32 ? ctx->psd[f] >> shift : 0;
+  }
+  ctx->psd_exp = top;
+}
+
+// Helper function to integrate PSD over a frequency range
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+float IntegratePSD(const MEM_ContextT<Order, Bins, Numeric>* ctx, float freq_start, float freq_end) {
+  typedef MEM_ExpTableT<Order, Bins> Table;
+  typedef typename Numeric::Power Real;
+  const Real* psd = ctx->psd;
+
+  if (freq_start >= freq_end) {
+    return 0.0f;
+  }
+
+  // Calculate exact bin positions (can be fractional)
+  float start_pos = (freq_start - Table::low) / Table::step;
+  float end_pos = (freq_end - Table::low) / Table::step;
+
+  // Get integer bin indices
+  int start_bin = (int)start_pos;
+  int end_bin = (int)end_pos;
+
+  // Clamp to valid range
+  start_bin = fmaxf(0, fminf(start_bin, Bins - 2));
+  end_bin = fmaxf(0, fminf(end_bin, Bins - 2));
+
+  // Calculate frequency step size
+  Real freq_step = Table::step;
+
+  // Initialize integral
+  Real integral = 0;
+
+  // Handle fractional start bin
+  if (start_pos > start_bin) {
+    Real frac = start_pos - start_bin;
+    Real p0 = psd[start_bin];
+    Real p1 = psd[start_bin + 1];
+    integral += (p0 + (p1 - p0) * frac) * (1 - frac) * freq_step * (Real)0.5;
+    start_bin++;
+  }
+
+  // Handle fractional end bin
+  if (end_pos < end_bin + 1) {
+    Real frac = end_pos - end_bin;
+    Real p0 = psd[end_bin];
+    Real p1 = psd[end_bin + 1];
+    integral += (p0 + (p1 - p0) * frac) * frac * freq_step * (Real)0.5;
+    end_bin--;
+  }
+
+  // Integrate over complete bins using trapezoidal rule
+  for (int i = start_bin; i <= end_bin; i++) {
+    integral += (psd[i] + psd[i + 1]) * (Real)0.5 * freq_step;
+  }
+
+  return (float)integral;
+}
+
+// Fixed-point variant: the same trapezoids, summed in 64 bits with the fractional bin edges in
+// Q16, then scaled by the block exponent and the gain once
+template <uint16_t Order, uint16_t Bins>
+float IntegratePSD(const MEM_ContextT<Order, Bins, MEM_Q31>* ctx, float freq_start, float freq_end) {
+  typedef MEM_ExpTableT<Order, Bins> Table;
+  const uint32_t* psd = ctx->psd;
+
+  if (freq_start >= freq_end) {
+    return 0.0f;
+  }
+
+  float start_pos = (freq_start - Table::low) / Table::step;
+  float end_pos = (freq_end - Table::low) / Table::step;
+  int start_bin = (int)start_pos;
+  int end_bin = (int)end_pos;
+  start_bin = fmaxf(0, fminf(start_bin, Bins - 2));
+  end_bin = fmaxf(0, fminf(end_bin, Bins - 2));
+
+  uint64_t sum = 0;  // Twice the integral in bins, Q16
+  if (start_pos > start_bin) {
+    int64_t frac = (int64_t)((start_pos - start_bin) * 65536.0f);
+    int64_t p0 = psd[start_bin], p1 = psd[start_bin + 1];
+    sum += (uint64_t)(p0 + (((p1 - p0) * frac) >> 16)) * (65536 - frac);
+    start_bin++;
+  }
+  if (end_pos < end_bin + 1) {
+    int64_t frac = (int64_t)((end_pos - end_bin) * 65536.0f);
+    int64_t p0 = psd[end_bin], p1 = psd[end_bin + 1];
+    sum += (uint64_t)(p0 + (((p1 - p0) * frac) >> 16)) * frac;
+    end_bin--;
+  }
+  for (int i = start_bin; i <= end_bin; i++) {
+    sum += ((uint64_t)psd[i] + psd[i + 1]) << 16;
+  }
+
+  return ldexpf((float)sum, ctx->psd_exp - 16) * 0.5f * (float)Table::step * 2.0f * ctx->noise_var;
+}
+
+// 5. Real-Time Update Handler
+// Estimate the spectrum of the window once it is full (its lag sums must already include it)
+template <uint16_t Order, uint16_t Bins, typename Numeric>
+void ProcessWindow(MEM_ContextT<Order, Bins, Numeric>* ctx, const TachoWindow& window, bool full, MEM_WorkspaceT<Numeric>* work) {
+  if (full) {
+    if (ctx->ar_method == MEM_AR_BURG) {
+      BurgsMethod(ctx, window, work);
+    } else {
+      SlidingYuleWalker(ctx, window);
+    }
+    HRV_PROFILE_MARK("mem.ar");
+    ComputePSD(ctx);
+    HRV_PROFILE_MARK("mem.psd");
+
+    // Calculate total power for normalization
+    ctx->total_power = IntegratePSD(ctx, MEM_CYCLES(FREQ_VLOW), MEM_CYCLES(FREQ_HIGH));  // Full HRV range
+
+    // VO2 prediction using LF/HF ratios
+    ctx->LF = IntegratePSD(ctx, MEM_CYCLES(FREQ_LOW), MEM_CYCLES(FREQ_MID));
+    ctx->HF = IntegratePSD(ctx, MEM_CYCLES(FREQ_MID), MEM_CYCLES(FREQ_HIGH));
+
+    // Normalize powers to percentage of total
+    // if (ctx->total_power > MEM_MIN_POWER) {
+    //   ctx->LF = (ctx->LF / ctx->total_power) * 100.0f;
+    //   ctx->HF = (ctx->HF / ctx->total_power) * 100.0f;
+    // } else {
+    //   ctx->LF = MEM_MIN_POWER;
+    //   ctx->HF = MEM_MIN_POWER;
+    // }
+
+    // Calculate ratio only if both powers are significant
+    if (ctx->LF > MEM_MIN_POWER && ctx->HF > MEM_MIN_POWER) {
+      ctx->LF_HF_Ratio = ctx->LF / ctx->HF;
+    } else {
+      ctx->LF_HF_Ratio = 0.0f;  // Default to 0.0 if either power is too small
+    }
+  } else {
+    // No power in any band before we have enough samples
+    ctx->total_power = 0.0f;
+    ctx->LF = 0.0f;
+    ctx->HF = 0.0f;
+    ctx->LF_HF_Ratio = 0.0f;
+  }
+}
 
 #endif // MEM_H
@@ -0,0 +1,77 @@
+#include "./PMDCapture.h"
+
+std::atomic<bool> pmdCaptureEnabled(false);
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+uint16_t PMD_FormatCapture(uint8_t session, uint32_t time, const uint8_t* data, uint16_t length, char* line) {
+  length = MIN(length, PMD_CAPTURE_MAX_PAYLOAD);
+  int n = snprintf(line, PMD_CAPTURE_MAX_LINE, PMD_CAPTURE_PREFIX "%u,%lu,", session, (unsigned long)time);
+  for (uint16_t i = 0; i < length; i++) {
+    line[n++] = HEX_DIGITS[data[i] >> 4];
+    line[n++] = HEX_DIGITS[data[i] & 0x0F];
+  }
+  line[n++] = '\n';
+  line[n] = '\0';
+  return n;
+}
+
+// Value of a hex digit, or -1
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Read a decimal field ending in a comma. Returns the character after the comma, or nullptr.
+static const char* readNumber(const char* p, uint32_t limit, uint32_t* value) {
+  uint64_t v = 0;
+  const char* start = p;
+  while (*p >= '0' && *p <= '9') {
+    v = v * 10 + (*p++ - '0');
+    if (v > limit) {
+      return nullptr;
+    }
+  }
+  if (p == start || *p != ',') {
+    return nullptr;
+  }
+  *value = (uint32_t)v;
+  return p + 1;
+}
+
+bool PMD_ParseCapture(const char* line, PMD_CaptureRecord* record) {
+  const size_t prefix = sizeof(PMD_CAPTURE_PREFIX) - 1;
+  if (strncmp(line, PMD_CAPTURE_PREFIX, prefix) != 0) {
+    return false;
+  }
+
+  uint32_t session, time;
+  const char* p = readNumber(line + prefix, UINT8_MAX, &session);
+  p = p != nullptr ? readNumber(p, UINT32_MAX, &time) : nullptr;
+  if (p == nullptr) {
+    return false;
+  }
+
+  uint16_t length = 0;
+  for (; p[0] != '\0' && p[0] != '\n' && p[0] != '\r'; p += 2) {
+    int high = hexValue(p[0]);
+    int low = high >= 0 ? hexValue(p[1]) : -1;
+    if (low < 0 || length == PMD_CAPTURE_MAX_PAYLOAD) {
+      return false;
+    }
+    record->data[length++] = (uint8_t)(high << 4 | low);
+  }
+
+  record->session = (uint8_t)session;
+  record->time = time;
+  record->length = length;
+  return true;
+}
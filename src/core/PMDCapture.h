@@ -0,0 +1,46 @@
+#ifndef _PMD_CAPTURE_H
+#define _PMD_CAPTURE_H
+
+#include "../utils/Constants.h"
+
+#include <atomic>
+
+// Capture of PMD data notifications, for replay on the host
+//
+// While capture is on (serial command "capture"), the BLE callback prints every data
+// notification it receives, before decoding it, as one line on the serial port:
+//    PMD,<session>,<ms>,<payload>
+// session is the sensor session, ms the millis() at reception and payload the notification
+// bytes as lowercase hex, header included. Lines are interleaved with the CSV telemetry output,
+// so a serial log holds both; readers skip every line without the prefix. The BLE callback
+// writes them straight to the port, which would split binary frames, so capture is only
+// available in CSV mode: the "capture" command is ignored in binary mode, and "binary" turns
+// capture off.
+//
+// bench/ble_replay.cc feeds captured notifications back through PolarBLEConnection's callback
+// on the mock BLE transport, and tests/pmd_notify_fuzz.cc uses them as seeds.
+
+#define PMD_CAPTURE_PREFIX "PMD,"
+#define PMD_CAPTURE_MAX_PAYLOAD 512  // Longest notification a line may carry
+// Longest line, terminator included: prefix, session, ms, two commas, hex, newline
+#define PMD_CAPTURE_MAX_LINE (4 + 3 + 10 + 2 + 2 * PMD_CAPTURE_MAX_PAYLOAD + 2)
+
+typedef struct {
+  uint8_t session;
+  uint32_t time;    // ms
+  uint16_t length;  // Payload bytes
+  uint8_t data[PMD_CAPTURE_MAX_PAYLOAD];
+} PMD_CaptureRecord;
+
+// Capture on or off. Changed at run time by the serial command task, read by the BLE callback.
+extern std::atomic<bool> pmdCaptureEnabled;
+
+// Format one notification as a capture line, newline included. Payloads over
+// PMD_CAPTURE_MAX_PAYLOAD are truncated. Returns the line length.
+uint16_t PMD_FormatCapture(uint8_t session, uint32_t time, const uint8_t* data, uint16_t length, char* line);
+
+// Read a capture line (trailing newline optional). Returns false if the line is not one or is
+// malformed.
+bool PMD_ParseCapture(const char* line, PMD_CaptureRecord* record);
+
+#endif  // _PMD_CAPTURE_H
@@ -0,0 +1,255 @@
+#include "./PMDDecoder.h"
+
+// Unpack count signed deltas of Bits bits from [src, end) into out.
+// Bits are gathered 64 at a time: while at least 8 bytes are left one unaligned word load refills
+// the accumulator, and only the tail of a block is read byte by byte. Bytes after end are never
+// read, so the caller only has to check that the block fits in the frame.
+template <uint8_t Bits>
+static void unpackDeltas(const uint8_t* src, const uint8_t* end, int32_t* out, uint32_t count) {
+  if (Bits == 0) {
+    memset(out, 0, count * sizeof(int32_t));
+    return;
+  }
+
+  const uint32_t mask = (uint32_t)((1ull << Bits) - 1);
+  const uint8_t shift = Bits > 0 ? 32 - Bits : 0;
+  uint64_t acc = 0;   // Unread bits, LSB first
+  uint8_t bits = 0;   // Number of unread bits in acc
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (bits < Bits) {
+      if (end - src >= 8) {
+        // Bits above the valid ones are the same bytes the next refill loads again, so OR-ing
+        // the whole word is harmless
+        uint64_t word;
+        memcpy(&word, src, sizeof(word));  // Little-endian, as is the ESP32
+        acc |= word << bits;
+        src += (63 - bits) >> 3;
+        bits |= 56;
+      } else {
+        while (bits <= 56 && src < end) {
+          acc |= (uint64_t)*src++ << bits;
+          bits += 8;
+        }
+      }
+    }
+    uint32_t raw = (uint32_t)acc & mask;
+    acc >>= Bits;
+    bits -= Bits;
+
+    // Sign-extend from Bits bits
+    out[i] = (int32_t)(raw << shift) >> shift;
+  }
+}
+
+typedef void (*UnpackFn)(const uint8_t*, const uint8_t*, int32_t*, uint32_t);
+
+// One unpacker per delta size, with the mask and sign shift folded in at compile time
+static const UnpackFn UNPACK[PMD_MAX_DELTA_BITS + 1] = {
+#define PMD_UNPACK(n) unpackDeltas<n>
+  PMD_UNPACK(0),  PMD_UNPACK(1),  PMD_UNPACK(2),  PMD_UNPACK(3),  PMD_UNPACK(4),  PMD_UNPACK(5),
+  PMD_UNPACK(6),  PMD_UNPACK(7),  PMD_UNPACK(8),  PMD_UNPACK(9),  PMD_UNPACK(10), PMD_UNPACK(11),
+  PMD_UNPACK(12), PMD_UNPACK(13), PMD_UNPACK(14), PMD_UNPACK(15), PMD_UNPACK(16), PMD_UNPACK(17),
+  PMD_UNPACK(18), PMD_UNPACK(19), PMD_UNPACK(20), PMD_UNPACK(21), PMD_UNPACK(22), PMD_UNPACK(23),
+  PMD_UNPACK(24), PMD_UNPACK(25), PMD_UNPACK(26), PMD_UNPACK(27), PMD_UNPACK(28), PMD_UNPACK(29),
+  PMD_UNPACK(30), PMD_UNPACK(31), PMD_UNPACK(32)
+#undef PMD_UNPACK
+};
+
+uint16_t PMD_DecodeDeltaFrames(const uint8_t* data, uint16_t length, uint8_t channels, uint8_t refBytes,
+                               int32_t* out, uint16_t maxSamples) {
+  if (channels == 0 || refBytes == 0 || refBytes > 4 || maxSamples == 0 || length < channels * refBytes) {
+    return 0;
+  }
+
+  // Reference sample
+  const uint8_t refShift = 32 - 8 * refBytes;
+  for (uint8_t c = 0; c < channels; c++) {
+    uint32_t value = 0;
+    for (uint8_t b = 0; b < refBytes; b++) {
+      value |= (uint32_t)data[c * refBytes + b] << (8 * b);
+    }
+    out[c] = (int32_t)(value << refShift) >> refShift;
+  }
+  uint16_t samples = 1;
+  uint32_t pos = channels * refBytes;
+
+  while (pos + 2 <= length && samples < maxSamples) {
+    uint8_t deltaBits = data[pos];
+    uint16_t count = data[pos + 1];
+    pos += 2;
+
+    uint32_t blockBytes = ((uint32_t)count * channels * deltaBits + 7) / 8;
+    if (deltaBits > PMD_MAX_DELTA_BITS || blockBytes > length - pos) {
+      break;  // Malformed block
+    }
+
+    // Unpack the deltas in place, then add each to the previous sample of its channel
+    uint16_t decode = MIN(count, maxSamples - samples);
+    int32_t* block = out + samples * channels;
+    UNPACK[deltaBits](data + pos, data + pos + blockBytes, block, (uint32_t)decode * channels);
+    const int32_t* previous = block - channels;
+    for (uint32_t i = 0; i < (uint32_t)decode * channels; i++) {
+      block[i] = (int32_t)((uint32_t)block[i] + (uint32_t)previous[i]);  // Modulo 2^32, so a corrupt frame cannot overflow
+    }
+
+    samples += decode;
+    pos += blockBytes;
+  }
+  return samples;
+}
+
+// Supported frames. Add a row to decode another measurement or frame type; the stride of raw
+// formats is the sum of the channel widths.
+const PMD_FrameFormat PMD_FORMATS[] = {
+  // measurement   frameType                layout             stream           signed ch  widths        stride
+  { PMD_TYPE_PPG, 0x00,                   PMD_LAYOUT_RAW,   PMD_STREAM_PPG, true,  4, { 3, 3, 3, 3 }, 12 },
+  { PMD_TYPE_PPG, PMD_COMPRESSED | 0x00,  PMD_LAYOUT_DELTA, PMD_STREAM_PPG, true,  4, { 3, 3, 3, 3 }, 0 },
+  { PMD_TYPE_ACC, 0x00,                   PMD_LAYOUT_RAW,   PMD_STREAM_ACC, true,  3, { 1, 1, 1 },    3 },
+  { PMD_TYPE_ACC, 0x01,                   PMD_LAYOUT_RAW,   PMD_STREAM_ACC, true,  3, { 2, 2, 2 },    6 },
+  { PMD_TYPE_ACC, 0x02,                   PMD_LAYOUT_RAW,   PMD_STREAM_ACC, true,  3, { 3, 3, 3 },    9 },
+  { PMD_TYPE_ACC, PMD_COMPRESSED | 0x00,  PMD_LAYOUT_DELTA, PMD_STREAM_ACC, true,  3, { 2, 2, 2 },    0 },
+  // Heart rate, PPI (ms), PPI error estimate (ms), flags
+  { PMD_TYPE_PPI, 0x00,                   PMD_LAYOUT_RAW,   PMD_STREAM_PPI, false, 4, { 1, 2, 2, 1 }, 6 },
+};
+const uint8_t PMD_NUM_FORMATS = sizeof(PMD_FORMATS) / sizeof(PMD_FORMATS[0]);
+
+const PMD_FrameFormat* PMD_FindFormat(uint8_t measurement, uint8_t frameType) {
+  for (uint8_t i = 0; i < PMD_NUM_FORMATS; i++) {
+    if (PMD_FORMATS[i].measurement == measurement && PMD_FORMATS[i].frameType == frameType) {
+      return &PMD_FORMATS[i];
+    }
+  }
+  return nullptr;
+}
+
+uint16_t PMD_DecodeRawFrames(const uint8_t* data, uint16_t length, const PMD_FrameFormat* format,
+                             int32_t* out, uint16_t maxSamples) {
+  if (format->stride == 0) {
+    return 0;
+  }
+  uint16_t count = MIN(length / format->stride, maxSamples);
+
+  // Shifts of each channel that sign-extend (arithmetic) or clear (logical) the bits above its width
+  uint8_t shift[PMD_MAX_CHANNELS];
+  for (uint8_t c = 0; c < format->channels; c++) {
+    shift[c] = 32 - 8 * format->width[c];
+  }
+
+  for (uint16_t i = 0; i < count; i++) {
+    for (uint8_t c = 0; c < format->channels; c++) {
+      uint32_t value = 0;
+      for (uint8_t b = 0; b < format->width[c]; b++) {
+        value |= (uint32_t)*data++ << (8 * b);
+      }
+      *out++ = format->isSigned ? (int32_t)(value << shift[c]) >> shift[c] : (int32_t)value;
+    }
+  }
+  return count;
+}
+
+uint16_t PMD_DecodeFrame(const uint8_t* data, uint16_t length, PMD_Frame* frame, int32_t* values, uint16_t maxValues) {
+  frame->format = nullptr;
+  if (length < PMD_HEADER_SIZE) {
+    return 0;
+  }
+
+  frame->measurement = data[0] & 0x3F;
+  frame->frameType = data[9];
+  frame->timestamp = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    frame->timestamp |= (uint64_t)data[i + 1] << (8 * i);
+  }
+
+  frame->format = PMD_FindFormat(frame->measurement, frame->frameType);
+  if (frame->format == nullptr) {
+    return 0;
+  }
+
+  const PMD_FrameFormat* format = frame->format;
+  uint16_t maxSamples = maxValues / format->channels;
+  if (format->layout == PMD_LAYOUT_DELTA) {
+    return PMD_DecodeDeltaFrames(data + PMD_HEADER_SIZE, length - PMD_HEADER_SIZE, format->channels,
+      format->width[0], values, maxSamples);
+  }
+  return PMD_DecodeRawFrames(data + PMD_HEADER_SIZE, length - PMD_HEADER_SIZE, format, values, maxSamples);
+}
+
+bool PMD_ParseControlResponse(const uint8_t* data, uint16_t length, PMD_ControlResponse* response) {
+  if (length < 4 || data[0] != PMD_CONTROL_RESPONSE) {
+    return false;
+  }
+  response->opCode = data[1];
+  response->measurement = data[2];
+  response->status = data[3];
+  // Failed requests may end after the status
+  response->more = length > 4 && data[4] != 0;
+  response->params = data + MIN(length, 5);
+  response->paramLength = length > 5 ? length - 5 : 0;
+  return true;
+}
+
+// Bytes of one value of each setting type
+static const uint8_t SETTING_WIDTH[] = {
+  2,  // 0x00 sample rate (Hz)
+  2,  // 0x01 resolution (bits)
+  2,  // 0x02 range (g, dps...)
+  4,  // 0x03 range in milliunits
+  1,  // 0x04 number of channels
+  4,  // 0x05 conversion factor (float)
+};
+
+bool PMD_ParseSettings(const uint8_t* params, uint16_t length, PMD_Settings* settings) {
+  memset(settings, 0, sizeof(*settings));
+  uint16_t pos = 0;
+  while (pos + 2 <= length) {
+    uint8_t type = params[pos];
+    uint8_t count = params[pos + 1];
+    pos += 2;
+    if (type >= sizeof(SETTING_WIDTH) || (uint32_t)count * SETTING_WIDTH[type] > (uint32_t)(length - pos)) {
+      return false;
+    }
+
+    // Each setting lists the values it accepts; the single-valued ones keep the first
+    for (uint8_t i = 0; i < count; i++, pos += SETTING_WIDTH[type]) {
+      uint16_t value = params[pos] | (SETTING_WIDTH[type] > 1 ? params[pos + 1] << 8 : 0);
+      switch (type) {
+      case 0x00:
+        if (settings->numSampleRates < PMD_MAX_SETTING_VALUES) {
+          settings->sampleRates[settings->numSampleRates++] = value;
+        }
+        break;
+      case 0x01:
+        settings->resolution = i == 0 ? value : settings->resolution;
+        break;
+      case 0x02:
+        settings->range = i == 0 ? value : settings->range;
+        break;
+      case 0x04:
+        settings->channels = i == 0 ? (uint8_t)value : settings->channels;
+        break;
+      }
+    }
+  }
+  return pos == length;
+}
+
+const char* PMD_StatusName(uint8_t status) {
+  static const char* const NAMES[] = {
+    "SUCCESS",
+    "INVALID_OP_CODE",
+    "INVALID_MEASUREMENT_TYPE",
+    "NOT_SUPPORTED",
+    "INVALID_LENGTH",
+    "INVALID_PARAMETER",
+    "ALREADY_IN_STATE",
+    "INVALID_RESOLUTION",
+    "INVALID_SAMPLE_RATE",
+    "INVALID_RANGE",
+    "INVALID_MTU",
+    "INVALID_NUMBER_OF_CHANNELS",
+    "INVALID_STATE",
+    "DEVICE_IN_CHARGER",
+  };
+  return status < sizeof(NAMES) / sizeof(NAMES[0]) ? NAMES[status] : "UNKNOWN";
+}
@@ -0,0 +1,127 @@
+#ifndef _PMD_DECODER_H
+#define _PMD_DECODER_H
+
+#include "../utils/Constants.h"
+
+// Polar Measurement Data (PMD) frame decoding
+//
+// Every notification on the PMD data characteristic starts with a header:
+//    measurement type u8 | timestamp u64 | frame type u8
+// The timestamp is in ns and belongs to the last sample. Bit 7 of the frame type marks a
+// delta-compressed payload:
+//    reference sample: one value per channel, refBytes bytes each, little-endian, signed
+//    blocks, until the end of the frame:
+//      deltaBits u8 | count u8 | count * channels deltas, deltaBits bits each, LSB first,
+//      sample by sample, padded to a whole byte
+// Each delta is signed (two's complement in deltaBits bits) and is added to the previous sample
+// of the same channel. Uncompressed payloads are back-to-back samples, each channel a
+// little-endian value of the width given by the frame format.
+//
+// Formats are looked up in PMD_FORMATS by measurement type and frame type, and every layout is
+// decoded by the same two routines into int32 values, channels values per sample. The control
+// point answers on the PMD control characteristic with:
+//    0xF0 | op code u8 | measurement type u8 | status u8 | more frames u8 | parameters...
+
+#define PMD_HEADER_SIZE 10
+#define PMD_COMPRESSED 0x80   // Frame type flag
+#define PMD_MAX_DELTA_BITS 32
+#define PMD_MAX_CHANNELS 4
+
+// Measurement types (low 6 bits of the first byte)
+#define PMD_TYPE_ECG 0x00
+#define PMD_TYPE_PPG 0x01
+#define PMD_TYPE_ACC 0x02
+#define PMD_TYPE_PPI 0x03
+#define PMD_TYPE_SDK 0x09
+
+// Control point
+#define PMD_CONTROL_RESPONSE 0xF0
+#define PMD_OP_GET_SETTINGS 0x01
+#define PMD_OP_START 0x02
+#define PMD_OP_STOP 0x03
+#define PMD_MAX_SETTING_VALUES 8
+
+typedef enum {
+  PMD_LAYOUT_RAW,    // Uncompressed samples
+  PMD_LAYOUT_DELTA   // Reference sample and delta blocks
+} PMD_Layout;
+
+// Ring each decoded frame is routed to
+typedef enum {
+  PMD_STREAM_PPG,
+  PMD_STREAM_ACC,
+  PMD_STREAM_PPI,
+  PMD_NUM_STREAMS
+} PMD_Stream;
+
+typedef struct {
+  uint8_t measurement;  // PMD_TYPE_*
+  uint8_t frameType;    // Including PMD_COMPRESSED
+  PMD_Layout layout;
+  PMD_Stream stream;
+  bool isSigned;
+  uint8_t channels;
+  uint8_t width[PMD_MAX_CHANNELS];  // Bytes of each channel (raw) or of the reference values (delta)
+  uint8_t stride;                   // Bytes per raw sample
+} PMD_FrameFormat;
+
+typedef struct {
+  const PMD_FrameFormat* format;  // nullptr if the frame is not in PMD_FORMATS
+  uint8_t measurement;
+  uint8_t frameType;
+  uint64_t timestamp;             // ns, of the last sample
+} PMD_Frame;
+
+typedef struct {
+  uint8_t opCode;
+  uint8_t measurement;
+  uint8_t status;        // 0 = success, see PMD_StatusName()
+  bool more;             // Parameters continue in another response
+  const uint8_t* params;
+  uint16_t paramLength;
+} PMD_ControlResponse;
+
+// Settings listed in a PMD_OP_GET_SETTINGS response (0 = not listed)
+typedef struct {
+  uint16_t sampleRates[PMD_MAX_SETTING_VALUES];  // Hz
+  uint8_t numSampleRates;
+  uint16_t resolution;   // Bits
+  uint16_t range;
+  uint8_t channels;
+} PMD_Settings;
+
+extern const PMD_FrameFormat PMD_FORMATS[];
+extern const uint8_t PMD_NUM_FORMATS;
+
+// Format of a measurement and frame type, or nullptr if it is not supported
+const PMD_FrameFormat* PMD_FindFormat(uint8_t measurement, uint8_t frameType);
+
+// Decode one data notification (header included) into values, channels values per sample, at
+// most maxValues values. frame receives the header and the format found. Returns the number of
+// samples written; 0 if the frame is too short or its format is not supported.
+uint16_t PMD_DecodeFrame(const uint8_t* data, uint16_t length, PMD_Frame* frame, int32_t* values, uint16_t maxValues);
+
+// Decode a delta-compressed payload (the bytes after the header) into out, which receives the
+// reference sample followed by every reconstructed sample, channels values per sample.
+// Nothing is allocated. Decoding stops at the end of the data, at a malformed block (delta size
+// over 32 bits or more deltas than bytes left) or once maxSamples samples were written.
+// Returns the number of samples written.
+uint16_t PMD_DecodeDeltaFrames(const uint8_t* data, uint16_t length, uint8_t channels, uint8_t refBytes,
+                               int32_t* out, uint16_t maxSamples);
+
+// Decode an uncompressed payload laid out as format describes. A trailing partial sample is
+// ignored. Returns the number of samples written, at most maxSamples.
+uint16_t PMD_DecodeRawFrames(const uint8_t* data, uint16_t length, const PMD_FrameFormat* format,
+                             int32_t* out, uint16_t maxSamples);
+
+// Split a control point response. Returns false if it is not one.
+bool PMD_ParseControlResponse(const uint8_t* data, uint16_t length, PMD_ControlResponse* response);
+
+// Read the settings of a PMD_OP_GET_SETTINGS response. Returns false if the parameters are
+// malformed or end in the middle of a setting.
+bool PMD_ParseSettings(const uint8_t* params, uint16_t length, PMD_Settings* settings);
+
+// Name of a control point status code
+const char* PMD_StatusName(uint8_t status);
+
+#endif  // _PMD_DECODER_H
@@ -0,0 +1,86 @@
+#include "./PPGBeatDetector.h"
+
+// Fraction of the running amplitude a maximum must rise above the preceding trough to become a candidate
+#define PPG_THRESHOLD 0.5f
+// Weight of a new beat in the running amplitude
+#define PPG_AMPLITUDE_GAIN 0.125f
+// Per-sample decay of the amplitude once no beat was seen for BIN_END ms
+#define PPG_AMPLITUDE_DECAY 0.99f
+
+PPGBeatDetector::PPGBeatDetector(float sampleRate, bool inverted) :
+  sampleRate(sampleRate),
+  sign(inverted ? -1.0f : 1.0f),
+  refractory((uint32_t)(PPG_REFRACTORY_MS * sampleRate / 1000.0f)),
+  maxGap((uint32_t)(BIN_END * sampleRate / 1000.0f)),
+  highPass(Biquad::highPass(sampleRate, PPG_HIGHPASS_HZ)),
+  lowPass(Biquad::lowPass(sampleRate, PPG_LOWPASS_HZ)) {
+  reset();
+}
+
+void PPGBeatDetector::reset() {
+  highPass.reset();
+  lowPass.reset();
+  offset = 0;
+  y1 = 0.0f;
+  y2 = 0.0f;
+  samples = 0;
+  amplitude = 0.0f;
+  trough = 0.0f;
+  hasCandidate = false;
+  hasPeak = false;
+  beats = 0;
+  lastPPI = 0.0f;
+}
+
+bool PPGBeatDetector::push(int32_t sample) {
+  if (samples == 0) {
+    offset = sample;
+  }
+  float y = sign * lowPass.process(highPass.process((float)(sample - offset)));
+  uint32_t n = samples++;
+  bool beat = false;
+
+  // Confirm the candidate once no higher maximum can replace it
+  if (hasCandidate && n - candidateIndex > refractory) {
+    hasCandidate = false;
+    amplitude += PPG_AMPLITUDE_GAIN * (candidateRise - amplitude);
+    trough = y;
+
+    if (hasPeak && candidateIndex - peakIndex <= maxGap) {
+      float intervalSamples = (float)(candidateIndex - peakIndex) + (candidateFraction - peakFraction);
+      lastPPI = intervalSamples * 1000.0f / sampleRate;
+      beat = true;
+    }
+    hasPeak = true;
+    peakIndex = candidateIndex;
+    peakFraction = candidateFraction;
+    beats++;
+  }
+
+  // Local maximum at the previous sample, rising above the adaptive threshold and outside the
+  // refractory time of the last beat. The rise is measured from the lowest point since the last
+  // beat, so what is left of the baseline wander does not move the threshold.
+  trough = MIN(trough, y);
+  if (n >= 2 && y1 > y2 && y1 >= y && y1 - trough > PPG_THRESHOLD * amplitude &&
+      (!hasPeak || n - 1 - peakIndex > refractory) &&
+      (!hasCandidate || y1 > candidateValue)) {
+    // Vertex of the parabola through the three samples, within half a sample of the maximum
+    float curvature = y2 - 2.0f * y1 + y;
+    float fraction = curvature < 0.0f ? 0.5f * (y2 - y) / curvature : 0.0f;
+
+    hasCandidate = true;
+    candidateIndex = n - 1;
+    candidateFraction = fraction;
+    candidateValue = y1;
+    candidateRise = y1 - trough;
+  }
+
+  // Let the threshold fall if the pulse got weaker
+  if (!hasCandidate && (!hasPeak || n - peakIndex > maxGap)) {
+    amplitude *= PPG_AMPLITUDE_DECAY;
+  }
+
+  y2 = y1;
+  y1 = y;
+  return beat;
+}
@@ -0,0 +1,71 @@
+#ifndef _PPG_BEAT_DETECTOR_H
+#define _PPG_BEAT_DETECTOR_H
+
+#include "../utils/Constants.h"
+#include "../utils/Biquad.hpp"
+
+// Streaming beat detector deriving PPIs from one PPG channel
+//
+// Each sample passes through three stages, all O(1) with a fixed amount of work:
+//   1. Band-pass: high-pass and low-pass biquads (PPG_HIGHPASS_HZ to PPG_LOWPASS_HZ) remove the
+//      baseline wander and the noise above the pulse, and the signal is flipped if PPG_INVERTED
+//   2. Adaptive peak detection: a local maximum rising from the last trough by more than half the
+//      running pulse amplitude becomes the beat candidate. A higher maximum within
+//      PPG_REFRACTORY_MS replaces it, and the candidate is confirmed once the refractory time
+//      has passed without one. The amplitude
+//      decays while no beat is found, so the detector recovers after a drop in signal strength.
+//   3. Sub-sample interpolation: a parabola through the peak and its neighbours places the beat
+//      between samples, so PPIs are not quantized to the 5.7 ms sample period
+//
+// Times are kept as sample counts plus a fractional offset, so precision does not degrade over
+// long recordings. Nothing is allocated. A detector is not thread safe; drive it from one task.
+class PPGBeatDetector {
+public:
+  PPGBeatDetector(float sampleRate = PPG_SAMPLE_RATE, bool inverted = PPG_INVERTED);
+
+  // Forget the signal history and restart detection
+  void reset();
+
+  // Feed one raw sample. Returns true when a beat is confirmed that completes an interval
+  // (not the first beat, nor the first after a gap longer than BIN_END); it is then given by ppi().
+  bool push(int32_t sample);
+
+  // Interval in ms between the last two confirmed beats, with sub-sample resolution
+  float ppi() const { return lastPPI; }
+
+  // Beats confirmed since reset()
+  uint32_t getBeats() const { return beats; }
+
+  // Samples fed since reset()
+  uint32_t getSamples() const { return samples; }
+
+private:
+  float sampleRate;
+  float sign;            // -1 if pulses are minima of the raw signal
+  uint32_t refractory;   // Samples
+  uint32_t maxGap;       // Samples between beats beyond which no PPI is reported
+
+  Biquad highPass;
+  Biquad lowPass;
+  int32_t offset;        // First sample, subtracted so the filters work on small values
+  float y1, y2;          // Previous two filtered samples
+
+  uint32_t samples;
+  float amplitude;       // Running rise from trough to peak (filtered units)
+  float trough;          // Lowest filtered sample since the last beat was confirmed
+
+  bool hasCandidate;
+  uint32_t candidateIndex;
+  float candidateFraction;
+  float candidateValue;
+  float candidateRise;   // Candidate peak above the trough
+
+  bool hasPeak;          // A beat was confirmed; its time is below
+  uint32_t peakIndex;
+  float peakFraction;
+
+  uint32_t beats;
+  float lastPPI;
+};
+
+#endif  // _PPG_BEAT_DETECTOR_H
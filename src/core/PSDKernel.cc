@@ -0,0 +1,151 @@
+#include "./PSDKernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PSD_HAVE_X86 1
+#endif
+
+// Guard against division by zero at a pole, as in the original per-bin loop
+static const float PSD_EPSILON = 1e-9f;
+
+// Finish bins [f, bins) one at a time
+static inline void PSDKernelTail(const float* real, const float* imag, int bins, int f,
+                                 const float* ar_coeff, int order, float gain, float* psd) {
+  for (; f < bins; f++) {
+    float dr = 1.0f;
+    float di = 0.0f;
+    for (int i = 0; i < order; i++) {
+      dr += ar_coeff[i] * real[i * bins + f];
+      di += ar_coeff[i] * imag[i * bins + f];
+    }
+    psd[f] = gain / (dr * dr + di * di + PSD_EPSILON);
+  }
+}
+
+void PSDKernelScalar(const float* real, const float* imag, int bins,
+                     const float* ar_coeff, int order, float gain, float* psd) {
+  int f = 0;
+  for (; f + 4 <= bins; f += 4) {
+    float dr0 = 1.0f, dr1 = 1.0f, dr2 = 1.0f, dr3 = 1.0f;
+    float di0 = 0.0f, di1 = 0.0f, di2 = 0.0f, di3 = 0.0f;
+    for (int i = 0; i < order; i++) {
+      const float a = ar_coeff[i];
+      const float* re = real + i * bins + f;
+      const float* im = imag + i * bins + f;
+      dr0 += a * re[0]; dr1 += a * re[1]; dr2 += a * re[2]; dr3 += a * re[3];
+      di0 += a * im[0]; di1 += a * im[1]; di2 += a * im[2]; di3 += a * im[3];
+    }
+    psd[f + 0] = gain / (dr0 * dr0 + di0 * di0 + PSD_EPSILON);
+    psd[f + 1] = gain / (dr1 * dr1 + di1 * di1 + PSD_EPSILON);
+    psd[f + 2] = gain / (dr2 * dr2 + di2 * di2 + PSD_EPSILON);
+    psd[f + 3] = gain / (dr3 * dr3 + di3 * di3 + PSD_EPSILON);
+  }
+  PSDKernelTail(real, imag, bins, f, ar_coeff, order, gain, psd);
+}
+
+#ifdef PSD_HAVE_X86
+// The x86 kernels keep two independent vectors of bins in flight to hide add latency
+static void PSDKernelSSE(const float* real, const float* imag, int bins,
+                         const float* ar_coeff, int order, float gain, float* psd) {
+  const __m128 g = _mm_set1_ps(gain);
+  const __m128 eps = _mm_set1_ps(PSD_EPSILON);
+  int f = 0;
+  for (; f + 8 <= bins; f += 8) {
+    __m128 dr0 = _mm_set1_ps(1.0f), dr1 = dr0;
+    __m128 di0 = _mm_setzero_ps(), di1 = di0;
+    for (int i = 0; i < order; i++) {
+      const __m128 a = _mm_set1_ps(ar_coeff[i]);
+      const float* re = real + i * bins + f;
+      const float* im = imag + i * bins + f;
+      dr0 = _mm_add_ps(dr0, _mm_mul_ps(a, _mm_loadu_ps(re)));
+      dr1 = _mm_add_ps(dr1, _mm_mul_ps(a, _mm_loadu_ps(re + 4)));
+      di0 = _mm_add_ps(di0, _mm_mul_ps(a, _mm_loadu_ps(im)));
+      di1 = _mm_add_ps(di1, _mm_mul_ps(a, _mm_loadu_ps(im + 4)));
+    }
+    __m128 mag0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr0, dr0), _mm_mul_ps(di0, di0)), eps);
+    __m128 mag1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr1, dr1), _mm_mul_ps(di1, di1)), eps);
+    _mm_storeu_ps(psd + f, _mm_div_ps(g, mag0));
+    _mm_storeu_ps(psd + f + 4, _mm_div_ps(g, mag1));
+  }
+  PSDKernelTail(real, imag, bins, f, ar_coeff, order, gain, psd);
+}
+
+__attribute__((target("avx2,fma")))
+static void PSDKernelAVX2(const float* real, const float* imag, int bins,
+                          const float* ar_coeff, int order, float gain, float* psd) {
+  const __m256 g = _mm256_set1_ps(gain);
+  const __m256 eps = _mm256_set1_ps(PSD_EPSILON);
+  int f = 0;
+  for (; f + 16 <= bins; f += 16) {
+    __m256 dr0 = _mm256_set1_ps(1.0f), dr1 = dr0;
+    __m256 di0 = _mm256_setzero_ps(), di1 = di0;
+    for (int i = 0; i < order; i++) {
+      const __m256 a = _mm256_set1_ps(ar_coeff[i]);
+      const float* re = real + i * bins + f;
+      const float* im = imag + i * bins + f;
+      dr0 = _mm256_fmadd_ps(a, _mm256_loadu_ps(re), dr0);
+      dr1 = _mm256_fmadd_ps(a, _mm256_loadu_ps(re + 8), dr1);
+      di0 = _mm256_fmadd_ps(a, _mm256_loadu_ps(im), di0);
+      di1 = _mm256_fmadd_ps(a, _mm256_loadu_ps(im + 8), di1);
+    }
+    __m256 mag0 = _mm256_fmadd_ps(di0, di0, _mm256_fmadd_ps(dr0, dr0, eps));
+    __m256 mag1 = _mm256_fmadd_ps(di1, di1, _mm256_fmadd_ps(dr1, dr1, eps));
+    _mm256_storeu_ps(psd + f, _mm256_div_ps(g, mag0));
+    _mm256_storeu_ps(psd + f + 8, _mm256_div_ps(g, mag1));
+  }
+  PSDKernelTail(real, imag, bins, f, ar_coeff, order, gain, psd);
+}
+#endif
+
+static int activeKernel = -1;
+static PSDKernelFn activeFn = PSDKernelScalar;
+
+bool PSD_SelectKernel(int kernel) {
+  switch (kernel) {
+  case PSD_KERNEL_SCALAR:
+    activeFn = PSDKernelScalar;
+    break;
+#ifdef PSD_HAVE_X86
+  case PSD_KERNEL_SSE:
+    activeFn = PSDKernelSSE;
+    break;
+  case PSD_KERNEL_AVX2:
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) {
+      return false;
+    }
+    activeFn = PSDKernelAVX2;
+    break;
+#endif
+  default:
+    return false;
+  }
+  activeKernel = kernel;
+  return true;
+}
+
+int PSD_ActiveKernel(void) {
+  // Default to the widest implementation the CPU supports
+  if (activeKernel < 0 && !PSD_SelectKernel(PSD_KERNEL_AVX2) && !PSD_SelectKernel(PSD_KERNEL_SSE)) {
+    PSD_SelectKernel(PSD_KERNEL_SCALAR);
+  }
+  return activeKernel;
+}
+
+const char* PSD_KernelName(int kernel) {
+  switch (kernel) {
+  case PSD_KERNEL_SSE:
+    return "sse";
+  case PSD_KERNEL_AVX2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
+
+void ComputePSDKernel(const float* real, const float* imag, int bins,
+                      const float* ar_coeff, int order, float gain, float* psd) {
+  if (activeKernel < 0) {
+    PSD_ActiveKernel();
+  }
+  activeFn(real, imag, bins, ar_coeff, order, gain, psd);
+}
@@ -0,0 +1,40 @@
+#ifndef PSD_KERNEL_H
+#define PSD_KERNEL_H
+
+#include "../utils/Constants.h"
+
+// Vectorized evaluation of an AR power spectrum over a table of complex exponentials.
+//
+// For every bin f the kernel computes
+//    psd[f] = gain / (|1 + Σ aᵢ·e^(-j2πf(i+1))|² + 1e-9)
+// fusing the denominator accumulation, the magnitude-squared and the normalization.
+// real/imag point at [order][bins] tables with the bins of each order contiguous
+// (see ExpTable.hpp), so several adjacent bins are processed per instruction.
+//
+// Implementations:
+//    PSD_KERNEL_SCALAR: portable, 4 bins per iteration held in registers (used on the ESP32-S3,
+//                       whose PIE extension has no floating point vector operations)
+//    PSD_KERNEL_SSE:    x86 SSE2, 4 bins per instruction
+//    PSD_KERNEL_AVX2:   x86 AVX2 + FMA, 8 bins per instruction (selected if the CPU supports it)
+#define PSD_KERNEL_SCALAR 0
+#define PSD_KERNEL_SSE 1
+#define PSD_KERNEL_AVX2 2
+
+typedef void (*PSDKernelFn)(const float* real, const float* imag, int bins,
+                            const float* ar_coeff, int order, float gain, float* psd);
+
+void PSDKernelScalar(const float* real, const float* imag, int bins,
+                     const float* ar_coeff, int order, float gain, float* psd);
+
+// Evaluate the spectrum with the selected implementation
+void ComputePSDKernel(const float* real, const float* imag, int bins,
+                      const float* ar_coeff, int order, float gain, float* psd);
+
+// Select an implementation. Returns false (and keeps the current one) if it is not available.
+bool PSD_SelectKernel(int kernel);
+
+// Implementation currently in use, and its name
+int PSD_ActiveKernel(void);
+const char* PSD_KernelName(int kernel);
+
+#endif  // PSD_KERNEL_H
@@ -2,13 +2,16 @@
 #define _PARAMETERS_H
 
 #include "../utils/Constants.h"
-#include "../utils/BoundedQueue.hpp"
-#include "./MEM.h"
+#include "./HRVEngine.hpp"
+#include "./Telemetry.h"
 
-// Queue to store PPI measurements
-extern BoundedQueue<uint16_t> ppiQueue;
+// Default engine, analyzing the stream received from the sensor
+typedef HRVEngine<NUM_SAMPLES, FREQ_BINS, MODEL_ORDER> DefaultHRVEngine;
+extern DefaultHRVEngine hrvEngine;
 
-// Number of PPI measurements received so far
+// Its short-term window is also published in the variables below
+
+// Number of PPI measurements in the short-term window
 extern uint32_t PPI_Count;
 
 // Previous PPI measurement
@@ -26,9 +29,6 @@ extern uint16_t HRV_MaxPPI;
 // Minimum PPI Interval
 extern uint16_t HRV_MinPPI;
 
-// Variable used in Welford's algorithm for calculating aggregate variance (sum of squared deviations)
-extern float M2;
-
 // Standard Deviation of PPI Intervals (√[ Σ (PPIᵢ - MeanPPI)² / (N - 1) ])
 extern float HRV_SDPPI;
 
@@ -38,16 +38,12 @@ extern uint16_t HRV_Prc20PPI;
 // 80th Percentile of PPI Intervals (Value below which 80% of sorted PPI intervals fall)
 extern uint16_t HRV_Prc80PPI;
 
-// Sum of squared differences between adjacent PPI intervals
-extern float sum2Diff;
-
 // Root Mean Square of Successive Differences 
 // (Square root of the mean of squared differences between adjacent PPI intervals: √[ Σ (PPIᵢ₊₁ - PPIᵢ)² / (N - 1) ])
 extern uint16_t HRV_RMSSD;
 
 // Percentage of Differences > 50 ms
 // (Percentage of adjacent PPI intervals differing by > 50 ms: (Count(PPIᵢ₊₁ - PPIᵢ> 50ms) / (N - 1)) * 100)
-extern uint32_t HRV_PPI50_Count;
 extern float HRV_pPPI50;
 
 // HRV Triangular Index
@@ -59,13 +55,13 @@ extern float HRV_HTI;
 // Baseline width of the PPI interval histogram determined by triangular interpolation: M - N
 extern uint16_t HRV_TIPPI;
 
-// Histogram of PPI intervals
-// Bin size is 7.8125 ms. Allowable range of PPI intervals is 300 - 2000 ms
-extern uint16_t hist[NUM_BINS];
-extern uint8_t maxBinValue;
-
-// MEM-based PSD Estimation Context
-extern MEM_Context mem_ctx;
+// Poincaré Plot Descriptors
+// Spread of the (PPIᵢ, PPIᵢ₊₁) plot across the identity line, SD1 = √(Var(PPIᵢ₊₁ - PPIᵢ) / 2), and along it,
+// SD2 = √(Var(PPIᵢ₊₁ + PPIᵢ) / 2), their ratio SD1 / SD2 and the area of the fitted ellipse, π · SD1 · SD2 (ms²)
+extern float HRV_SD1;
+extern float HRV_SD2;
+extern float HRV_SD1_SD2;
+extern float HRV_PoincareArea;
 
 // Total Power
 extern float HRV_TotalPower;
@@ -79,23 +75,22 @@ extern float HRV_HF;
 // Ratio of Low Frequency Power to High Frequency Power
 extern float HRV_LF_HF_Ratio;
 
+// Short-Term Detrended Fluctuation Exponent
+// Slope of log F(n) against log n, F(n) being the RMS of the linearly detrended integrated PPI series in boxes of n = 4..16 beats
+extern float HRV_DFA_Alpha1;
+
+// Sample Entropy
+// Negative log of the probability that beat sequences matching for 2 beats (within ENTROPY_TOLERANCE ms) also match for 3: ln(B / A)
+extern float HRV_SampEn;
+
+// Approximate Entropy
+// Mean log fraction of matching sequences for 2 beats minus the same for 3 beats: Φ² - Φ³
+extern float HRV_ApEn;
+
 // Function prototypes
 void resetHRVParameters(void);  // Reset all HRV parameters to default values
-void updateHRVParameters(uint16_t measurement);  // Update all HRV parameters at once
-void printHRVParameters(uint16_t measurement);   // Print all HRV parameters
-
-// Methods to update each HRV parameter individually
-void updateHRV_MedianPPI(uint16_t measurement);
-void updateHRV_MaxPPI(uint16_t measurement, uint16_t popped);
-void updateHRV_MinPPI(uint16_t measurement, uint16_t popped);
-void updateHRV_SDPPI_Mean(uint16_t measurement, uint16_t popped);
-void updateHRV_Prc20PPI(uint16_t measurement);
-void updateHRV_Prc80PPI(uint16_t measurement);
-void updateHRV_RMSSD(uint16_t measurement, uint16_t popped);
-void updateHRV_pPPI50(uint16_t measurement, uint16_t popped);
-void updateHRV_HTI(uint16_t measurement);
-void updateHRV_TIPPI(uint16_t measurement);
-void updateHistogram(uint16_t measurement, uint16_t popped);
-void updateMEM_Parameters(uint16_t measurement);
+void updateHRVParameters(uint16_t measurement);  // Push a beat into hrvEngine and publish the results
+void printHRVParameters(uint8_t session, const HRV_Snapshot& snap, uint16_t current_PPI);  // Print one session's record
+void publishShortTermWindow(void);  // Copy the first window into the HRV_* variables
 
 #endif  // _PARAMETERS_H
@@ -2,207 +2,183 @@
 
 void processPpgData(uint64_t time, float ppgGrn, float ppgRed, float ppgInf, float ppgAmb);
 
-boolean PolarBLEConnection::connected = false;
-boolean PolarBLEConnection::doConnect = false;
-boolean PolarBLEConnection::doScan = false;
-
-BLERemoteCharacteristic* PolarBLEConnection::pControlCharacteristic = nullptr;
-BLERemoteCharacteristic* PolarBLEConnection::pDataCharacteristic = nullptr;
-BLEAdvertisedDevice* PolarBLEConnection::myDevice = nullptr;
-
 BLEUUID PolarBLEConnection::serviceUUID;
 BLEUUID PolarBLEConnection::controlCharUUID;
 BLEUUID PolarBLEConnection::dataCharUUID;
 
-QueueHandle_t PolarBLEConnection::ppiQueue;
+TaskHandle_t PolarBLEConnection::ppiConsumer = NULL;
+std::mutex PolarBLEConnection::deviceLock;
 
-PolarBLEConnection::PolarBLEConnection() :
+PolarBLEConnection::PolarBLEConnection(uint8_t id) :
   PolarBLEConnection(
     SERVICE_UUID,
     CONTROL_CHAR_UUID,
-    DATA_CHAR_UUID) {
+    DATA_CHAR_UUID,
+    id) {
 }
 
 PolarBLEConnection::PolarBLEConnection(String serviceUUID,
   String controlCharUUID,
-  String dataCharUUID) {
+  String dataCharUUID,
+  uint8_t id) :
+  id(id),
+  connected(false),
+  doConnect(false),
+  doScan(false),
+  pClient(nullptr),
+  pControlCharacteristic(nullptr),
+  pDataCharacteristic(nullptr),
+  myDevice(nullptr),
+  packets(0),
+  beats(0),
+  generation(0),
+  resetRequested(false),
+  clientCallbacks(nullptr) {
   this->serviceUUID = BLEUUID(serviceUUID.c_str());
   this->controlCharUUID = BLEUUID(controlCharUUID.c_str());
   this->dataCharUUID = BLEUUID(dataCharUUID.c_str());
-
-  this->ppiQueue = xQueueCreate(PPI_QUEUE_SIZE, sizeof(PPIData));
 }
 
-// Call the correct callback function based on the type of measurement
+const PolarBLEConnection::StreamHandler PolarBLEConnection::STREAM_HANDLERS[PMD_NUM_STREAMS] = {
+  &PolarBLEConnection::emitPpg,  // PMD_STREAM_PPG
+  &PolarBLEConnection::emitAcc,  // PMD_STREAM_ACC
+  &PolarBLEConnection::emitPpi,  // PMD_STREAM_PPI
+};
+
+// Decoded values of one notification. BLE callbacks of every connection run on the single BLE
+// host task, so one buffer serves them all, as does the capture line.
+static int32_t pmdValues[PMD_MAX_VALUES];
+static char captureLine[PMD_CAPTURE_MAX_LINE];
+
+// Decode the frame with the format table and hand it to the consumer of its stream
 void PolarBLEConnection::NotifyCallback(
   BLERemoteCharacteristic* pBLERemoteCharacteristic,
   uint8_t* pData,
   size_t length,
   bool isNotify) {
 
-  switch (pData[0] & 0x3F) {
-  case 0x01:
-    PpgNotifyCallback(pData, length);
-    break;
-  case 0x03:
-    PpiNotifyCallback(pData, length);
-    break;
-  default:
-    String response = "Response: [";
-    if (length > 0) {
-      for (int i = 0; i < length; i++) {
-        response += String(pData[i], HEX) + " ";
-      }
-      response += "]";
-      Serial.println(response);
-    }
-  }  // end switch
-}
-
-// Parses the PPG data
-void PolarBLEConnection::PpgNotifyCallback(
-  uint8_t*& pData,
-  size_t& length) {
-
-  // Extract the timestamp from bytes 1 - 8
-  uint64_t timestamp = 0;
-  for (int i = 0; i < 8; i++) {
-    timestamp |= (uint64_t)pData[i + 1] << (8 * i);
+  if (pmdCaptureEnabled) {
+    uint16_t n = PMD_FormatCapture(id, millis(), pData, (uint16_t)MIN(length, (size_t)UINT16_MAX), captureLine);
+    Serial.write((const uint8_t*)captureLine, n);
   }
 
-  // Check if the PPG measurement is of type 0x00
-  if (pData[9] & 0x7F != 0x00) {
-    Serial.printf("PPG Measurement is of type %d\n", pData[9] & 0x7F);
+  PMD_Frame frame;
+  uint16_t count = PMD_DecodeFrame(pData, (uint16_t)MIN(length, (size_t)UINT16_MAX), &frame, pmdValues, PMD_MAX_VALUES);
+
+  if (frame.format == nullptr) {
+    if (length >= PMD_HEADER_SIZE) {
+      Serial.printf("Session %u: unsupported PMD frame, measurement 0x%02x type 0x%02x, %u bytes\n",
+        id, frame.measurement, frame.frameType, (unsigned)length);
+    } else {
+      Serial.printf("Session %u: short PMD frame, %u bytes\n", id, (unsigned)length);
+    }
     return;
   }
 
-  if (pData[0] & 0x80 != 0) {  // Data is compressed
-    const uint8_t CHANNELS = 0x04;
-    // Resolution is 0x16 (22 bit value)
-    const uint8_t RESOLUTION = 0x16;
-    // This takes up 3 bytes (almost)
-    const uint8_t RES_BYTES = 0x03;
-
-    // Calculate Reference Sample (first sample)
-    uint8_t refSampleIndex = 10;  // = 10
-    uint8_t refSampleSize = CHANNELS * RES_BYTES;  // = 12
-
-    uint32_t maskPmdData = -0x1 << RESOLUTION;
-    uint32_t bitmask = maskPmdData - 1;
-
-    // For each of the reference values (one for each channel)
-    std::vector<int32_t> refSample(CHANNELS);
-    for (int i = 0; i < CHANNELS; i++) {
-      // Construct a 24 bit int from the three bytes of data for each channel
-      int32_t value = 0;
-      for (int j = 0; j < 3; j++) {
-        value |= (pData[refSampleIndex + i * 3 + j] << (j * 8));
-      }
-
-      // If the result is negative, apply a bitmask to sign-extend it to 32 bits
-      if ((value & bitmask) < 0) {
-        value |= 0xFFFFFFFF << (3 * 8);
-      }
-
-      // Save reference sample into array
-      refSample[i] = value;
-    }
+  (this->*STREAM_HANDLERS[frame.format->stream])(frame, pmdValues, count);
+  packets.fetch_add(1, std::memory_order_relaxed);
+}
 
-    // Now that we have a reference sample, we can calculate the rest based off the delta frames
-
-    // Find the Delta Frame Size
-    uint8_t frameSizeIndex = (CHANNELS * RES_BYTES) + 10;  // = 22
-    uint8_t frameSize = pData[frameSizeIndex];  // In bits
-    // Samples are tightly packed (compressed) and will span byte boundaries.
-    // Number of bits per sample = frameSize*CHANNELS.
-    // Bytes per sample = ceil(bits per sample / 8.0)
-
-    // Find the Sample Count
-    uint8_t sampleCountIndex = frameSizeIndex + 1;  // = 23
-    uint8_t sampleCount = pData[sampleCountIndex];
-
-    // Extract the samples from the packet following the reference sample
-    std::vector<std::vector<int32_t>> samples(sampleCount + 1, std::vector<int32_t>(CHANNELS));
-    samples[0] = refSample;
-    uint8_t deltaDataIndex = sampleCountIndex + 1;  // = 24
-    uint8_t bitIndex = 0;
-
-    // Extract the samples from the packet following the reference sample
-    for (int sample = 1; sample <= sampleCount; sample++) {
-      for (int channel = 0; channel < CHANNELS; channel++) {
-        int32_t delta = 0;
-        // Extract the delta value from the compressed data
-        for (int bit = 0; bit < frameSize; bit++) {
-          int byteIndex = deltaDataIndex + ((bitIndex + bit) / 8);
-          int bitOffset = (bitIndex + bit) % 8;
-          int bitValue = (pData[byteIndex] >> bitOffset) & 0x01;
-          delta = ((delta | bitValue) << 1);
-        }
-        bitIndex += frameSize;
-
-        // If the delta is negative, sign extend it to 32 bits
-        if (delta != 0) {
-          delta |= (INT32_MAX << (frameSize - 1));
-        }
-
-        // Add the delta to the previous sample to get the current sample
-        samples[sample][channel] = samples[sample - 1][channel] + delta;
-      }
-    }
+// Print the control point responses, and the settings a measurement supports
+void PolarBLEConnection::ControlCallback(
+  BLERemoteCharacteristic* pBLERemoteCharacteristic,
+  uint8_t* pData,
+  size_t length,
+  bool isNotify) {
 
-    // Implement later when I find a conversion factor for the PPG values...
-    // const float CONVERSION_FACTOR = CONVERSION_FACTOR_FROM_SETTINGS;
-    // // Maybe std::transform would be better here?
-    // for (auto& sample : samples) {
-    //   for (auto& value : sample) {
-    //     value *= CONVERSION_FACTOR;
-    //   }
-    // }
-
-    // Print out the PPG data
-    for (const auto& sample : samples) {
-      float ppgGrn = sample[0];
-      float ppgRed = sample[1];
-      float ppgInf = sample[2];
-      float ppgAmb = sample[3];
-
-      processPpgData(timestamp, ppgGrn, ppgRed, ppgInf, ppgAmb);
+  PMD_ControlResponse response;
+  if (!PMD_ParseControlResponse(pData, (uint16_t)MIN(length, (size_t)UINT16_MAX), &response)) {
+    Serial.printf("Session %u: control point sent %u bytes that are not a response\n", id, (unsigned)length);
+    return;
+  }
+  Serial.printf("Session %u: op 0x%02x measurement 0x%02x: %s\n", id, response.opCode, response.measurement,
+    PMD_StatusName(response.status));
+
+  PMD_Settings settings;
+  if (response.opCode == PMD_OP_GET_SETTINGS && response.status == 0 &&
+      PMD_ParseSettings(response.params, response.paramLength, &settings)) {
+    Serial.printf(" - sample rates:");
+    for (uint8_t i = 0; i < settings.numSampleRates; i++) {
+      Serial.printf(" %u", settings.sampleRates[i]);
     }
+    Serial.printf(" Hz, resolution %u bits, range %u, %u channels\n", settings.resolution, settings.range,
+      settings.channels);
+  }
+}
 
-  } else {
-    Serial.println("Data packet is uncompressed. Parsing not implemented.");
+void PolarBLEConnection::emitPpg(const PMD_Frame& frame, int32_t* values, uint16_t count) {
+#if PPI_SOURCE == PPI_SOURCE_PPG
+  // Hand the green channel to ComputeTask, which detects the beats. Samples that do not fit
+  // are counted as overruns by the ring.
+  for (uint16_t i = 0; i < count; i++) {
+    values[i] = values[i * PPG_CHANNELS];
+  }
+  ppgRing.pushBatch(values, count);
+
+  if (count > 0 && ppiConsumer != NULL) {
+    xTaskNotifyGive(ppiConsumer);
+  }
+#else
+  // Implement later when I find a conversion factor for the PPG values...
+  // const float CONVERSION_FACTOR = CONVERSION_FACTOR_FROM_SETTINGS;
+
+  // Print out the PPG data
+  for (uint16_t i = 0; i < count; i++) {
+    const int32_t* sample = &values[i * PPG_CHANNELS];
+    processPpgData(frame.timestamp, sample[0], sample[1], sample[2], sample[3]);
   }
+#endif
 }
 
 // Print out the ppg measurement values in a CSV format
 void processPpgData(uint64_t time, float ppgGrn, float ppgRed, float ppgInf, float ppgAmb) {
   if ((ppgGrn != 0) && (ppgRed != 0) && (ppgInf != 0) && (ppgAmb != 0)) {
     // CSV output (Add header to top of file)
-    Serial.printf("%"PRIu64",%8.0f,%8.0f,%8.0f,%8.0f\n", time, ppgGrn, ppgRed, ppgInf, ppgAmb);
+    Serial.printf("%" PRIu64 ",%8.0f,%8.0f,%8.0f,%8.0f\n", time, ppgGrn, ppgRed, ppgInf, ppgAmb);
   }
 }
 
-// Parses the PPI data
-void PolarBLEConnection::PpiNotifyCallback(
-  uint8_t*& pData,
-  size_t& length) {
+void PolarBLEConnection::emitAcc(const PMD_Frame& frame, int32_t* values, uint16_t count) {
+  // Turn the x, y, z values of each sample into an ACCSample and hand them over a batch at a time,
+  // as a delta frame can carry hundreds of samples. Samples that do not fit are counted as
+  // overruns by the ring.
+  ACCSample batch[ACC_PUSH_BATCH];
+  for (uint16_t start = 0; start < count; start += ACC_PUSH_BATCH) {
+    uint16_t n = MIN(count - start, ACC_PUSH_BATCH);
+    for (uint16_t i = 0; i < n; i++) {
+      const int32_t* sample = &values[(start + i) * 3];
+      batch[i].x = sample[0];
+      batch[i].y = sample[1];
+      batch[i].z = sample[2];
+    }
+    accRing.pushBatch(batch, n);
+  }
+}
 
-  for (int i = 10; i < length; i += 6) {
-    // Extract the data from the current ppi response
-    uint8_t heartRate = pData[i];
-    uint16_t ppi = pData[i + 1] | (pData[i + 2] << 8);
-    uint16_t ppError = pData[i + 3] | (pData[i + 4] << 8);
-    uint8_t flags = pData[i + 5];
+void PolarBLEConnection::emitPpi(const PMD_Frame& frame, int32_t* values, uint16_t count) {
+  // Turn every beat of the notification into a PPIData, then hand them over in one batch
+  PPIData batch[PPI_MAX_BEATS];
+  count = MIN(count, PPI_MAX_BEATS);
 
-    PPIData data;
+  for (uint16_t i = 0; i < count; i++) {
+    const int32_t* beat = &values[i * 4];  // Heart rate, PPI, error estimate, flags
+    PPIData& data = batch[i];
     data.timestamp = millis();
-    data.heartRate = heartRate;
-    data.ppi = ppi;
-    data.ppError = ppError;
-    data.flags = flags;
-    data.valid = !(flags & 0x1) && ppError > 0 && ppError < 30;  // ignore skin flags for now
+    data.heartRate = (uint8_t)beat[0];
+    data.ppi = (uint16_t)beat[1];
+    data.ppError = (uint16_t)beat[2];
+    data.flags = (uint8_t)beat[3];
+    data.valid = !(data.flags & 0x1) && data.ppError > 0 && data.ppError < 30;  // ignore skin flags for now
+  }
+
+  // Beats that do not fit are counted as overruns by the ring
+  ppiRing.pushBatch(batch, count);
+  beats.fetch_add(count, std::memory_order_relaxed);
 
-    xQueueSendToBack(ppiQueue, &data, 0);
+  // Wake ComputeTask. The notification count is latched, so a wakeup sent while it is still
+  // draining the previous batch is not lost.
+  if (count > 0 && ppiConsumer != NULL) {
+    xTaskNotifyGive(ppiConsumer);
   }
 }
 
@@ -210,7 +186,7 @@ void PolarBLEConnection::ReadData() {
   if (pControlCharacteristic->canRead()) {
     String rawData = pControlCharacteristic->readValue();
     String response = "Control says: ";
-    for (int i = 0; i < rawData.length(); i++) {
+    for (size_t i = 0; i < rawData.length(); i++) {
       response += String(rawData[i], HEX) + " ";
     }
     Serial.println(response);
@@ -219,14 +195,44 @@ void PolarBLEConnection::ReadData() {
   }
 }
 
+void PolarBLEConnection::Release() {
+  // From here on, events of the client belong to the released sensor
+  generation.fetch_add(1);
+  if (pClient != nullptr && connected) {
+    pClient->disconnect();
+  }
+  connected = false;
+  doConnect = false;
+  doScan = false;
+
+  // Detach the device before freeing it, so the scan callback never sees a freed pointer
+  BLEAdvertisedDevice* device;
+  {
+    std::lock_guard<std::mutex> lock(deviceLock);
+    device = myDevice;
+    myDevice = nullptr;
+  }
+  delete device;
+
+  // The beats of the released sensor must not reach the next one's analysis
+  resetRequested.store(true);
+  if (ppiConsumer != NULL) {
+    xTaskNotifyGive(ppiConsumer);
+  }
+}
+
 bool PolarBLEConnection::ConnectToServer() {
-  Serial.print("Connecting to ");
+  Serial.printf("Session %u: connecting to ", id);
   Serial.println(myDevice->getAddress().toString());
 
-  BLEClient* pClient = BLEDevice::createClient();
-  Serial.println(" - Created client");
-
-  pClient->setClientCallbacks(new MyClientCallback());
+  // The client is kept and reused when the session reconnects
+  if (pClient == nullptr) {
+    pClient = BLEDevice::createClient();
+    clientCallbacks = new MyClientCallback(this);
+    pClient->setClientCallbacks(clientCallbacks);
+    Serial.println(" - Created client");
+  }
+  clientCallbacks->arm(generation.load());
 
   // neopixelWrite(ONBOARD_LED, 0, 0, 0);
 
@@ -273,26 +279,23 @@ bool PolarBLEConnection::ConnectToServer() {
 
   if (pControlCharacteristic->canNotify()) {
     pControlCharacteristic->registerForNotify([this](BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-      this->NotifyCallback(pBLERemoteCharacteristic, pData, length, isNotify);
+      this->ControlCallback(pBLERemoteCharacteristic, pData, length, isNotify);
       });
     Serial.println(" - Registered for control notifications");
   } else if (pControlCharacteristic->canIndicate()) {
     pControlCharacteristic->registerForNotify([this](BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-      this->NotifyCallback(pBLERemoteCharacteristic, pData, length, isNotify);
+      this->ControlCallback(pBLERemoteCharacteristic, pData, length, isNotify);
       }, false);
     Serial.println(" - Registered for control indications");
   } else {
     Serial.println(" * Control characteristic doesn't support notifications or indications");
   }
 
-  uint8_t getPpg[] = { 0x01, 0x01 };
-  uint8_t getAccel[] = { 0x01, 0x02 };
-  uint8_t getPpi[] = { 0x01, 0x03 };
-
-  uint8_t startPpg[] = { 0x02, 0x01, 0x00, 0x01, 0x87, 0x00, 0x01, 0x01, 0x16, 0x00, 0x04, 0x01, 0x04 };
-  uint8_t startAccel[] = { 0x02, 0x02, 0x00, 0x01, 0x34, 0x00, 0x01, 0x01, 0x10, 0x00, 0x02, 0x01, 0x08, 0x00, 0x04, 0x01, 0x03 };
-  uint8_t startPpi[] = { 0x02, 0x03 };
-  uint8_t startSdk[] = { 0x02, 0x09 };
+  // Kept for the commands commented out below
+  [[maybe_unused]] uint8_t getPpg[] = { 0x01, 0x01 };
+  [[maybe_unused]] uint8_t getAccel[] = { 0x01, 0x02 };
+  [[maybe_unused]] uint8_t startPpg[] = { 0x02, 0x01, 0x00, 0x01, 0x87, 0x00, 0x01, 0x01, 0x16, 0x00, 0x04, 0x01, 0x04 };
+  [[maybe_unused]] uint8_t startAccel[] = { 0x02, 0x02, 0x00, 0x01, 0x34, 0x00, 0x01, 0x01, 0x10, 0x00, 0x02, 0x01, 0x08, 0x00, 0x04, 0x01, 0x03 };
 
   // Serial.println("Fetching Accel State");
   // pControlCharacteristic->writeValue(getAccel, sizeof(getAccel), true);
@@ -322,6 +325,22 @@ bool PolarBLEConnection::ConnectToServer() {
   // pControlCharacteristic->writeValue(getPpg, sizeof(getPpg), true);
   // delay(1000);
 
+#if PPI_SOURCE == PPI_SOURCE_PPG
+  // Beats are detected locally from the PPG stream at 176 Hz, which needs SDK mode
+  uint8_t startSdk[] = { 0x02, 0x09 };
+  uint8_t startPpgSdk[] = { 0x02, 0x01, 0x00, 0x01, 0xB0, 0x00, 0x01, 0x01, 0x16, 0x00, 0x04, 0x01, 0x04 };
+
+  Serial.println("Entering SDK Mode");
+  pControlCharacteristic->writeValue(startSdk, sizeof(startSdk), true);
+  delay(1000);  // Wait for SDK mode to be enabled
+
+  Serial.println("Starting PPG Measurements");
+  pControlCharacteristic->writeValue(startPpgSdk, sizeof(startPpgSdk), true);
+  delay(1000);
+#else
+  uint8_t getPpi[] = { 0x01, 0x03 };
+  uint8_t startPpi[] = { 0x02, 0x03 };
+
   Serial.println("Starting PPI Measurements");
   pControlCharacteristic->writeValue(startPpi, sizeof(startPpi), true);
   delay(1000);
@@ -329,6 +348,7 @@ bool PolarBLEConnection::ConnectToServer() {
   Serial.println("Fetching PPI State");
   pControlCharacteristic->writeValue(getPpi, sizeof(getPpi), true);
   delay(1000);
+#endif
 
   // Send [0x01 0x01] (read ppg settings) in normal mode
   // f0 01 01 - control point response for read ppg (0x01 0x01)
@@ -2,20 +2,34 @@
 #define _POLARBLECONNECT_H
 
 #include "../utils/Constants.h"
+#include "../utils/SpscRing.hpp"
+#include "./PMDCapture.h"
+#include "./PMDDecoder.h"
 
 #include <BLEDevice.h>
 #include <BLEUtils.h>
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
 #include <queue>
+#include <atomic>
+#include <mutex>
 
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
+#include <freertos/task.h>
 
 #define SERVICE_UUID "FB005C80-02E7-F387-1CAD-8ACD2D8DF0C8"
 #define CONTROL_CHAR_UUID "FB005C81-02E7-F387-1CAD-8ACD2D8DF0C8"
 #define DATA_CHAR_UUID "FB005C82-02E7-F387-1CAD-8ACD2D8DF0C8"
 #define MTU 232
+#define PPI_FRAME_SIZE 6  // Bytes per beat in a PPI notification
+#define PPI_HEADER_SIZE 10  // Bytes before the first beat
+#define PPI_MAX_BEATS ((MTU - PPI_HEADER_SIZE) / PPI_FRAME_SIZE)
+#define PPG_CHANNELS 4   // Green, red, infrared, ambient
+#define PPG_REF_BYTES 3  // 22 bit reference values
+// Most samples one PPG notification can carry (a single block of 1 bit deltas)
+#define PPG_MAX_SAMPLES (1 + (MTU - PMD_HEADER_SIZE - PPG_CHANNELS * PPG_REF_BYTES - 2) * 8 / PPG_CHANNELS)
+// Most values one notification of any format can carry (1 bit deltas plus a reference sample)
+#define PMD_MAX_VALUES ((MTU - PMD_HEADER_SIZE) * 8 + PMD_MAX_CHANNELS)
 
 typedef struct ppi_data {
   unsigned long timestamp;
@@ -26,45 +40,66 @@ typedef struct ppi_data {
   bool     valid;
 } PPIData;
 
+// One accelerometer sample, in the units of the range the stream was started with
+typedef struct acc_sample {
+  int32_t x;
+  int32_t y;
+  int32_t z;
+} ACCSample;
+
 class PolarBLEConnection {
   public:
-    static boolean connected;
-    static boolean doConnect;
-    static boolean doScan;
+    class MyClientCallback;
+
+    // Session number of this connection (index in sensorSessions)
+    uint8_t id;
+
+    boolean connected;
+    boolean doConnect;  // A sensor was assigned by the scan and should be connected
+    boolean doScan;     // The sensor was lost; release it and scan for another
 
-    static BLERemoteCharacteristic* pControlCharacteristic;
-    static BLERemoteCharacteristic* pDataCharacteristic;
-    static BLEAdvertisedDevice* myDevice;
+    BLEClient* pClient;
+    BLERemoteCharacteristic* pControlCharacteristic;
+    BLERemoteCharacteristic* pDataCharacteristic;
+    // Sensor assigned to this connection (nullptr = free). The scan callback reads it on the BLE
+    // host task, so it is assigned and cleared only under deviceLock.
+    BLEAdvertisedDevice* myDevice;
+    static std::mutex deviceLock;
 
     static BLEUUID serviceUUID;
     static BLEUUID controlCharUUID;
     static BLEUUID dataCharUUID;
 
-    static QueueHandle_t ppiQueue;
+    // Beats handed from the BLE callback (Core 0) to ComputeTask (Core 1)
+    SpscRing<PPIData, PPI_QUEUE_SIZE> ppiRing;
+    // Green PPG samples handed to ComputeTask for beat detection (PPI_SOURCE_PPG)
+    SpscRing<int32_t, PPG_QUEUE_SIZE> ppgRing;
+    // Accelerometer samples, if the ACC stream was started
+    SpscRing<ACCSample, ACC_QUEUE_SIZE> accRing;
+    // Task notified after each batch of beats or samples is pushed (ComputeTask, shared by every connection)
+    static TaskHandle_t ppiConsumer;
 
     // Default constructor
-    PolarBLEConnection();
+    PolarBLEConnection(uint8_t id = 0);
 
     // Parameterized constructor
-    PolarBLEConnection(String serviceUUID, String controlCharUUID, String dataCharUUID);
+    PolarBLEConnection(String serviceUUID, String controlCharUUID, String dataCharUUID, uint8_t id = 0);
 
     // Callback functions
-    // Parses the data from the control characteristic for all notifications
+    // Decodes a notification of the data characteristic with the PMD_FORMATS table and hands
+    // the samples to the ring of their stream
     void NotifyCallback(
       BLERemoteCharacteristic* pBLERemoteCharacteristic,
       uint8_t* pData,
       size_t length,
       bool isNotify);
 
-    // Parses the PPG data
-    void PpgNotifyCallback(
-      uint8_t* &pData,
-      size_t &length);
-
-    // Parses the PPI data
-    void PpiNotifyCallback(
-      uint8_t* &pData,
-      size_t &length);
+    // Prints the control point responses
+    void ControlCallback(
+      BLERemoteCharacteristic* pBLERemoteCharacteristic,
+      uint8_t* pData,
+      size_t length,
+      bool isNotify);
 
     // Read data from the control characteristic and then
     // print it to the Serial Monitor in raw hexadecimal format
@@ -74,21 +109,82 @@ class PolarBLEConnection {
     // flag to true and return true. Otherwise, return false.
     bool ConnectToServer();
 
+    // Forget the assigned sensor so the scan can hand this connection another one. Client
+    // events still pending for the released sensor are ignored, and the consumer is asked to
+    // reset the session's analysis (takeReset()), as the next sensor may be another subject.
+    void Release();
+
+    // Consumer: true once after each Release()
+    bool takeReset() { return resetRequested.exchange(false); }
+
+    // Counters of the BLE callback side. Written only by the callback, readable from any core.
+    uint32_t getPackets() const { return packets.load(std::memory_order_relaxed); }
+    uint32_t getBeats() const { return beats.load(std::memory_order_relaxed); }
+
+  private:
+    // Consumers of decoded frames, one per PMD_Stream. count samples of
+    // frame.format->channels values each are in values, which they may overwrite.
+    void emitPpg(const PMD_Frame& frame, int32_t* values, uint16_t count);
+    void emitAcc(const PMD_Frame& frame, int32_t* values, uint16_t count);
+    void emitPpi(const PMD_Frame& frame, int32_t* values, uint16_t count);
+
+    typedef void (PolarBLEConnection::*StreamHandler)(const PMD_Frame&, int32_t*, uint16_t);
+    static const StreamHandler STREAM_HANDLERS[PMD_NUM_STREAMS];
+
+    std::atomic<uint32_t> packets;  // PPI, PPG and ACC notifications parsed
+    std::atomic<uint32_t> beats;    // Beats parsed (including those the ring rejected)
+
+    // Sensors released so far. Client events carry the generation they were armed with, so
+    // events of a released sensor cannot touch the flags of the next one.
+    std::atomic<uint32_t> generation;
+    std::atomic<bool> resetRequested;   // Set by Release(), taken by the consumer
+    MyClientCallback* clientCallbacks;  // Owned by pClient's callbacks, created with it
+
+  public:
   // Class definitions
+  // Events of the connection's client. The client is reused for every sensor the session gets,
+  // so ConnectToServer() arms the callbacks with the current generation before each connect.
+  // Events that arrive after a Release() belong to the released sensor and are dropped; the stack
+  // reports the disconnect of a link before the next connect on the same client completes.
   class MyClientCallback : public BLEClientCallbacks {
-    void onConnect(BLEClient* pclient) {
-      connected = true;
-    }
-
-    void onDisconnect(BLEClient* pclient) {
-      connected = false;
-      Serial.println("Disconnected");
-    }
+    public:
+      MyClientCallback(PolarBLEConnection* connection) : connection_(connection), generation_(0) {}
+
+      void arm(uint32_t generation) {
+        generation_.store(generation);
+      }
+
+      void onConnect(BLEClient* pclient) {
+        if (stale()) {
+          return;
+        }
+        connection_->connected = true;
+      }
+
+      void onDisconnect(BLEClient* pclient) {
+        if (stale()) {
+          return;
+        }
+        connection_->connected = false;
+        connection_->doScan = true;
+        Serial.printf("Session %u disconnected\n", connection_->id);
+      }
+
+    private:
+      bool stale() const {
+        return generation_.load() != connection_->generation.load();
+      }
+
+      PolarBLEConnection* connection_;
+      std::atomic<uint32_t> generation_;  // Generation of the sensor these events belong to
   };  // class MyClientCallback
 
+  // Hands each newly found sensor to the first free connection, so several sensors can be
+  // connected at once. Scanning stops once every connection has a sensor.
   class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
     public:
-      MyAdvertisedDeviceCallbacks(String deviceName) : device_name_(deviceName) {}
+      MyAdvertisedDeviceCallbacks(String deviceName, PolarBLEConnection* const* connections, uint8_t count) :
+        device_name_(deviceName), connections_(connections), count_(count) {}
 
       ~MyAdvertisedDeviceCallbacks() {}
 
@@ -100,21 +196,53 @@ class PolarBLEConnection {
         // Print (or not) each device found
         // Serial.println("Found device: " + advertisedDevice.toString());
         // delay(20);
-        if (advertisedDevice.getName().indexOf(device_name_) != -1) {
-          // Found the device we are looking for!
-          Serial.println("Found device: " + advertisedDevice.toString());
-          BLEDevice::getScan()->stop();
-          if (myDevice != nullptr) {
-            delete myDevice;
-            myDevice = nullptr;
+        if (advertisedDevice.getName().indexOf(device_name_) == -1) {
+          return;  // We do not care about the advertised device, so just continue scanning
+        }
+
+        // Skip sensors that already belong to a connection. The lock keeps Release() from freeing
+        // a device while it is compared here.
+        std::lock_guard<std::mutex> lock(PolarBLEConnection::deviceLock);
+        PolarBLEConnection* free = nullptr;
+        for (uint8_t i = 0; i < count_; i++) {
+          BLEAdvertisedDevice* device = connections_[i]->myDevice;
+          if (device != nullptr && device->getAddress().equals(advertisedDevice.getAddress())) {
+            return;
+          }
+          if (device == nullptr && free == nullptr) {
+            free = connections_[i];
           }
-          myDevice = new BLEAdvertisedDevice(advertisedDevice);
-          doConnect = true;
         }
-        // else we do not care about the advertised device, so just continue scanning
+        if (free == nullptr) {
+          return;
+        }
+
+        // Found a device we are looking for!
+        Serial.printf("Found device for session %u: %s\n", free->id, advertisedDevice.toString().c_str());
+        free->myDevice = new BLEAdvertisedDevice(advertisedDevice);
+        free->doConnect = true;
+
+        if (countFree() == 0) {
+          BLEDevice::getScan()->stop();
+        }
+      }
+
+      // Connections without a sensor
+      uint8_t freeConnections() const {
+        std::lock_guard<std::mutex> lock(PolarBLEConnection::deviceLock);
+        return countFree();
       }
 
     private:
+      // freeConnections() for callers holding deviceLock
+      uint8_t countFree() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < count_; i++) {
+          n += connections_[i]->myDevice == nullptr;
+        }
+        return n;
+      }
+
       void processPpgData(uint64_t time,
                                  float ppgGrn,
                                  float ppgRed,
@@ -122,6 +250,8 @@ class PolarBLEConnection {
                                  float ppgAmb);
 
       String device_name_;
+      PolarBLEConnection* const* connections_;
+      uint8_t count_;
   };  // class MyAdvertisedDeviceCallbacks
 
 };  // class PolarBLEConnection
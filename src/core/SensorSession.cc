@@ -0,0 +1,204 @@
+#include "SensorSession.h"
+
+SensorSession sensorSessions[MAX_SENSORS];
+PolarBLEConnection* sensorConnections[MAX_SENSORS];
+
+// Engines of the sessions after the first, which uses hrvEngine
+static DefaultHRVEngine sessionEngines[MAX_SENSORS > 1 ? MAX_SENSORS - 1 : 1];
+
+static_assert(sizeof(DefaultHRVEngine) * MAX_SENSORS <= HRV_ENGINE_RAM_BUDGET,
+  "The HRV engines of MAX_SENSORS sessions exceed HRV_ENGINE_RAM_BUDGET: lower MAX_SENSORS or the window sizes");
+
+// Session served last by Sessions_Service()
+static uint8_t lastServed = MAX_SENSORS - 1;
+
+// Set by the serial command task, taken by ComputeTask
+static std::atomic<bool> statsRequested(false);
+
+SensorSession::SensorSession() :
+  engine(nullptr),
+  output(nullptr),
+  prevPPI(0),
+  processed(0),
+  rejected(0),
+  accSamples(0),
+  lastAcc(),
+  reportedBeats(0),
+  reportedAt(0) {
+}
+
+void SensorSession::begin(uint8_t id, DefaultHRVEngine* engine) {
+  connection.id = id;
+  this->engine = engine;
+  engine->reset();
+  detector.reset();
+  prevPPI = 0;
+  processed = 0;
+  rejected = 0;
+  accSamples = 0;
+  lastAcc = ACCSample();
+  reportedBeats = 0;
+  reportedAt = millis();
+}
+
+uint16_t SensorSession::drain(uint16_t maxBeats) {
+  uint16_t total = 0;
+
+  while (total < maxBeats) {
+    uint16_t count = connection.ppiRing.popBatch(beats, MIN(maxBeats - total, SESSION_BATCH));
+    if (count == 0) {
+      break;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      process(beats[i]);
+    }
+    processed += count;
+    total += count;
+  }
+
+  // PPG samples cost a few hundred ns each, so a batch of them is worth about one beat
+  uint16_t count = connection.ppgRing.popBatch(ppgSamples, MIN(maxBeats, SESSION_BATCH) * PPG_SAMPLES_PER_BEAT);
+  for (uint16_t i = 0; i < count; i++) {
+    if (detector.push(ppgSamples[i])) {
+      PPIData beat;
+      beat.timestamp = millis();
+      beat.ppi = (uint16_t)(detector.ppi() + 0.5f);
+      beat.heartRate = (uint8_t)MIN(60000 / MAX(beat.ppi, 1), 255);
+      beat.ppError = 0;
+      beat.flags = 0;
+      beat.valid = true;
+      process(beat);
+      processed++;
+    }
+  }
+
+  // Only the latest accelerometer sample is kept, for the stats and motion checks, so the samples
+  // are taken one at a time rather than through a buffer
+  uint16_t accLimit = MIN(maxBeats, SESSION_BATCH) * PPG_SAMPLES_PER_BEAT;
+  uint16_t accCount = 0;
+  while (accCount < accLimit && connection.accRing.pop(lastAcc)) {
+    accCount++;
+  }
+  accSamples += accCount;
+  return total + count + accCount;
+}
+
+void SensorSession::restart() {
+  connection.ppiRing.discard();
+  connection.ppgRing.discard();
+  connection.accRing.discard();
+  // Session 0 also publishes the HRV_* variables of its engine
+  if (connection.id == 0) {
+    resetHRVParameters();
+  } else {
+    engine->reset();
+  }
+  detector.reset();
+  prevPPI = 0;
+  lastAcc = ACCSample();
+}
+
+void SensorSession::process(const PPIData& currentData) {
+  // Accept the beat if it is valid and not too different from the last measurement
+  bool valid = ((abs(currentData.ppi - prevPPI) < MAX_PPI_DIFF) || prevPPI < BIN_START) && currentData.valid;
+
+  // Otherwise keep the previous PPI
+  uint16_t validPPI = valid ? currentData.ppi : prevPPI;
+  prevPPI = validPPI;
+  if (!valid) {
+    rejected++;
+  }
+
+  // Update all HRV parameters given the most recent valid PPI. The first session is the
+  // default engine, which also publishes the HRV_* variables.
+  if (validPPI > 0) {
+    if (connection.id == 0) {
+      updateHRVParameters(validPPI);
+    } else {
+      engine->push(validPPI);
+    }
+  }
+
+  printHRVParameters(connection.id, engine->snapshot(), validPPI);
+
+  if (output != nullptr) {
+    output->enqueue(validPPI);
+  }
+}
+
+void SensorSession::printStats(uint32_t now) {
+  uint32_t elapsed = now - reportedAt;
+  float rate = elapsed > 0 ? (processed - reportedBeats) * 1000.0f / elapsed : 0.0f;
+
+  Serial.printf("Session %u: %s, %u packets, %u beats, %u processed (%.2f beats/s), %u dropped, %u rejected, high-water %u/%u\n",
+    connection.id, connection.connected ? "connected" : "disconnected",
+    (unsigned)connection.getPackets(), (unsigned)connection.getBeats(), (unsigned)processed, rate,
+    (unsigned)getDropped(), (unsigned)rejected,
+    (unsigned)connection.ppiRing.getHighWater(), (unsigned)connection.ppiRing.getCapacity());
+  if (accSamples > 0) {
+    Serial.printf("Session %u: %u ACC samples, %u dropped, last (%d, %d, %d)\n", connection.id, (unsigned)accSamples,
+      (unsigned)connection.accRing.getOverruns(), (int)lastAcc.x, (int)lastAcc.y, (int)lastAcc.z);
+  }
+
+  reportedBeats = processed;
+  reportedAt = now;
+}
+
+void Sessions_Init(void) {
+  for (uint8_t i = 0; i < MAX_SENSORS; i++) {
+    sensorSessions[i].begin(i, i == 0 ? &hrvEngine : &sessionEngines[i - 1]);
+    sensorConnections[i] = &sensorSessions[i].connection;
+  }
+  lastServed = MAX_SENSORS - 1;
+}
+
+uint32_t Sessions_Service(uint16_t batch) {
+  for (uint8_t i = 0; i < MAX_SENSORS; i++) {
+    if (sensorSessions[i].connection.takeReset()) {
+      sensorSessions[i].restart();
+    }
+  }
+
+  uint32_t total = 0;
+  uint16_t served;
+  do {
+    // One pass gives every session at most one batch, so a busy sensor cannot starve the others
+    served = 0;
+    uint8_t first = (lastServed + 1) % MAX_SENSORS;
+    for (uint8_t n = 0; n < MAX_SENSORS; n++) {
+      uint8_t i = (first + n) % MAX_SENSORS;
+      uint16_t count = sensorSessions[i].drain(batch);
+      if (count > 0) {
+        served += count;
+        lastServed = i;
+      }
+    }
+    total += served;
+  } while (served > 0);
+  return total;
+}
+
+void Sessions_PrintStats(void) {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < MAX_SENSORS; i++) {
+    if (sensorSessions[i].isActive() || sensorSessions[i].getProcessed() > 0) {
+      sensorSessions[i].printStats(now);
+    }
+  }
+}
+
+void Sessions_RequestStats(void) {
+  statsRequested.store(true);
+}
+
+bool Sessions_TakeStatsRequest(void) {
+  return statsRequested.exchange(false);
+}
+
+uint32_t Sessions_Dropped(void) {
+  uint32_t dropped = 0;
+  for (uint8_t i = 0; i < MAX_SENSORS; i++) {
+    dropped += sensorSessions[i].getDropped();
+  }
+  return dropped;
+}
@@ -0,0 +1,100 @@
+#ifndef _SENSOR_SESSION_H
+#define _SENSOR_SESSION_H
+
+#include "../utils/Constants.h"
+#include "../utils/BoundedQueue.hpp"
+#include "./PolarBLEConnection.h"
+#include "./Parameters.h"
+#include "./PPGBeatDetector.h"
+
+// One subject: a sensor connection with its receive rings and PMD parser, the PPG beat detector,
+// the PPI validation state and an HRV engine. The BLE callback of the connection produces beats
+// (or PPG samples) on Core 0 and ComputeTask consumes them with drain() on Core 1.
+class SensorSession {
+  public:
+    PolarBLEConnection connection;
+    DefaultHRVEngine* engine;
+    PPGBeatDetector detector;  // Turns PPG samples into beats (PPI_SOURCE_PPG)
+
+    // Valid PPIs are also queued here for the paced PWM output (nullptr = not queued)
+    BoundedQueue<uint16_t, PPI_QUEUE_SIZE>* output;
+
+    SensorSession();
+
+    // Attach the session number and engine. Session 0 must use hrvEngine.
+    void begin(uint8_t id, DefaultHRVEngine* engine);
+
+    // Validate, analyze and report up to maxBeats queued beats, then run the beat detector over
+    // up to maxBeats * PPG_SAMPLES_PER_BEAT queued PPG samples and take as many accelerometer
+    // samples. Returns the number of beats and samples taken, so the scheduler knows whether
+    // anything was left to do.
+    uint16_t drain(uint16_t maxBeats);
+
+    // A sensor is assigned to the session
+    bool isActive() const {
+      return connection.myDevice != nullptr;
+    }
+
+    uint8_t getId() const { return connection.id; }
+
+    // Counters of the compute side
+    uint32_t getProcessed() const { return processed; }  // Beats taken from the ring
+    uint32_t getRejected() const { return rejected; }    // Beats replaced by the previous valid PPI
+    uint32_t getDropped() const { return connection.ppiRing.getOverruns(); }  // Beats the ring rejected
+    uint32_t getAccSamples() const { return accSamples; }  // Accelerometer samples taken from the ring
+
+    // Most recent accelerometer sample (zero until one arrived)
+    const ACCSample& getAcc() const { return lastAcc; }
+
+    // Print the counters and the throughput since the previous report
+    void printStats(uint32_t now);
+
+    // Start the analysis over for the next sensor: drop what the released one left in the
+    // rings and reset the engine, the beat detector and the PPI validation. The counters keep
+    // running. ComputeTask only.
+    void restart();
+
+  private:
+    // Validate, analyze and report one beat
+    void process(const PPIData& currentData);
+
+    uint16_t prevPPI;        // Most recent valid PPI
+    uint32_t processed;
+    uint32_t rejected;
+    uint32_t accSamples;
+    ACCSample lastAcc;
+    uint32_t reportedBeats;  // processed at the previous report
+    uint32_t reportedAt;     // millis() of the previous report
+
+    // Beats and PPG samples taken by drain(). Members rather than locals, as PWM_Task has a small
+    // stack.
+    PPIData beats[SESSION_BATCH];
+    int32_t ppgSamples[SESSION_BATCH * PPG_SAMPLES_PER_BEAT];
+};
+
+extern SensorSession sensorSessions[MAX_SENSORS];
+
+// Connections of every session, in session order (for the scan callback)
+extern PolarBLEConnection* sensorConnections[MAX_SENSORS];
+
+// Number every session and give it an engine. Session 0 gets the default engine hrvEngine.
+void Sessions_Init(void);
+
+// Round-robin scheduler: restart the sessions whose sensor was released, then take up to batch
+// beats from each session in turn, starting after the session served last, until every ring is
+// empty. Returns the number of beats processed.
+uint32_t Sessions_Service(uint16_t batch);
+
+// Print the counters of every active session. ComputeTask only, as it writes the counters.
+void Sessions_PrintStats(void);
+
+// Ask ComputeTask to print the counters (the "stats" command), from any task
+void Sessions_RequestStats(void);
+
+// True once after each Sessions_RequestStats()
+bool Sessions_TakeStatsRequest(void);
+
+// Beats dropped by the receive rings of all sessions
+uint32_t Sessions_Dropped(void);
+
+#endif  // _SENSOR_SESSION_H
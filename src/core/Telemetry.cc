@@ -0,0 +1,170 @@
+#include "./Telemetry.h"
+
+#include <atomic>
+
+uint8_t telemetryMode = TELEMETRY_MODE;
+uint32_t telemetryDroppedFrames = 0;
+
+#define TELEMETRY_FIELD_SCALE(name, scale) scale,
+static const double TELEMETRY_SCALES[TELEMETRY_NUM_FIELDS] = {
+  TELEMETRY_SCHEMA(TELEMETRY_FIELD_SCALE)
+};
+#undef TELEMETRY_FIELD_SCALE
+
+static ByteRing<TELEMETRY_TX_BUFFER> txRing;
+
+// Mode asked for by another task, or TELEMETRY_NO_REQUEST
+#define TELEMETRY_NO_REQUEST 0xFF
+static std::atomic<uint8_t> requestedMode(TELEMETRY_NO_REQUEST);
+
+// Encoder state of each session
+static struct {
+  int32_t previous[TELEMETRY_NUM_FIELDS];  // Quantized values of the last record sent
+  uint16_t sequence;
+  uint16_t sinceKeyframe;
+  bool synced;  // A keyframe was sent and no frame dropped since (all zero = start with a keyframe)
+} encoders[MAX_SENSORS];
+
+void Telemetry_Reset(void) {
+  txRing.clear();
+  memset(encoders, 0, sizeof(encoders));
+  telemetryDroppedFrames = 0;
+}
+
+void Telemetry_RequestMode(uint8_t mode) {
+  requestedMode.store(mode);
+}
+
+void Telemetry_Service(void) {
+  uint8_t mode = requestedMode.exchange(TELEMETRY_NO_REQUEST);
+  if (mode != TELEMETRY_NO_REQUEST) {
+    // A new binary stream starts from keyframes, so a decoder can join it from the first frame
+    if (mode == TELEMETRY_BINARY) {
+      Telemetry_Reset();
+    }
+    telemetryMode = mode;
+  }
+  Telemetry_Flush();
+}
+
+bool Telemetry_Pending(void) {
+  return !txRing.isEmpty();
+}
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+uint16_t Telemetry_CRC16(const uint8_t* data, uint16_t length) {
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Consistent Overhead Byte Stuffing: removes every 0x00 from the data so 0x00 can delimit frames.
+// Output holds at most length + length / 254 + 1 bytes. Returns the encoded length.
+uint16_t Telemetry_COBSEncode(const uint8_t* input, uint16_t length, uint8_t* output) {
+  uint16_t out = 1;
+  uint16_t codeIndex = 0;
+  uint8_t code = 1;
+  for (uint16_t i = 0; i < length; i++) {
+    if (input[i] == 0) {
+      output[codeIndex] = code;
+      codeIndex = out++;
+      code = 1;
+    } else {
+      output[out++] = input[i];
+      if (++code == 0xFF) {
+        output[codeIndex] = code;
+        codeIndex = out++;
+        code = 1;
+      }
+    }
+  }
+  output[codeIndex] = code;
+  return out;
+}
+
+// Append an unsigned LEB128 varint
+static inline uint16_t PutVarint(uint8_t* out, uint32_t value) {
+  uint16_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+// Frame under construction. Static rather than on the small stack of the compute task, which is
+// the only task that encodes records.
+static uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+static uint8_t frameBuffer[TELEMETRY_MAX_FRAME];
+
+// Build a complete frame, delimiters included. Returns its length.
+uint16_t Telemetry_EncodeFrame(uint8_t session, const double* values, uint8_t* frame) {
+  int32_t* previous = encoders[session].previous;
+  uint16_t& sequence = encoders[session].sequence;
+  uint16_t& sinceKeyframe = encoders[session].sinceKeyframe;
+  bool keyframe = !encoders[session].synced || sinceKeyframe >= TELEMETRY_KEYFRAME_INTERVAL;
+
+  uint16_t n = 0;
+  payload[n++] = TELEMETRY_VERSION;
+  payload[n++] = keyframe ? TELEMETRY_FLAG_KEYFRAME : 0;
+  payload[n++] = session;
+  payload[n++] = sequence & 0xFF;
+  payload[n++] = sequence >> 8;
+
+  for (int i = 0; i < TELEMETRY_NUM_FIELDS; i++) {
+    int32_t value = (int32_t)llround(values[i] * TELEMETRY_SCALES[i]);
+    int32_t delta = keyframe ? value : (int32_t)((uint32_t)value - (uint32_t)previous[i]);
+    previous[i] = value;
+    // Zigzag so small negative deltas stay short: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+    n += PutVarint(payload + n, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+  }
+
+  uint16_t crc = Telemetry_CRC16(payload, n);
+  payload[n++] = crc & 0xFF;
+  payload[n++] = crc >> 8;
+
+  frame[0] = 0x00;
+  uint16_t length = 1 + Telemetry_COBSEncode(payload, n, frame + 1);
+  frame[length++] = 0x00;
+
+  sequence++;
+  sinceKeyframe = keyframe ? 1 : sinceKeyframe + 1;
+  encoders[session].synced = true;
+  return length;
+}
+
+bool Telemetry_SendRecord(uint8_t session, const double* values) {
+  uint16_t length = Telemetry_EncodeFrame(session, values, frameBuffer);
+
+  bool queued = txRing.write(frameBuffer, length);
+  if (!queued) {
+    // The decoder cannot apply later deltas without this frame, so resync with a keyframe
+    telemetryDroppedFrames++;
+    encoders[session].synced = false;
+  }
+  Telemetry_Flush();
+  return queued;
+}
+
+void Telemetry_Flush(void) {
+  int room = Serial.availableForWrite();
+  while (room > 0 && !txRing.isEmpty()) {
+    const uint8_t* data;
+    uint16_t length = txRing.contiguous(&data);
+    if (length > room) {
+      length = room;
+    }
+    size_t written = Serial.write(data, length);
+    txRing.consume(written);
+    room -= written;
+    if (written < length) {
+      break;
+    }
+  }
+}
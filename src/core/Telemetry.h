@@ -0,0 +1,130 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include "../utils/Constants.h"
+#include "../utils/ByteRing.hpp"
+
+// Binary telemetry stream
+//
+// Each HRV record is sent as one frame:
+//    0x00 | COBS( version u8 | flags u8 | session u8 | sequence u16 | fields... | CRC-16 u16 ) | 0x00
+// session is the sensor session the record belongs to. Fields follow TELEMETRY_SCHEMA. Each value is quantized to round(value * scale). The result is
+// delta-encoded against the previous record of the same session, zigzag-mapped and written as a LEB128 varint.
+// Keyframes (flags bit 0) hold deltas against zero, so a decoder can start or resync from them.
+// They are sent every TELEMETRY_KEYFRAME_INTERVAL records and after a dropped frame. Sequence
+// numbers and keyframes are kept per session.
+// The CRC is CRC-16/CCITT-FALSE over everything before it. Multi-byte integers are little-endian.
+// Frames are queued in a TX ring and drained only as fast as the serial port accepts them,
+// so the compute task never blocks. If the ring is full the frame is dropped and counted.
+// The compute task calls Telemetry_Service() every TELEMETRY_FLUSH_INTERVAL ms while data is
+// queued, so the ring drains between records too. Only that task touches the encoder state; other
+// tasks switch modes through Telemetry_RequestMode().
+//
+// scripts/decode_telemetry.py decodes the stream into the same CSV columns as the text mode,
+// which ends each record with the session number.
+
+#define TELEMETRY_VERSION 7
+#define TELEMETRY_FLAG_KEYFRAME 0x01
+
+#define TELEMETRY_CSV 0     // START,...,END text records (default)
+#define TELEMETRY_BINARY 1  // Framed binary records
+
+#ifndef TELEMETRY_MODE
+#define TELEMETRY_MODE TELEMETRY_CSV
+#endif
+
+#define TELEMETRY_KEYFRAME_INTERVAL 32  // Records between keyframes
+#define TELEMETRY_TX_BUFFER 1024        // Bytes queued for the serial port
+#define TELEMETRY_FLUSH_INTERVAL 5      // ms between flushes while the TX ring holds data
+
+// Fields reported for each analysis window: X(column name, scale), w being the window's column
+// suffix from HRV_WINDOWS. Column names match the CSV header used by tests/graphs.ipynb.
+#define TELEMETRY_WINDOW_SCHEMA(X, w) \
+  X(Mean_PPI##w,    100)   \
+  X(Median_PPI##w,  100)   \
+  X(Min_PPI##w,     1)     \
+  X(Max_PPI##w,     1)     \
+  X(SD_PPI##w,      100)   \
+  X(Prc20_PPI##w,   1)     \
+  X(Prc80_PPI##w,   1)     \
+  X(RMSSD##w,       1)     \
+  X(pPPI50##w,      100)   \
+  X(HTI##w,         100)   \
+  X(TIPPI##w,       1)     \
+  X(SD1##w,         100)   \
+  X(SD2##w,         100)   \
+  X(SD1_SD2##w,     1000)  \
+  X(Poincare_Area##w, 1)   \
+  X(Total_Power##w, 1)     \
+  X(LF##w,          100)   \
+  X(HF##w,          100)   \
+  X(LF_HF_Ratio##w, 1000)  \
+  X(DFA_Alpha1##w,  1000)  \
+  X(SampEn##w,      1000)  \
+  X(ApEn##w,        1000)
+
+// Record schema, version 2 and later: the short-term window in the original column order, then one block
+// per further entry of HRV_WINDOWS, each starting with the window's beat count. Version 4 adds the
+// artifact correction counts since the engine was reset, version 5 the entropies of every window,
+// version 6 their DFA α1 and version 7 the Poincaré plot descriptors.
+#define TELEMETRY_SCHEMA(X) \
+  X(Timestamp,   1)     /* ms since start (CSV: seconds) */ \
+  X(PPI_Count,   1)     \
+  X(Current_PPI, 1)     \
+  TELEMETRY_WINDOW_SCHEMA(X, ) \
+  X(PPI_Count_1min, 1)  \
+  TELEMETRY_WINDOW_SCHEMA(X, _1min) \
+  X(PPI_Count_5min, 1)  \
+  TELEMETRY_WINDOW_SCHEMA(X, _5min) \
+  X(Corrected_Beats,   1)  /* Beats replaced by the artifact median */ \
+  X(Uncorrected_Beats, 1)  /* Beats analyzed as received */
+
+#define TELEMETRY_FIELD_INDEX(name, scale) TELEMETRY_FIELD_##name,
+enum {
+  TELEMETRY_SCHEMA(TELEMETRY_FIELD_INDEX)
+  TELEMETRY_NUM_FIELDS
+};
+#undef TELEMETRY_FIELD_INDEX
+
+#define TELEMETRY_FIELD_COUNT(name, scale) +1
+#define TELEMETRY_WINDOW_FIELDS (0 TELEMETRY_WINDOW_SCHEMA(TELEMETRY_FIELD_COUNT, ))
+
+// Largest encoded frame, including delimiters: header, 5-byte varint per field and CRC, plus the
+// COBS overhead
+#define TELEMETRY_MAX_PAYLOAD (5 + 5 * TELEMETRY_NUM_FIELDS + 2)
+#define TELEMETRY_MAX_FRAME (2 + TELEMETRY_MAX_PAYLOAD + TELEMETRY_MAX_PAYLOAD / 254 + 1)
+
+// Output mode, TELEMETRY_CSV or TELEMETRY_BINARY. Written only by the task that sends records;
+// other tasks change it with Telemetry_RequestMode().
+extern uint8_t telemetryMode;
+
+// Frames dropped because the TX ring was full
+extern uint32_t telemetryDroppedFrames;
+
+// Clear the TX ring, the encoder state of every session and the drop counter. Call only from the
+// task that sends records.
+void Telemetry_Reset(void);
+
+// Ask the task that sends records to switch to a mode. Safe from any task; the switch, and the
+// reset of the stream when entering TELEMETRY_BINARY, happen in its next Telemetry_Service().
+void Telemetry_RequestMode(uint8_t mode);
+
+// Apply a requested mode switch, then flush. Called by the task that sends records.
+void Telemetry_Service(void);
+
+// True while frames are queued for the serial port
+bool Telemetry_Pending(void);
+
+// Encode one record of a session (values in schema order, unscaled) into a frame and queue it.
+// Returns false if the frame was dropped.
+bool Telemetry_SendRecord(uint8_t session, const double* values);
+
+// Write as much queued data as the serial port accepts without blocking
+void Telemetry_Flush(void);
+
+// Building blocks, exposed for tests and host tools
+uint16_t Telemetry_CRC16(const uint8_t* data, uint16_t length);
+uint16_t Telemetry_COBSEncode(const uint8_t* input, uint16_t length, uint8_t* output);
+uint16_t Telemetry_EncodeFrame(uint8_t session, const double* values, uint8_t* frame);
+
+#endif  // _TELEMETRY_H
@@ -1,25 +1,24 @@
 #include "BLEReceiveTask.h"
 
 TaskHandle_t BLEReceiveTask::taskHandle = NULL;
-PolarBLEConnection* BLEReceiveTask::connection = nullptr;
+PolarBLEConnection::MyAdvertisedDeviceCallbacks* BLEReceiveTask::scanCallbacks = nullptr;
 
 void BLEReceiveTask::start() {
-  connection = new PolarBLEConnection();
+  // Number the sessions before the scan can hand out sensors
+  Sessions_Init();
 
-  // Start the BLE scan for the device
+  // Start the BLE scan for the devices. Every sensor found is given to a free session.
   BLEDevice::init("");
   BLEScan* pBLEScan = BLEDevice::getScan();
-  pBLEScan->setAdvertisedDeviceCallbacks(new PolarBLEConnection::MyAdvertisedDeviceCallbacks(DEVICE_NAME));
+  scanCallbacks = new PolarBLEConnection::MyAdvertisedDeviceCallbacks(DEVICE_NAME, sensorConnections, MAX_SENSORS);
+  pBLEScan->setAdvertisedDeviceCallbacks(scanCallbacks);
   pBLEScan->setInterval(2500);
   pBLEScan->setWindow(1000);
   pBLEScan->setActiveScan(true);
 
-  Serial.printf("Starting scan for %s...\n", DEVICE_NAME);
+  Serial.printf("Starting scan for up to %d x %s...\n", MAX_SENSORS, DEVICE_NAME);
   pBLEScan->start(5, false);
 
-  // Initialize scanning state
-  connection->doScan = true;
-
   // Start the BLE task on Core 0 (priority 1)
   xTaskCreatePinnedToCore(taskFunction, "BLE_Task", 4096, NULL, 1, &taskHandle, 0);
 }
@@ -29,66 +28,80 @@ void BLEReceiveTask::stop() {
     vTaskDelete(taskHandle);
     taskHandle = NULL;
   }
-  if (connection != nullptr) {
-    delete connection;
-    connection = nullptr;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    sensorConnections[i]->Release();
+  }
+}
+
+// Blink the onboard LED
+void BLEReceiveTask::blink(uint8_t red, uint8_t green, uint8_t blue, int times, int onMs, int offMs) {
+  for (int i = 0; i < times; i++) {
+    neopixelWrite(ONBOARD_LED, red, green, blue);
+    delay(onMs);
+    neopixelWrite(ONBOARD_LED, 0, 0, 0);
+    delay(offMs);
   }
 }
 
 void BLEReceiveTask::taskFunction(void* parameters) {
   unsigned long scanStartTime = millis();  // Initialize scanStartTime immediately
   bool isScanning = true;
+  uint8_t outputMode = telemetryMode;  // Telemetry mode last requested by a command
 
   while (1) {
-    if (connection->doConnect == true) {
-      if (connection->ConnectToServer()) {
-        Serial.println("Connected to Polar Sense!");
-        // Stop trying to connect and scan
-        connection->doConnect = false;
-        connection->doScan = false;
-        isScanning = false;
-
-        // Blink the onboard LED green five times
-        for (int i = 0; i < 5; i++) {
-          neopixelWrite(ONBOARD_LED, 0, 20, 0);
-          delay(200);
-          neopixelWrite(ONBOARD_LED, 0, 0, 0);
-          delay(100);
-        }
-      } else {
-        Serial.printf("Failed to connect to %s. Rescanning...\n", DEVICE_NAME);
+    for (int i = 0; i < MAX_SENSORS; i++) {
+      PolarBLEConnection* connection = sensorConnections[i];
 
-        // Blink the onboard LED red three times
-        for (int i = 0; i < 3; i++) {
+      if (connection->doConnect == true) {
+        if (connection->ConnectToServer()) {
+          Serial.printf("Session %d connected to Polar Sense!\n", i);
+          connection->doConnect = false;
+
+          // Blink the onboard LED green five times
+          blink(0, 20, 0, 5, 200, 100);
+        } else {
+          Serial.printf("Session %d failed to connect to %s. Rescanning...\n", i, DEVICE_NAME);
+
+          // Blink the onboard LED red three times
+          blink(20, 0, 0, 3, 333, 167);
           neopixelWrite(ONBOARD_LED, 20, 0, 0);
-          delay(333);
-          neopixelWrite(ONBOARD_LED, 0, 0, 0);
-          delay(167);
-        }
-        neopixelWrite(ONBOARD_LED, 20, 0, 0);
 
-        connection->doScan = true;
-        isScanning = true;
-        scanStartTime = millis();
+          // Free the session for the next sensor the scan finds
+          connection->Release();
+        }
+      } else if (connection->doScan == true) {
+        // The sensor disconnected: free the session for the next sensor the scan finds
+        connection->Release();
       }
-    } else if (isScanning) {
+    }
+
+    // Keep scanning while a session has no sensor
+    bool wanted = scanCallbacks->freeConnections() > 0;
+    if (wanted && !isScanning) {
+      Serial.printf("Scanning for %s (%u sessions free)...\n", DEVICE_NAME, scanCallbacks->freeConnections());
+      BLEDevice::getScan()->start(5, false);
+      isScanning = true;
+      scanStartTime = millis();
+    } else if (!wanted) {
+      // The scan callback stopped the scan once the last session got a sensor
+      isScanning = false;
+    } else if (millis() - scanStartTime > 10000) {
       // Check if we've been scanning for more than 10 seconds
-      if (millis() - scanStartTime > 10000) {
-        Serial.printf("%s not found within 10 seconds. Restarting scan...\n", DEVICE_NAME);
-
-        // Blink the onboard LED yellow three times
-        for (int i = 0; i < 3; i++) {
-          neopixelWrite(ONBOARD_LED, 20, 20, 0);
-          delay(333);
-          neopixelWrite(ONBOARD_LED, 0, 0, 0);
-          delay(167);
-        }
-        neopixelWrite(ONBOARD_LED, 20, 0, 0);
+      Serial.printf("%s not found within 10 seconds. Restarting scan...\n", DEVICE_NAME);
 
-        BLEScan* pBLEScan = BLEDevice::getScan();
-        pBLEScan->start(5, false);
-        scanStartTime = millis();
+      // Blink the onboard LED yellow three times, unless a sensor is already streaming
+      bool anyConnected = false;
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        anyConnected |= sensorConnections[i]->connected;
       }
+      if (!anyConnected) {
+        blink(20, 20, 0, 3, 333, 167);
+        neopixelWrite(ONBOARD_LED, 20, 0, 0);
+      }
+
+      BLEScan* pBLEScan = BLEDevice::getScan();
+      pBLEScan->start(5, false);
+      scanStartTime = millis();
     }
 
     // Otherwise, do nothing!
@@ -100,17 +113,52 @@ void BLEReceiveTask::taskFunction(void* parameters) {
       String input = Serial.readStringUntil('\n');
       if (input == "quit") {
         uint8_t endPpi[] = { 0x03, 0x03 };
+        uint8_t endPpg[] = { 0x03, 0x01 };
         uint8_t endSdk[] = { 0x03, 0x09 };
-        Serial.println("Ending PPI Measurements");
-        connection->pControlCharacteristic->writeValue(endPpi, sizeof(endPpi), true);
-        delay(500);
-        Serial.println("Ending SDK Mode");
-        connection->pControlCharacteristic->writeValue(endSdk, sizeof(endSdk), true);
-        delay(500);
+        for (int i = 0; i < MAX_SENSORS; i++) {
+          PolarBLEConnection* connection = sensorConnections[i];
+          if (!connection->connected) {
+            continue;
+          }
+#if PPI_SOURCE == PPI_SOURCE_PPG
+          Serial.printf("Session %d: ending PPG Measurements\n", i);
+          connection->pControlCharacteristic->writeValue(endPpg, sizeof(endPpg), true);
+#else
+          Serial.printf("Session %d: ending PPI Measurements\n", i);
+          connection->pControlCharacteristic->writeValue(endPpi, sizeof(endPpi), true);
+#endif
+          delay(500);
+          Serial.printf("Session %d: ending SDK Mode\n", i);
+          connection->pControlCharacteristic->writeValue(endSdk, sizeof(endSdk), true);
+          delay(500);
+        }
         Serial.println("Exiting...");
         ComputeTask::stop();
         BLEReceiveTask::stop();
         exit(0);
+      } else if (input == "binary") {
+        // Switch HRV output to framed binary records (decode with scripts/decode_telemetry.py).
+        // The compute task encodes the records, so it resets the stream and switches itself.
+        // Capture lines would land inside the frames, so capture stops first.
+        pmdCaptureEnabled = false;
+        outputMode = TELEMETRY_BINARY;
+        Telemetry_RequestMode(TELEMETRY_BINARY);
+        ComputeTask::wake();
+      } else if (input == "csv") {
+        outputMode = TELEMETRY_CSV;
+        Telemetry_RequestMode(TELEMETRY_CSV);
+        ComputeTask::wake();
+      } else if (input == "stats") {
+        // The compute task owns the counters and the serial output, so it prints them
+        Sessions_RequestStats();
+        ComputeTask::wake();
+      } else if (input == "capture") {
+        // Print every PMD data notification for replay on the host (see PMDCapture.h). Text
+        // output only: ignored in binary mode, where it could not even be acknowledged.
+        if (outputMode == TELEMETRY_CSV) {
+          pmdCaptureEnabled = !pmdCaptureEnabled;
+          Serial.printf("PMD capture %s\n", pmdCaptureEnabled ? "on" : "off");
+        }
       }
     }
   }
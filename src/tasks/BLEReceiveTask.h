@@ -11,8 +11,9 @@ public:
 
 private:
   static void taskFunction(void* parameters);
+  static void blink(uint8_t red, uint8_t green, uint8_t blue, int times, int onMs, int offMs);
   static TaskHandle_t taskHandle;
-  static PolarBLEConnection* connection;
+  static PolarBLEConnection::MyAdvertisedDeviceCallbacks* scanCallbacks;
 };
 
 #endif // BLERECEIVE_TASK_H
@@ -15,55 +15,84 @@ void ComputeTask::start() {
 
   delay(100);
 
+  // Initialize the HRV state (including the MEM context) before the first beat arrives.
+  // The other sessions' engines were reset by Sessions_Init() in BLEReceiveTask::start().
+  resetHRVParameters();
+
   // Start the PWM task on Core 1 (priority 2, higher than BLE)
   xTaskCreatePinnedToCore(taskFunction, "PWM_Task", 4096, NULL, 2, &taskHandle, 1);
+
+  // Ask the BLE callbacks of all sessions to wake this task whenever they push new beats
+  PolarBLEConnection::ppiConsumer = taskHandle;
 }
 
 void ComputeTask::stop() {
+  PolarBLEConnection::ppiConsumer = NULL;
   if (taskHandle != NULL) {
     vTaskDelete(taskHandle);
     taskHandle = NULL;
   }
 }
 
+void ComputeTask::wake() {
+  TaskHandle_t handle = taskHandle;
+  if (handle != NULL) {
+    xTaskNotifyGive(handle);
+  }
+}
+
 void ComputeTask::taskFunction(void* parameters) {
-  PPIData currentData;
-  uint16_t prevPPI = 0;
-  uint16_t validPPI = 0;
-  uint32_t lastProcessTime = 0;
+  // Beats of the first session, replayed on the PWM output at the pace they occurred
+  BoundedQueue<uint16_t, PPI_QUEUE_SIZE> pwmQueue;
+  sensorSessions[0].output = &pwmQueue;
+
+  uint32_t nextPwmTime = millis();
+  uint32_t lastStatsTime = millis();
+  uint32_t reportedDrops = 0;
   float dutyCycle;
-  bool valid = false;
 
   while (1) {
-    if (xQueueReceive(PolarBLEConnection::ppiQueue, &currentData, portMAX_DELAY) == pdTRUE) {
-      // Update voltage output if currentData is valid and not too different from the last measurement
-      valid = ((abs(currentData.ppi - prevPPI) < MAX_PPI_DIFF) || prevPPI < BIN_START) && currentData.valid;
+    // Sleep until a BLE callback signals new beats, or until the next PWM step is due
+    uint32_t now = millis();
+    TickType_t wait = pdMS_TO_TICKS(SESSION_STATS_INTERVAL);
+    if (!pwmQueue.isEmpty()) {
+      wait = (int32_t)(nextPwmTime - now) > 0 ? pdMS_TO_TICKS(nextPwmTime - now) : 0;
+    }
+    // Keep draining queued telemetry while no records arrive to push it out
+    if (Telemetry_Pending() && wait > pdMS_TO_TICKS(TELEMETRY_FLUSH_INTERVAL)) {
+      wait = pdMS_TO_TICKS(TELEMETRY_FLUSH_INTERVAL);
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+
+    // Apply a mode switch asked for over the serial port before encoding further records
+    Telemetry_Service();
 
-      // Store the most recent valid PPI
-      validPPI = valid ? currentData.ppi : prevPPI;
+    // Drain every session's ring, one batch per session at a time, including beats that arrived
+    // while we were waiting for the PWM output
+    Sessions_Service(SESSION_BATCH);
 
-      // If the newest PPI was valid, update the previous PPI, otherwise keep the previous PPI
-      prevPPI = valid ? currentData.ppi : prevPPI;
+    // Step the output through the queued PPIs, holding each for its own duration
+    now = millis();
+    while (!pwmQueue.isEmpty() && (int32_t)(now - nextPwmTime) >= 0) {
+      uint16_t validPPI = pwmQueue.dequeue();
 
       // Calculate duty cycle
       dutyCycle = (4095.0 / (HIST_WIDTH)) * (validPPI - (BIN_START));
 
       // Write voltage output to PWM_PIN
       ledcWrite(PWM_PIN, (uint32_t)dutyCycle);
+      nextPwmTime = now + validPPI;
+    }
 
-      // Update all HRV parameters given the previous PPI measurement
-      if (validPPI > 0)
-        updateHRVParameters(validPPI);
-
-      printHRVParameters(validPPI);
-
-      // Dynamic delay management
-      uint32_t processingTime = millis() - lastProcessTime;
-      uint32_t requiredDelay = validPPI > processingTime ?
-        validPPI - processingTime : 0;
-
-      vTaskDelay(pdMS_TO_TICKS(requiredDelay));
-      lastProcessTime = millis();
+    // Report the session counters periodically, at once when beats were dropped, and when asked
+    // by the "stats" command (text mode only, so binary frames stay intact)
+    uint32_t drops = Sessions_Dropped();
+    bool requested = Sessions_TakeStatsRequest();
+    if (telemetryMode == TELEMETRY_CSV &&
+        (requested || drops != reportedDrops || now - lastStatsTime >= SESSION_STATS_INTERVAL)) {
+      Sessions_PrintStats();
+      reportedDrops = drops;
+      lastStatsTime = now;
     }
   }
 }
@@ -3,12 +3,16 @@
 
 #include "../core/PolarBLEConnection.h"
 #include "../core/Parameters.h"
+#include "../core/SensorSession.h"
 
 class ComputeTask {
 public:
   static void start();
   static void stop();
 
+  // Wake the task, e.g. so it applies a telemetry mode request without waiting for beats
+  static void wake();
+
 private:
   static void taskFunction(void* parameters);
   static TaskHandle_t taskHandle;
@@ -0,0 +1,54 @@
+#ifndef _BIQUAD_HPP
+#define _BIQUAD_HPP
+
+#include <math.h>
+
+// Second-order IIR section in transposed direct form II.
+//
+// Coefficients follow the RBJ audio EQ cookbook and are normalized so a0 = 1. One sample costs
+// five multiplies and four adds, and the state is two floats, so cascades stay cheap enough to
+// run on every PPG sample.
+struct Biquad {
+  float b0, b1, b2, a1, a2;
+  float z1, z2;
+
+  static Biquad lowPass(float sampleRate, float cutoff, float q = M_SQRT1_2) {
+    float w0 = 2.0f * (float)M_PI * cutoff / sampleRate;
+    float cosw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    return normalize((1.0f - cosw) / 2.0f, 1.0f - cosw, (1.0f - cosw) / 2.0f, 1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+  }
+
+  static Biquad highPass(float sampleRate, float cutoff, float q = M_SQRT1_2) {
+    float w0 = 2.0f * (float)M_PI * cutoff / sampleRate;
+    float cosw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    return normalize((1.0f + cosw) / 2.0f, -(1.0f + cosw), (1.0f + cosw) / 2.0f, 1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+  }
+
+  void reset() {
+    z1 = 0.0f;
+    z2 = 0.0f;
+  }
+
+  float process(float x) {
+    float y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+
+private:
+  static Biquad normalize(float b0, float b1, float b2, float a0, float a1, float a2) {
+    Biquad f;
+    f.b0 = b0 / a0;
+    f.b1 = b1 / a0;
+    f.b2 = b2 / a0;
+    f.a1 = a1 / a0;
+    f.a2 = a2 / a0;
+    f.reset();
+    return f;
+  }
+};
+
+#endif  // _BIQUAD_HPP
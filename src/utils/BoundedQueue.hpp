@@ -3,61 +3,112 @@
 
 #include "Constants.h"
 
-#include <queue>
-
-template <typename T>
+// Fixed-capacity FIFO backed by a statically sized ring buffer.
+// Nothing is allocated after construction, and items can be read by age in O(1):
+// index 0 is the oldest item and index size() - 1 the newest.
+// Capacity is the storage size; a smaller runtime capacity may be passed to the constructor.
+template <typename T, uint16_t Capacity = NUM_SAMPLES>
 class BoundedQueue {
 private:
-  std::queue<T> q;
-  uint16_t capacity;
+  T buffer[Capacity];
+  uint16_t head;      // Index of the oldest item
+  uint16_t count;     // Number of items stored
+  uint16_t capacity;  // Runtime capacity (<= Capacity)
+
+  // Physical index of the i-th oldest item
+  uint16_t physical(uint16_t i) const {
+    uint16_t idx = head + i;
+    return idx >= capacity ? idx - capacity : idx;
+  }
 
 public:
-  BoundedQueue() : capacity(NUM_SAMPLES) {}
-  BoundedQueue(uint16_t capacity) : capacity(capacity) {}
+  // Read-only iterator from oldest to newest item
+  class const_iterator {
+  private:
+    const BoundedQueue* q;
+    uint16_t i;
+
+  public:
+    const_iterator(const BoundedQueue* q, uint16_t i) : q(q), i(i) {}
+    const T& operator*() const { return (*q)[i]; }
+    const_iterator& operator++() { i++; return *this; }
+    bool operator==(const const_iterator& other) const { return i == other.i; }
+    bool operator!=(const const_iterator& other) const { return i != other.i; }
+  };
+
+  BoundedQueue() : head(0), count(0), capacity(Capacity) {}
+  BoundedQueue(uint16_t capacity) : head(0), count(0), capacity(MIN(capacity, Capacity)) {}
 
   // Enqueue an item into the queue. If the queue is full, remove the oldest item.
-  // Returns the removed item if the queue was full, otherwise returns NULL.
+  // Returns the removed item if the queue was full, otherwise returns 0 (T()).
   T enqueue(const T& item) {
-    T front = NULL;
+    T front = T();
     if (isFull()) {
-      front = q.front();
-      q.pop();
+      front = buffer[head];
+      buffer[head] = item;
+      head = physical(1);
+    } else {
+      buffer[physical(count)] = item;
+      count++;
     }
-    q.push(item);
     return front;
   }
 
-  // Dequeue an item from the queue. Returns NULL if the queue is empty.
+  // Dequeue an item from the queue. Returns 0 (T()) if the queue is empty.
   T dequeue() {
     if (isEmpty()) {
-      return NULL;
+      return T();
     }
-    T item = q.front();
-    q.pop();
+    T item = buffer[head];
+    head = physical(1);
+    count--;
     return item;
   }
 
-  // Peek at the front item of the queue without removing it. Returns NULL if the queue is empty.
+  // Peek at the front item of the queue without removing it. Returns 0 (T()) if the queue is empty.
   T peek() const {
     if (isEmpty()) {
-      return NULL;
+      return T();
     }
-    return q.front();
+    return buffer[head];
+  }
+
+  // Oldest and newest items. The queue must not be empty.
+  const T& front() const {
+    return buffer[head];
+  }
+
+  const T& back() const {
+    return buffer[physical(count - 1)];
+  }
+
+  // The i-th oldest item (0 = oldest). i must be less than size().
+  const T& operator[](uint16_t i) const {
+    return buffer[physical(i)];
+  }
+
+  // Iterate from oldest to newest item
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, count);
   }
 
   // Check if the queue is full.
   bool isFull() const {
-    return q.size() == capacity;
+    return count == capacity;
   }
 
   // Check if the queue is empty.
   bool isEmpty() const {
-    return q.empty();
+    return count == 0;
   }
 
   // Get the current size of the queue.
   uint16_t size() const {
-    return q.size();
+    return count;
   }
 
   // Get the maximum capacity of the queue.
@@ -67,9 +118,8 @@ public:
 
   // Clear the queue.
   void clear() {
-    while (!q.empty()) {
-      q.pop();
-    }
+    head = 0;
+    count = 0;
   }
 };
 
@@ -0,0 +1,65 @@
+#ifndef _BYTE_RING_HPP
+#define _BYTE_RING_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-capacity byte FIFO used to queue outgoing data without blocking the writer.
+// Data is written all-or-nothing so a frame is never split by an overflow.
+template <uint16_t Capacity>
+class ByteRing {
+private:
+  uint8_t buffer[Capacity];
+  uint16_t head;   // Index of the oldest byte
+  uint16_t count;  // Number of bytes stored
+
+public:
+  ByteRing() : head(0), count(0) {}
+
+  // Append length bytes. Returns false, writing nothing, if they do not fit.
+  bool write(const uint8_t* data, uint16_t length) {
+    if (length > Capacity - count) {
+      return false;
+    }
+    uint16_t tail = (head + count) % Capacity;
+    uint16_t first = length < Capacity - tail ? length : Capacity - tail;
+    memcpy(buffer + tail, data, first);
+    memcpy(buffer, data + first, length - first);
+    count += length;
+    return true;
+  }
+
+  // Longest run of queued bytes that is contiguous in memory, starting at the oldest byte
+  uint16_t contiguous(const uint8_t** data) const {
+    *data = buffer + head;
+    return count < Capacity - head ? count : Capacity - head;
+  }
+
+  // Drop length bytes from the front (after they have been sent)
+  void consume(uint16_t length) {
+    if (length > count) {
+      length = count;
+    }
+    head = (head + length) % Capacity;
+    count -= length;
+  }
+
+  uint16_t size() const {
+    return count;
+  }
+
+  uint16_t space() const {
+    return Capacity - count;
+  }
+
+  bool isEmpty() const {
+    return count == 0;
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+};
+
+#endif  // _BYTE_RING_HPP
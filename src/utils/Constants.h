@@ -4,8 +4,6 @@
 #include <Arduino.h>
 #include <esp32-hal-ledc.h>
 
-#define NULL 0
-
 #define DEVICE_NAME "Polar Sense"
 
 // Pinout definitions
@@ -18,15 +16,86 @@
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
 // MEM-based PSD Estimation Parameters
-#define MODEL_ORDER ((int)(NUM_SAMPLES / log(2*NUM_SAMPLES) + 0.5))
+// The spectrum is estimated from the beat series resampled to a uniform tachogram (Tachogram.hpp),
+// so the bands below are in Hz
+// MODEL_ORDER, FREQ_BINS and NUM_SAMPLES may be overridden at build time (see CMakeLists.txt)
+#ifndef MODEL_ORDER
+#define MODEL_ORDER 16    // Highest AR model order (exponential tables are sized to it)
+#endif
 #define FREQ_VLOW 0.003   // Very low frequency
 #define FREQ_LOW 0.04     // Low frequency
 #define FREQ_MID 0.15     // Middle frequency
 #define FREQ_HIGH 0.4     // High frequency
+#ifndef FREQ_BINS
 #define FREQ_BINS 50      // Number of frequency bins
+#endif
+
+// AR estimators for the MEM path
+//    MEM_AR_BURG:    Burg's method over the window's tachogram samples every beat, O(samples * MODEL_ORDER)
+//    MEM_AR_SLIDING: Lag products updated as samples enter/leave the window, then Levinson-Durbin,
+//                    O(MODEL_ORDER²) per beat independent of NUM_SAMPLES
+#define MEM_AR_BURG 0
+#define MEM_AR_SLIDING 1
+#ifndef MEM_AR_METHOD
+#define MEM_AR_METHOD MEM_AR_SLIDING  // Default estimator, can be changed at run time via MEM_Context
+#endif
+
+// Spectral estimators producing the windows' LF, HF, total power and LF/HF
+//    SPECTRUM_MEM:  AR model (MEM) of the 4 Hz tachogram resampled from the beats (see MEM_AR_METHOD)
+//    SPECTRUM_LOMB: Lomb-Scargle periodogram of the beats at the times they occurred, without
+//                   resampling, O(LOMB_BINS) per beat
+//    SPECTRUM_SDFT: Hann-windowed sliding DFT of the tachogram, O(bins) per tachogram sample
+#define SPECTRUM_MEM 0
+#define SPECTRUM_LOMB 1
+#define SPECTRUM_SDFT 2
+#ifndef SPECTRUM_METHOD
+#define SPECTRUM_METHOD SPECTRUM_MEM  // Default estimator, can be changed at run time via HRVEngine
+#endif
+// Estimators compiled into HRVEngine, one bit per SPECTRUM_* value. Each one keeps its own state
+// in every window, so the firmware only has SPECTRUM_METHOD (and MEM, always there); the host
+// build compiles them all for the tests and benches that switch between them.
+#ifndef SPECTRUM_METHODS
+#define SPECTRUM_METHODS (1 << SPECTRUM_METHOD)
+#endif
+#define SPECTRUM_ENABLED(method) ((((SPECTRUM_METHODS) | 1 << SPECTRUM_MEM) >> (method)) & 1)
+// Frequencies of the periodogram between FREQ_LOW and FREQ_HIGH. Its peaks are 1/T wide for a
+// window of T seconds, and the band powers only hold if the bins are closer than that:
+// (FREQ_HIGH - FREQ_LOW) · 300 s + 1 = 109 for the 5 minute window.
+#ifndef LOMB_BINS
+#define LOMB_BINS 128
+#endif
+// Bins kept per window by the sliding DFT. A window of T seconds has bins 1/T apart, and the 5
+// minute window needs FREQ_HIGH · 300 s + 2 = 122 of them to reach FREQ_HIGH with a neighbour.
+#ifndef SDFT_BINS
+#define SDFT_BINS 128
+#endif
+
+// AR model order selection, decided during the estimator's order recursion (see MEM_OrderSelector)
+//    MEM_ORDER_FIXED: always MODEL_ORDER
+//    MEM_ORDER_FPE:   Akaike's final prediction error
+//    MEM_ORDER_AIC:   Akaike's information criterion
+//    MEM_ORDER_MDL:   Rissanen's minimum description length, the most parsimonious
+#define MEM_ORDER_FIXED 0
+#define MEM_ORDER_FPE 1
+#define MEM_ORDER_AIC 2
+#define MEM_ORDER_MDL 3
+#ifndef MEM_ORDER_RULE
+#define MEM_ORDER_RULE MEM_ORDER_FIXED  // Default rule, can be changed at run time via MEM_Context
+#endif
+#ifndef MEM_ORDER_MIN
+#define MEM_ORDER_MIN 8   // Lowest order a criterion may select: fewer poles merge the LF and HF peaks
+#endif
+
+// Numeric policy of the MEM path: MEM_Float, MEM_Double or MEM_Q31 (see MEM_Types.h). Engines
+// may also choose their own through the HRVEngine template.
+#ifndef MEM_NUMERIC
+#define MEM_NUMERIC MEM_Float
+#endif
 
 // Constants for parameters
+#ifndef NUM_SAMPLES
 #define NUM_SAMPLES 30    // Number of samples to store to compute moving averages
+#endif
 #define NUM_BINS 218      // Number of bins in the histogram (300 - 2000 ms) / 7.8125 ms
 #define BIN_WIDTH 7.815   // Width of histogram bins (in ms)
 #define BIN_START 300.0   // Lowest PPI value in the histogram (in ms)
@@ -34,7 +103,85 @@
 #define HIST_WIDTH BIN_END - BIN_START  // Width of the histogram (in ms)
 #define MAX_PPI_DIFF 300  // Maximum difference between consecutive PPI samples to be considered valid
 
-#define PPI_QUEUE_SIZE 15 // Maximum number of PPI samples to store in the receive queue
+// Artifact correction, applied by each engine before any parameter sees the beat: a beat further
+// than ARTIFACT_TOLERANCE from the median of the previous ARTIFACT_WINDOW beats (as received) is
+// replaced by that median. A lasting change of rate is accepted once it fills half the window.
+#ifndef ARTIFACT_WINDOW
+#define ARTIFACT_WINDOW 11       // Beats in the running median
+#endif
+#define ARTIFACT_TOLERANCE 0.20  // Largest accepted deviation, as a fraction of the median
+
+// Sample and approximate entropy of every window: templates of m = 2 beats, matching when each
+// beat is within ENTROPY_TOLERANCE ms. The usual r is 0.2 x SD; it is fixed here so that matches
+// can be counted as beats enter and leave (HRVEngine::setEntropyTolerance() changes it). The
+// default suits resting recordings; during exercise, with a lower SD, a smaller r resolves more.
+#ifndef ENTROPY_TOLERANCE
+#define ENTROPY_TOLERANCE 10     // ms
+#endif
+
+// Short-term detrended fluctuation analysis (DFA α1) of every window: boxes of DFA_MIN_BOX to
+// DFA_MAX_BOX beats, the usual α1 range. α1 falls through 0.75 near the aerobic threshold.
+#define DFA_MIN_BOX 4
+#define DFA_MAX_BOX 16
+
+// Analysis windows, all computed from one shared PPI history: X(column suffix, max beats, max duration in ms)
+// A window holds the newest beats that fit both limits (0 = no limit). The first entry is the
+// short-term window reported through the HRV_* variables and the original CSV columns.
+#define HRV_WINDOWS(X) \
+  X(,      NUM_SAMPLES, 0)      \
+  X(_1min, 0,           60000)  \
+  X(_5min, 0,           300000)
+
+#define HRV_WINDOW_COUNT(suffix, beats, ms) +1
+#define HRV_NUM_WINDOWS (0 HRV_WINDOWS(HRV_WINDOW_COUNT))
+
+// Beats kept in the shared history. Windows hold at most HRV_HISTORY_SIZE - 1 beats,
+// which covers 5 minutes down to the shortest valid PPI (BIN_START).
+#define HRV_HISTORY_SIZE 1024
+
+// Uniform tachogram the spectral estimates run on
+#define TACHO_RATE_HZ 4                         // Resampling rate
+#define TACHO_PERIOD_MS (1000 / TACHO_RATE_HZ)  // Sample spacing
+// Tachogram samples kept: the 5 minute window at TACHO_RATE_HZ plus the samples one long beat adds
+#define TACHO_HISTORY_SIZE 1280
+
+#define PPI_QUEUE_SIZE 32 // Maximum number of PPI samples waiting in the receive ring (power of two)
+
+// Source of the PPIs fed to the HRV engines
+//    PPI_SOURCE_SENSOR: the sensor's own PPI stream (PMD measurement type 0x03)
+//    PPI_SOURCE_PPG:    beats detected on the ESP32 from the green PPG channel (PPGBeatDetector)
+#define PPI_SOURCE_SENSOR 0
+#define PPI_SOURCE_PPG 1
+#ifndef PPI_SOURCE
+#define PPI_SOURCE PPI_SOURCE_SENSOR
+#endif
+
+// PPG beat detection
+#define PPG_SAMPLE_RATE 176     // Hz, highest rate of the SDK mode
+#define PPG_HIGHPASS_HZ 0.5     // Band-pass removing baseline wander...
+#define PPG_LOWPASS_HZ 5.0      // ...and everything above the pulse harmonics that matter
+#define PPG_REFRACTORY_MS 300   // Shortest interval between two beats (200 bpm)
+#define PPG_INVERTED 1          // Raw PPG falls as blood volume rises, so pulses are minima
+#define PPG_QUEUE_SIZE 256      // PPG samples waiting in the receive ring (power of two)
+#define PPG_SAMPLES_PER_BEAT 16 // PPG samples taken from a session in place of one beat
+
+#define ACC_QUEUE_SIZE 64       // Accelerometer samples waiting in the receive ring (power of two)
+#define ACC_PUSH_BATCH 16       // Accelerometer samples the BLE callback converts per ring push
+
+// Sensor sessions. Each session has its own BLE connection, receive ring and HRV engine, and all
+// of them are served by ComputeTask. The engines are static and dominate the firmware's RAM
+// (about 59 kB each with the default windows and MEM, 70 kB with every spectral estimator
+// compiled in), so MAX_SENSORS engines must fit in
+// HRV_ENGINE_RAM_BUDGET. The budget leaves the rest of the ESP32-S3's internal DRAM to the BLE
+// stack, the task stacks and the receive rings; SensorSession.cc checks it at compile time.
+#ifndef MAX_SENSORS
+#define MAX_SENSORS 2     // Sensors connected at once
+#endif
+#ifndef HRV_ENGINE_RAM_BUDGET
+#define HRV_ENGINE_RAM_BUDGET (144 * 1024)  // Bytes for the HRV engines of all sessions
+#endif
+#define SESSION_BATCH 8   // Beats taken from one session before the next one is served
+#define SESSION_STATS_INTERVAL 30000  // ms between per-session counter reports
 
 // Function macro to convert PPI to bin index
 #define PPI_TO_BIN(x) \
@@ -42,4 +189,7 @@
     (((int)(((x) - BIN_START) / BIN_WIDTH) >= NUM_BINS) ? (NUM_BINS-1) : \
     (int)(((x) - BIN_START) / BIN_WIDTH)))
 
+// Function macro to convert a bin index to the PPI at the centre of that bin
+#define BIN_TO_PPI(bin) (BIN_START + ((float)(bin) + 0.5) * BIN_WIDTH)
+
 #endif  // _CONSTANTS_H 
\ No newline at end of file
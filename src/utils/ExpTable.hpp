@@ -0,0 +1,115 @@
+#ifndef _EXP_TABLE_HPP
+#define _EXP_TABLE_HPP
+
+#include <stdint.h>
+
+// Compile-time table of the complex exponentials e^(-j2πf(i+1)) used to evaluate an AR spectrum,
+// one per AR coefficient aᵢ (the lag of aᵢ is i + 1).
+//
+// Order is the number of AR coefficients, Bins the number of frequency points, and Band a type
+// with static constexpr double members `low` and `high` giving the band edges in cycles/sample.
+// Frequencies are spaced like numpy.linspace(low, high, Bins), including both edges.
+// The table is built by the compiler and lives in flash (.rodata) in structure-of-arrays layout:
+// real[i][f] and imag[i][f], with the frequency bins of each order contiguous.
+// Each instantiation is independent, so several spectral configurations can coexist.
+// `fixed` holds the same values in Q30 for the fixed-point path; it is only emitted if used.
+template <uint16_t Order, uint16_t Bins, typename Band>
+struct ExpTable {
+  static_assert(Order > 0, "ExpTable needs at least one AR coefficient");
+  static_assert(Bins > 1, "ExpTable needs at least two frequency bins");
+
+  static constexpr double low = Band::low;
+  static constexpr double high = Band::high;
+  static constexpr double step = (Band::high - Band::low) / (Bins - 1);  // Bin spacing
+
+  struct Data {
+    float real[Order][Bins];
+    float imag[Order][Bins];
+  };
+
+  struct FixedData {
+    int32_t real[Order][Bins];  // Q30
+    int32_t imag[Order][Bins];
+  };
+
+  // Frequency of bin f in cycles/sample
+  static constexpr double frequency(uint16_t f) {
+    return low + step * f;
+  }
+
+  struct CosSin {
+    double cos;
+    double sin;
+  };
+
+  // cos and sin of 2π·turns. The angle is reduced to [-π/4, π/4] plus a whole number of
+  // quarter turns, where a short Taylor series is accurate to double precision.
+  static constexpr CosSin cosSinTurns(double turns) {
+    double quarters = turns * 4.0;
+    int64_t q = (int64_t)(quarters + (quarters >= 0 ? 0.5 : -0.5));
+    double x = 1.5707963267948966 * (quarters - (double)q);
+
+    double c = 1.0, s = x;
+    double cTerm = 1.0, sTerm = x;
+    for (int n = 1; n < 9; n++) {
+      cTerm *= -x * x / ((2 * n - 1) * (2 * n));
+      sTerm *= -x * x / ((2 * n) * (2 * n + 1));
+      c += cTerm;
+      s += sTerm;
+    }
+
+    switch (((q % 4) + 4) % 4) {
+    case 1:
+      return { -s, c };
+    case 2:
+      return { -c, -s };
+    case 3:
+      return { s, -c };
+    default:
+      return { c, s };
+    }
+  }
+
+  static constexpr Data generate() {
+    Data data = {};
+    for (uint16_t i = 0; i < Order; i++) {
+      for (uint16_t f = 0; f < Bins; f++) {
+        // e^(-j2πf(i+1)) = cos(2πf(i+1)) - j·sin(2πf(i+1))
+        CosSin cs = cosSinTurns(frequency(f) * (i + 1));
+        data.real[i][f] = (float)cs.cos;
+        data.imag[i][f] = (float)-cs.sin;
+      }
+    }
+    return data;
+  }
+
+  static constexpr int32_t toQ30(double v) {
+    return (int32_t)(v * 1073741824.0 + (v >= 0 ? 0.5 : -0.5));
+  }
+
+  static constexpr FixedData generateFixed() {
+    FixedData data = {};
+    for (uint16_t i = 0; i < Order; i++) {
+      for (uint16_t f = 0; f < Bins; f++) {
+        CosSin cs = cosSinTurns(frequency(f) * (i + 1));
+        data.real[i][f] = toQ30(cs.cos);
+        data.imag[i][f] = toQ30(-cs.sin);
+      }
+    }
+    return data;
+  }
+
+  static const Data table;
+  static const FixedData fixed;
+};
+
+// Defined outside the class so generate() can be evaluated once ExpTable is complete
+template <uint16_t Order, uint16_t Bins, typename Band>
+constexpr typename ExpTable<Order, Bins, Band>::Data ExpTable<Order, Bins, Band>::table =
+  ExpTable<Order, Bins, Band>::generate();
+
+template <uint16_t Order, uint16_t Bins, typename Band>
+constexpr typename ExpTable<Order, Bins, Band>::FixedData ExpTable<Order, Bins, Band>::fixed =
+  ExpTable<Order, Bins, Band>::generateFixed();
+
+#endif  // _EXP_TABLE_HPP
@@ -0,0 +1,60 @@
+#ifndef _FIXED_POINT_HPP
+#define _FIXED_POINT_HPP
+
+#include <stdint.h>
+
+// Fixed-point helpers for the Q31 MEM path.
+//
+// A Qn value v stands for v / 2ⁿ. Products are formed in 64 bits and shifted back, so a
+// multiply costs one 32x32->64 instruction (MULSH/MULL on the ESP32-S3). Per-bin reciprocals
+// come from Newton-Raphson iterations rather than divisions.
+
+#define Q31_ONE 0x7FFFFFFF  // Largest Q31 value, standing in for 1.0
+
+// a·b of two Q31 values
+static inline int32_t Q31_Mul(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b) >> 31);
+}
+
+// v clamped to the int32 range
+static inline int32_t Q31_Saturate(int64_t v) {
+  return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+}
+
+// Leading zero bits of a non-zero value
+static inline int Fixed_CountLeadingZeros64(uint64_t v) {
+  return __builtin_clzll(v);
+}
+
+// Significant bits of |v|
+static inline int Fixed_Bits64(int64_t v) {
+  uint64_t magnitude = v < 0 ? -(uint64_t)v : (uint64_t)v;
+  return magnitude == 0 ? 0 : 64 - Fixed_CountLeadingZeros64(magnitude);
+}
+
+// num / den in Q31, for den > 0 and |num| <= den. Both are first scaled down together until den
+// fits 31 bits, so the quotient is exact to about 30 bits and the division is 64 by 32 bits.
+static inline int32_t Q31_Ratio(int64_t num, int64_t den) {
+  int shift = Fixed_Bits64(den) - 31;
+  if (shift > 0) {
+    num >>= shift;
+    den >>= shift;
+  }
+  return Q31_Saturate(num * ((int64_t)1 << 31) / den);
+}
+
+// 1/x for x = m / 2³² in [0.5, 1), as Q30 in (2³⁰, 2³¹]. The seed 48/17 - 32/17·x is within
+// 1/17 of 1/x over the range, and each Newton-Raphson step y·(2 - x·y) squares the error, so
+// three steps reach the 32-bit resolution.
+static inline uint32_t Fixed_Reciprocal(uint32_t m) {
+  const uint32_t C1 = 3031741621u;  // 48/17 in Q30
+  const uint32_t C2 = 2021161081u;  // 32/17 in Q30
+  uint32_t y = C1 - (uint32_t)(((uint64_t)C2 * m) >> 32);
+  for (int i = 0; i < 3; i++) {
+    uint32_t xy = (uint32_t)(((uint64_t)m * y) >> 32);  // x·y in Q30, close to 1
+    y = (uint32_t)(((uint64_t)y * ((1u << 31) - xy)) >> 30);
+  }
+  return y;
+}
+
+#endif  // _FIXED_POINT_HPP
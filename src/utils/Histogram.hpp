@@ -0,0 +1,131 @@
+#ifndef _HISTOGRAM_HPP
+#define _HISTOGRAM_HPP
+
+#include <stdint.h>
+
+// Order-statistic histogram backed by a binary indexed (Fenwick) tree.
+//
+// Answers rank, quantile, min and max queries in O(log Bins) instead of a linear
+// cumulative scan, and tracks the height of the modal bin in O(1) per update.
+// MaxCount bounds the number of samples a single bin can hold (the window size).
+template <uint16_t Bins, uint16_t MaxCount>
+class FenwickHistogram {
+private:
+  uint16_t counts[Bins];             // Raw per-bin counts
+  uint16_t tree[Bins + 1];           // 1-indexed Fenwick tree over counts
+  uint16_t countFreq[MaxCount + 2];  // Number of bins holding each count (for the modal bin)
+  uint16_t n;                        // Total number of samples
+  uint16_t mode;                     // Height of the tallest bin
+
+  // Largest power of two not exceeding Bins, the first step of the rank search
+  static constexpr uint16_t topStep(uint16_t step = 1) {
+    return (uint32_t)step * 2 > Bins ? step : topStep(step * 2);
+  }
+
+  void treeAdd(uint16_t bin, int16_t delta) {
+    for (uint16_t i = bin + 1; i <= Bins; i += i & (-i)) {
+      tree[i] += delta;
+    }
+  }
+
+public:
+  FenwickHistogram() { clear(); }
+
+  // Remove all samples
+  void clear() {
+    for (uint16_t i = 0; i < Bins; i++) {
+      counts[i] = 0;
+    }
+    for (uint16_t i = 0; i <= Bins; i++) {
+      tree[i] = 0;
+    }
+    for (uint16_t i = 0; i < MaxCount + 2; i++) {
+      countFreq[i] = 0;
+    }
+    countFreq[0] = Bins;
+    n = 0;
+    mode = 0;
+  }
+
+  // Add one sample to a bin
+  void add(uint16_t bin) {
+    uint16_t c = counts[bin]++;
+    countFreq[c]--;
+    countFreq[c + 1]++;
+    if (c + 1 > mode) {
+      mode = c + 1;
+    }
+    treeAdd(bin, 1);
+    n++;
+  }
+
+  // Remove one sample from a bin. The bin must not be empty.
+  void remove(uint16_t bin) {
+    uint16_t c = counts[bin]--;
+    countFreq[c]--;
+    countFreq[c - 1]++;
+    if (c == mode && countFreq[c] == 0) {
+      mode--;
+    }
+    treeAdd(bin, -1);
+    n--;
+  }
+
+  // Number of samples in a bin
+  uint16_t operator[](uint16_t bin) const {
+    return counts[bin];
+  }
+
+  // Total number of samples
+  uint16_t total() const {
+    return n;
+  }
+
+  // Height of the modal (tallest) bin
+  uint16_t maxCount() const {
+    return mode;
+  }
+
+  // Number of samples in bins [0, bin]
+  uint16_t cumulative(uint16_t bin) const {
+    uint16_t sum = 0;
+    for (uint16_t i = bin + 1; i > 0; i -= i & (-i)) {
+      sum += tree[i];
+    }
+    return sum;
+  }
+
+  // Smallest bin whose cumulative count is >= rank (1-based).
+  // Returns 0 if the histogram holds fewer than rank samples.
+  uint16_t binAtRank(uint16_t rank) const {
+    if (rank == 0 || rank > n) {
+      return 0;
+    }
+    uint16_t pos = 0;
+    uint16_t remaining = rank;
+    for (uint16_t step = topStep(); step > 0; step >>= 1) {
+      if (pos + step <= Bins && tree[pos + step] < remaining) {
+        pos += step;
+        remaining -= tree[pos];
+      }
+    }
+    return pos;
+  }
+
+  // Bin holding the p-quantile (0 <= p <= 1), using rank = ⌊p * N⌋ + 1
+  uint16_t quantile(float p) const {
+    uint16_t rank = (uint16_t)(p * (float)n) + 1;
+    return binAtRank(rank > n ? n : rank);
+  }
+
+  // Lowest and highest non-empty bins
+  uint16_t minBin() const {
+    return binAtRank(1);
+  }
+
+  uint16_t maxBin() const {
+    return binAtRank(n);
+  }
+};
+
+#endif  // _HISTOGRAM_HPP
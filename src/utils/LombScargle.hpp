@@ -0,0 +1,159 @@
+#ifndef _LOMB_SCARGLE_HPP
+#define _LOMB_SCARGLE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "SineTable.hpp"
+
+// Lomb-Scargle periodogram of a sliding window of unevenly spaced samples, such as beats at the
+// times they occurred, without resampling them.
+//
+// At each frequency ω the periodogram is the power of the least-squares fit of a sinusoid to the
+// mean-removed samples:
+//    P(ω) = (SS·C² - 2·CS·C·S + CC·S²) / (2·(CC·SS - CS²))
+// with C = Σ (xₖ - x̄)·cos ωtₖ, S = Σ (xₖ - x̄)·sin ωtₖ, CC = Σ cos² ωtₖ, SS = Σ sin² ωtₖ and
+// CS = Σ cos ωtₖ·sin ωtₖ. Scargle's time offset τ only rotates the fit so that CS vanishes; the
+// power is the same. Since
+//    C = Σ xₖ·cos ωtₖ - x̄·Σ cos ωtₖ,   CC, SS = (N ± Σ cos 2ωtₖ) / 2,   CS = Σ sin 2ωtₖ / 2
+// six sums per frequency (Σ x·cos ωt, Σ x·sin ωt, Σ cos ωt, Σ sin ωt, Σ cos 2ωt, Σ sin 2ωt) hold
+// everything, and they are updated as samples enter and leave the window. A sample costs O(Bins)
+// and the periodogram O(Bins) whatever the window length, where evaluating it directly, or by the
+// extirpolation and FFT of Press and Rybicki, visits every sample of the window each time.
+//
+// Times are whole ms. The phase ω·t is a 32-bit product in turns, which wraps once per turn, and
+// cos and sin are read from a Q15 table, so removing a sample subtracts exactly what adding it
+// added: the sums are integers and never drift. The table (SineTable) has 1024 entries, close
+// enough for band powers.
+//
+// The Bins frequencies are spaced like numpy.linspace(Band::low, Band::high, Bins), Band being a
+// type with static constexpr double members `low` and `high` in Hz. The spectrum is one-sided in
+// ms²/Hz, 2·P(ω)·T/N for N samples spanning T seconds, so it integrates to the variance of the
+// samples like the MEM spectrum does. Its peaks are 1/T wide, so the bins have to be closer than
+// that for the band powers to hold. The spectrum goes to a buffer of the caller, which windows can
+// share. A window holds at most MAX_SAMPLES samples, which keeps N·Σ x·cos ωt within 64 bits.
+// Nothing is allocated.
+template <uint16_t Bins, typename Band>
+class SlidingLomb {
+  static_assert(Bins > 1, "SlidingLomb needs at least two frequency bins");
+
+public:
+  static const uint16_t MAX_SAMPLES = 4096;
+  static constexpr double step = (Band::high - Band::low) / (Bins - 1);  // Bin spacing in Hz
+
+  SlidingLomb() { clear(); }
+
+  // Empty the window
+  void clear() {
+    memset(sums, 0, sizeof(sums));
+    sum = 0;
+    count = 0;
+  }
+
+  // Sample of value x at time t ms entering or leaving the window
+  void add(uint32_t t, uint16_t x) {
+    update(t, x, 1);
+    sum += x;
+    count++;
+  }
+
+  void remove(uint32_t t, uint16_t x) {
+    update(t, x, -1);
+    sum -= x;
+    count--;
+  }
+
+  // Spectrum of the samples in the window into psd[Bins] (ms²/Hz, bin f at Band::low + f·step),
+  // the samples spanning spanMs ms (the sum of the PPIs for beats)
+  void compute(uint32_t spanMs, float* psd) const {
+    if (count < 3) {
+      memset(psd, 0, Bins * sizeof(float));
+      return;
+    }
+    const int64_t n = count;
+    const float unit = 1.0f / 32768.0f, perSample = unit / n, half = 0.5f * unit;
+    const float scale = (spanMs / 1000.0f) / n;  // ms²/Hz per unit of P, with P's factor 1/2
+    for (uint16_t f = 0; f < Bins; f++) {
+      const Sums& s = sums[f];
+
+      // N·C and N·S are exact; CC, SS and CS follow from the double-angle sums
+      float c = (float)(n * s.xc - sum * s.c) * perSample;
+      float sn = (float)(n * s.xs - sum * s.s) * perSample;
+      float cc = 0.5f * (float)n + s.c2 * half;
+      float ss = 0.5f * (float)n - s.c2 * half;
+      float cs = s.s2 * half;
+
+      // The fit is undetermined when the samples barely cover a cycle and cos and sin coincide on them
+      float det = cc * ss - cs * cs;
+      float p = det > 1e-6f * cc * ss ? (ss * c * c - 2.0f * cs * c * sn + cc * sn * sn) / det : 0.0f;
+      psd[f] = p * scale;
+    }
+  }
+
+  // Power of a spectrum from compute() between low and high Hz (ms²), integrating the piecewise
+  // linear spectrum within the band
+  static float integrate(const float* psd, float low, float high) {
+    float a = ((low < Band::low ? (float)Band::low : low) - (float)Band::low) / (float)step;
+    float b = ((high > Band::high ? (float)Band::high : high) - (float)Band::low) / (float)step;
+    float power = 0.0f;
+    for (int i = (int)a; i < Bins - 1 && i < b; i++) {
+      float x0 = a > i ? a : i, x1 = b < i + 1 ? b : i + 1;
+      float p0 = psd[i] + (psd[i + 1] - psd[i]) * (x0 - i);
+      float p1 = psd[i] + (psd[i + 1] - psd[i]) * (x1 - i);
+      power += 0.5f * (p0 + p1) * (x1 - x0);
+    }
+    return power * (float)step;
+  }
+
+  uint16_t samples() const { return count; }
+
+  // Frequency of bin f in Hz
+  static constexpr double frequency(uint16_t f) { return Band::low + step * f; }
+
+private:
+  struct Tables {
+    SineTable<10> sine;
+    uint32_t turns[Bins];  // Phase advance per ms of each frequency, in 2⁻³² turns
+  };
+
+  static constexpr Tables generate() {
+    Tables tables = {};
+    for (uint16_t f = 0; f < Bins; f++) {
+      tables.turns[f] = (uint32_t)(frequency(f) / 1000.0 * 4294967296.0 + 0.5);
+    }
+    return tables;
+  }
+
+  static const Tables tables;
+
+  // Per frequency, Q15: Σ x·cos ωt, Σ x·sin ωt, Σ cos ωt, Σ sin ωt, Σ cos 2ωt, Σ sin 2ωt
+  struct Sums {
+    int64_t xc, xs;
+    int32_t c, s, c2, s2;
+  };
+
+  void update(uint32_t t, uint16_t x, int32_t sign) {
+    const int32_t v = sign * (int32_t)x;
+    for (uint16_t f = 0; f < Bins; f++) {
+      uint32_t phase = tables.turns[f] * t;
+      int32_t s1 = tables.sine.sin(phase), c1 = tables.sine.cos(phase);
+      Sums& s = sums[f];
+      s.xc += (int64_t)v * c1;
+      s.xs += (int64_t)v * s1;
+      s.c += sign * c1;
+      s.s += sign * s1;
+      s.c2 += sign * tables.sine.cos(phase << 1);
+      s.s2 += sign * tables.sine.sin(phase << 1);
+    }
+  }
+
+  Sums sums[Bins];
+  int64_t sum;     // Σ x
+  uint16_t count;  // Samples in the window
+};
+
+// Defined outside the class so generate() can be evaluated once SlidingLomb is complete
+template <uint16_t Bins, typename Band>
+constexpr typename SlidingLomb<Bins, Band>::Tables SlidingLomb<Bins, Band>::tables = SlidingLomb<Bins, Band>::generate();
+
+#endif  // _LOMB_SCARGLE_HPP
@@ -2,18 +2,87 @@
 #define MEM_TYPES_H
 
 #include "Constants.h"
+#include "BoundedQueue.hpp"
+#include "Tachogram.hpp"
 
-// Structure to hold MEM algorithm context
+// PPI history shared by all analysis windows (index 0 = oldest beat stored)
+typedef BoundedQueue<uint16_t, HRV_HISTORY_SIZE> PPIHistory;
+
+// Resampled tachogram shared by all analysis windows
+typedef Tachogram<TACHO_HISTORY_SIZE> HRVTachogram;
+typedef HRVTachogram::History TachoHistory;
+
+// A run of consecutive tachogram samples that MEM operates on
 typedef struct {
-  int index;                    // Current write position
-  uint32_t samples_processed;   // Number of samples processed
-  float LF;                     // Low Frequency (percentage of total power)
-  float HF;                     // High Frequency (percentage of total power)
+  const TachoHistory* history;
+  uint16_t first;  // History index of the oldest sample
+  uint16_t count;  // Number of samples
+} TachoWindow;
+
+// Numeric policies of the MEM path (AR estimate, PSD and band integration), selected per
+// context by template parameter. Coeff holds the model, Power the spectrum and Error Burg's
+// prediction errors.
+//    MEM_Float:  single precision, the vectorized PSD kernels (PSDKernel.h)
+//    MEM_Double: double precision throughout, the reference for the others
+//    MEM_Q31:    32-bit fixed point with 64-bit accumulators. The model is kept as reflection
+//                coefficients (Q31, always within ±1) from Burg's method or the Schur
+//                recursion, the spectrum is evaluated by the lattice recursion, and 1/|A(f)|² is
+//                formed by Newton-Raphson in block floating point, so no stage divides per bin.
+struct MEM_Float {
+  typedef float Coeff;
+  typedef float Power;
+  typedef float Error;
+  static constexpr const char* name = "float";
+};
+
+struct MEM_Double {
+  typedef double Coeff;
+  typedef double Power;
+  typedef double Error;
+  static constexpr const char* name = "double";
+};
+
+struct MEM_Q31 {
+  typedef int32_t Coeff;   // Reflection coefficients, Q31
+  typedef uint32_t Power;  // 1/|A(f)|² scaled by 2^-psd_exp
+  typedef int32_t Error;   // Mean-removed samples normalized to 23 bits
+  static constexpr const char* name = "q31";
+};
+
+// MEM algorithm context for an AR model of up to Order coefficients evaluated at Bins frequencies
+template <uint16_t Order, uint16_t Bins, typename Numeric = MEM_NUMERIC>
+struct MEM_ContextT {
+  static constexpr uint16_t order = Order;
+  static constexpr uint16_t bins = Bins;
+  typedef typename Numeric::Coeff Coeff;
+  typedef typename Numeric::Power Power;
+
+  uint8_t ar_method;            // MEM_AR_BURG or MEM_AR_SLIDING
+  uint8_t order_rule;           // MEM_ORDER_FIXED, MEM_ORDER_FPE, MEM_ORDER_AIC or MEM_ORDER_MDL
+  uint16_t model_order;         // Order of the latest model (ar_coeff beyond it are zero)
+  float LF;                     // Low Frequency power (ms²)
+  float HF;                     // High Frequency power (ms²)
   float LF_HF_Ratio;            // Low Frequency / High Frequency Ratio
-  float total_power;            // Total power
-  float buffer[NUM_SAMPLES];    // Circular buffer
-  float ar_coeff[MODEL_ORDER];  // Autoregressive coefficients
-  float psd[FREQ_BINS];         // Power spectrum
-} MEM_Context;
+  float total_power;            // Total power (ms²)
+  int64_t lag_sum[Order + 1];   // Σ xₜ·xₜ₋ₖ over the window for lags 0..Order (exact)
+  int64_t window_sum;           // Σ xₜ over the window
+  Coeff ar_coeff[Order];        // Autoregressive coefficients (MEM_Q31: reflection coefficients)
+  float noise_var;              // Prediction error variance of the AR model (ms²)
+  Power psd[Bins];              // Power spectrum (MEM_Q31: psd·2^psd_exp·2·noise_var)
+  int16_t psd_exp;              // Block exponent of a fixed-point spectrum
+};
+
+// Context for the configured MODEL_ORDER and FREQ_BINS
+typedef MEM_ContextT<MODEL_ORDER, FREQ_BINS> MEM_Context;
+
+// Scratch space for Burg's prediction errors, one per thread running the estimator.
+// Kept out of the context so the windows of an engine can share it.
+template <typename Numeric = MEM_NUMERIC>
+struct MEM_WorkspaceT {
+  typename Numeric::Error f_error[TACHO_HISTORY_SIZE];  // Forward prediction errors
+  typename Numeric::Error b_error[TACHO_HISTORY_SIZE];  // Backward prediction errors
+};
+
+typedef MEM_WorkspaceT<> MEM_Workspace;
 
 #endif // MEM_TYPES_H
@@ -0,0 +1,17 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+// Per-stage profiling hooks for the HRV pipeline.
+// The firmware build compiles these away. Host benchmarks define HRV_PROFILE and provide
+// hrvProfileBegin() / hrvProfileMark(), which attribute the time since the previous mark to a stage.
+#ifdef HRV_PROFILE
+void hrvProfileBegin(void);
+void hrvProfileMark(const char* stage);
+#define HRV_PROFILE_BEGIN() hrvProfileBegin()
+#define HRV_PROFILE_MARK(stage) hrvProfileMark(stage)
+#else
+#define HRV_PROFILE_BEGIN() ((void)0)
+#define HRV_PROFILE_MARK(stage) ((void)0)
+#endif
+
+#endif  // _PROFILE_H
@@ -0,0 +1,343 @@
+#ifndef _SAMPLE_ENTROPY_HPP
+#define _SAMPLE_ENTROPY_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Sample entropy (SampEn) and approximate entropy (ApEn) of several sliding windows over one
+// series, embedding dimension m = 2, updated as values enter and leave the windows.
+//
+// Template i is three consecutive values (xᵢ, xᵢ₊₁, xᵢ₊₂): its first two are the m point template
+// and all three the m + 1 point one. Two templates match at m (or m + 1) points when each of those
+// values differs by at most the tolerance r. A window of N values holds the N - 2 templates that
+// start in it, and over those
+//    B = pairs matching at m points, A = pairs matching at m + 1 points
+//    SampEn = ln(B / A)
+//    cᵢᵐ = templates matching template i at m points, itself included (likewise cᵢᵐ⁺¹)
+//    ApEn = Φᵐ - Φᵐ⁺¹ = Σᵢ (ln cᵢᵐ - ln cᵢᵐ⁺¹) / (N - 2)
+// ApEn therefore uses the same N - m templates at both lengths, where the textbook definition has
+// one more at m points.
+//
+// Counted naively, each window costs O(N²) per value. Here the templates are kept in a grid of
+// cells r wide over (xᵢ, xᵢ₊₁), hashed into Buckets lists. A template can only match the ones in
+// the 3 x 3 cells around its own, so adding or retiring one visits those few and adjusts the counts
+// of each match in place. The grid is shared by the windows, which all end at the newest value:
+// each window has its own start and counts, and a new template is matched once for all of them. Σ ln c is kept in Q16 from a compile-time table, so
+// the terms added and removed cancel exactly however long the series runs.
+//
+// r is fixed: counts made with one tolerance cannot be rescaled to another, so setTolerance()
+// starts over. Capacity (a power of two) is the most values from the oldest window start to the
+// newest value. Nothing is allocated.
+template <uint16_t Capacity, uint8_t Windows, uint16_t Buckets = 256>
+class StreamingEntropy {
+  static_assert(Capacity >= 4 && Capacity <= 0x8000 && (Capacity & (Capacity - 1)) == 0,
+    "Capacity must be a power of two up to 32768");
+  static_assert((Buckets & (Buckets - 1)) == 0, "Buckets must be a power of two");
+  static_assert(Windows > 0 && Windows <= 32, "Windows must fit a 32 bit mask");
+
+public:
+  explicit StreamingEntropy(uint16_t r = 10) : tolerance(r > 0 ? r : 1) { clear(); }
+
+  // Forget every value. The next one pushed is number first.
+  void clear(uint32_t first = 0) {
+    total = first;
+    oldest = first;
+    memset(heads, 0xFF, sizeof(heads));
+    for (uint8_t w = 0; w < Windows; w++) {
+      Counts& c = windows[w];
+      c.start = first;
+      c.end = first;
+      c.A = 0;
+      c.B = 0;
+      c.logM = 0;
+      c.logM1 = 0;
+    }
+  }
+
+  // Tolerance in units of the values. Clears the state.
+  void setTolerance(uint16_t r) {
+    tolerance = r > 0 ? r : 1;
+    clear();
+  }
+
+  uint16_t getTolerance() const { return tolerance; }
+
+  // Append the next value, completing the template that starts two values earlier
+  void push(uint16_t value) {
+    trim();
+    values[total & MASK] = value;
+    total++;
+    if (total - oldest >= 3) {
+      link(total - 3);
+    }
+  }
+
+  // Move every window w to the values [starts[w], newest]: retire its templates before its start,
+  // then count the ones completed since the last call. Starts never decrease.
+  void advance(const uint32_t* starts) {
+    for (uint8_t w = 0; w < Windows; w++) {
+      Counts& c = windows[w];
+      for (; c.start < starts[w] && c.start < c.end; c.start++) {
+        retire(c, c.start);
+      }
+      c.start = starts[w] > c.start ? starts[w] : c.start;
+      c.end = c.end > c.start ? c.end : c.start;
+    }
+
+    // Templates are added in order, each matched once for all the windows counting it next
+    uint32_t complete = total - oldest >= 3 ? total - 2 : oldest;
+    for (;;) {
+      uint32_t n = complete;
+      for (uint8_t w = 0; w < Windows; w++) {
+        n = windows[w].end < n ? windows[w].end : n;
+      }
+      if (n == complete) {
+        break;
+      }
+      uint32_t counting = 0, from = n;
+      for (uint8_t w = 0; w < Windows; w++) {
+        if (windows[w].end == n) {
+          counting |= 1u << w;
+          from = windows[w].start < from ? windows[w].start : from;
+        }
+      }
+      add(counting, n, from);
+    }
+  }
+
+  // ln(B / A) of window w, or 0 until a pair matches at m points. With no match at m + 1 points
+  // this is the bound ln(B), as if one pair did.
+  float sampleEntropy(uint8_t w) const {
+    const Counts& c = windows[w];
+    if (c.B == 0) {
+      return 0.0f;
+    }
+    return logf((float)c.B / (float)(c.A > 0 ? c.A : 1));
+  }
+
+  // Φᵐ - Φᵐ⁺¹ of window w, or 0 without templates
+  float approximateEntropy(uint8_t w) const {
+    const Counts& c = windows[w];
+    uint32_t templates = c.end - c.start;
+    if (templates == 0) {
+      return 0.0f;
+    }
+    return (float)(c.logM - c.logM1) / (65536.0f * templates);
+  }
+
+  // Templates of window w and their matching pairs at m and m + 1 points
+  uint32_t templates(uint8_t w) const { return windows[w].end - windows[w].start; }
+  uint32_t matchesM(uint8_t w) const { return windows[w].B; }
+  uint32_t matchesM1(uint8_t w) const { return windows[w].A; }
+
+private:
+  static const uint16_t MASK = Capacity - 1;
+  static const uint16_t NONE = 0xFFFF;
+
+  struct Counts {
+    uint32_t start;  // First template in the window
+    uint32_t end;    // Templates [start, end) are counted
+    uint32_t A;      // Pairs matching at m + 1 points
+    uint32_t B;      // Pairs matching at m points
+    int32_t logM;    // Σ ln cᵢᵐ over the templates, Q16
+    int32_t logM1;   // Σ ln cᵢᵐ⁺¹, Q16
+    uint16_t countM[Capacity];   // cᵢᵐ of template i at i & MASK
+    uint16_t countM1[Capacity];  // cᵢᵐ⁺¹
+  };
+
+  // ln(c) in Q16 for c = 0..Capacity (0 for c = 0, which no template has), built by the compiler
+  struct LogTable {
+    int32_t q16[Capacity + 1];
+  };
+
+  // ln(c) = k·ln 2 + ln(f) with f in [1, 2), ln(f) = 2·atanh((f - 1) / (f + 1)) by its series
+  static constexpr double logSeries(uint32_t c) {
+    int k = 0;
+    double f = c;
+    while (f >= 2.0) {
+      f /= 2.0;
+      k++;
+    }
+    double z = (f - 1.0) / (f + 1.0), z2 = z * z, term = z, sum = 0.0;
+    for (int n = 1; n < 40; n += 2) {
+      sum += term / n;
+      term *= z2;
+    }
+    return k * 0.6931471805599453 + 2.0 * sum;
+  }
+
+  static constexpr LogTable generateLogs() {
+    LogTable table = {};
+    for (uint32_t c = 1; c <= Capacity; c++) {
+      table.q16[c] = (int32_t)(logSeries(c) * 65536.0 + 0.5);
+    }
+    return table;
+  }
+
+  static const LogTable logs;
+
+  uint16_t cell(uint16_t value) const { return value / tolerance; }
+
+  uint16_t bucket(uint16_t cx, uint16_t cy) const {
+    return (uint16_t)((cx * 0x9E37u) ^ (cy * 0x7F4Bu) ^ (cx >> 3)) & (Buckets - 1);
+  }
+
+  uint16_t bucketOf(uint32_t t) const {
+    return bucket(cell(values[t & MASK]), cell(values[(t + 1) & MASK]));
+  }
+
+  // Absolute number of a template in the grid from its slot
+  uint32_t templateAt(uint16_t slot) const {
+    uint32_t newest = total - 3;
+    return newest - ((newest - slot) & MASK);
+  }
+
+  void link(uint32_t t) {
+    uint16_t b = bucketOf(t);
+    next[t & MASK] = heads[b];
+    heads[b] = t & MASK;
+  }
+
+  // Drop the templates no window holds any more from the grid, before their slots are reused
+  void trim() {
+    uint32_t keep = total;
+    for (uint8_t w = 0; w < Windows; w++) {
+      keep = windows[w].start < keep ? windows[w].start : keep;
+    }
+    // A window more than Capacity - 1 values long would read overwritten values: it starts over
+    if (total - keep > Capacity - 1) {
+      keep = total - (Capacity - 1);
+      for (uint8_t w = 0; w < Windows; w++) {
+        Counts& c = windows[w];
+        if (c.start < keep) {
+          c.start = c.end = keep;
+          c.A = c.B = 0;
+          c.logM = c.logM1 = 0;
+        }
+      }
+    }
+    for (; oldest < keep; oldest++) {
+      if (total - oldest < 3) {
+        continue;  // Never linked
+      }
+      uint16_t slot = oldest & MASK;
+      uint16_t* p = &heads[bucketOf(oldest)];
+      while (*p != slot) {
+        p = &next[*p];
+      }
+      *p = next[slot];
+    }
+  }
+
+  // Call visit(j, matchesM1) for every template j in [from, to) matching t at m points
+  template <typename Visit>
+  void forMatches(uint32_t t, uint32_t from, uint32_t to, Visit visit) const {
+    int x0 = values[t & MASK], x1 = values[(t + 1) & MASK], x2 = values[(t + 2) & MASK];
+    int cx = cell(x0), cy = cell(x1);
+
+    // Each bucket of the 3 x 3 neighbourhood once, even if two of its cells hash together
+    uint16_t visited[9];
+    int count = 0;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        if (cx + dx < 0 || cy + dy < 0) {
+          continue;
+        }
+        uint16_t b = bucket(cx + dx, cy + dy);
+        bool seen = false;
+        for (int i = 0; i < count; i++) {
+          seen |= visited[i] == b;
+        }
+        if (seen) {
+          continue;
+        }
+        visited[count++] = b;
+
+        for (uint16_t slot = heads[b]; slot != NONE; slot = next[slot]) {
+          uint32_t j = templateAt(slot);
+          if (j < from || j >= to) {
+            continue;
+          }
+          int y0 = values[j & MASK], y1 = values[(j + 1) & MASK];
+          if (abs(x0 - y0) <= tolerance && abs(x1 - y1) <= tolerance) {
+            visit(j, abs(x2 - (int)values[(j + 2) & MASK]) <= tolerance);
+          }
+        }
+      }
+    }
+  }
+
+  // Count template n, the next one of the windows in the counting mask, against the templates
+  // before it in each of them (from is the earliest of their starts)
+  void add(uint32_t counting, uint32_t n, uint32_t from) {
+    for (uint8_t w = 0; w < Windows; w++) {
+      if (counting & (1u << w)) {
+        windows[w].countM[n & MASK] = 1;
+        windows[w].countM1[n & MASK] = 1;
+      }
+    }
+    forMatches(n, from, n, [&](uint32_t j, bool m1) {
+      for (uint8_t w = 0; w < Windows; w++) {
+        Counts& c = windows[w];
+        if (!(counting & (1u << w)) || j < c.start) {
+          continue;
+        }
+        uint16_t& cm = c.countM[j & MASK];
+        c.logM += logs.q16[cm + 1] - logs.q16[cm];
+        cm++;
+        c.countM[n & MASK]++;
+        c.B++;
+        if (m1) {
+          uint16_t& cm1 = c.countM1[j & MASK];
+          c.logM1 += logs.q16[cm1 + 1] - logs.q16[cm1];
+          cm1++;
+          c.countM1[n & MASK]++;
+          c.A++;
+        }
+      }
+    });
+    for (uint8_t w = 0; w < Windows; w++) {
+      if (counting & (1u << w)) {
+        Counts& c = windows[w];
+        c.logM += logs.q16[c.countM[n & MASK]];
+        c.logM1 += logs.q16[c.countM1[n & MASK]];
+        c.end++;
+      }
+    }
+  }
+
+  // Remove template t (the window's oldest) and its pairs
+  void retire(Counts& c, uint32_t t) {
+    c.logM -= logs.q16[c.countM[t & MASK]];
+    c.logM1 -= logs.q16[c.countM1[t & MASK]];
+    forMatches(t, t + 1, c.end, [&](uint32_t j, bool m1) {
+      uint16_t& cm = c.countM[j & MASK];
+      c.logM += logs.q16[cm - 1] - logs.q16[cm];
+      cm--;
+      c.B--;
+      if (m1) {
+        uint16_t& cm1 = c.countM1[j & MASK];
+        c.logM1 += logs.q16[cm1 - 1] - logs.q16[cm1];
+        cm1--;
+        c.A--;
+      }
+    });
+  }
+
+  uint16_t tolerance;
+  uint32_t total;   // Values pushed (the next value's number)
+  uint32_t oldest;  // Templates before this one are out of the grid
+  uint16_t values[Capacity];  // Value v at v & MASK
+  uint16_t next[Capacity];    // Grid lists, by template slot
+  uint16_t heads[Buckets];
+  Counts windows[Windows];
+};
+
+// Defined outside the class so generateLogs() can be evaluated once the class is complete
+template <uint16_t Capacity, uint8_t Windows, uint16_t Buckets>
+constexpr typename StreamingEntropy<Capacity, Windows, Buckets>::LogTable StreamingEntropy<Capacity, Windows, Buckets>::logs =
+  StreamingEntropy<Capacity, Windows, Buckets>::generateLogs();
+
+#endif  // _SAMPLE_ENTROPY_HPP
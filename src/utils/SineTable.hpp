@@ -0,0 +1,48 @@
+#ifndef _SINE_TABLE_HPP
+#define _SINE_TABLE_HPP
+
+#include <stdint.h>
+
+// Q15 sine table over one turn, built at compile time, for the sliding spectral sums
+// (SlidingLomb, SlidingDFT).
+//
+// Phases are unsigned 32-bit fractions of a turn, so a phase advance multiplied by a sample time
+// or number wraps by itself, and the same time always reads the same entry. The phase is truncated
+// to an entry (0.35° with 10 bits): adding and removing a sample then subtract exactly what was
+// added, which keeps integer sums of the products free of drift.
+template <uint8_t Bits>
+struct SineTable {
+  static const uint16_t SIZE = 1 << Bits;
+  static const uint32_t MASK = SIZE - 1;
+
+  int16_t q15[SIZE];  // sin(2π·i / SIZE)
+
+  constexpr SineTable() : q15() {
+    for (uint16_t i = 0; i < SIZE; i++) {
+      double v = sineTurns((double)i / SIZE) * 32767.0;
+      q15[i] = (int16_t)(v + (v >= 0 ? 0.5 : -0.5));
+    }
+  }
+
+  // sin and cos of a phase in 2⁻³² turns, Q15
+  int32_t sin(uint32_t phase) const { return q15[phase >> (32 - Bits)]; }
+  int32_t cos(uint32_t phase) const { return q15[((phase >> (32 - Bits)) + SIZE / 4) & MASK]; }
+
+private:
+  // sin(2π·turns) for turns in [0, 1) by a Taylor series around the nearest quarter turn
+  static constexpr double sineTurns(double turns) {
+    double quarters = turns * 4.0;
+    int q = (int)(quarters + 0.5);
+    double x = 1.5707963267948966 * (quarters - q);
+    double c = 1.0, s = x, cTerm = 1.0, sTerm = x;
+    for (int n = 1; n < 9; n++) {
+      cTerm *= -x * x / ((2 * n - 1) * (2 * n));
+      sTerm *= -x * x / ((2 * n) * (2 * n + 1));
+      c += cTerm;
+      s += sTerm;
+    }
+    return q % 4 == 0 ? s : q % 4 == 1 ? c : q % 4 == 2 ? -s : -c;
+  }
+};
+
+#endif  // _SINE_TABLE_HPP
@@ -0,0 +1,177 @@
+#ifndef _SLIDING_DFT_HPP
+#define _SLIDING_DFT_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "SineTable.hpp"
+
+// Frequency band [low, high) in cycles per sample
+struct SDFT_Band {
+  float low;
+  float high;
+};
+
+// Hann-windowed sliding DFT of a window of uniformly spaced samples, such as the tachogram,
+// updated as samples enter and leave the window.
+//
+// The bins are those of a DFT of length N: bin m at m/N cycles per sample. Each bin keeps
+//    Xₘ = Σ xₙ·e^(-2πi·m·n/N),   Eₘ = Σ e^(-2πi·m·n/N)
+// over the window, n being the absolute sample number, so a sample entering or leaving the window
+// changes every bin in O(1) and nothing else. As in SlidingLomb the phases come from a Q15 table
+// indexed by a 32-bit phase, and the sums are integers: removing a sample subtracts exactly what
+// adding it added, where the usual recursion Xₘ ← (Xₘ + xₙ - xₙ₋ₙ)·e^(2πi·m/N) lets rounding errors
+// pile up.
+//
+// The window is applied in the frequency domain. Relative to the oldest sample s, the spectrum is
+// Yₘ = e^(2πi·m·s/N)·Xₘ, and a Hann window 0.5 - 0.5·cos(2π(n - s)/N) turns it into
+//    Hₘ = 0.5·Yₘ - 0.25·(Yₘ₋₁ + Yₘ₊₁)
+// Subtracting the mean x̄·Eₘ first keeps the window's DC from leaking into the lowest bins. A window
+// of exactly N samples is Hann-windowed; windows of a few samples more or less get a slightly
+// truncated or padded taper, which is why the length can be set again (clear) when the window
+// length drifts.
+//
+// The power of bin m is 2·|Hₘ|² / (U·N), U being Σ w², so the bins of a sinusoid of amplitude A add
+// up to A²/2 and a band's power (ms² for a tachogram in ms) is the sum of its bins, accumulated as
+// the bins are formed. Bins 0 to bins - 1 are kept (at most Bins), so bins - 2 is the highest that
+// can be reported. A window holds at most MAX_SAMPLES samples, which keeps N·Σ x·cos within 64 bits.
+// Nothing is allocated.
+template <uint16_t Bins>
+class SlidingDFT {
+  static_assert(Bins > 2, "SlidingDFT needs a bin and its neighbours");
+
+public:
+  static const uint16_t MAX_SAMPLES = 4096;
+
+  SlidingDFT() { clear(Bins, Bins); }
+
+  // Empty the window and set the DFT length N (at least 4), tracking bins [0, bins)
+  void clear(uint16_t length, uint16_t bins) {
+    memset(sums, 0, sizeof(sums));
+    sum = 0;
+    count = 0;
+    n = length;
+    tracked = bins < Bins ? bins : Bins;
+    step = (uint32_t)(4294967296.0 / length + 0.5);
+  }
+
+  // Sample number t of value x entering or leaving the window
+  void add(uint32_t t, uint16_t x) {
+    update(t, x, 1);
+    sum += x;
+    count++;
+  }
+
+  void remove(uint32_t t, uint16_t x) {
+    update(t, x, -1);
+    sum -= x;
+    count--;
+  }
+
+  // Power of each of bandCount bands of the window whose oldest sample is number first. A bin
+  // belongs to every band that holds its frequency.
+  void bandPowers(uint32_t first, const SDFT_Band* bands, uint8_t bandCount, float* power) const {
+    for (uint8_t b = 0; b < bandCount; b++) {
+      power[b] = 0.0f;
+    }
+    const float perBin = 1.0f / n;
+    forEachBin(first, [&](uint16_t m, float p) {
+      float cycles = m * perBin;
+      for (uint8_t b = 0; b < bandCount; b++) {
+        if (cycles >= bands[b].low && cycles < bands[b].high) {
+          power[b] += p;
+        }
+      }
+    });
+  }
+
+  // Power of bins [1, bins() - 1) into power[m], for displays; power[0] is left alone
+  void compute(uint32_t first, float* power) const {
+    forEachBin(first, [&](uint16_t m, float p) { power[m] = p; });
+  }
+
+  uint16_t samples() const { return count; }
+  uint16_t length() const { return n; }
+  uint16_t bins() const { return tracked; }
+
+private:
+  // Per bin, Q15: Σ x·cos, Σ x·sin, Σ cos, Σ sin of the phase 2π·m·t/N
+  struct Sums {
+    int64_t xc, xs;
+    int32_t c, s;
+  };
+
+  static const SineTable<10> sine;
+
+  void update(uint32_t t, uint16_t x, int32_t sign) {
+    const int32_t v = sign * (int32_t)x;
+    const uint32_t advance = step * t;  // Phase of bin 1; bin m is m times further
+    uint32_t phase = 0;
+    for (uint16_t m = 0; m < tracked; m++, phase += advance) {
+      int32_t c = sine.cos(phase), s = sine.sin(phase);
+      Sums& b = sums[m];
+      b.xc += (int64_t)v * c;
+      b.xs += (int64_t)v * s;
+      b.c += sign * c;
+      b.s += sign * s;
+    }
+  }
+
+  // Calls visit(m, power) for bins 1 to tracked - 2 in order
+  template <typename Visit>
+  void forEachBin(uint32_t first, Visit visit) const {
+    if (count < 3 || tracked < 3) {
+      return;
+    }
+    const int64_t total = count;
+    const float perSample = 1.0f / (32768.0f * total);
+
+    // Rotation to the oldest sample, e^(2πi·s/N) raised to m bin by bin
+    const float angle = (float)(step * first) * (float)(2.0 * M_PI / 4294967296.0);
+    const float stepRe = cosf(angle), stepIm = sinf(angle);
+    float rotRe = 1.0f, rotIm = 0.0f;
+
+    // Σ w² of the Hann taper over the window's samples, closed form of the cosine sums
+    const float theta = (float)(2.0 * M_PI) / n;
+    const float c1 = sinf(0.5f * theta * total) * cosf(0.5f * theta * (total - 1)) / sinf(0.5f * theta);
+    const float c2 = sinf(theta * total) * cosf(theta * (total - 1)) / sinf(theta);
+    const float u = 0.375f * total - 0.5f * c1 + 0.125f * c2;
+    const float scale = 2.0f / (u * n);
+
+    // Mean-removed Y of the bin before the one visited, that bin and the next
+    float prevRe = 0.0f, prevIm = 0.0f, re = 0.0f, im = 0.0f;
+    for (uint16_t m = 0; m < tracked; m++) {
+      const Sums& b = sums[m];
+      float xc = (float)(total * b.xc - sum * b.c) * perSample;
+      float xs = (float)(total * b.xs - sum * b.s) * perSample;
+      float nextRe = xc * rotRe + xs * rotIm;
+      float nextIm = xc * rotIm - xs * rotRe;
+      float rotNext = rotRe * stepRe - rotIm * stepIm;
+      rotIm = rotRe * stepIm + rotIm * stepRe;
+      rotRe = rotNext;
+
+      if (m >= 2) {
+        float hRe = 0.5f * re - 0.25f * (prevRe + nextRe);
+        float hIm = 0.5f * im - 0.25f * (prevIm + nextIm);
+        visit(m - 1, (hRe * hRe + hIm * hIm) * scale);
+      }
+      prevRe = re;
+      prevIm = im;
+      re = nextRe;
+      im = nextIm;
+    }
+  }
+
+  Sums sums[Bins];
+  int64_t sum;       // Σ x
+  uint16_t count;    // Samples in the window
+  uint16_t n;        // DFT length N
+  uint16_t tracked;  // Bins kept
+  uint32_t step;     // Phase advance of bin 1 per sample, in 2⁻³² turns
+};
+
+template <uint16_t Bins>
+constexpr SineTable<10> SlidingDFT<Bins>::sine = SineTable<10>();
+
+#endif  // _SLIDING_DFT_HPP
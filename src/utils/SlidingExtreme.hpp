@@ -0,0 +1,68 @@
+#ifndef _SLIDING_EXTREME_HPP
+#define _SLIDING_EXTREME_HPP
+
+#include <stdint.h>
+#include <functional>
+
+// Exact sliding-window extreme (max or min) using a monotonic deque.
+//
+// The deque holds the window values that could still become the extreme, in arrival order,
+// with the current extreme at the front. Each value is pushed and popped at most once, so
+// both operations are amortized O(1). Capacity must be at least the window length.
+// Compare(a, b) is true when a should displace b, e.g. std::greater for a maximum.
+template <typename T, uint16_t Capacity, typename Compare>
+class SlidingExtreme {
+private:
+  T buffer[Capacity];
+  uint16_t head;   // Index of the front (current extreme)
+  uint16_t count;  // Number of candidates stored
+  Compare dominates;
+
+  uint16_t wrap(uint16_t idx) const {
+    return idx >= Capacity ? idx - Capacity : idx;
+  }
+
+public:
+  SlidingExtreme() : head(0), count(0) {}
+
+  // Add the newest window value, discarding candidates it strictly dominates.
+  // Equal values are kept so that evict() stays correct with duplicates.
+  void push(const T& value) {
+    while (count > 0 && dominates(value, buffer[wrap(head + count - 1)])) {
+      count--;
+    }
+    buffer[wrap(head + count)] = value;
+    count++;
+  }
+
+  // Remove the oldest window value. Must be called before pushing its replacement.
+  void evict(const T& oldest) {
+    if (count > 0 && !dominates(buffer[head], oldest) && !dominates(oldest, buffer[head])) {
+      head = wrap(head + 1);
+      count--;
+    }
+  }
+
+  // Current extreme of the window. The window must not be empty.
+  const T& extreme() const {
+    return buffer[head];
+  }
+
+  bool isEmpty() const {
+    return count == 0;
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+};
+
+// Sliding maximum and minimum over a window of up to Capacity values
+template <typename T, uint16_t Capacity>
+using SlidingMax = SlidingExtreme<T, Capacity, std::greater<T>>;
+
+template <typename T, uint16_t Capacity>
+using SlidingMin = SlidingExtreme<T, Capacity, std::less<T>>;
+
+#endif  // _SLIDING_EXTREME_HPP
@@ -0,0 +1,157 @@
+#ifndef _SLIDING_MEDIAN_HPP
+#define _SLIDING_MEDIAN_HPP
+
+#include <stdint.h>
+
+// Exact median of the last Window values, using two indexed heaps.
+//
+// The lower half of the window is kept in a max-heap and the upper half in a min-heap, the lower
+// one holding the extra value when the count is odd, so the median is at the top of the heaps.
+// Values live in a ring of Window slots and each slot remembers where it sits in the heaps, so
+// the value leaving the window is removed in place rather than searched for. push() is
+// O(log Window) and median() O(1). Nothing is allocated.
+template <typename T, uint16_t Window>
+class SlidingMedian {
+  static_assert(Window > 0 && Window < 0x8000, "Window must fit the heap positions");
+
+public:
+  SlidingMedian() { clear(); }
+
+  void clear() {
+    next = 0;
+    count = 0;
+    lowSize = 0;
+    highSize = 0;
+  }
+
+  // Add a value, replacing the oldest one once the window is full
+  void push(const T& value) {
+    if (count == Window) {
+      remove(next);
+    } else {
+      count++;
+    }
+    values[next] = value;
+    insert(next);
+    next = next + 1 == Window ? 0 : next + 1;
+  }
+
+  // Median of the window; the mean of the two middle values if the count is even.
+  // The window must not be empty.
+  float median() const {
+    if (lowSize > highSize) {
+      return (float)values[low[0]];
+    }
+    return ((float)values[low[0]] + (float)values[high[0]]) / 2.0f;
+  }
+
+  uint16_t size() const { return count; }
+  bool isFull() const { return count == Window; }
+
+private:
+  // Heap position of each slot: p >= 0 is low[p], p < 0 is high[~p]
+  bool inLow(uint16_t slot) const { return where[slot] >= 0; }
+
+  // Heap order: a belongs above b in the max-heap (or in the min-heap when swapped)
+  bool above(uint16_t a, uint16_t b, bool max) const {
+    return max ? values[a] > values[b] : values[a] < values[b];
+  }
+
+  void place(uint16_t* heap, bool max, uint16_t pos, uint16_t slot) {
+    heap[pos] = slot;
+    where[slot] = max ? (int16_t)pos : (int16_t)~pos;
+  }
+
+  void siftUp(uint16_t* heap, bool max, uint16_t pos) {
+    uint16_t slot = heap[pos];
+    while (pos > 0) {
+      uint16_t parent = (pos - 1) / 2;
+      if (!above(slot, heap[parent], max)) {
+        break;
+      }
+      place(heap, max, pos, heap[parent]);
+      pos = parent;
+    }
+    place(heap, max, pos, slot);
+  }
+
+  void siftDown(uint16_t* heap, uint16_t size, bool max, uint16_t pos) {
+    uint16_t slot = heap[pos];
+    for (;;) {
+      uint16_t child = 2 * pos + 1;
+      if (child >= size) {
+        break;
+      }
+      if (child + 1 < size && above(heap[child + 1], heap[child], max)) {
+        child++;
+      }
+      if (!above(heap[child], slot, max)) {
+        break;
+      }
+      place(heap, max, pos, heap[child]);
+      pos = child;
+    }
+    place(heap, max, pos, slot);
+  }
+
+  void heapPush(uint16_t* heap, uint16_t& size, bool max, uint16_t slot) {
+    place(heap, max, size, slot);
+    siftUp(heap, max, size++);
+  }
+
+  // Take out the entry at pos, filling the gap with the last entry
+  void heapErase(uint16_t* heap, uint16_t& size, bool max, uint16_t pos) {
+    size--;
+    if (pos == size) {
+      return;
+    }
+    place(heap, max, pos, heap[size]);
+    if (pos > 0 && above(heap[pos], heap[(pos - 1) / 2], max)) {
+      siftUp(heap, max, pos);
+    } else {
+      siftDown(heap, size, max, pos);
+    }
+  }
+
+  void remove(uint16_t slot) {
+    if (inLow(slot)) {
+      heapErase(low, lowSize, true, (uint16_t)where[slot]);
+    } else {
+      heapErase(high, highSize, false, (uint16_t)~where[slot]);
+    }
+    rebalance();
+  }
+
+  void insert(uint16_t slot) {
+    if (lowSize == 0 || values[slot] <= values[low[0]]) {
+      heapPush(low, lowSize, true, slot);
+    } else {
+      heapPush(high, highSize, false, slot);
+    }
+    rebalance();
+  }
+
+  // Restore lowSize == highSize or lowSize == highSize + 1 after one value came or went
+  void rebalance() {
+    if (lowSize > highSize + 1) {
+      uint16_t top = low[0];
+      heapErase(low, lowSize, true, 0);
+      heapPush(high, highSize, false, top);
+    } else if (highSize > lowSize) {
+      uint16_t top = high[0];
+      heapErase(high, highSize, false, 0);
+      heapPush(low, lowSize, true, top);
+    }
+  }
+
+  T values[Window];                    // Ring of the window's values
+  int16_t where[Window];               // Heap position of each slot
+  uint16_t low[(Window + 1) / 2 + 1];  // Max-heap of the lower half (slots)
+  uint16_t high[Window / 2 + 1];       // Min-heap of the upper half (slots)
+  uint16_t lowSize;
+  uint16_t highSize;
+  uint16_t next;   // Slot of the next value
+  uint16_t count;
+};
+
+#endif  // _SLIDING_MEDIAN_HPP
@@ -0,0 +1,111 @@
+#ifndef _SPSC_RING_HPP
+#define _SPSC_RING_HPP
+
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring for handing items between two cores.
+//
+// Exactly one task may call the push functions and exactly one other task the pop functions.
+// head and tail are free-running counters: the producer only writes tail and the consumer
+// only writes head, so no lock or compare-and-swap is needed. Release stores publish the
+// slot contents before the counter and acquire loads observe them in the other task.
+// Capacity must be a power of two so the counters can wrap around 2^32.
+//
+// When the ring is full new items are rejected and counted as overruns, so the consumer
+// never sees a partially overwritten batch.
+template <typename T, uint16_t Capacity>
+class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+private:
+  T buffer[Capacity];
+  std::atomic<uint32_t> head;       // Items popped so far (written by the consumer)
+  std::atomic<uint32_t> tail;       // Items pushed so far (written by the producer)
+  std::atomic<uint32_t> overruns;   // Items rejected because the ring was full
+  std::atomic<uint16_t> highWater;  // Largest fill level seen by the producer
+
+public:
+  SpscRing() : head(0), tail(0), overruns(0), highWater(0) {}
+
+  // Producer: append up to count items. Returns the number stored; the rest are overruns.
+  uint16_t pushBatch(const T* items, uint16_t count) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t used = t - head.load(std::memory_order_acquire);
+    uint16_t free = Capacity - used;
+    uint16_t n = count < free ? count : free;
+
+    for (uint16_t i = 0; i < n; i++) {
+      buffer[(t + i) & (Capacity - 1)] = items[i];
+    }
+    tail.store(t + n, std::memory_order_release);
+
+    if (n < count) {
+      overruns.fetch_add(count - n, std::memory_order_relaxed);
+    }
+    if (used + n > highWater.load(std::memory_order_relaxed)) {
+      highWater.store(used + n, std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  bool push(const T& item) {
+    return pushBatch(&item, 1) == 1;
+  }
+
+  // Consumer: remove up to maxCount of the oldest items into items. Returns the number taken.
+  uint16_t popBatch(T* items, uint16_t maxCount) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t available = tail.load(std::memory_order_acquire) - h;
+    uint16_t n = available < maxCount ? available : maxCount;
+
+    for (uint16_t i = 0; i < n; i++) {
+      items[i] = buffer[(h + i) & (Capacity - 1)];
+    }
+    head.store(h + n, std::memory_order_release);
+    return n;
+  }
+
+  bool pop(T& item) {
+    return popBatch(&item, 1) == 1;
+  }
+
+  // Consumer: drop every item pushed so far. Returns the number dropped.
+  uint16_t discard() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    head.store(t, std::memory_order_release);
+    return t - h;
+  }
+
+  // Snapshot of the fill level; exact only when called from the producer or consumer
+  uint16_t size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+
+  bool isEmpty() const {
+    return size() == 0;
+  }
+
+  uint16_t getCapacity() const {
+    return Capacity;
+  }
+
+  uint32_t getOverruns() const {
+    return overruns.load(std::memory_order_relaxed);
+  }
+
+  uint16_t getHighWater() const {
+    return highWater.load(std::memory_order_relaxed);
+  }
+
+  // Reset the counters. Only safe while neither side is running.
+  void clear() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    highWater.store(0, std::memory_order_relaxed);
+  }
+};
+
+#endif  // _SPSC_RING_HPP
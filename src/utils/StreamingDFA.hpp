@@ -0,0 +1,223 @@
+#ifndef _STREAMING_DFA_HPP
+#define _STREAMING_DFA_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+// Short-term detrended fluctuation analysis exponent (DFA α1) of several sliding windows over one
+// series, updated as values enter and leave the windows.
+//
+// The profile is the running sum of the values. It is cut into boxes of n values for every n from
+// MinBox to MaxBox, and a line is fitted to the profile in each box by least squares. F(n) is the
+// RMS of the residuals over the boxes in the window, and α1 the slope of ln F(n) against ln n.
+//
+// Boxes are aligned to the value numbers (box k covers [k·n, (k + 1)·n)) rather than to the
+// window start, so a box keeps its residual while the window slides; a window counts the boxes
+// that lie entirely inside it. Within the box being filled, the sums Σy, Σy² and Σt·y of the local
+// profile are extended by each value (Σt and Σt² depend only on n), and when the box is full its
+// residual follows from them in O(1):
+//    SSR = ((n·Σy² - (Σy)²)·D - (n·Σt·y - Σt·Σy)²) / (n·D),  D = n·Σt² - (Σt)² = n²(n² - 1) / 12
+// Every value therefore costs O(MaxBox - MinBox + 1): one update per box size, a box added or
+// retired now and then, and a line fit over the box sizes whose F changed.
+//
+// Fitting a line removes any linear term, so the local profile starts from the box's first value
+// instead of subtracting the window mean. Its sums stay small and are kept in integers, and the
+// numerator above is exact in 64 bits: the windows' sums of residuals do not drift as boxes come
+// and go. A box leaving a window is recomputed from the stored values.
+//
+// Capacity (a power of two) is the most values from the oldest window start to the newest value.
+// Nothing is allocated.
+template <uint16_t Capacity, uint8_t Windows, uint8_t MinBox = 4, uint8_t MaxBox = 16>
+class StreamingDFA {
+  static_assert(Capacity >= 2 * MaxBox && (Capacity & (Capacity - 1)) == 0,
+    "Capacity must be a power of two holding two of the largest boxes");
+  static_assert(MinBox >= 3 && MaxBox > MinBox, "DFA needs box sizes from 3 values and at least two of them");
+
+public:
+  static const uint8_t SCALES = MaxBox - MinBox + 1;
+
+  StreamingDFA() {
+    for (uint8_t s = 0; s < SCALES; s++) {
+      logN[s] = logf((float)(MinBox + s));
+    }
+    clear();
+  }
+
+  // Forget every value. The next one pushed is number first.
+  void clear(uint32_t first = 0) {
+    total = first;
+    for (uint8_t w = 0; w < Windows; w++) {
+      for (uint8_t s = 0; s < SCALES; s++) {
+        Counted& c = windows[w][s];
+        uint8_t n = MinBox + s;
+        c.first = c.end = (first + n - 1) / n * n;
+        c.sum = 0;
+        c.logF2 = 0.0f;
+      }
+      alphas[w] = 0.0f;
+    }
+    for (uint8_t s = 0; s < SCALES; s++) {
+      completed[s] = UINT32_MAX;
+      phase[s] = first % (MinBox + s);
+    }
+  }
+
+  // Append the next value and extend the box being filled at every size
+  void push(uint16_t value) {
+    uint32_t b = total++;
+    values[b & MASK] = value;
+    for (uint8_t s = 0; s < SCALES; s++) {
+      uint8_t n = MinBox + s;
+      uint8_t t = phase[s];
+      Box& box = filling[s];
+      if (t == 0) {
+        box.clear(value);
+      }
+      box.add(t, value);
+      if (t == n - 1) {
+        completed[s] = b + 1 - n;
+        completedResidual[s] = box.residual(n);
+        phase[s] = 0;
+      } else {
+        phase[s] = t + 1;
+      }
+    }
+  }
+
+  // Move every window w to the values [starts[w], newest]: retire the boxes starting before its
+  // start, count the boxes completed since the last call and refit α1 if any F(n) changed.
+  // Starts never decrease.
+  void advance(const uint32_t* starts) {
+    for (uint8_t w = 0; w < Windows; w++) {
+      bool changed = false;
+      for (uint8_t s = 0; s < SCALES; s++) {
+        changed |= advanceScale(windows[w][s], MinBox + s, s, starts[w]);
+      }
+      if (changed) {
+        alphas[w] = fit(w);
+      }
+    }
+  }
+
+  // α1 of window w, or 0 until two box sizes have a non-zero fluctuation
+  float alpha(uint8_t w) const { return alphas[w]; }
+
+  // F(n) of window w, or 0 without a box of that size
+  float fluctuation(uint8_t w, uint8_t n) const {
+    const Counted& c = windows[w][n - MinBox];
+    return c.sum > 0 ? expf(0.5f * c.logF2) : 0.0f;
+  }
+
+  // Boxes of n values in window w
+  uint32_t boxes(uint8_t w, uint8_t n) const {
+    const Counted& c = windows[w][n - MinBox];
+    return (c.end - c.first) / n;
+  }
+
+private:
+  static const uint16_t MASK = Capacity - 1;
+
+  // Sums of the local profile yₜ = Σ (xᵢ - x₀) over t = 0..n-1 of one box
+  struct Box {
+    uint16_t ref;  // First value of the box
+    int32_t y;     // Profile at the last value added
+    int64_t sy, syy, sty;
+
+    void clear(uint16_t first) {
+      ref = first;
+      y = 0;
+      sy = syy = sty = 0;
+    }
+
+    void add(uint8_t t, uint16_t value) {
+      y += (int32_t)value - ref;
+      sy += y;
+      syy += (int64_t)y * y;
+      sty += (int64_t)t * y;
+    }
+
+    // n·D times the sum of squared residuals of the fitted line
+    int64_t residual(uint8_t n) const {
+      int64_t st = n * (n - 1) / 2;
+      int64_t d = (int64_t)n * n * (n * n - 1) / 12;
+      int64_t a = n * syy - sy * sy;
+      int64_t c = n * sty - st * sy;
+      return a * d - c * c;
+    }
+  };
+
+  // Boxes of one size counted by a window: those starting in [first, end), in steps of n
+  struct Counted {
+    uint32_t first;
+    uint32_t end;
+    int64_t sum;   // Σ n·D·SSR over the boxes
+    float logF2;   // ln F(n)² while sum > 0
+  };
+
+  // Residual of the stored box starting at value first
+  int64_t boxResidual(uint32_t first, uint8_t n) const {
+    Box box;
+    box.clear(values[first & MASK]);
+    for (uint8_t t = 0; t < n; t++) {
+      box.add(t, values[(first + t) & MASK]);
+    }
+    return box.residual(n);
+  }
+
+  // Returns true if the window's F(n) changed
+  bool advanceScale(Counted& c, uint8_t n, uint8_t s, uint32_t start) {
+    bool changed = false;
+    for (; c.first < c.end && c.first < start; c.first += n) {
+      c.sum -= boxResidual(c.first, n);
+      changed = true;
+    }
+    if (c.first == c.end && c.first < start) {
+      c.first = c.end = (start + n - 1) / n * n;
+    }
+    for (; c.end + n <= total; c.end += n) {
+      c.sum += c.end == completed[s] ? completedResidual[s] : boxResidual(c.end, n);
+      changed = true;
+    }
+    if (changed && c.sum > 0) {
+      // F(n)² = Σ SSR / (boxes · n)
+      int64_t d = (int64_t)n * n * (n * n - 1) / 12;
+      float boxes = (float)((c.end - c.first) / n);
+      c.logF2 = logf((float)c.sum) - logf((float)(n * d) * boxes * n);
+    }
+    return changed;
+  }
+
+  // Least-squares slope of ln F(n) = ln F(n)² / 2 against ln n
+  float fit(uint8_t w) const {
+    float sx = 0.0f, sy = 0.0f, sxx = 0.0f, sxy = 0.0f;
+    int k = 0;
+    for (uint8_t s = 0; s < SCALES; s++) {
+      const Counted& c = windows[w][s];
+      if (c.sum <= 0) {
+        continue;
+      }
+      float x = logN[s], y = 0.5f * c.logF2;
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+      k++;
+    }
+    if (k < 2) {
+      return 0.0f;
+    }
+    return (k * sxy - sx * sy) / (k * sxx - sx * sx);
+  }
+
+  uint32_t total;  // Values pushed (the next value's number)
+  uint16_t values[Capacity];  // Value v at v & MASK
+  Box filling[SCALES];        // Box being filled at each size
+  uint8_t phase[SCALES];      // Position of the next value in it
+  uint32_t completed[SCALES];          // Start of the box the last value completed, per size
+  int64_t completedResidual[SCALES];   // Its residual
+  Counted windows[Windows][SCALES];
+  float alphas[Windows];
+  float logN[SCALES];
+};
+
+#endif  // _STREAMING_DFA_HPP
@@ -0,0 +1,113 @@
+#ifndef _TACHOGRAM_HPP
+#define _TACHOGRAM_HPP
+
+#include "Constants.h"
+#include "BoundedQueue.hpp"
+
+// Beat series resampled to a uniform tachogram, built incrementally as beats arrive.
+//
+// Each beat is a knot (Tₖ, PPIₖ) at the time it occurred, Tₖ being the sum of the PPIs so far.
+// Consecutive knots are joined by cubic Hermite segments with Catmull-Rom tangents, which for
+// uneven knot spacing are
+//    mₖ = (PPIₖ₊₁ - PPIₖ₋₁) / (Tₖ₊₁ - Tₖ₋₁)
+// so the curve passes through every beat and its slope is continuous. The segment [Tₖ₋₁, Tₖ] is
+// final once the beat after Tₖ is known, so each push() evaluates only the segment it completes,
+// at the grid times t₀ + j·TACHO_PERIOD_MS it covers: O(new samples) per beat, and the output
+// lags one beat behind the input.
+//
+// Samples are rounded to whole ms, the resolution of the PPIs themselves, so the lag sums built
+// from them stay exact integers. Capacity samples are kept; index 0 is the oldest.
+template <uint16_t Capacity>
+class Tachogram {
+public:
+  typedef BoundedQueue<uint16_t, Capacity> History;
+
+  Tachogram() { reset(); }
+
+  void reset() {
+    samples.clear();
+    sampleTotal = 0;
+    knots = 0;
+    clock = 0;
+    nextTime = 0;
+  }
+
+  // Add the beat ending PPI ms after the previous one. Returns the number of samples added.
+  uint16_t push(uint16_t ppi) {
+    clock += ppi;
+    if (knots == 4) {
+      for (int k = 0; k < 3; k++) {
+        time[k] = time[k + 1];
+        value[k] = value[k + 1];
+      }
+      knots--;
+    }
+    time[knots] = clock;
+    value[knots] = ppi;
+    knots++;
+
+    if (knots == 1) {
+      nextTime = clock;  // First sample at the first beat
+      return 0;
+    }
+    if (knots == 2) {
+      return 0;  // The first segment needs the tangent at its end
+    }
+
+    // Segment [T₁, T₂] of the knots (T₀, T₁, T₂, T₃); there is no T₀ for the first segment
+    const int k = knots - 3;
+    const uint32_t t1 = time[k], t2 = time[k + 1];
+    const float v1 = value[k], v2 = value[k + 1];
+    const float h = (float)(t2 - t1);
+    const float m1 = k > 0 ? slope(k - 1, k + 1) : slope(k, k + 1);
+    const float m2 = slope(k, k + 2);
+
+    uint16_t added = 0;
+    for (; nextTime < t2; nextTime += TACHO_PERIOD_MS, added++) {
+      // Cubic Hermite basis at s = (t - T₁) / h
+      float s = (float)(nextTime - t1) / h;
+      float s2 = s * s, s3 = s2 * s;
+      float y = (2.0f * s3 - 3.0f * s2 + 1.0f) * v1 + (s3 - 2.0f * s2 + s) * h * m1 +
+                (-2.0f * s3 + 3.0f * s2) * v2 + (s3 - s2) * h * m2;
+      samples.enqueue((uint16_t)(MAX(0.0f, MIN(y, 65535.0f)) + 0.5f));
+    }
+    sampleTotal += added;
+    return added;
+  }
+
+  // Samples produced so far, retained or not (the next sample's number)
+  uint32_t total() const { return sampleTotal; }
+
+  const History& history() const { return samples; }
+
+  // Sum of all PPIs: the time of the newest beat in ms
+  uint32_t now() const { return clock; }
+
+  // Number of the first sample at or after time ms (total() if it is not produced yet)
+  uint32_t sampleAt(uint32_t t) const {
+    if (sampleTotal == 0) {
+      return 0;
+    }
+    uint32_t first = nextTime - sampleTotal * TACHO_PERIOD_MS;  // Time of sample 0
+    if (t <= first) {
+      return 0;
+    }
+    return MIN((t - first + TACHO_PERIOD_MS - 1) / TACHO_PERIOD_MS, sampleTotal);
+  }
+
+private:
+  // Slope of the chord between knots a and b
+  float slope(int a, int b) const {
+    return (value[b] - value[a]) / (float)MAX(time[b] - time[a], 1u);
+  }
+
+  History samples;
+  uint32_t sampleTotal;
+  uint32_t time[4];   // Newest knots, oldest first
+  float value[4];
+  uint8_t knots;
+  uint32_t clock;     // Time of the newest beat
+  uint32_t nextTime;  // Time of the next grid sample
+};
+
+#endif  // _TACHOGRAM_HPP
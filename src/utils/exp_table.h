@@ -1,70 +0,0 @@
-// Generated with command: python scripts/generate_exp_table.py > src/utils/exp_table.h
-// Re-run command to update.
-
-#ifndef EXP_TABLE_H
-#define EXP_TABLE_H
-
-#include "Constants.h"
-
-static const struct {
-  float real[FREQ_BINS];
-  float imag[FREQ_BINS];
-} exp_table[MODEL_ORDER] __attribute__((section(".rodata"))) = {
-  {  // i = 0
-    {  // real parts
-      1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f, 1.000000f,
-    },
-    {  // imaginary parts
-      -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f, -0.000000f,
-    }
-  },
-  {  // i = 1
-    {  // real parts
-      0.968583f, 0.956075f, 0.941531f, 0.924980f, 0.906458f, 0.886005f, 0.863665f, 0.839484f, 0.813515f, 0.785813f, 0.756436f, 0.725448f, 0.692914f, 0.658904f, 0.623490f, 0.586747f, 0.548755f, 0.509593f, 0.469346f, 0.428098f, 0.385939f, 0.342957f, 0.299245f, 0.254895f, 0.210002f, 0.164661f, 0.118970f, 0.073025f, 0.026925f, -0.019233f, -0.065350f, -0.111327f, -0.157068f, -0.202473f, -0.247448f, -0.291895f, -0.335720f, -0.378830f, -0.421133f, -0.462538f, -0.502958f, -0.542307f, -0.580500f, -0.617456f, -0.653097f, -0.687346f, -0.720131f, -0.751382f, -0.781031f, -0.809017f,
-    },
-    {  // imaginary parts
-      -0.248690f, -0.293121f, -0.336928f, -0.380016f, -0.422295f, -0.463675f, -0.504066f, -0.543384f, -0.581544f, -0.618464f, -0.654067f, -0.688277f, -0.721020f, -0.752227f, -0.781831f, -0.809770f, -0.835983f, -0.860415f, -0.883014f, -0.903732f, -0.922524f, -0.939351f, -0.954176f, -0.966969f, -0.977701f, -0.986350f, -0.992898f, -0.997330f, -0.999637f, -0.999815f, -0.997862f, -0.993784f, -0.987588f, -0.979288f, -0.968901f, -0.956450f, -0.941962f, -0.925466f, -0.906999f, -0.886599f, -0.864311f, -0.840180f, -0.814260f, -0.786605f, -0.757274f, -0.726330f, -0.693838f, -0.659868f, -0.624492f, -0.587785f,
-    }
-  },
-  {  // i = 2
-    {  // real parts
-      0.876307f, 0.828160f, 0.772960f, 0.711175f, 0.643333f, 0.570011f, 0.491834f, 0.409468f, 0.323614f, 0.235004f, 0.144391f, 0.052549f, -0.039740f, -0.131691f, -0.222521f, -0.311455f, -0.397736f, -0.480630f, -0.559429f, -0.633464f, -0.702102f, -0.764761f, -0.820905f, -0.870057f, -0.911799f, -0.945773f, -0.971692f, -0.989335f, -0.998550f, -0.999260f, -0.991459f, -0.975212f, -0.950659f, -0.918009f, -0.877539f, -0.829595f, -0.774584f, -0.712976f, -0.645294f, -0.572117f, -0.494066f, -0.411807f, -0.326040f, -0.237496f, -0.146929f, -0.055110f, 0.037178f, 0.129149f, 0.220020f, 0.309017f,
-    },
-    {  // imaginary parts
-      -0.481754f, -0.560492f, -0.634455f, -0.703015f, -0.765586f, -0.821637f, -0.870689f, -0.912324f, -0.946189f, -0.971994f, -0.989521f, -0.998618f, -0.999210f, -0.991291f, -0.974928f, -0.950261f, -0.917500f, -0.876924f, -0.828878f, -0.773773f, -0.712076f, -0.644314f, -0.571064f, -0.492950f, -0.410638f, -0.324827f, -0.236250f, -0.145660f, -0.053830f, 0.038459f, 0.130420f, 0.221271f, 0.310236f, 0.396559f, 0.479505f, 0.558366f, 0.632471f, 0.701189f, 0.763934f, 0.820172f, 0.869425f, 0.911271f, 0.945356f, 0.971389f, 0.989147f, 0.998480f, 0.999309f, 0.991625f, 0.975495f, 0.951057f,
-    }
-  },
-  {  // i = 3
-    {  // real parts
-      0.728969f, 0.627492f, 0.514000f, 0.390666f, 0.259851f, 0.124061f, -0.014105f, -0.152000f, -0.286985f, -0.416475f, -0.537990f, -0.649204f, -0.747987f, -0.832448f, -0.900969f, -0.952238f, -0.985274f, -0.999444f, -0.994477f, -0.970468f, -0.927876f, -0.867518f, -0.790548f, -0.698441f, -0.592960f, -0.476125f, -0.350174f, -0.217517f, -0.080696f, 0.057671f, 0.194933f, 0.328463f, 0.455703f, 0.574218f, 0.681738f, 0.776204f, 0.855807f, 0.919023f, 0.964642f, 0.991790f, 0.999947f, 0.988958f, 0.959032f, 0.910743f, 0.845014f, 0.763106f, 0.666586f, 0.557302f, 0.437346f, 0.309017f,
-    },
-    {  // imaginary parts
-      -0.684547f, -0.778623f, -0.857790f, -0.920533f, -0.965649f, -0.992275f, -0.999901f, -0.988380f, -0.957935f, -0.909147f, -0.842951f, -0.760614f, -0.663713f, -0.554103f, -0.433884f, -0.305356f, -0.170982f, -0.033333f, 0.104954f, 0.241231f, 0.372889f, 0.497407f, 0.612400f, 0.715668f, 0.805232f, 0.879377f, 0.936685f, 0.976056f, 0.996739f, 0.998336f, 0.980817f, 0.944517f, 0.890132f, 0.818702f, 0.731597f, 0.630482f, 0.517296f, 0.394204f, 0.263564f, 0.127877f, -0.010258f, -0.148197f, -0.283298f, -0.412975f, -0.534744f, -0.646273f, -0.745429f, -0.830310f, -0.899293f, -0.951057f,
-    }
-  },
-  {  // i = 4
-    {  // real parts
-      0.535827f, 0.371699f, 0.194933f, 0.011540f, -0.172245f, -0.350174f, -0.516198f, -0.664672f, -0.790548f, -0.889547f, -0.958302f, -0.994477f, -0.996841f, -0.965315f, -0.900969f, -0.805992f, -0.683612f, -0.537990f, -0.374078f, -0.197448f, -0.014105f, 0.169718f, 0.347771f, 0.514000f, 0.662753f, 0.788975f, 0.888372f, 0.957566f, 0.994205f, 0.997042f, 0.965981f, 0.902079f, 0.807507f, 0.685481f, 0.540150f, 0.376455f, 0.199961f, 0.016669f, -0.167190f, -0.345365f, -0.511798f, -0.660831f, -0.787396f, -0.887192f, -0.956824f, -0.993926f, -0.997236f, -0.966641f, -0.903182f, -0.809017f,
-    },
-    {  // imaginary parts
-      -0.844328f, -0.928353f, -0.980817f, -0.999933f, -0.985054f, -0.936685f, -0.856469f, -0.747136f, -0.612400f, -0.456844f, -0.285757f, -0.104954f, 0.079418f, 0.261089f, 0.433884f, 0.591927f, 0.729846f, 0.842951f, 0.927397f, 0.980313f, 0.999901f, 0.985493f, 0.937580f, 0.857790f, 0.748838f, 0.614426f, 0.459124f, 0.288213f, 0.107504f, -0.076861f, -0.258613f, -0.431572f, -0.589858f, -0.728090f, -0.841569f, -0.926435f, -0.979804f, -0.999861f, -0.985925f, -0.938468f, -0.859106f, -0.750535f, -0.616447f, -0.461401f, -0.290668f, -0.110053f, 0.074304f, 0.256134f, 0.429257f, 0.587785f,
-    }
-  },
-  {  // i = 5
-    {  // real parts
-      0.309017f, 0.083252f, -0.146929f, -0.369316f, -0.572117f, -0.744573f, -0.877539f, -0.963963f, -0.999260f, -0.981559f, -0.911799f, -0.793678f, -0.633464f, -0.439651f, -0.222521f, 0.006411f, 0.235004f, 0.451132f, 0.643333f, 0.801414f, 0.916989f, 0.983930f, 0.998685f, 0.960472f, 0.871319f, 0.735952f, 0.561553f, 0.357370f, 0.134233f, -0.096023f, -0.321186f, -0.529315f, -0.709370f, -0.851802f, -0.949056f, -0.995974f, -0.990069f, -0.931652f, -0.823823f, -0.672301f, -0.485121f, -0.272212f, -0.044865f, 0.184862f, 0.404783f, 0.603236f, 0.769695f, 0.895331f, 0.973481f, 1.000000f,
-    },
-    {  // imaginary parts
-      -0.951057f, -0.996529f, -0.989147f, -0.929304f, -0.820172f, -0.667541f, -0.479505f, -0.266037f, -0.038459f, 0.191159f, 0.410638f, 0.608337f, 0.773773f, 0.898169f, 0.974928f, 0.999979f, 0.971994f, 0.892457f, 0.765586f, 0.598111f, 0.398912f, 0.178557f, -0.051269f, -0.278375f, -0.490718f, -0.677033f, -0.827441f, -0.933963f, -0.990950f, -0.995379f, -0.947016f, -0.848425f, -0.704836f, -0.523865f, -0.315108f, -0.089639f, 0.140584f, 0.363351f, 0.566846f, 0.740278f, 0.874447f, 0.962237f, 0.998993f, 0.982765f, 0.914413f, 0.797562f, 0.638411f, 0.445401f, 0.228767f, 0.000000f,
-    }
-  },
-  {  // i = 6
-    {  // real parts
-      0.062791f, -0.212508f, -0.471609f, -0.694761f, -0.864955f, -0.969218f, -0.999602f, -0.953792f, -0.835279f, -0.653097f, -0.421133f, -0.157068f, 0.118970f, 0.385939f, 0.623490f, 0.813515f, 0.941531f, 0.997778f, 0.977970f, 0.883616f, 0.721908f, 0.505173f, 0.249932f, -0.024361f, -0.296797f, -0.546609f, -0.754756f, -0.905372f, -0.986976f, -0.993348f, -0.924002f, -0.784224f, -0.584669f, -0.340547f, -0.070467f, 0.204984f, 0.464811f, 0.689207f, 0.861068f, 0.967295f, 0.999790f, 0.956075f, 0.839484f, 0.658904f, 0.428098f, 0.164661f, -0.111327f, -0.378830f, -0.617456f, -0.809017f,
-    },
-    {  // imaginary parts
-      -0.998027f, -0.977159f, -0.881808f, -0.719241f, -0.501850f, -0.246205f, 0.028206f, 0.300468f, 0.549826f, 0.757274f, 0.906999f, 0.987588f, 0.992898f, 0.922524f, 0.781831f, 0.581544f, 0.336928f, 0.066629f, -0.208748f, -0.468213f, -0.691989f, -0.863018f, -0.968263f, -0.999703f, -0.954941f, -0.837388f, -0.656005f, -0.424619f, -0.160866f, 0.115149f, 0.382387f, 0.620478f, 0.811272f, 0.940227f, 0.997514f, 0.978765f, 0.885410f, 0.724565f, 0.508489f, 0.253655f, -0.020515f, -0.293121f, -0.543384f, -0.752227f, -0.903732f, -0.986350f, -0.993784f, -0.925466f, -0.786605f, -0.587785f,
-    }
-  }
-};
-#endif  // EXP_TABLE_H
\ No newline at end of file
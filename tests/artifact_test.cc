@@ -0,0 +1,120 @@
+// Artifact correction test for SlidingMedian (src/utils/SlidingMedian.hpp) and the correction stage
+// of HRVEngine.
+//
+// Checks that:
+//   - the running median matches a sort of the last Window values for odd and even windows, with
+//     repeated values and while the window is still filling
+//   - isolated ectopic and missed beats are replaced by the median and counted, and clean beats
+//     pass unchanged
+//   - a lasting change of rate is corrected only until it fills half the median window
+//   - the time-domain and spectral values are computed from the corrected beats, and the
+//     correction can be switched off
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+static Lcg rng(7);
+
+template <uint16_t Window>
+static void compareMedian(uint16_t range) {
+  SlidingMedian<uint16_t, Window> median;
+  std::vector<uint16_t> values;
+  int mismatches = 0;
+  for (int n = 0; n < 5000; n++) {
+    uint16_t value = 600 + rng.next() % range;  // A small range forces repeated values
+    median.push(value);
+    values.push_back(value);
+
+    std::vector<uint16_t> window(values.end() - std::min<size_t>(values.size(), Window), values.end());
+    std::sort(window.begin(), window.end());
+    size_t m = window.size();
+    float expected = m % 2 ? window[m / 2] : (window[m / 2 - 1] + window[m / 2]) / 2.0f;
+    mismatches += median.median() != expected;
+  }
+  EXPECT(mismatches == 0, "window %u, range %u: %d medians differ from the sort", Window, range, mismatches);
+  EXPECT(median.isFull() && median.size() == Window, "window %u not full", Window);
+}
+
+static void runningMedian() {
+  compareMedian<1>(50);
+  compareMedian<2>(50);
+  compareMedian<5>(4);
+  compareMedian<11>(300);
+  compareMedian<64>(20);
+  compareMedian<101>(1000);
+}
+
+static void isolatedArtifacts() {
+  static DefaultHRVEngine engine;
+  engine.reset();
+  uint32_t expected = 0;
+  for (int i = 0; i < 400; i++) {
+    uint16_t beat = 800 + (i % 7) * 5;  // Clean beats within a few percent
+    if (i > 50 && i % 40 == 0) {
+      beat = 450;   // Ectopic beat
+    } else if (i > 50 && i % 40 == 20) {
+      beat = 1640;  // Missed beat
+    }
+    engine.push(beat);
+    const HRV_Snapshot& s = engine.snapshot();
+    if (beat == 450 || beat == 1640) {
+      expected++;
+      EXPECT(s.current_ppi > 790 && s.current_ppi < 840, "beat %d (%u ms) analyzed as %u ms", i, beat, s.current_ppi);
+    } else {
+      EXPECT(s.current_ppi == beat, "clean beat %d changed from %u to %u ms", i, beat, s.current_ppi);
+    }
+  }
+  const HRV_Snapshot& s = engine.snapshot();
+  EXPECT(s.corrected == expected && s.beats == 400, "%u of %u beats corrected, %u expected", s.corrected, s.beats, expected);
+
+  // No artifact reaches the windows
+  for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+    EXPECT(s.window[i].min_ppi >= 790 && s.window[i].max_ppi <= 840, "window %d spans %u-%u ms", i, s.window[i].min_ppi, s.window[i].max_ppi);
+  }
+}
+
+static void rateChange() {
+  static DefaultHRVEngine engine;
+  engine.reset();
+  for (int i = 0; i < 100; i++) {
+    engine.push(1000);
+  }
+  // Exercise: the rate jumps by 40% and stays there
+  uint32_t before = engine.snapshot().corrected;
+  for (int i = 0; i < 100; i++) {
+    engine.push(600);
+  }
+  uint32_t corrected = engine.snapshot().corrected - before;
+  EXPECT(corrected == ARTIFACT_WINDOW / 2 + 1, "%u beats of the new rate corrected", corrected);
+  EXPECT(engine.snapshot().window[0].max_ppi == 600, "short-term window still at the old rate");
+}
+
+static void switchedOff() {
+  static DefaultHRVEngine corrected, raw;
+  raw.setArtifactCorrection(false);
+  for (int i = 0; i < 600; i++) {
+    uint16_t beat = i % 25 == 24 ? 1700 : 850 + (i % 5) * 10;
+    corrected.push(beat);
+    raw.push(beat);
+  }
+  const HRV_Metrics& c = corrected.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& r = raw.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("5 min window: RMSSD %u vs %u ms, total power %.0f vs %.0f ms² with and without correction\n",
+    c.rmssd, r.rmssd, c.total_power, r.total_power);
+  EXPECT(raw.snapshot().corrected == 0 && r.max_ppi == 1700, "correction not switched off");
+  EXPECT(c.max_ppi < 900 && c.rmssd * 5 < r.rmssd, "RMSSD %u ms corrected, %u ms raw", c.rmssd, r.rmssd);
+  EXPECT(c.total_power * 5 < r.total_power, "total power %.0f ms² corrected, %.0f ms² raw", c.total_power, r.total_power);
+}
+
+int main() {
+  runningMedian();
+  isolatedArtifacts();
+  rateChange();
+  switchedOff();
+
+  return testResult();
+}
@@ -0,0 +1,184 @@
+// Streaming DFA α1 test for StreamingDFA (src/utils/StreamingDFA.hpp) and the DFA stage of
+// HRVEngine.
+//
+// Checks that:
+//   - F(n) and α1 of several windows sliding at different paces match a direct DFA in double over
+//     the same boxes (profile of the mean-removed window, a least-squares line per box), including
+//     after clearing from a value number that is not a box boundary
+//   - white noise gives α1 near 0.5 (a little above, as short boxes do) and a random walk near
+//     1.5, and a constant series no α1
+//   - engines report α1 for every window through the snapshot and HRV_DFA_Alpha1
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static Lcg rng(23);
+
+// DFA over the boxes [k·n, (k + 1)·n) inside [start, end) of x, as it is usually written
+struct Reference {
+  double F[DFA_MAX_BOX + 1] = { 0 };
+  double alpha = 0.0;
+};
+
+static Reference direct(const std::vector<uint16_t>& x, uint32_t start, uint32_t end) {
+  Reference ref;
+  double mean = 0.0;
+  for (uint32_t i = start; i < end; i++) {
+    mean += x[i];
+  }
+  mean /= MAX(end - start, 1u);
+  std::vector<double> profile(end - start + 1, 0.0);
+  for (uint32_t i = start; i < end; i++) {
+    profile[i - start + 1] = profile[i - start] + (x[i] - mean);
+  }
+
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  int k = 0;
+  for (int n = DFA_MIN_BOX; n <= DFA_MAX_BOX; n++) {
+    double ssr = 0.0;
+    int boxes = 0;
+    for (uint32_t first = (start + n - 1) / n * n; first + n <= end; first += n, boxes++) {
+      double st = 0, stt = 0, sy1 = 0, sty = 0;
+      for (int t = 0; t < n; t++) {
+        double y = profile[first - start + t + 1];
+        st += t;
+        stt += t * t;
+        sy1 += y;
+        sty += t * y;
+      }
+      double slope = (n * sty - st * sy1) / (n * stt - st * st);
+      double intercept = (sy1 - slope * st) / n;
+      for (int t = 0; t < n; t++) {
+        double r = profile[first - start + t + 1] - (intercept + slope * t);
+        ssr += r * r;
+      }
+    }
+    if (boxes > 0 && ssr > 1e-9) {
+      ref.F[n] = sqrt(ssr / (boxes * n));
+      double lx = log((double)n), ly = log(ref.F[n]);
+      sx += lx;
+      sy += ly;
+      sxx += lx * lx;
+      sxy += lx * ly;
+      k++;
+    }
+  }
+  ref.alpha = k >= 2 ? (k * sxy - sx * sy) / (k * sxx - sx * sx) : 0.0;
+  return ref;
+}
+
+typedef StreamingDFA<1024, 3, DFA_MIN_BOX, DFA_MAX_BOX> DFA;
+
+// Largest relative F(n) error and α1 error of window w against the direct DFA
+static void compare(const DFA& dfa, uint8_t w, const std::vector<uint16_t>& x, uint32_t start, double& worstF,
+                    double& worstAlpha) {
+  Reference ref = direct(x, start, x.size());
+  for (int n = DFA_MIN_BOX; n <= DFA_MAX_BOX; n++) {
+    double f = dfa.fluctuation(w, n);
+    worstF = fmax(worstF, ref.F[n] > 0 ? fabs(f / ref.F[n] - 1.0) : f);
+  }
+  worstAlpha = fmax(worstAlpha, fabs(dfa.alpha(w) - ref.alpha));
+}
+
+static void slidingWindows(uint32_t first) {
+  static DFA dfa;
+  dfa.clear(first);
+  std::vector<uint16_t> x(first, 0);  // Values before first are never pushed
+  uint32_t starts[3] = { first, first, first };
+  double worstF = 0.0, worstAlpha = 0.0;
+  double walk = 0.0;
+
+  for (uint32_t n = first; n < first + 4000; n++) {
+    walk = 0.95 * walk + (rng.uniform() - 0.5) * 40.0;
+    x.push_back((uint16_t)(850.0 + walk + (rng.uniform() - 0.5) * 30.0));
+    dfa.push(x.back());
+    uint32_t total = n + 1;
+
+    // A fixed length, a length that wanders, and a start that jumps now and then
+    starts[0] = MAX(first, total > 60 ? total - 60 : 0);
+    uint32_t length = 200 + (n / 5) % 300;
+    starts[1] = MAX(starts[1], total > length ? total - length : 0);
+    if (rng.uniform() < 0.02) {
+      starts[2] = MIN(starts[2] + (uint32_t)(rng.uniform() * 40), total);
+    }
+    starts[2] = MAX(starts[2], total > 1023 ? total - 1023 : 0);
+    dfa.advance(starts);
+
+    if (n % 17 == 0 || n + 1 == first + 4000) {
+      for (uint8_t w = 0; w < 3; w++) {
+        compare(dfa, w, x, starts[w], worstF, worstAlpha);
+      }
+    }
+  }
+  printf("Cleared at %u: F(n) within %.1e, alpha1 within %.1e of the direct DFA\n", first, worstF, worstAlpha);
+  EXPECT(worstF < 1e-4, "cleared at %u: F(n) off by %.2e", first, worstF);
+  EXPECT(worstAlpha < 1e-3, "cleared at %u: alpha1 off by %.2e", first, worstAlpha);
+}
+
+static float alphaOf(const std::vector<uint16_t>& x) {
+  static StreamingDFA<1024, 1, DFA_MIN_BOX, DFA_MAX_BOX> dfa;
+  dfa.clear();
+  for (uint32_t n = 0; n < x.size(); n++) {
+    dfa.push(x[n]);
+    uint32_t start = n >= 1000 ? n - 1000 : 0;
+    dfa.advance(&start);
+  }
+  return dfa.alpha(0);
+}
+
+static void knownExponents() {
+  std::vector<uint16_t> noise, walk, constant(600, 850);
+  double level = 1000.0;
+  for (int n = 0; n < 3000; n++) {
+    noise.push_back((uint16_t)(850.0 + (rng.uniform() - 0.5) * 100.0));
+    level += (rng.uniform() - 0.5) * 20.0;
+    walk.push_back((uint16_t)level);
+  }
+  float white = alphaOf(noise), brown = alphaOf(walk);
+  printf("alpha1: white noise %.3f, random walk %.3f\n", white, brown);
+  EXPECT(white > 0.4f && white < 0.7f, "white noise alpha1 %.3f", white);
+  EXPECT(brown > 1.3f && brown < 1.7f, "random walk alpha1 %.3f", brown);
+  EXPECT(alphaOf(constant) == 0.0f, "constant series alpha1 %.3f", alphaOf(constant));
+}
+
+static void engines() {
+  static DefaultHRVEngine engine;
+  engine.setArtifactCorrection(false);
+  std::vector<uint16_t> beats;
+  Modulated series(850.0f, 60.0f, 25.0f, 40.0f, 29);
+  double worstAlpha = 0.0;
+  for (int n = 0; n < 1500; n++) {
+    beats.push_back(series.next());
+    engine.push(beats.back());
+    if (n % 101 == 0) {
+      for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+        Reference ref = direct(beats, beats.size() - engine.snapshot().window[i].ppi_count, beats.size());
+        worstAlpha = fmax(worstAlpha, fabs(engine.snapshot().window[i].dfa_alpha1 - ref.alpha));
+      }
+    }
+  }
+  EXPECT(worstAlpha < 1e-3, "engine alpha1 off by %.2e", worstAlpha);
+
+  const HRV_Metrics& s = engine.snapshot().window[0];
+  const HRV_Metrics& l = engine.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("Engine: alpha1 %.3f (%u beats), %.3f (%u beats)\n", s.dfa_alpha1, s.ppi_count, l.dfa_alpha1, l.ppi_count);
+
+  resetHRVParameters();
+  for (uint16_t beat : beats) {
+    updateHRVParameters(beat);
+  }
+  EXPECT(HRV_DFA_Alpha1 == hrvEngine.snapshot().window[0].dfa_alpha1 && HRV_DFA_Alpha1 > 0.0f,
+    "HRV_DFA_Alpha1 %.3f not published", HRV_DFA_Alpha1);
+}
+
+int main() {
+  slidingWindows(0);
+  slidingWindows(7);
+  knownExponents();
+  engines();
+
+  return testResult();
+}
@@ -0,0 +1,228 @@
+// Streaming sample and approximate entropy test for StreamingEntropy
+// (src/utils/SampleEntropy.hpp) and the entropy stage of HRVEngine.
+//
+// Checks that:
+//   - the incremental pair counts of several windows sliding at different paces equal a brute
+//     force count over the same templates, and SampEn and ApEn follow from them, for tolerances
+//     from one unit to wider than the spread of the values
+//   - a constant or strictly periodic series has zero entropy, and white noise more than a slow
+//     oscillation
+//   - engines report the entropies of every window's beats through the snapshot and HRV_SampEn /
+//     HRV_ApEn, and changing the tolerance recounts the beats already in the windows
+//   - a window left more than the capacity behind starts over instead of reading stale values
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static Lcg rng(11);
+
+// O(N²) count over the templates starting in [start, end - 2)
+struct Reference {
+  uint32_t A = 0, B = 0;
+  double sampen = 0.0, apen = 0.0;
+};
+
+static Reference bruteForce(const std::vector<uint16_t>& x, uint32_t start, uint32_t end, int r) {
+  Reference ref;
+  if (end < start + 3) {
+    return ref;
+  }
+  uint32_t n = end - 2 - start;
+  std::vector<uint32_t> cm(n, 1), cm1(n, 1);
+  for (uint32_t i = 0; i < n; i++) {
+    for (uint32_t j = i + 1; j < n; j++) {
+      const uint16_t* a = &x[start + i];
+      const uint16_t* b = &x[start + j];
+      if (abs(a[0] - b[0]) <= r && abs(a[1] - b[1]) <= r) {
+        ref.B++;
+        cm[i]++;
+        cm[j]++;
+        if (abs(a[2] - b[2]) <= r) {
+          ref.A++;
+          cm1[i]++;
+          cm1[j]++;
+        }
+      }
+    }
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    ref.apen += (log((double)cm[i]) - log((double)cm1[i])) / n;
+  }
+  ref.sampen = ref.B > 0 ? log((double)ref.B / (ref.A > 0 ? ref.A : 1)) : 0.0;
+  return ref;
+}
+
+static void slidingWindows(uint16_t r, uint16_t spread) {
+  static StreamingEntropy<256, 3> entropy;
+  entropy.setTolerance(r);
+  std::vector<uint16_t> x;
+  uint32_t starts[3] = { 0, 0, 0 };
+  int mismatches = 0, checks = 0;
+  double worstApEn = 0.0;
+
+  for (uint32_t n = 0; n < 3000; n++) {
+    uint16_t value = 800 + rng.next() % spread;
+    x.push_back(value);
+    entropy.push(value);
+    uint32_t total = n + 1;
+
+    // A fixed length, a length that wanders, and a start that jumps now and then
+    starts[0] = total > 40 ? total - 40 : 0;
+    uint32_t length = 100 + (n / 7) % 120;
+    starts[1] = MAX(starts[1], total > length ? total - length : 0);
+    if (rng.next() % 50 == 0) {
+      starts[2] = MAX(starts[2], total > 255 ? total - 255 : 0) + rng.next() % 30;
+      starts[2] = MIN(starts[2], total);
+    }
+    starts[2] = MAX(starts[2], total > 255 ? total - 255 : 0);
+
+    entropy.advance(starts);
+    for (uint8_t w = 0; w < 3; w++) {
+      if (n % 13 != 0 && n < 2900) {
+        continue;
+      }
+      Reference ref = bruteForce(x, starts[w], total, r);
+      checks++;
+      if (entropy.matchesM(w) != ref.B || entropy.matchesM1(w) != ref.A ||
+          fabs(entropy.sampleEntropy(w) - ref.sampen) > 1e-5) {
+        if (mismatches++ == 0) {
+          fprintf(stderr, "r %u, window %u at %u: B %u vs %u, A %u vs %u\n", r, w, n, entropy.matchesM(w), ref.B,
+            entropy.matchesM1(w), ref.A);
+        }
+      }
+      worstApEn = fmax(worstApEn, fabs(entropy.approximateEntropy(w) - ref.apen));
+    }
+  }
+  EXPECT(mismatches == 0, "r %u, spread %u: %d of %d counts differ from brute force", r, spread, mismatches, checks);
+  EXPECT(worstApEn < 1e-4, "r %u, spread %u: ApEn off by %.2e", r, spread, worstApEn);
+}
+
+static void advanceTo(StreamingEntropy<1024, 1>& entropy, uint32_t start) {
+  entropy.advance(&start);
+}
+
+static void knownSeries() {
+  static StreamingEntropy<1024, 1> entropy;
+
+  // Constant: every template matches every other at both lengths
+  entropy.setTolerance(10);
+  for (int n = 0; n < 300; n++) {
+    entropy.push(850);
+    advanceTo(entropy, n > 200 ? n - 200 : 0);
+  }
+  EXPECT(entropy.sampleEntropy(0) == 0.0f && fabsf(entropy.approximateEntropy(0)) < 1e-6f,
+    "constant series: SampEn %.4f, ApEn %.4f", entropy.sampleEntropy(0), entropy.approximateEntropy(0));
+
+  // Period 4: the first two beats of a template fix the third
+  const uint16_t cycle[4] = { 800, 900, 850, 950 };
+  entropy.setTolerance(10);
+  for (int n = 0; n < 300; n++) {
+    entropy.push(cycle[n % 4]);
+    advanceTo(entropy, n > 200 ? n - 200 : 0);
+  }
+  EXPECT(entropy.sampleEntropy(0) == 0.0f, "periodic series: SampEn %.4f", entropy.sampleEntropy(0));
+
+  // White noise against a slow oscillation with a little noise
+  entropy.setTolerance(10);
+  for (int n = 0; n < 600; n++) {
+    entropy.push(850 + rng.next() % 100);
+    advanceTo(entropy, n > 300 ? n - 300 : 0);
+  }
+  float noise = entropy.sampleEntropy(0), noiseAp = entropy.approximateEntropy(0);
+  entropy.setTolerance(10);
+  for (int n = 0; n < 600; n++) {
+    entropy.push((uint16_t)(850 + 50 * sin(2.0 * M_PI * n / 10.0) + rng.next() % 4));
+    advanceTo(entropy, n > 300 ? n - 300 : 0);
+  }
+  float slow = entropy.sampleEntropy(0), slowAp = entropy.approximateEntropy(0);
+  printf("SampEn %.3f, ApEn %.3f for white noise; %.3f, %.3f for an oscillation\n", noise, noiseAp, slow, slowAp);
+  EXPECT(noise > 1.2f && slow < 0.5f * noise, "SampEn %.3f of noise, %.3f of an oscillation", noise, slow);
+  EXPECT(noiseAp > slowAp, "ApEn %.3f of noise, %.3f of an oscillation", noiseAp, slowAp);
+}
+
+// The engine's windows hold the beats from their start to the newest
+static void engines() {
+  static DefaultHRVEngine engine, retuned;
+  engine.setArtifactCorrection(false);
+  retuned.setArtifactCorrection(false);
+  std::vector<uint16_t> beats;
+  Modulated series(850.0f, 60.0f, 25.0f, 40.0f, 13);
+  int mismatches = 0;
+
+  for (int n = 0; n < 1500; n++) {
+    uint16_t ppi = series.next();
+    beats.push_back(ppi);
+    engine.push(ppi);
+    retuned.push(ppi);
+    if (n == 700) {
+      retuned.setEntropyTolerance(20);  // Halfway through, with every window full
+    }
+    if (n % 97 != 0 && n != 1499) {
+      continue;
+    }
+
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      uint32_t count = engine.snapshot().window[i].ppi_count;
+      Reference ref = bruteForce(beats, beats.size() - count, beats.size(), ENTROPY_TOLERANCE);
+      const HRV_Metrics& m = engine.snapshot().window[i];
+      if (fabs(m.sampen - ref.sampen) > 1e-5 || fabs(m.apen - ref.apen) > 1e-4) {
+        if (mismatches++ == 0) {
+          fprintf(stderr, "window %d at beat %d: SampEn %.5f vs %.5f, ApEn %.5f vs %.5f\n", i, n, m.sampen,
+            ref.sampen, m.apen, ref.apen);
+        }
+      }
+      if (n > 700) {
+        Reference wide = bruteForce(beats, beats.size() - count, beats.size(), 20);
+        const HRV_Metrics& w = retuned.snapshot().window[i];
+        mismatches += fabs(w.sampen - wide.sampen) > 1e-5 || fabs(w.apen - wide.apen) > 1e-4;
+      }
+    }
+  }
+  EXPECT(mismatches == 0, "%d window entropies differ from brute force", mismatches);
+  EXPECT(retuned.entropyTolerance() == 20, "tolerance %u after setEntropyTolerance(20)", retuned.entropyTolerance());
+
+  const HRV_Metrics& s = engine.snapshot().window[0];
+  const HRV_Metrics& l = engine.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("Engine: SampEn %.3f (%u beats), %.3f (%u beats); ApEn %.3f, %.3f\n", s.sampen, s.ppi_count, l.sampen,
+    l.ppi_count, s.apen, l.apen);
+
+  // The default engine publishes its short-term window
+  resetHRVParameters();
+  for (uint16_t beat : beats) {
+    updateHRVParameters(beat);
+  }
+  EXPECT(HRV_SampEn == hrvEngine.snapshot().window[0].sampen && HRV_SampEn > 0.0f, "HRV_SampEn %.3f not published",
+    HRV_SampEn);
+  EXPECT(HRV_ApEn == hrvEngine.snapshot().window[0].apen && HRV_ApEn > 0.0f, "HRV_ApEn %.3f not published", HRV_ApEn);
+}
+
+static void staleWindow() {
+  static StreamingEntropy<64, 2> entropy;
+  entropy.setTolerance(5);
+  std::vector<uint16_t> x;
+  for (uint32_t n = 0; n < 500; n++) {
+    x.push_back(800 + rng.next() % 20);
+    entropy.push(x.back());
+    uint32_t starts[2] = { n > 30 ? n - 30 : 0, 0 };  // The second one never moves
+    entropy.advance(starts);
+  }
+  EXPECT(entropy.templates(1) <= 63, "stale window holds %u templates", entropy.templates(1));
+  Reference ref = bruteForce(x, 500 - entropy.templates(1) - 2, 500, 5);
+  EXPECT(entropy.matchesM(1) == ref.B && entropy.matchesM1(1) == ref.A, "stale window counts B %u vs %u, A %u vs %u",
+    entropy.matchesM(1), ref.B, entropy.matchesM1(1), ref.A);
+}
+
+int main() {
+  slidingWindows(1, 50);
+  slidingWindows(5, 60);
+  slidingWindows(10, 200);
+  slidingWindows(300, 200);  // Everything matches
+  knownSeries();
+  engines();
+  staleWindow();
+
+  return testResult();
+}
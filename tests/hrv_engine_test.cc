@@ -0,0 +1,114 @@
+// Instance independence test for HRVEngine (src/core/HRVEngine.hpp).
+//
+// Checks that:
+//   - the default instance driven through updateHRVParameters() matches a standalone engine
+//     with the same parameters, field for field
+//   - two engines fed interleaved streams give the same results as engines fed one stream each,
+//     so no state is shared between instances
+//   - engines with different window, bin and model sizes run side by side in one process
+//   - reset() returns an engine to its initial state
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+
+static const int BEATS = 1500;
+
+// Deterministic PPI series around a given mean with LF and HF modulation plus noise
+struct Stream {
+  Lcg rng;
+  float mean;
+  float t;
+
+  Stream(uint32_t seed, float mean) : rng(seed), mean(mean), t(0.0f) {}
+
+  uint16_t next() {
+    float noise = ((float)rng.uniform() - 0.5f) * 30.0f;
+    float ppi = mean + 40.0f * sinf(2.0f * M_PI * 0.1f * t) + 25.0f * sinf(2.0f * M_PI * 0.25f * t) + noise;
+    t += ppi / 1000.0f;
+    return (uint16_t)ppi;
+  }
+};
+
+static void defaultInstance() {
+  static DefaultHRVEngine engine;
+  Stream stream(1, 850.0f);
+  resetHRVParameters();
+  for (int i = 0; i < BEATS; i++) {
+    uint16_t ppi = stream.next();
+    updateHRVParameters(ppi);
+    engine.push(ppi);
+  }
+  EXPECT(sameSnapshot(hrvEngine.snapshot(), engine.snapshot()), "default instance differs from a standalone engine");
+  EXPECT(HRV_MeanPPI == engine.snapshot().window[0].mean_ppi, "HRV_MeanPPI not published");
+  EXPECT(HRV_LF_HF_Ratio == engine.snapshot().window[0].lf_hf_ratio, "HRV_LF_HF_Ratio not published");
+}
+
+template <typename Engine>
+static void independence(const char* name) {
+  static Engine separateA, separateB, interleavedA, interleavedB;
+  Stream a1(7, 700.0f), b1(11, 1000.0f);
+  for (int i = 0; i < BEATS; i++) {
+    separateA.push(a1.next());
+  }
+  for (int i = 0; i < BEATS; i++) {
+    separateB.push(b1.next());
+  }
+
+  Stream a2(7, 700.0f), b2(11, 1000.0f);
+  for (int i = 0; i < BEATS; i++) {
+    interleavedA.push(a2.next());
+    interleavedB.push(b2.next());
+  }
+
+  EXPECT(separateA.allWindowsFull(), "%s: windows not full after %d beats", name, BEATS);
+  EXPECT(sameSnapshot(separateA.snapshot(), interleavedA.snapshot()), "%s: stream A depends on stream B", name);
+  EXPECT(sameSnapshot(separateB.snapshot(), interleavedB.snapshot()), "%s: stream B depends on stream A", name);
+  EXPECT(separateA.snapshot().window[0].lf > 0.0f, "%s: no spectrum computed", name);
+  printf("%s: %zu bytes per engine, LF/HF %.3f and %.3f\n", name, sizeof(Engine),
+    separateA.snapshot().window[0].lf_hf_ratio, separateB.snapshot().window[0].lf_hf_ratio);
+
+  // Burg's method shares the engine's workspace between windows
+  separateA.reset();
+  separateA.setARMethod(MEM_AR_BURG);
+  interleavedA.reset();
+  interleavedA.setARMethod(MEM_AR_BURG);
+  interleavedB.setARMethod(MEM_AR_BURG);
+  Stream a3(7, 700.0f), a4(7, 700.0f), b3(13, 900.0f);
+  for (int i = 0; i < BEATS; i++) {
+    separateA.push(a3.next());
+  }
+  for (int i = 0; i < BEATS; i++) {
+    interleavedA.push(a4.next());
+    interleavedB.push(b3.next());
+  }
+  EXPECT(sameSnapshot(separateA.snapshot(), interleavedA.snapshot()), "%s: Burg results depend on another engine", name);
+}
+
+static void reset() {
+  static DefaultHRVEngine fresh, used;
+  Stream stream(3, 800.0f);
+  for (int i = 0; i < 200; i++) {
+    used.push(stream.next());
+  }
+  used.reset();
+  EXPECT(sameSnapshot(fresh.snapshot(), used.snapshot()), "reset() left results behind");
+
+  Stream s1(5, 800.0f), s2(5, 800.0f);
+  for (int i = 0; i < BEATS; i++) {
+    fresh.push(s1.next());
+    used.push(s2.next());
+  }
+  EXPECT(sameSnapshot(fresh.snapshot(), used.snapshot()), "reset() left aggregates behind");
+}
+
+int main() {
+  defaultInstance();
+  independence<DefaultHRVEngine>("default");
+  independence<HRVEngine<60, 100, 12>>("window 60, 100 bins, order 12");
+  independence<HRVEngine<20, 32, 4>>("window 20, 32 bins, order 4");
+  reset();
+
+  return testResult();
+}
@@ -0,0 +1,198 @@
+// Lomb-Scargle test for SlidingLomb (src/utils/LombScargle.hpp) and the SPECTRUM_LOMB path of
+// HRVEngine.
+//
+// Checks that:
+//   - the periodogram of windows sliding over unevenly timed samples matches Scargle's formula
+//     with the time offset τ, evaluated directly in double, and a window rebuilt from its samples
+//     has exactly the same spectrum as the one that slid there
+//   - a sinusoid of amplitude A between beats puts A²/2 into the band of its frequency
+//   - engines switched to Lomb-Scargle mid-stream agree with engines that ran it from the start,
+//     switching back to MEM gives the MEM results again, and both estimators find similar LF and
+//     HF in a trace with known band powers
+//   - windows that are not full report no power (total, LF, HF and LF/HF all 0) with either
+//     estimator, and an estimator that does not exist is refused
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static Lcg rng(41);
+
+typedef DefaultHRVEngine::Lomb Lomb;
+
+// Scargle's periodogram of x at times t (ms), with the offset τ: tan 2ωτ = Σ sin 2ωt / Σ cos 2ωt
+static double scargle(const std::vector<uint32_t>& t, const std::vector<uint16_t>& x, size_t first, size_t end,
+                      double hz) {
+  double mean = 0.0;
+  for (size_t k = first; k < end; k++) {
+    mean += x[k];
+  }
+  mean /= end - first;
+  double w = 2.0 * M_PI * hz / 1000.0, s2 = 0.0, c2 = 0.0;
+  for (size_t k = first; k < end; k++) {
+    s2 += sin(2.0 * w * t[k]);
+    c2 += cos(2.0 * w * t[k]);
+  }
+  double tau = atan2(s2, c2) / (2.0 * w);
+  double yc = 0.0, ys = 0.0, cc = 0.0, ss = 0.0;
+  for (size_t k = first; k < end; k++) {
+    double c = cos(w * (t[k] - tau)), s = sin(w * (t[k] - tau));
+    yc += (x[k] - mean) * c;
+    ys += (x[k] - mean) * s;
+    cc += c * c;
+    ss += s * s;
+  }
+  return 0.5 * (yc * yc / cc + ys * ys / ss);
+}
+
+static void slidingWindows() {
+  static Lomb lomb, rebuilt;
+  float psd[LOMB_BINS];
+  std::vector<uint32_t> times;
+  std::vector<uint16_t> values;
+  size_t first = 0;
+  uint32_t now = 0, span = 0;
+  double worst = 0.0;
+
+  for (int n = 0; n < 2000; n++) {
+    uint16_t ppi = (uint16_t)(850.0 + 60.0 * sin(2.0 * M_PI * 0.1 * now / 1000.0) +
+                              30.0 * sin(2.0 * M_PI * 0.3 * now / 1000.0) + (rng.uniform() - 0.5) * 80.0);
+    now += ppi;
+    span += ppi;
+    times.push_back(now);
+    values.push_back(ppi);
+    lomb.add(now, ppi);
+
+    // A window of 40 to 200 beats that grows and shrinks
+    size_t length = 40 + (n / 3) % 160;
+    while (values.size() - first > length) {
+      lomb.remove(times[first], values[first]);
+      span -= values[first];
+      first++;
+    }
+    if (n % 37 != 0 || values.size() - first < 40) {
+      continue;
+    }
+
+    lomb.compute(span, psd);
+    double scale = 2.0 * (span / 1000.0) / (values.size() - first), peak = 0.0;
+    for (uint16_t f = 0; f < LOMB_BINS; f++) {
+      peak = fmax(peak, scargle(times, values, first, values.size(), Lomb::frequency(f)) * scale);
+    }
+    for (uint16_t f = 0; f < LOMB_BINS; f++) {
+      double reference = scargle(times, values, first, values.size(), Lomb::frequency(f)) * scale;
+      worst = fmax(worst, fabs(psd[f] - reference) / peak);
+    }
+  }
+
+  rebuilt.clear();
+  for (size_t k = first; k < values.size(); k++) {
+    rebuilt.add(times[k], values[k]);
+  }
+  float again[LOMB_BINS];
+  lomb.compute(span, psd);
+  rebuilt.compute(span, again);
+  int differences = 0;
+  for (uint16_t f = 0; f < LOMB_BINS; f++) {
+    differences += psd[f] != again[f];
+  }
+  printf("Sliding periodogram within %.1e of the peak of Scargle's, %d bins differ after rebuilding\n", worst,
+    differences);
+  EXPECT(worst < 5e-3, "periodogram off by %.2e of its peak", worst);
+  EXPECT(differences == 0, "%d bins differ from a window rebuilt from its samples", differences);
+}
+
+// Band powers of 300 beats modulated by a sinusoid of amplitude 40 ms at hz
+static void sinusoid(double hz, bool lowBand) {
+  static Lomb lomb;
+  lomb.clear();
+  uint32_t now = 0, span = 0;
+  for (int n = 0; n < 300; n++) {
+    uint16_t ppi = (uint16_t)lround(850.0 + 40.0 * sin(2.0 * M_PI * hz * now / 1000.0));
+    now += ppi;
+    span += ppi;
+    lomb.add(now, ppi);
+  }
+  float psd[LOMB_BINS];
+  lomb.compute(span, psd);
+  float lf = Lomb::integrate(psd, FREQ_LOW, FREQ_MID), hf = Lomb::integrate(psd, FREQ_MID, FREQ_HIGH);
+  float band = lowBand ? lf : hf, other = lowBand ? hf : lf;
+  printf("%.2f Hz sinusoid: LF %.0f, HF %.0f ms² (A²/2 = 800)\n", hz, lf, hf);
+  EXPECT(fabsf(band - 800.0f) < 80.0f && other < 40.0f, "%.2f Hz: %.0f ms² in its band, %.0f in the other", hz, band,
+    other);
+}
+
+static void engines() {
+  static DefaultHRVEngine mem, lomb, switched;
+  mem.setArtifactCorrection(false);
+  lomb.setArtifactCorrection(false);
+  switched.setArtifactCorrection(false);
+  EXPECT(lomb.setSpectrumMethod(SPECTRUM_LOMB) && !lomb.setSpectrumMethod(SPECTRUM_SDFT + 1),
+    "estimator switch refused or unknown estimator accepted");
+  EXPECT(lomb.spectrumMethod() == SPECTRUM_LOMB && mem.spectrumMethod() == SPECTRUM_METHOD, "spectrum methods %u, %u",
+    lomb.spectrumMethod(), mem.spectrumMethod());
+
+  int mismatches = 0, incomplete = 0;
+  double lfRatio = 0.0, hfRatio = 0.0;
+  int compared = 0;
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 47);
+  for (int n = 0; n < 2500; n++) {
+    uint16_t ppi = series.next();
+    mem.push(ppi);
+    lomb.push(ppi);
+    switched.push(ppi);
+    if (n == 700) {
+      switched.setSpectrumMethod(SPECTRUM_LOMB);
+    } else if (n == 1600) {
+      switched.setSpectrumMethod(SPECTRUM_MEM);
+    }
+
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      for (const DefaultHRVEngine* engine : { &mem, &lomb }) {
+        const HRV_Metrics& w = engine->snapshot().window[i];
+        if (!engine->window(i).full && (w.total_power != 0.0f || w.lf != 0.0f || w.hf != 0.0f || w.lf_hf_ratio != 0.0f)) {
+          incomplete++;
+        }
+      }
+      const HRV_Metrics& expected = (n > 700 && n <= 1600 ? lomb : mem).snapshot().window[i];
+      if ((n > 700 && n != 1600) && !sameSpectrum(switched.snapshot().window[i], expected)) {
+        if (mismatches++ == 0) {
+          fprintf(stderr, "window %d at beat %d: LF %.2f vs %.2f\n", i, n, switched.snapshot().window[i].lf, expected.lf);
+        }
+      }
+    }
+    if (mem.allWindowsFull() && n % 50 == 0) {
+      const HRV_Metrics& a = mem.snapshot().window[HRV_NUM_WINDOWS - 1];
+      const HRV_Metrics& b = lomb.snapshot().window[HRV_NUM_WINDOWS - 1];
+      lfRatio += b.lf / a.lf;
+      hfRatio += b.hf / a.hf;
+      compared++;
+    }
+  }
+  EXPECT(mismatches == 0, "%d window spectra differ after switching the estimator", mismatches);
+  EXPECT(incomplete == 0, "%d incomplete window spectra report power", incomplete);
+
+  // 40 ms at 0.1 Hz and 25 ms at 0.25 Hz: 800 and 312 ms² plus the noise in each band
+  const HRV_Metrics& m = mem.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& l = lomb.snapshot().window[HRV_NUM_WINDOWS - 1];
+  lfRatio /= compared;
+  hfRatio /= compared;
+  printf("Longest window: MEM LF %.0f, HF %.0f; Lomb-Scargle LF %.0f, HF %.0f ms² (Lomb / MEM %.2f, %.2f on average)\n",
+    m.lf, m.hf, l.lf, l.hf, lfRatio, hfRatio);
+  EXPECT(l.lf > 700.0f && l.lf < 1000.0f && l.hf > 280.0f && l.hf < 420.0f, "Lomb-Scargle LF %.0f, HF %.0f", l.lf,
+    l.hf);
+  EXPECT(lfRatio > 0.8 && lfRatio < 1.25 && hfRatio > 0.8 && hfRatio < 1.25, "Lomb / MEM LF %.2f, HF %.2f", lfRatio,
+    hfRatio);
+  EXPECT(l.model_order == 0, "Lomb-Scargle window reports model order %u", l.model_order);
+}
+
+int main() {
+  slidingWindows();
+  sinusoid(0.1, true);
+  sinusoid(0.25, false);
+  engines();
+
+  return testResult();
+}
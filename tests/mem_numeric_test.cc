@@ -0,0 +1,158 @@
+// Accuracy test of the MEM numeric policies (MEM_Float, MEM_Double, MEM_Q31 in
+// src/utils/MEM_Types.h) and the fixed-point helpers (src/utils/FixedPoint.hpp).
+//
+// Checks that:
+//   - the Newton-Raphson reciprocal and Q31_Ratio are exact to about 30 bits over their range
+//   - the Schur recursion of the Q31 Yule-Walker path gives the reflection coefficients
+//     Levinson-Durbin does
+//   - the Q31 lattice spectrum of a model matches the direct-form evaluation in double
+//   - with both AR estimators, engines running in double and Q31 report the LF, HF, total power
+//     and LF/HF of every window within a fraction of a percent of the float engine, beat by beat
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static void helpers() {
+  double worst = 0.0;
+  for (uint64_t m = 1u << 31; m < (1ull << 32); m += 65537) {
+    double x = m / 4294967296.0;
+    worst = fmax(worst, fabs(Fixed_Reciprocal((uint32_t)m) / 1073741824.0 * x - 1.0));
+  }
+  EXPECT(worst < 1e-8, "reciprocal off by %.2e", worst);
+
+  worst = 0.0;
+  Lcg rng(3);
+  for (int i = 0; i < 10000; i++) {
+    double fraction = rng.uniform();
+    int64_t den = ((int64_t)rng.state << (i % 30)) + 1;
+    int64_t num = (int64_t)((double)den * (fraction * 2.0 - 1.0));
+    worst = fmax(worst, fabs(Q31_Ratio(num, den) / 2147483648.0 - (double)num / den));
+  }
+  EXPECT(worst < 4e-9, "Q31_Ratio off by %.2e", worst);
+}
+
+// Fill a history with a modulated series and return the window over all of it
+static TachoWindow fill(TachoHistory& history, uint16_t count) {
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 11);
+  Tachogram<TACHO_HISTORY_SIZE> tacho;
+  while (tacho.total() < count) {
+    tacho.push(series.next());
+  }
+  history.clear();
+  for (uint16_t i = tacho.total() - count; i < tacho.total(); i++) {
+    history.enqueue(tacho.history()[i - (tacho.total() - tacho.history().size())]);
+  }
+  TachoWindow window = { &history, 0, count };
+  return window;
+}
+
+template <typename Numeric>
+static void build(MEM_ContextT<MODEL_ORDER, FREQ_BINS, Numeric>* ctx, const TachoWindow& window) {
+  MEM_Init(ctx);
+  for (uint16_t n = 1; n <= window.count; n++) {
+    MEM_AddNewest(ctx, TachoWindow{ window.history, window.first, n });
+  }
+}
+
+static void schurAndLattice() {
+  static TachoHistory history;
+  TachoWindow window = fill(history, 1200);
+  static MEM_ContextT<MODEL_ORDER, FREQ_BINS, MEM_Double> reference;
+  static MEM_ContextT<MODEL_ORDER, FREQ_BINS, MEM_Q31> fixed;
+  build(&reference, window);
+  build(&fixed, window);
+
+  // Reflection coefficients of the double model, by stepping its AR coefficients down
+  SlidingYuleWalker(&reference, window);
+  SlidingYuleWalker(&fixed, window);
+  double a[MODEL_ORDER], k[MODEL_ORDER];
+  for (int i = 0; i < MODEL_ORDER; i++) {
+    a[i] = reference.ar_coeff[i];
+  }
+  for (int m = MODEL_ORDER - 1; m >= 0; m--) {
+    k[m] = a[m];
+    double prev[MODEL_ORDER];
+    for (int i = 0; i < m; i++) {
+      prev[i] = (a[i] - k[m] * a[m - 1 - i]) / (1.0 - k[m] * k[m]);
+    }
+    memcpy(a, prev, m * sizeof(double));
+  }
+  double worst = 0.0;
+  for (int m = 0; m < MODEL_ORDER; m++) {
+    worst = fmax(worst, fabs(fixed.ar_coeff[m] / 2147483648.0 - k[m]));
+  }
+  printf("Schur: k off by %.2e, noise variance %.4f vs %.4f ms²\n", worst, fixed.noise_var, reference.noise_var);
+  EXPECT(worst < 1e-5, "Schur reflection coefficients off by %.2e", worst);
+  EXPECT(fabs(fixed.noise_var / reference.noise_var - 1.0) < 1e-3, "noise variance %.4f vs %.4f ms²", fixed.noise_var, reference.noise_var);
+
+  // Spectrum of the same model through the lattice, relative to the direct form
+  ComputePSD(&reference);
+  ComputePSD(&fixed);
+  worst = 0.0;
+  for (int f = 0; f < FREQ_BINS; f++) {
+    double value = ldexp(fixed.psd[f], fixed.psd_exp) * 2.0 * fixed.noise_var;
+    worst = fmax(worst, fabs(value / reference.psd[f] - 1.0));
+  }
+  printf("lattice: PSD off by %.2e\n", worst);
+  EXPECT(worst < 2e-3, "lattice PSD off by %.2e", worst);
+}
+
+template <typename Numeric>
+using TestEngine = HRVEngine<NUM_SAMPLES, FREQ_BINS, MODEL_ORDER, Numeric>;
+
+static float relative(float value, float reference) {
+  return fabsf(value - reference) / fmaxf(fabsf(reference), 1e-3f);
+}
+
+static void engines() {
+  static TestEngine<MEM_Float> single;
+  static TestEngine<MEM_Double> wide;
+  static TestEngine<MEM_Q31> fixed;
+
+  for (uint8_t method : { MEM_AR_SLIDING, MEM_AR_BURG }) {
+    const char* name = method == MEM_AR_BURG ? "burg" : "sliding";
+    single.reset();
+    wide.reset();
+    fixed.reset();
+    single.setARMethod(method);
+    wide.setARMethod(method);
+    fixed.setARMethod(method);
+
+    Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 11);
+    float worstWide = 0.0f, worstFixed = 0.0f;
+    for (int beat = 0; beat < 900; beat++) {
+      uint16_t ppi = series.next();
+      single.push(ppi);
+      wide.push(ppi);
+      fixed.push(ppi);
+      if (!single.allWindowsFull()) {
+        continue;
+      }
+      for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+        const HRV_Metrics& s = single.snapshot().window[i];
+        const HRV_Metrics& w = wide.snapshot().window[i];
+        const HRV_Metrics& q = fixed.snapshot().window[i];
+        worstWide = fmaxf(worstWide, fmaxf(relative(w.lf, s.lf), relative(w.hf, s.hf)));
+        worstWide = fmaxf(worstWide, fmaxf(relative(w.total_power, s.total_power), relative(w.lf_hf_ratio, s.lf_hf_ratio)));
+        worstFixed = fmaxf(worstFixed, fmaxf(relative(q.lf, s.lf), relative(q.hf, s.hf)));
+        worstFixed = fmaxf(worstFixed, fmaxf(relative(q.total_power, s.total_power), relative(q.lf_hf_ratio, s.lf_hf_ratio)));
+      }
+    }
+    const HRV_Metrics& q = fixed.snapshot().window[HRV_NUM_WINDOWS - 1];
+    printf("%s: largest deviation from float: double %.2e, q31 %.2e (5 min LF/HF %.3f vs %.3f)\n", name, worstWide,
+      worstFixed, q.lf_hf_ratio, single.snapshot().window[HRV_NUM_WINDOWS - 1].lf_hf_ratio);
+    EXPECT(worstWide < 5e-3, "%s: double deviates %.2e from float", name, worstWide);
+    EXPECT(worstFixed < 5e-3, "%s: q31 deviates %.2e from float", name, worstFixed);
+  }
+}
+
+int main() {
+  helpers();
+  schurAndLattice();
+  engines();
+
+  return testResult();
+}
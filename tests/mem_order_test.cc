@@ -0,0 +1,174 @@
+// AR model order selection test (MEM_OrderSelector in src/core/MEM.h).
+//
+// Checks that:
+//   - MEM_ORDER_FIXED always keeps the highest order, and the criteria stop at the last stage
+//     whose reflection coefficient pays for its penalty, MDL being stricter than AIC and FPE
+//   - no criterion selects fewer than MEM_ORDER_MIN coefficients
+//   - with every estimator and numeric policy, the selected model is the one a context of
+//     exactly that order estimates (same coefficients, prediction error and spectrum), with the
+//     coefficients above it zeroed
+//   - engines report the order behind each window, and a criterion changes the band powers by
+//     little on a series a lower order describes well
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+
+// Order selected from a sequence of reflection coefficients
+static uint16_t select(uint8_t rule, int n, const float* k, int count) {
+  MEM_OrderSelector selector(rule, n);
+  for (int m = 0; m < count; m++) {
+    selector.add(m, k[m]);
+  }
+  return selector.best;
+}
+
+static void criteria() {
+  // Strong poles up to order 10, a weak one at 12, noise above it. With N = 1000 the stage at 12
+  // lowers N·ln(E) by 6.4: more than the 4 AIC charges for orders 11 and 12, less than the 13.8
+  // of MDL (ln(N) per order).
+  const float k[16] = { 0.9f, -0.8f, 0.5f, 0.4f, -0.3f, 0.3f, 0.2f, -0.2f, 0.2f, 0.15f, 0.001f, 0.08f,
+                        0.001f, -0.002f, 0.001f, 0.001f };
+  EXPECT(select(MEM_ORDER_FIXED, 1000, k, 16) == 16, "fixed order %u", select(MEM_ORDER_FIXED, 1000, k, 16));
+  EXPECT(select(MEM_ORDER_AIC, 1000, k, 16) == 12, "AIC selected %u", select(MEM_ORDER_AIC, 1000, k, 16));
+  EXPECT(select(MEM_ORDER_FPE, 1000, k, 16) == 12, "FPE selected %u", select(MEM_ORDER_FPE, 1000, k, 16));
+  EXPECT(select(MEM_ORDER_MDL, 1000, k, 16) == 10, "MDL selected %u", select(MEM_ORDER_MDL, 1000, k, 16));
+
+  // White noise: nothing pays for itself, the floor holds
+  const float white[16] = { 0.001f, -0.002f, 0.001f, 0.0f, 0.002f, -0.001f, 0.0f, 0.001f,
+                            0.0f, 0.001f, 0.0f, -0.001f, 0.0f, 0.0f, 0.001f, 0.0f };
+  for (uint8_t rule : { MEM_ORDER_FPE, MEM_ORDER_AIC, MEM_ORDER_MDL }) {
+    EXPECT(select(rule, 1000, white, 16) == MEM_ORDER_MIN, "rule %u selected %u for white noise", rule,
+      select(rule, 1000, white, 16));
+  }
+}
+
+// AR(4) series around 850 ms: an LF pole pair at 0.1 Hz and an HF pair at 0.25 Hz (4 Hz sampling)
+static TachoWindow fill(TachoHistory& history, uint16_t count) {
+  const double lf = 2.0 * M_PI * 0.1 / TACHO_RATE_HZ, hf = 2.0 * M_PI * 0.25 / TACHO_RATE_HZ;
+  const double r1 = 0.97, r2 = 0.9;
+  // (1 - 2r₁cos·z⁻¹ + r₁²z⁻²)(1 - 2r₂cos·z⁻¹ + r₂²z⁻²)
+  const double p1[3] = { 1.0, -2.0 * r1 * cos(lf), r1 * r1 }, p2[3] = { 1.0, -2.0 * r2 * cos(hf), r2 * r2 };
+  double a[5] = { 0 };
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      a[i + j] += p1[i] * p2[j];
+    }
+  }
+
+  double x[5] = { 0 };
+  Lcg rng(5);
+  history.clear();
+  for (int t = 0; t < count + 200; t++) {
+    double next = (rng.uniform() - 0.5) * 20.0;
+    for (int i = 1; i <= 4; i++) {
+      next -= a[i] * x[i - 1];
+    }
+    memmove(x + 1, x, 3 * sizeof(double));
+    x[0] = next;
+    if (t >= 200) {
+      history.enqueue((uint16_t)lround(850.0 + next));
+    }
+  }
+  TachoWindow window = { &history, 0, count };
+  return window;
+}
+
+template <uint16_t Order, typename Numeric>
+static void estimate(MEM_ContextT<Order, FREQ_BINS, Numeric>* ctx, const TachoWindow& window, uint8_t method, uint8_t rule) {
+  static MEM_WorkspaceT<Numeric> work;
+  MEM_Init(ctx);
+  ctx->ar_method = method;
+  ctx->order_rule = rule;
+  for (uint16_t n = 1; n <= window.count; n++) {
+    MEM_AddNewest(ctx, TachoWindow{ window.history, window.first, n });
+  }
+  ProcessWindow(ctx, window, true, &work);
+}
+
+// Compare a selected model of order p with a fixed model of order P == p
+template <uint16_t P, typename Numeric>
+static void compareAt(const MEM_ContextT<MODEL_ORDER, FREQ_BINS, Numeric>& selected, const TachoWindow& window,
+                      uint8_t method, const char* name) {
+  if (selected.model_order != P) {
+    if constexpr (P < MODEL_ORDER) {
+      compareAt<P + 1, Numeric>(selected, window, method, name);
+    }
+    return;
+  }
+
+  static MEM_ContextT<P, FREQ_BINS, Numeric> fixed;
+  estimate(&fixed, window, method, MEM_ORDER_FIXED);
+  double worst = 0.0;
+  for (int i = 0; i < P; i++) {
+    worst = fmax(worst, fabs((double)selected.ar_coeff[i] - (double)fixed.ar_coeff[i]) / (fabs((double)fixed.ar_coeff[i]) + 1e-3));
+  }
+  bool zeroed = true;
+  for (int i = P; i < MODEL_ORDER; i++) {
+    zeroed &= selected.ar_coeff[i] == 0;
+  }
+  EXPECT(worst < 1e-4 && zeroed, "%s: order %u coefficients off by %.2e%s", name, P, worst, zeroed ? "" : ", not zeroed above");
+  EXPECT(fabsf(selected.noise_var / fixed.noise_var - 1.0f) < 1e-4f, "%s: prediction error %.4f vs %.4f", name,
+    selected.noise_var, fixed.noise_var);
+  EXPECT(fabsf(selected.total_power / fixed.total_power - 1.0f) < 1e-4f && fabsf(selected.LF_HF_Ratio / fixed.LF_HF_Ratio - 1.0f) < 1e-4f,
+    "%s: total %.1f vs %.1f ms², LF/HF %.4f vs %.4f", name, selected.total_power, fixed.total_power,
+    selected.LF_HF_Ratio, fixed.LF_HF_Ratio);
+}
+
+template <typename Numeric>
+static void selectedModels(const TachoWindow& window) {
+  static MEM_ContextT<MODEL_ORDER, FREQ_BINS, Numeric> ctx;
+  for (uint8_t method : { MEM_AR_SLIDING, MEM_AR_BURG }) {
+    for (uint8_t rule : { MEM_ORDER_FIXED, MEM_ORDER_FPE, MEM_ORDER_AIC, MEM_ORDER_MDL }) {
+      char name[48];
+      snprintf(name, sizeof(name), "%s %s rule %u", Numeric::name, method == MEM_AR_BURG ? "burg" : "sliding", rule);
+      estimate(&ctx, window, method, rule);
+      EXPECT(ctx.model_order >= (rule == MEM_ORDER_FIXED ? MODEL_ORDER : MEM_ORDER_MIN) && ctx.model_order <= MODEL_ORDER,
+        "%s: order %u", name, ctx.model_order);
+      compareAt<MEM_ORDER_MIN, Numeric>(ctx, window, method, name);
+    }
+  }
+}
+
+static void engines() {
+  static DefaultHRVEngine fixed, selected;
+  selected.setOrderRule(MEM_ORDER_MDL);
+
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 9);
+  uint32_t orders = 0, results = 0;
+  for (int beat = 0; beat < 900; beat++) {
+    uint16_t ppi = series.next();
+    fixed.push(ppi);
+    selected.push(ppi);
+    if (!fixed.allWindowsFull()) {
+      continue;
+    }
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      EXPECT(fixed.snapshot().window[i].model_order == MODEL_ORDER, "fixed engine window %d at order %u", i,
+        fixed.snapshot().window[i].model_order);
+      orders += selected.snapshot().window[i].model_order;
+      results++;
+    }
+  }
+
+  const HRV_Metrics& f = fixed.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& s = selected.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("MDL: mean order %.1f of %d, 5 min LF/HF %.3f vs %.3f at order %u\n", (float)orders / results, MODEL_ORDER,
+    s.lf_hf_ratio, f.lf_hf_ratio, s.model_order);
+  EXPECT(orders < results * MODEL_ORDER, "MDL never chose a lower order");
+  EXPECT(fabsf(s.lf_hf_ratio / f.lf_hf_ratio - 1.0f) < 0.1f, "5 min LF/HF %.3f with MDL, %.3f fixed", s.lf_hf_ratio, f.lf_hf_ratio);
+}
+
+int main() {
+  criteria();
+
+  static TachoHistory history;
+  TachoWindow window = fill(history, 1200);
+  selectedModels<MEM_Float>(window);
+  selectedModels<MEM_Double>(window);
+  selectedModels<MEM_Q31>(window);
+  engines();
+
+  return testResult();
+}
@@ -0,0 +1,374 @@
+// Round-trip and fuzz test for the PMD frame decoder (src/core/PMDDecoder.h).
+//
+// Checks that:
+//   - frames built by a reference encoder decode to the samples they were built from, for every
+//     delta size from 0 to 32 bits, 1 to 8 channels and 1 to 4 byte reference samples
+//   - a full MTU-sized PPG frame (more than 255 bits of deltas) decodes correctly
+//   - maxSamples truncates the output without writing past it
+//   - on random and mutated frames the decoder agrees with a bit-by-bit reference decoder and
+//     never writes past the output buffer (run under the sanitizers to also catch over-reads)
+//   - whole notifications are routed through PMD_FORMATS: raw and compressed PPG, ACC in every
+//     resolution, PPI beats, and unsupported or short frames rejected
+//   - control point responses, their status names and GET_SETTINGS parameters are parsed, and
+//     truncated settings are rejected
+
+#include "../src/core/PMDDecoder.h"
+#include "./test_util.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static XorShift32 rng(12345);
+
+static uint32_t randomBelow(uint32_t n) {
+  return rng.next() % n;
+}
+
+// Random signed value that fits in bits bits
+static int32_t randomSigned(uint8_t bits) {
+  if (bits == 0) {
+    return 0;
+  }
+  uint32_t raw = bits == 32 ? rng.next() : rng.next() & ((1u << bits) - 1);
+  return (int32_t)(raw << (32 - bits)) >> (32 - bits);
+}
+
+// Builds delta-compressed payloads bit by bit and records the samples they encode
+struct Encoder {
+  uint8_t channels;
+  std::vector<uint8_t> data;
+  std::vector<int32_t> samples;
+  uint32_t bitPos;
+
+  Encoder(uint8_t channels, uint8_t refBytes) : channels(channels), bitPos(0) {
+    for (uint8_t c = 0; c < channels; c++) {
+      int32_t value = randomSigned(8 * refBytes);
+      for (uint8_t b = 0; b < refBytes; b++) {
+        data.push_back((uint8_t)(value >> (8 * b)));
+      }
+      samples.push_back(value);
+    }
+  }
+
+  void block(uint8_t deltaBits, uint8_t count) {
+    data.push_back(deltaBits);
+    data.push_back(count);
+    bitPos = 0;
+    size_t start = data.size();
+    for (uint16_t s = 0; s < count; s++) {
+      for (uint8_t c = 0; c < channels; c++) {
+        int32_t delta = randomSigned(deltaBits);
+        for (uint8_t bit = 0; bit < deltaBits; bit++) {
+          if (bitPos % 8 == 0) {
+            data.push_back(0);
+          }
+          data[start + bitPos / 8] |= ((delta >> bit) & 1) << (bitPos % 8);
+          bitPos++;
+        }
+        int32_t previous = samples[samples.size() - channels];
+        samples.push_back((int32_t)((uint32_t)previous + (uint32_t)delta));
+      }
+    }
+  }
+};
+
+// Straightforward decoder: same format and stopping rules, one bit at a time
+static uint16_t referenceDecode(const uint8_t* data, uint16_t length, uint8_t channels, uint8_t refBytes,
+                                int32_t* out, uint16_t maxSamples) {
+  if (channels == 0 || refBytes == 0 || refBytes > 4 || maxSamples == 0 || length < channels * refBytes) {
+    return 0;
+  }
+  for (uint8_t c = 0; c < channels; c++) {
+    int64_t value = 0;
+    for (uint8_t b = 0; b < refBytes; b++) {
+      value |= (int64_t)data[c * refBytes + b] << (8 * b);
+    }
+    if (value & (1ll << (8 * refBytes - 1))) {
+      value -= 1ll << (8 * refBytes);
+    }
+    out[c] = (int32_t)value;
+  }
+  uint16_t samples = 1;
+  size_t pos = channels * refBytes;
+  while (pos + 2 <= length && samples < maxSamples) {
+    uint8_t deltaBits = data[pos];
+    uint16_t count = data[pos + 1];
+    pos += 2;
+    size_t bytes = ((size_t)count * channels * deltaBits + 7) / 8;
+    if (deltaBits > 32 || bytes > length - pos) {
+      break;
+    }
+    size_t bit = 0;
+    for (uint16_t s = 0; s < count && samples < maxSamples; s++, samples++) {
+      for (uint8_t c = 0; c < channels; c++) {
+        int64_t delta = 0;
+        for (uint8_t b = 0; b < deltaBits; b++, bit++) {
+          delta |= (int64_t)((data[pos + bit / 8] >> (bit % 8)) & 1) << b;
+        }
+        if (deltaBits > 0 && (delta & (1ll << (deltaBits - 1)))) {
+          delta -= 1ll << deltaBits;
+        }
+        int32_t previous = out[(samples - 1) * channels + c];
+        out[samples * channels + c] = (int32_t)((uint32_t)previous + (uint32_t)delta);
+      }
+    }
+    pos += bytes;
+  }
+  return samples;
+}
+
+static const int32_t GUARD = 0x5A5A5A5A;
+
+// Decode into a buffer with guard values after maxSamples samples
+static std::vector<int32_t> decode(const std::vector<uint8_t>& data, uint8_t channels, uint8_t refBytes,
+                                   uint16_t maxSamples, uint16_t* count) {
+  std::vector<int32_t> out((size_t)maxSamples * channels + 16, GUARD);
+  // Exact-size copy so the sanitizers see any read past the frame
+  std::vector<uint8_t> frame(data);
+  *count = PMD_DecodeDeltaFrames(frame.data(), (uint16_t)frame.size(), channels, refBytes, out.data(), maxSamples);
+  for (size_t i = (size_t)maxSamples * channels; i < out.size(); i++) {
+    EXPECT(out[i] == GUARD, "wrote past maxSamples (%u channels, %u samples)", channels, maxSamples);
+  }
+  out.resize((size_t)*count * channels);
+  return out;
+}
+
+static void roundTrip() {
+  for (int iteration = 0; iteration < 4000; iteration++) {
+    uint8_t channels = 1 + randomBelow(8);
+    uint8_t refBytes = 1 + randomBelow(4);
+    Encoder encoder(channels, refBytes);
+    int blocks = randomBelow(4);
+    for (int b = 0; b < blocks; b++) {
+      encoder.block(randomBelow(PMD_MAX_DELTA_BITS + 1), randomBelow(40));
+    }
+
+    uint16_t expected = encoder.samples.size() / channels;
+    uint16_t count;
+    std::vector<int32_t> out = decode(encoder.data, channels, refBytes, 2048, &count);
+    EXPECT(count == expected && out == encoder.samples,
+      "round trip failed: %u channels, %u byte reference, %d blocks (%u of %u samples)", channels, refBytes, blocks, count, expected);
+
+    // Truncated output is a prefix of the full one
+    uint16_t limit = 1 + randomBelow(expected);
+    std::vector<int32_t> prefix = decode(encoder.data, channels, refBytes, limit, &count);
+    EXPECT(count == limit && std::equal(prefix.begin(), prefix.end(), encoder.samples.begin()),
+      "truncation to %u of %u samples failed", limit, expected);
+  }
+
+  // Every delta size on its own, with blocks that do and do not end on a byte boundary
+  for (uint8_t bits = 0; bits <= PMD_MAX_DELTA_BITS; bits++) {
+    for (uint8_t count : { 1, 7, 64, 255 }) {
+      Encoder encoder(3, 3);
+      encoder.block(bits, count);
+      uint16_t n;
+      std::vector<int32_t> out = decode(encoder.data, 3, 3, 2048, &n);
+      EXPECT(n == count + 1 && out == encoder.samples, "%u bit deltas, %u samples", bits, count);
+    }
+  }
+}
+
+static void fullPpgFrame() {
+  // Four 22 bit channels filling an MTU of 232 bytes: 26 samples of 16 bit deltas span 1664 bits
+  Encoder encoder(4, 3);
+  encoder.block(16, 26);
+  std::vector<uint8_t> frame(PMD_HEADER_SIZE, 0);
+  frame[0] = 0x01;
+  frame[9] = PMD_COMPRESSED;
+  frame.insert(frame.end(), encoder.data.begin(), encoder.data.end());
+  EXPECT(frame.size() == 232, "frame is %zu bytes", frame.size());
+
+  std::vector<int32_t> out(27 * 4);
+  uint16_t count = PMD_DecodeDeltaFrames(frame.data() + PMD_HEADER_SIZE, frame.size() - PMD_HEADER_SIZE, 4, 3, out.data(), 27);
+  EXPECT(count == 27 && out == encoder.samples, "full frame decoded %u samples", count);
+}
+
+static void fuzz() {
+  for (int iteration = 0; iteration < 20000; iteration++) {
+    uint8_t channels = randomBelow(9);
+    uint8_t refBytes = randomBelow(6);
+    std::vector<uint8_t> data;
+
+    if (iteration % 2 == 0) {
+      // Random bytes, with small delta sizes made likely
+      data.resize(randomBelow(300));
+      for (uint8_t& byte : data) {
+        byte = rng.next();
+      }
+      for (size_t i = 0; i < data.size(); i += 1 + randomBelow(16)) {
+        data[i] = randomBelow(40);
+      }
+    } else {
+      // Valid frame with a few corrupted, dropped or appended bytes
+      uint8_t c = 1 + randomBelow(8);
+      Encoder encoder(c, 1 + randomBelow(4));
+      for (int b = randomBelow(4); b > 0; b--) {
+        encoder.block(randomBelow(PMD_MAX_DELTA_BITS + 1), randomBelow(40));
+      }
+      data = encoder.data;
+      for (int m = randomBelow(4); m > 0 && !data.empty(); m--) {
+        switch (randomBelow(3)) {
+        case 0: data[randomBelow(data.size())] = rng.next(); break;
+        case 1: data.resize(randomBelow(data.size())); break;
+        default: data.push_back(rng.next()); break;
+        }
+      }
+    }
+
+    uint16_t maxSamples = randomBelow(600);
+    std::vector<int32_t> expected((size_t)maxSamples * (channels ? channels : 1));
+    uint16_t expectedCount = referenceDecode(data.data(), data.size(), channels, refBytes, expected.data(), maxSamples);
+    expected.resize((size_t)expectedCount * channels);
+
+    uint16_t count;
+    std::vector<int32_t> out = decode(data, channels, refBytes, maxSamples, &count);
+    EXPECT(count == expectedCount && out == expected,
+      "differs from the reference decoder: %zu bytes, %u channels, %u byte reference (%u vs %u samples)",
+      data.size(), channels, refBytes, count, expectedCount);
+    if (failures > 10) {
+      return;
+    }
+  }
+}
+
+// PMD notification of a measurement and frame type with the given payload
+static std::vector<uint8_t> notification(uint8_t measurement, uint8_t frameType, const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> frame = { measurement, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, frameType };
+  frame.insert(frame.end(), payload.begin(), payload.end());
+  return frame;
+}
+
+// Little-endian bytes of the low width bytes of value
+static void put(std::vector<uint8_t>& data, int32_t value, uint8_t width) {
+  for (uint8_t b = 0; b < width; b++) {
+    data.push_back((uint8_t)(value >> (8 * b)));
+  }
+}
+
+static void frames() {
+  int32_t values[PMD_MAX_CHANNELS * 600];
+  PMD_Frame frame;
+
+  // Raw PPG: four signed 3 byte channels per sample
+  std::vector<uint8_t> payload;
+  const int32_t ppg[] = { 1000000, -5, 8388607, -8388608, 42, 0, -1, 123456 };
+  for (int32_t value : ppg) {
+    put(payload, value, 3);
+  }
+  payload.push_back(0xAB);  // Partial sample
+  std::vector<uint8_t> data = notification(PMD_TYPE_PPG, 0x00, payload);
+  uint16_t count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, sizeof(values) / sizeof(values[0]));
+  EXPECT(frame.format != nullptr && frame.format->stream == PMD_STREAM_PPG, "raw PPG not recognized");
+  EXPECT(frame.timestamp == 0x1122334455667788ull, "timestamp 0x%llx", (unsigned long long)frame.timestamp);
+  EXPECT(count == 2 && std::equal(ppg, ppg + 8, values), "raw PPG decoded %u samples", count);
+
+  // Compressed PPG goes through the delta decoder
+  Encoder encoder(4, 3);
+  encoder.block(9, 20);
+  data = notification(PMD_TYPE_PPG, PMD_COMPRESSED, encoder.data);
+  count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, sizeof(values) / sizeof(values[0]));
+  EXPECT(count == 21 && std::equal(encoder.samples.begin(), encoder.samples.end(), values), "compressed PPG decoded %u samples", count);
+
+  // ACC in 8, 16 and 24 bit resolution, and compressed with 16 bit reference values
+  for (uint8_t type = 0; type < 3; type++) {
+    uint8_t width = type + 1;
+    std::vector<int32_t> expected;
+    payload.clear();
+    for (int i = 0; i < 30; i++) {
+      int32_t value = randomSigned(8 * width);
+      expected.push_back(value);
+      put(payload, value, width);
+    }
+    data = notification(PMD_TYPE_ACC, type, payload);
+    count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, sizeof(values) / sizeof(values[0]));
+    EXPECT(frame.format != nullptr && frame.format->stream == PMD_STREAM_ACC && frame.format->channels == 3,
+      "ACC frame type %u not recognized", type);
+    EXPECT(count == 10 && std::equal(expected.begin(), expected.end(), values), "ACC frame type %u decoded %u samples", type, count);
+  }
+  Encoder acc(3, 2);
+  acc.block(6, 40);
+  acc.block(11, 3);
+  data = notification(PMD_TYPE_ACC, PMD_COMPRESSED, acc.data);
+  count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, sizeof(values) / sizeof(values[0]));
+  EXPECT(count == 44 && std::equal(acc.samples.begin(), acc.samples.end(), values), "compressed ACC decoded %u samples", count);
+
+  // maxValues counts values, not samples
+  count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, 10);
+  EXPECT(count == 3, "10 values held %u ACC samples", count);
+
+  // PPI: unsigned heart rate, PPI, error estimate and flags
+  payload = { 75, 0x20, 0x03, 10, 0, 0x06, 200, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  data = notification(PMD_TYPE_PPI, 0x00, payload);
+  count = PMD_DecodeFrame(data.data(), data.size(), &frame, values, sizeof(values) / sizeof(values[0]));
+  const int32_t beats[] = { 75, 800, 10, 6, 200, 65535, 65535, 255 };
+  EXPECT(frame.format != nullptr && frame.format->stream == PMD_STREAM_PPI, "PPI not recognized");
+  EXPECT(count == 2 && std::equal(beats, beats + 8, values), "PPI decoded %u beats", count);
+
+  // Unsupported and short frames
+  data = notification(PMD_TYPE_ECG, 0x00, payload);
+  EXPECT(PMD_DecodeFrame(data.data(), data.size(), &frame, values, 64) == 0 && frame.format == nullptr, "ECG frame accepted");
+  data = notification(PMD_TYPE_PPG, 0x07, payload);
+  EXPECT(PMD_DecodeFrame(data.data(), data.size(), &frame, values, 64) == 0 && frame.format == nullptr, "PPG frame type 7 accepted");
+  EXPECT(PMD_DecodeFrame(data.data(), PMD_HEADER_SIZE - 1, &frame, values, 64) == 0 && frame.format == nullptr, "short frame accepted");
+  EXPECT(PMD_FindFormat(PMD_TYPE_PPI, PMD_COMPRESSED) == nullptr, "compressed PPI has a format");
+
+  // Every raw format's stride matches its widths
+  for (uint8_t i = 0; i < PMD_NUM_FORMATS; i++) {
+    const PMD_FrameFormat& format = PMD_FORMATS[i];
+    uint8_t stride = 0;
+    for (uint8_t c = 0; c < format.channels; c++) {
+      stride += format.width[c];
+    }
+    EXPECT(format.layout == PMD_LAYOUT_DELTA || format.stride == stride, "format %u has stride %u for %u bytes", i, format.stride, stride);
+  }
+}
+
+static void controlResponses() {
+  // GET_SETTINGS of PPG in SDK mode, as a Verity Sense answers it
+  const uint8_t settings[] = { 0xF0, 0x01, 0x01, 0x00, 0x00,
+    0x00, 0x05, 0x1C, 0x00, 0x2C, 0x00, 0x37, 0x00, 0x87, 0x00, 0xB0, 0x00,
+    0x01, 0x01, 0x16, 0x00,
+    0x04, 0x01, 0x04 };
+  PMD_ControlResponse response;
+  EXPECT(PMD_ParseControlResponse(settings, sizeof(settings), &response), "settings response rejected");
+  EXPECT(response.opCode == PMD_OP_GET_SETTINGS && response.measurement == PMD_TYPE_PPG && response.status == 0 && !response.more,
+    "response header misread");
+  EXPECT(response.paramLength == sizeof(settings) - 5, "%u parameter bytes", response.paramLength);
+
+  PMD_Settings parsed;
+  EXPECT(PMD_ParseSettings(response.params, response.paramLength, &parsed), "settings rejected");
+  const uint16_t rates[] = { 28, 44, 55, 135, 176 };
+  EXPECT(parsed.numSampleRates == 5 && std::equal(rates, rates + 5, parsed.sampleRates), "%u sample rates", parsed.numSampleRates);
+  EXPECT(parsed.resolution == 22 && parsed.channels == 4 && parsed.range == 0, "resolution %u, %u channels", parsed.resolution, parsed.channels);
+
+  // Every truncation of the parameters that splits a setting is rejected
+  for (uint16_t length = 0; length < response.paramLength; length++) {
+    bool whole = length == 0 || length == 12 || length == 16;
+    EXPECT(PMD_ParseSettings(response.params, length, &parsed) == whole, "%u parameter bytes %s", length, whole ? "rejected" : "accepted");
+  }
+  const uint8_t unknown[] = { 0x09, 0x01, 0x00 };
+  EXPECT(!PMD_ParseSettings(unknown, sizeof(unknown), &parsed), "unknown setting type accepted");
+
+  // Failed START of ACC, which ends after the status
+  const uint8_t failed[] = { 0xF0, 0x02, 0x02, 0x06 };
+  EXPECT(PMD_ParseControlResponse(failed, sizeof(failed), &response), "short response rejected");
+  EXPECT(response.opCode == PMD_OP_START && response.status == 6 && response.paramLength == 0, "failed response misread");
+  EXPECT(!strcmp(PMD_StatusName(response.status), "ALREADY_IN_STATE"), "status 6 is %s", PMD_StatusName(response.status));
+  EXPECT(!strcmp(PMD_StatusName(13), "DEVICE_IN_CHARGER") && !strcmp(PMD_StatusName(200), "UNKNOWN"), "status names");
+
+  const uint8_t data[] = { 0x01, 0x02, 0x03, 0x04 };
+  EXPECT(!PMD_ParseControlResponse(data, sizeof(data), &response), "data frame taken for a response");
+  EXPECT(!PMD_ParseControlResponse(failed, 3, &response), "3 byte response accepted");
+}
+
+int main() {
+  roundTrip();
+  fullPpgFrame();
+  fuzz();
+  frames();
+  controlResponses();
+
+  return testResult();
+}
@@ -0,0 +1,231 @@
+// Fuzz target for the BLE receive path: PolarBLEConnection::NotifyCallback, the PMD decoder,
+// the receive rings and SensorSession::drain() down to the HRV engine.
+//
+// An input is a sequence of notifications, each a length byte followed by that many bytes (the
+// last one gets whatever is left). Each notification is copied to a buffer of exactly its size,
+// handed to session 0's callback, and the session is drained, so a frame that makes the decoder
+// read past its end or hand out values the analysis cannot take is caught by the sanitizers.
+//
+// With -DHRV_FUZZ=ON (clang) this is a libFuzzer target. Without it, main() below drives the same
+// entry point under the address and undefined behaviour sanitizers, as the ctest does:
+//    pmd_notify_fuzz [--iterations N]          random mutations of valid PPI, PPG and ACC frames
+//    pmd_notify_fuzz input ...                 replay inputs, or PMD captures (PMDCapture.h)
+//    pmd_notify_fuzz --corpus dir [capture ...] write seeds for libFuzzer: the generated frames
+//                                               and the notifications of the captures
+
+#include "../src/core/SensorSession.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  static bool ready = false;
+  if (!ready) {
+    Serial.muted = true;
+    hostSkipDelay = true;
+    Sessions_Init();
+    resetHRVParameters();
+    ready = true;
+  }
+  SensorSession& session = sensorSessions[0];
+
+  size_t pos = 0;
+  while (pos < size) {
+    size_t length = MIN((size_t)data[pos], size - pos - 1);
+    std::vector<uint8_t> notification(data + pos + 1, data + pos + 1 + length);
+    pos += 1 + length;
+    session.connection.NotifyCallback(nullptr, notification.data(), notification.size(), true);
+    session.drain(UINT16_MAX);
+  }
+  return 0;
+}
+
+#ifndef HRV_LIBFUZZER
+
+static XorShift32 rng(1);
+
+// Valid notification of a random supported format
+static std::vector<uint8_t> validFrame() {
+  std::vector<uint8_t> frame(PMD_HEADER_SIZE, 0);
+  uint32_t kind = rng.next() % 4;
+  switch (kind) {
+  case 0: {  // PPI, heart rate | PPI | error | flags per beat
+    frame[0] = PMD_TYPE_PPI;
+    for (uint32_t i = 0, beats = 1 + rng.next() % 8; i < beats; i++) {
+      uint16_t ppi = 600 + rng.next() % 600;
+      uint8_t beat[PPI_FRAME_SIZE] = { (uint8_t)(60000 / ppi), (uint8_t)ppi, (uint8_t)(ppi >> 8), 10, 0, 0 };
+      frame.insert(frame.end(), beat, beat + PPI_FRAME_SIZE);
+    }
+    break;
+  }
+  case 1:  // Delta-compressed PPG, four 3 byte references and a block of 6 bit deltas
+  case 2: {  // Delta-compressed ACC, three 2 byte references and a block of 4 bit deltas
+    bool ppg = kind == 1;
+    uint8_t channels = ppg ? PPG_CHANNELS : 3, refBytes = ppg ? PPG_REF_BYTES : 2, bits = ppg ? 6 : 4;
+    frame[0] = ppg ? PMD_TYPE_PPG : PMD_TYPE_ACC;
+    frame[9] = PMD_COMPRESSED;
+    for (int i = 0; i < channels * refBytes; i++) {
+      frame.push_back(rng.next());
+    }
+    uint8_t count = 1 + rng.next() % 20;
+    frame.push_back(bits);
+    frame.push_back(count);
+    for (int i = 0; i < (count * channels * bits + 7) / 8; i++) {
+      frame.push_back(rng.next());
+    }
+    break;
+  }
+  default:  // Raw 2 byte ACC
+    frame[0] = PMD_TYPE_ACC;
+    frame[9] = 0x01;
+    for (uint32_t i = 0, bytes = 6 * (1 + rng.next() % 10); i < bytes; i++) {
+      frame.push_back(rng.next());
+    }
+    break;
+  }
+  return frame;
+}
+
+// Flip, overwrite, drop or append a few bytes
+static void mutate(std::vector<uint8_t>& frame) {
+  for (uint32_t i = 0, edits = rng.next() % 4; i < edits && !frame.empty(); i++) {
+    size_t at = rng.next() % frame.size();
+    switch (rng.next() % 4) {
+    case 0: frame[at] ^= 1 << (rng.next() % 8); break;
+    case 1: frame[at] = rng.next(); break;
+    case 2: frame.resize(at); break;
+    default: frame.push_back(rng.next()); break;
+    }
+  }
+}
+
+// Fuzz input of a series of notifications
+static std::vector<uint8_t> encode(const std::vector<std::vector<uint8_t>>& notifications) {
+  std::vector<uint8_t> input;
+  for (const std::vector<uint8_t>& n : notifications) {
+    size_t length = MIN(n.size(), (size_t)UINT8_MAX);
+    input.push_back(length);
+    input.insert(input.end(), n.begin(), n.begin() + length);
+  }
+  return input;
+}
+
+static bool readFile(const char* path, std::string& content) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    content.append(buffer, n);
+  }
+  fclose(file);
+  return true;
+}
+
+// Notifications of a PMD capture, or none if the content is not one
+static std::vector<std::vector<uint8_t>> captureNotifications(const std::string& content) {
+  std::vector<std::vector<uint8_t>> notifications;
+  static PMD_CaptureRecord record;
+  size_t start = 0;
+  while (start < content.size()) {
+    size_t end = content.find('\n', start);
+    end = end == std::string::npos ? content.size() : end;
+    if (PMD_ParseCapture(content.substr(start, end - start).c_str(), &record)) {
+      notifications.push_back(std::vector<uint8_t>(record.data, record.data + record.length));
+    }
+    start = end + 1;
+  }
+  return notifications;
+}
+
+static bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Could not write %s\n", path.c_str());
+    return false;
+  }
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  int iterations = 3000;
+  const char* corpus = nullptr;
+  std::vector<const char*> inputs;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+      corpus = argv[++i];
+    } else if (argv[i][0] != '-') {
+      inputs.push_back(argv[i]);
+    } else {
+      fprintf(stderr, "Usage: %s [--iterations N] [--corpus dir] [input ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (corpus != nullptr) {
+    int written = 0;
+    for (int i = 0; i < 64; i++) {
+      written += writeFile(std::string(corpus) + "/seed-" + std::to_string(i), encode({ validFrame() }));
+    }
+    for (const char* path : inputs) {
+      std::string content;
+      if (!readFile(path, content)) {
+        return 1;
+      }
+      for (const std::vector<uint8_t>& n : captureNotifications(content)) {
+        written += writeFile(std::string(corpus) + "/capture-" + std::to_string(written), encode({ n }));
+      }
+    }
+    printf("%d seeds written to %s\n", written, corpus);
+    return 0;
+  }
+
+  if (!inputs.empty()) {
+    for (const char* path : inputs) {
+      std::string content;
+      if (!readFile(path, content)) {
+        return 1;
+      }
+      std::vector<std::vector<uint8_t>> notifications = captureNotifications(content);
+      std::vector<uint8_t> input = notifications.empty() ? std::vector<uint8_t>(content.begin(), content.end())
+                                                         : encode(notifications);
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+      printf("%s: %zu bytes\n", path, input.size());
+    }
+    printf("OK\n");
+    return 0;
+  }
+
+  // Mutated frames, a few per input, plus raw noise now and then
+  for (int i = 0; i < iterations; i++) {
+    std::vector<std::vector<uint8_t>> notifications;
+    for (uint32_t n = 0, count = 1 + rng.next() % 4; n < count; n++) {
+      std::vector<uint8_t> frame = validFrame();
+      mutate(frame);
+      notifications.push_back(frame);
+    }
+    std::vector<uint8_t> input = encode(notifications);
+    if (i % 16 == 0) {
+      for (uint32_t b = 0, bytes = rng.next() % 64; b < bytes; b++) {
+        input.push_back(rng.next());
+      }
+    }
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  SensorSession& session = sensorSessions[0];
+  printf("%d inputs: %u packets decoded, %u beats, %u ACC samples\n", iterations, session.connection.getPackets(),
+    session.connection.getBeats(), session.getAccSamples());
+  printf("OK\n");
+  return 0;
+}
+
+#endif  // HRV_LIBFUZZER
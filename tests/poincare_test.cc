@@ -0,0 +1,126 @@
+// Poincaré plot descriptor test for the SD1/SD2 stage of HRVEngine.
+//
+// Checks that:
+//   - SD1, SD2, SD1/SD2 and the ellipse area of every window match a direct computation over the
+//     pairs of the window's beats, while the windows slide for thousands of beats
+//   - beats alternating around a level spread across the identity line (SD2 near 0) and a slow
+//     ramp along it (SD1 near 0), and a constant series has no spread at all
+//   - the short-term window is published through HRV_SD1, HRV_SD2, HRV_SD1_SD2 and HRV_PoincareArea
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static Lcg rng(31);
+
+// SD1 and SD2 as population SDs of the rotated pairs (xₖ, xₖ₊₁) of x[start, end)
+struct Reference {
+  double sd1 = 0.0, sd2 = 0.0;
+};
+
+static Reference direct(const std::vector<uint16_t>& x, uint32_t start, uint32_t end) {
+  Reference ref;
+  uint32_t pairs = end - start - 1;
+  if (end < start + 2) {
+    return ref;
+  }
+  double meanD = 0.0, meanS = 0.0;
+  for (uint32_t k = start; k + 1 < end; k++) {
+    meanD += (x[k + 1] - x[k]) / sqrt(2.0);
+    meanS += (x[k + 1] + x[k]) / sqrt(2.0);
+  }
+  meanD /= pairs;
+  meanS /= pairs;
+  for (uint32_t k = start; k + 1 < end; k++) {
+    double d = (x[k + 1] - x[k]) / sqrt(2.0) - meanD, s = (x[k + 1] + x[k]) / sqrt(2.0) - meanS;
+    ref.sd1 += d * d;
+    ref.sd2 += s * s;
+  }
+  ref.sd1 = sqrt(ref.sd1 / pairs);
+  ref.sd2 = sqrt(ref.sd2 / pairs);
+  return ref;
+}
+
+static void slidingWindows() {
+  static DefaultHRVEngine engine;
+  engine.setArtifactCorrection(false);
+  std::vector<uint16_t> beats;
+  double t = 0.0, worst = 0.0;
+  int checks = 0;
+
+  for (int n = 0; n < 3000; n++) {
+    // Breathing and a slow wander, with a stretch of exercise where the beats shorten and steady
+    double level = n > 1200 && n < 1800 ? 520.0 : 850.0 + 80.0 * sin(2.0 * M_PI * n / 700.0);
+    double ppi = level + 40.0 * sin(2.0 * M_PI * 0.25 * t) + (rng.uniform() - 0.5) * 30.0;
+    t += ppi / 1000.0;
+    beats.push_back((uint16_t)ppi);
+    engine.push(beats.back());
+    if (n % 23 != 0) {
+      continue;
+    }
+
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      const HRV_Metrics& m = engine.snapshot().window[i];
+      Reference ref = direct(beats, beats.size() - m.ppi_count, beats.size());
+      double error = fmax(fabs(m.sd1 - ref.sd1), fabs(m.sd2 - ref.sd2));
+      worst = fmax(worst, error);
+      checks++;
+      if (ref.sd2 > 0) {
+        EXPECT(fabs(m.sd1_sd2 - ref.sd1 / ref.sd2) < 1e-3, "window %d at %d: SD1/SD2 %.4f vs %.4f", i, n, m.sd1_sd2,
+          ref.sd1 / ref.sd2);
+      }
+      EXPECT(fabs(m.poincare_area - M_PI * ref.sd1 * ref.sd2) < 1e-3 * M_PI * ref.sd1 * ref.sd2 + 1.0,
+        "window %d at %d: area %.1f vs %.1f", i, n, m.poincare_area, M_PI * ref.sd1 * ref.sd2);
+    }
+  }
+  const HRV_Metrics& l = engine.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("%d checks: SD1 and SD2 within %.1e ms of the direct computation (SD1 %.1f, SD2 %.1f over %u beats)\n",
+    checks, worst, l.sd1, l.sd2, l.ppi_count);
+  EXPECT(worst < 1e-3, "SD1/SD2 off by %.3f ms", worst);
+}
+
+static const HRV_Metrics& runSeries(uint16_t (*beat)(int)) {
+  static DefaultHRVEngine engine;
+  engine.reset();
+  engine.setArtifactCorrection(false);
+  for (int n = 0; n < 400; n++) {
+    engine.push(beat(n));
+  }
+  return engine.snapshot().window[0];
+}
+
+static uint16_t alternating(int n) { return n % 2 ? 900 : 800; }
+static uint16_t ramp(int n) { return 700 + n / 2; }
+static uint16_t constant(int) { return 850; }
+
+static void knownShapes() {
+  const HRV_Metrics& a = runSeries(alternating);
+  EXPECT(fabsf(a.sd1 - 100.0f / sqrtf(2.0f)) < 0.1f && a.sd2 < 0.5f, "alternating: SD1 %.3f, SD2 %.3f", a.sd1,
+    a.sd2);
+  const HRV_Metrics& r = runSeries(ramp);
+  EXPECT(r.sd1 < 0.5f && r.sd2 > 5.0f && r.sd1_sd2 < 0.1f, "ramp: SD1 %.3f, SD2 %.3f", r.sd1, r.sd2);
+  const HRV_Metrics& c = runSeries(constant);
+  EXPECT(c.sd1 == 0.0f && c.sd2 == 0.0f && c.sd1_sd2 == 0.0f && c.poincare_area == 0.0f,
+    "constant: SD1 %.3f, SD2 %.3f", c.sd1, c.sd2);
+}
+
+static void published() {
+  resetHRVParameters();
+  for (int n = 0; n < 200; n++) {
+    updateHRVParameters((uint16_t)(850 + 50 * sin(n * 0.7) + (rng.uniform() - 0.5) * 20));
+  }
+  const HRV_Metrics& m = hrvEngine.snapshot().window[0];
+  EXPECT(HRV_SD1 == m.sd1 && HRV_SD2 == m.sd2 && HRV_SD1_SD2 == m.sd1_sd2 && HRV_PoincareArea == m.poincare_area &&
+           HRV_SD1 > 0.0f,
+    "Poincaré descriptors not published: SD1 %.2f, SD2 %.2f", HRV_SD1, HRV_SD2);
+}
+
+int main() {
+  slidingWindows();
+  knownShapes();
+  published();
+
+  return testResult();
+}
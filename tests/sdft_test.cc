@@ -0,0 +1,201 @@
+// Sliding DFT test for SlidingDFT (src/utils/SlidingDFT.hpp) and the SPECTRUM_SDFT path of
+// HRVEngine.
+//
+// Checks that:
+//   - the bins of windows sliding over a series, of exactly the DFT length and a few samples more
+//     or less, match a Hann-windowed DFT of the mean-removed window evaluated directly in double,
+//     and a window rebuilt from its samples has exactly the same bins as the one that slid there
+//   - a sinusoid of amplitude A puts A²/2 into the band of its frequency, on a bin or between two
+//   - engines switched to the sliding DFT mid-stream agree with engines that ran it from the start,
+//     and the DFT finds the band powers of a trace with known LF and HF like MEM does
+//   - DFT windows that are not full report no power (total, LF, HF and LF/HF all 0)
+//   - a strong very low frequency component stays out of the total power, which covers LF and HF
+//     as it does with MEM and stays below MEM's
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static Lcg rng(43);
+
+typedef SlidingDFT<64> DFT;
+
+// Power of bin m of x[first, end) through the Hann taper 0.5 - 0.5·cos(2π(n - first)/N)
+static double direct(const std::vector<uint16_t>& x, size_t first, size_t end, int length, int m) {
+  double mean = 0.0, u = 0.0, re = 0.0, im = 0.0;
+  for (size_t k = first; k < end; k++) {
+    mean += x[k];
+  }
+  mean /= end - first;
+  for (size_t k = first; k < end; k++) {
+    double w = 0.5 - 0.5 * cos(2.0 * M_PI * (k - first) / length);
+    re += w * (x[k] - mean) * cos(2.0 * M_PI * m * (k - first) / length);
+    im -= w * (x[k] - mean) * sin(2.0 * M_PI * m * (k - first) / length);
+    u += w * w;
+  }
+  return 2.0 * (re * re + im * im) / (u * length);
+}
+
+static void slidingWindows() {
+  static DFT dft, rebuilt;
+  const int LENGTH = 200;
+  std::vector<uint16_t> x;
+  size_t first = 0;
+  double worst = 0.0;
+  dft.clear(LENGTH, 40);
+
+  for (uint32_t t = 0; t < 6000; t++) {
+    x.push_back((uint16_t)(850.0 + 60.0 * sin(2.0 * M_PI * 0.021 * t) + 30.0 * sin(2.0 * M_PI * 0.07 * t) +
+                           (rng.uniform() - 0.5) * 80.0));
+    dft.add(t, x.back());
+
+    // Exactly the DFT length, then a window that wanders a few samples around it
+    size_t length = t < 3000 ? LENGTH : LENGTH - 6 + (t / 7) % 13;
+    while (x.size() - first > length) {
+      dft.remove(first, x[first]);
+      first++;
+    }
+    if (t % 41 != 0 || x.size() - first < length) {
+      continue;
+    }
+
+    float power[40];
+    dft.compute(first, power);
+    double peak = 0.0;
+    for (int m = 1; m < 39; m++) {
+      peak = fmax(peak, direct(x, first, x.size(), LENGTH, m));
+    }
+    for (int m = 1; m < 39; m++) {
+      worst = fmax(worst, fabs(power[m] - direct(x, first, x.size(), LENGTH, m)) / peak);
+    }
+  }
+
+  rebuilt.clear(LENGTH, 40);
+  for (size_t k = first; k < x.size(); k++) {
+    rebuilt.add(k, x[k]);
+  }
+  float power[40], again[40];
+  dft.compute(first, power);
+  rebuilt.compute(first, again);
+  int differences = 0;
+  for (int m = 1; m < 39; m++) {
+    differences += power[m] != again[m];
+  }
+  printf("Sliding bins within %.1e of the peak of the direct DFT, %d bins differ after rebuilding\n", worst,
+    differences);
+  EXPECT(worst < 5e-3, "bins off by %.2e of their peak", worst);
+  EXPECT(differences == 0, "%d bins differ from a window rebuilt from its samples", differences);
+}
+
+// Band power of a sinusoid of amplitude 40 at cycles per sample, in a window of 240 samples
+static void sinusoid(double cycles) {
+  static DFT dft;
+  dft.clear(240, 64);
+  for (uint32_t t = 0; t < 240; t++) {
+    dft.add(t + 1000, (uint16_t)lround(850.0 + 40.0 * sin(2.0 * M_PI * cycles * t + 0.3)));
+  }
+  const SDFT_Band bands[2] = { { (float)cycles - 0.02f, (float)cycles + 0.02f }, { 0.0f, 0.5f } };
+  float power[2];
+  dft.bandPowers(1000, bands, 2, power);
+  printf("Sinusoid at %.4f cycles/sample: %.0f ms² in its band, %.0f in all (A²/2 = 800)\n", cycles, power[0],
+    power[1]);
+  EXPECT(fabsf(power[0] - 800.0f) < 25.0f && power[1] - power[0] < 10.0f, "%.4f cycles: %.0f ms² in its band of %.0f",
+    cycles, power[0], power[1]);
+}
+
+static void engines() {
+  static DefaultHRVEngine mem, dft, switched;
+  mem.setArtifactCorrection(false);
+  dft.setArtifactCorrection(false);
+  switched.setArtifactCorrection(false);
+  dft.setSpectrumMethod(SPECTRUM_SDFT);
+  EXPECT(dft.spectrumMethod() == SPECTRUM_SDFT, "spectrum method %u", dft.spectrumMethod());
+
+  int mismatches = 0, incomplete = 0;
+  double worstShort = 0.0;
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 49);
+  for (int n = 0; n < 2500; n++) {
+    uint16_t ppi = series.next();
+    mem.push(ppi);
+    dft.push(ppi);
+    switched.push(ppi);
+    if (n == 700) {
+      switched.setSpectrumMethod(SPECTRUM_SDFT);
+    }
+    for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+      const HRV_Metrics& w = dft.snapshot().window[i];
+      if (!dft.window(i).full && (w.total_power != 0.0f || w.lf != 0.0f || w.hf != 0.0f || w.lf_hf_ratio != 0.0f)) {
+        incomplete++;
+      }
+    }
+    if (n <= 700) {
+      continue;
+    }
+
+    // The time windows keep their DFT length; the short-term window's follows its sample count,
+    // which the switched engine may pick at a different beat
+    for (int i = 1; i < HRV_NUM_WINDOWS; i++) {
+      if (!sameSpectrum(switched.snapshot().window[i], dft.snapshot().window[i]) && mismatches++ == 0) {
+        fprintf(stderr, "window %d at beat %d: LF %.2f vs %.2f\n", i, n, switched.snapshot().window[i].lf,
+          dft.snapshot().window[i].lf);
+      }
+    }
+    const HRV_Metrics& a = switched.snapshot().window[0];
+    const HRV_Metrics& b = dft.snapshot().window[0];
+    worstShort = fmax(worstShort, fabs(a.total_power - b.total_power) / b.total_power);
+  }
+  EXPECT(mismatches == 0, "%d window spectra differ after switching the estimator", mismatches);
+  EXPECT(incomplete == 0, "%d incomplete window spectra report power", incomplete);
+  EXPECT(worstShort < 0.25, "short-term total power of the switched engine off by %.0f%%", 100.0 * worstShort);
+
+  // 40 ms at 0.1 Hz and 25 ms at 0.25 Hz: 800 and 312 ms² plus the noise in each band
+  const HRV_Metrics& m = mem.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& d = dft.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("Longest window: MEM LF %.0f, HF %.0f; sliding DFT LF %.0f, HF %.0f ms²\n", m.lf, m.hf, d.lf, d.hf);
+  EXPECT(d.lf > 700.0f && d.lf < 950.0f && d.hf > 280.0f && d.hf < 400.0f, "sliding DFT LF %.0f, HF %.0f", d.lf, d.hf);
+  EXPECT(d.model_order == 0, "sliding DFT window reports model order %u", d.model_order);
+  for (int i = 0; i < HRV_NUM_WINDOWS; i++) {
+    const HRV_Metrics& s = dft.snapshot().window[i];
+    EXPECT(s.lf > 0.0f && s.hf > 0.0f && s.total_power >= s.lf + s.hf - 1.0f, "window %d: LF %.0f, HF %.0f, total %.0f",
+      i, s.lf, s.hf, s.total_power);
+  }
+}
+
+// 60 ms at 0.02 Hz (1800 ms², below FREQ_LOW) on top of the LF and HF components. The total power
+// of either estimator is its LF plus HF; the broad MEM peak at 0.02 Hz leaks into its LF band, so
+// MEM's total is the larger one.
+static void veryLowFrequency() {
+  static DefaultHRVEngine mem, dft;
+  mem.setArtifactCorrection(false);
+  dft.setArtifactCorrection(false);
+  dft.setSpectrumMethod(SPECTRUM_SDFT);
+
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 53);
+  series.vlf = 60.0f;
+  for (int n = 0; n < 1500; n++) {
+    uint16_t ppi = series.next();
+    mem.push(ppi);
+    dft.push(ppi);
+  }
+  const HRV_Metrics& m = mem.snapshot().window[HRV_NUM_WINDOWS - 1];
+  const HRV_Metrics& d = dft.snapshot().window[HRV_NUM_WINDOWS - 1];
+  printf("Longest window with 1800 ms² at 0.02 Hz: MEM total %.0f, LF %.0f, HF %.0f; sliding DFT total %.0f, LF %.0f, "
+    "HF %.0f ms²\n", m.total_power, m.lf, m.hf, d.total_power, d.lf, d.hf);
+  EXPECT(fabsf(d.total_power - (d.lf + d.hf)) < 0.05f * d.total_power, "sliding DFT total power %.0f, LF + HF %.0f",
+    d.total_power, d.lf + d.hf);
+  EXPECT(fabsf(m.total_power - (m.lf + m.hf)) < 0.05f * m.total_power, "MEM total power %.0f, LF + HF %.0f",
+    m.total_power, m.lf + m.hf);
+  EXPECT(d.total_power <= m.total_power, "sliding DFT total power %.0f above MEM's %.0f", d.total_power, m.total_power);
+}
+
+int main() {
+  slidingWindows();
+  sinusoid(0.1);       // On bin 24 of 240
+  sinusoid(0.0625);    // Between bins 15 and 16
+  engines();
+  veryLowFrequency();
+
+  return testResult();
+}
@@ -0,0 +1,239 @@
+// Multi-sensor session test for SensorSession (src/core/SensorSession.h) over the mock BLE
+// transport in host/arduino/BLEDevice.h.
+//
+// Checks that:
+//   - the scan hands each matching sensor to its own session, ignores other devices and
+//     repeated advertisements, and stops once every session has a sensor
+//   - each session connects, subscribes and starts the PPI stream on its own sensor
+//   - beats from interleaved sensors reach only their own engine, and every session matches a
+//     standalone engine fed that sensor's beats alone
+//   - a burst that overflows one session's receive ring is counted against that session only
+//   - accelerometer frames reach only their own session's ACC ring, without disturbing its beats
+//   - a disconnect frees only the session that lost its sensor, and the scan refills it; a late
+//     disconnect event of the released sensor is ignored
+//   - the session restarts for the new sensor: beats the old one left in the ring are dropped,
+//     and the new subject's beats are validated and analyzed as if the session had just started
+
+#include "../src/core/SensorSession.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static const char* ADDRESSES[] = { "a0:9e:1a:00:00:01", "a0:9e:1a:00:00:02", "a0:9e:1a:00:00:03",
+                                   "a0:9e:1a:00:00:04", "a0:9e:1a:00:00:05" };
+static const int BEATS = 600;
+static const int PER_PACKET = 5;
+
+// Sessions the checks of a single session use, for any MAX_SENSORS of 2 or more
+static_assert(MAX_SENSORS >= 2, "The session test needs at least two sessions");
+static const int BURST_SESSION = 1;              // Overflows its ring
+static const int ACC_SESSION = MAX_SENSORS - 1;  // Receives accelerometer frames
+static const int LOST_SESSION = 0;               // Loses its sensor and gets a new one
+
+// Deterministic PPI series around a given mean, slow enough to pass the MAX_PPI_DIFF check
+static Modulated sensorSeries(uint32_t seed, float mean) {
+  return Modulated(mean, 30.0f, 20.0f, 20.0f, seed);
+}
+
+// PMD PPI notification carrying the given beats
+static std::vector<uint8_t> ppiPacket(const uint16_t* ppis, int count) {
+  std::vector<uint8_t> packet(PPI_HEADER_SIZE, 0);
+  packet[0] = 0x03;
+  for (int i = 0; i < count; i++) {
+    uint8_t frame[PPI_FRAME_SIZE] = { (uint8_t)(60000 / ppis[i]), (uint8_t)(ppis[i] & 0xFF), (uint8_t)(ppis[i] >> 8), 10, 0, 0 };
+    packet.insert(packet.end(), frame, frame + PPI_FRAME_SIZE);
+  }
+  return packet;
+}
+
+// Connect every session the scan assigned a sensor to, as BLEReceiveTask does
+static void connectAssigned() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    PolarBLEConnection* connection = sensorConnections[i];
+    if (connection->doConnect) {
+      EXPECT(connection->ConnectToServer(), "session %d failed to connect", i);
+      connection->doConnect = false;
+    }
+  }
+}
+
+static void scanAndConnect(PolarBLEConnection::MyAdvertisedDeviceCallbacks* callbacks) {
+  BLEDevice::getScan()->start(5, false);
+  MockBLE::advertise("Polar H10 12345678", "c0:ff:ee:00:00:01");
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    MockBLE::advertise("Polar Sense 0A1B2C3D", ADDRESSES[i]);
+    MockBLE::advertise("Polar Sense 0A1B2C3D", ADDRESSES[i]);  // Repeated advertisement
+  }
+  EXPECT(callbacks->freeConnections() == 0, "%u sessions without a sensor", callbacks->freeConnections());
+  EXPECT(!BLEDevice::getScan()->scanning, "scan still running with every session assigned");
+
+  connectAssigned();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    PolarBLEConnection* connection = sensorConnections[i];
+    EXPECT(connection->connected, "session %d not connected", i);
+    EXPECT(connection->myDevice != nullptr && connection->myDevice->getAddress().toString() == ADDRESSES[i],
+      "session %d got the wrong sensor", i);
+
+    BLERemoteCharacteristic* control = MockBLE::characteristic(ADDRESSES[i], CONTROL_CHAR_UUID);
+    bool started = false;
+    for (const std::vector<uint8_t>& command : control ? control->writes : std::vector<std::vector<uint8_t>>()) {
+      started |= command.size() == 2 && command[0] == 0x02 && command[1] == 0x03;
+    }
+    EXPECT(started, "session %d did not start the PPI stream", i);
+  }
+}
+
+static void interleavedStreams() {
+  static DefaultHRVEngine reference[MAX_SENSORS];
+  std::vector<Modulated> streams;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    streams.push_back(sensorSeries(17 + i, 700.0f + 100.0f * i));
+  }
+
+  // Sensors send in turn; ComputeTask wakes after every round
+  for (int b = 0; b < BEATS; b += PER_PACKET) {
+    for (int i = 0; i < MAX_SENSORS; i++) {
+      uint16_t ppis[PER_PACKET];
+      for (int k = 0; k < PER_PACKET; k++) {
+        ppis[k] = streams[i].next();
+        reference[i].push(ppis[k]);
+      }
+      std::vector<uint8_t> packet = ppiPacket(ppis, PER_PACKET);
+      EXPECT(MockBLE::notify(ADDRESSES[i], DATA_CHAR_UUID, packet.data(), packet.size()), "session %d not subscribed", i);
+    }
+    Sessions_Service(SESSION_BATCH);
+  }
+
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    SensorSession& session = sensorSessions[i];
+    EXPECT(session.connection.getPackets() == BEATS / PER_PACKET, "session %d parsed %u packets", i, session.connection.getPackets());
+    EXPECT(session.getProcessed() == BEATS, "session %d processed %u beats", i, session.getProcessed());
+    EXPECT(session.getRejected() == 0, "session %d rejected %u beats", i, session.getRejected());
+    EXPECT(session.getDropped() == 0, "session %d dropped %u beats", i, session.getDropped());
+    EXPECT(sameSnapshot(session.engine->snapshot(), reference[i].snapshot()), "session %d differs from its own stream", i);
+    printf("session %d: LF/HF %.3f\n", i, session.engine->snapshot().window[0].lf_hf_ratio);
+  }
+  EXPECT(HRV_MeanPPI == sensorSessions[0].engine->snapshot().window[0].mean_ppi, "session 0 not published");
+}
+
+static void overflow() {
+  // More beats than the ring holds, sent before ComputeTask gets to run
+  const int burst = PPI_QUEUE_SIZE + 7;
+  Modulated series = sensorSeries(99, 800.0f);
+  uint16_t ppis[burst];
+  for (int k = 0; k < burst; k++) {
+    ppis[k] = series.next();
+  }
+  for (int sent = 0; sent < burst; sent += PER_PACKET) {
+    int count = MIN(PER_PACKET, burst - sent);
+    std::vector<uint8_t> packet = ppiPacket(ppis + sent, count);
+    MockBLE::notify(ADDRESSES[BURST_SESSION], DATA_CHAR_UUID, packet.data(), packet.size());
+  }
+  Sessions_Service(SESSION_BATCH);
+
+  EXPECT(sensorSessions[BURST_SESSION].getDropped() == burst - PPI_QUEUE_SIZE, "session %d dropped %u beats", BURST_SESSION, sensorSessions[BURST_SESSION].getDropped());
+  EXPECT(sensorSessions[BURST_SESSION].getProcessed() == BEATS + PPI_QUEUE_SIZE, "session %d processed %u beats", BURST_SESSION, sensorSessions[BURST_SESSION].getProcessed());
+  EXPECT(Sessions_Dropped() == burst - PPI_QUEUE_SIZE, "drops counted against other sessions");
+}
+
+static void accelerometer() {
+  // Two 16 bit ACC frames of 20 samples each for one session
+  std::vector<uint8_t> packet(PPI_HEADER_SIZE, 0);
+  packet[0] = PMD_TYPE_ACC;
+  packet[9] = 0x01;
+  for (int i = 0; i < 20; i++) {
+    int16_t axes[3] = { (int16_t)(i * 10), (int16_t)-i, (int16_t)1000 };
+    packet.insert(packet.end(), (uint8_t*)axes, (uint8_t*)(axes + 3));
+  }
+  uint32_t packets = sensorSessions[ACC_SESSION].connection.getPackets();
+  uint32_t processed = sensorSessions[ACC_SESSION].getProcessed();
+  MockBLE::notify(ADDRESSES[ACC_SESSION], DATA_CHAR_UUID, packet.data(), packet.size());
+  MockBLE::notify(ADDRESSES[ACC_SESSION], DATA_CHAR_UUID, packet.data(), packet.size());
+  Sessions_Service(SESSION_BATCH);
+
+  const ACCSample& acc = sensorSessions[ACC_SESSION].getAcc();
+  EXPECT(sensorSessions[ACC_SESSION].getAccSamples() == 40, "session %d took %u ACC samples", ACC_SESSION, sensorSessions[ACC_SESSION].getAccSamples());
+  EXPECT(acc.x == 190 && acc.y == -19 && acc.z == 1000, "last ACC sample (%d, %d, %d)", (int)acc.x, (int)acc.y, (int)acc.z);
+  EXPECT(sensorSessions[ACC_SESSION].connection.getPackets() == packets + 2, "ACC packets not counted");
+  EXPECT(sensorSessions[ACC_SESSION].getProcessed() == processed, "ACC samples taken for beats");
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    EXPECT(i == ACC_SESSION || sensorSessions[i].getAccSamples() == 0, "ACC samples reached session %d", i);
+  }
+}
+
+static void disconnect(PolarBLEConnection::MyAdvertisedDeviceCallbacks* callbacks) {
+  // Beats still in the ring when the sensor is lost
+  Modulated old = sensorSeries(5, 700.0f);
+  uint16_t leftover[PER_PACKET];
+  for (int k = 0; k < PER_PACKET; k++) {
+    leftover[k] = old.next();
+  }
+  std::vector<uint8_t> packet = ppiPacket(leftover, PER_PACKET);
+  MockBLE::notify(ADDRESSES[LOST_SESSION], DATA_CHAR_UUID, packet.data(), packet.size());
+  uint32_t rejected = sensorSessions[LOST_SESSION].getRejected();
+
+  MockBLE::disconnect(ADDRESSES[LOST_SESSION]);
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    bool lost = i == LOST_SESSION;
+    EXPECT(sensorConnections[i]->connected == !lost, "session %d connected flag wrong after disconnect", i);
+    EXPECT(sensorConnections[i]->doScan == lost, "session %d doScan flag wrong after disconnect", i);
+  }
+
+  // BLEReceiveTask releases the session and scans again. A disconnect event of the released
+  // sensor that arrives late does not ask for another release.
+  sensorConnections[LOST_SESSION]->Release();
+  Sessions_Service(SESSION_BATCH);  // ComputeTask, woken by Release()
+  EXPECT(sensorSessions[LOST_SESSION].getProcessed() == BEATS && sensorConnections[LOST_SESSION]->ppiRing.isEmpty(),
+    "session %d processed %u beats of the released sensor", LOST_SESSION, sensorSessions[LOST_SESSION].getProcessed() - BEATS);
+  sensorConnections[LOST_SESSION]->pClient->replayDisconnect();
+  EXPECT(!sensorConnections[LOST_SESSION]->doScan, "late disconnect of a released sensor set doScan");
+  EXPECT(callbacks->freeConnections() == 1, "%u sessions free after a disconnect", callbacks->freeConnections());
+  BLEDevice::getScan()->start(5, false);
+  MockBLE::advertise("Polar Sense 0A1B2C3D", ADDRESSES[MAX_SENSORS - 1]);  // Already served
+  MockBLE::advertise("Polar Sense 0A1B2C3D", ADDRESSES[MAX_SENSORS]);
+  connectAssigned();
+  EXPECT(sensorConnections[LOST_SESSION]->connected, "session %d not reconnected", LOST_SESSION);
+  EXPECT(sensorConnections[LOST_SESSION]->myDevice->getAddress().toString() == ADDRESSES[MAX_SENSORS], "session %d got the wrong sensor", LOST_SESSION);
+
+  // The old sensor is gone; the new one, a subject with a much longer PPI than the last one
+  // validated, streams into the same session
+  static DefaultHRVEngine reference;
+  Modulated subject = sensorSeries(6, 1100.0f);
+  uint16_t ppis[PER_PACKET];
+  for (int k = 0; k < PER_PACKET; k++) {
+    ppis[k] = subject.next();
+    reference.push(ppis[k]);
+  }
+  packet = ppiPacket(ppis, PER_PACKET);
+  EXPECT(!MockBLE::notify(ADDRESSES[LOST_SESSION], DATA_CHAR_UUID, packet.data(), packet.size()), "disconnected sensor still delivers");
+  EXPECT(MockBLE::notify(ADDRESSES[MAX_SENSORS], DATA_CHAR_UUID, packet.data(), packet.size()), "new sensor not subscribed");
+  Sessions_Service(SESSION_BATCH);
+  SensorSession& session = sensorSessions[LOST_SESSION];
+  EXPECT(session.getProcessed() == BEATS + PER_PACKET, "session %d processed %u beats", LOST_SESSION, session.getProcessed());
+  EXPECT(session.getRejected() == rejected, "session %d rejected %u beats of the new sensor", LOST_SESSION,
+    session.getRejected() - rejected);
+  EXPECT(sameSnapshot(session.engine->snapshot(), reference.snapshot()), "session %d kept the old sensor's beats",
+    LOST_SESSION);
+  EXPECT(HRV_MeanPPI == reference.snapshot().window[0].mean_ppi, "session %d published %.1f ms", LOST_SESSION, HRV_MeanPPI);
+}
+
+int main() {
+  Serial.muted = true;
+  hostSkipDelay = true;
+  MockBLE::reset();
+
+  Sessions_Init();
+  resetHRVParameters();
+  BLEDevice::init("");
+  PolarBLEConnection::MyAdvertisedDeviceCallbacks callbacks("Polar Sense", sensorConnections, MAX_SENSORS);
+  BLEDevice::getScan()->setAdvertisedDeviceCallbacks(&callbacks);
+
+  scanAndConnect(&callbacks);
+  interleavedStreams();
+  overflow();
+  accelerometer();
+  disconnect(&callbacks);
+
+  return testResult();
+}
@@ -0,0 +1,150 @@
+// Two-thread stress test for SpscRing (src/utils/SpscRing.hpp).
+//
+// A producer thread pushes a numbered sequence in batches of varying size while a consumer
+// thread pops batches of a different size, as the BLE callback and ComputeTask do on the two
+// ESP32 cores. Checks that:
+//   - lossless mode (producer retries when full): every item arrives exactly once, in order
+//   - lossy mode (producer drops when full): items arrive in order, and received + overruns
+//     equals produced
+//   - the high-water mark never exceeds the capacity and reaches it under overload
+//   - discard() empties the ring from the consumer side, and the ring works on from there
+
+#include "../src/utils/SpscRing.hpp"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <thread>
+
+static const uint16_t CAPACITY = 32;
+static const uint32_t ITEMS = 2000000;
+
+struct Item {
+  uint32_t sequence;
+  uint32_t check;  // Derived from sequence to detect torn slots
+};
+
+typedef SpscRing<Item, CAPACITY> Ring;
+
+static uint32_t checksum(uint32_t sequence) {
+  return sequence * 2654435761u ^ 0xA5A5A5A5u;
+}
+
+// Cheap deterministic batch sizes in [1, limit]
+static uint16_t nextSize(Lcg& rng, uint16_t limit) {
+  return 1 + (rng.next() >> 8) % limit;
+}
+
+static void producer(Ring& ring, bool lossless) {
+  Item batch[CAPACITY];
+  Lcg rng(1);
+  uint32_t next = 0;
+  while (next < ITEMS) {
+    uint16_t count = nextSize(rng, 12);
+    if (count > ITEMS - next) {
+      count = ITEMS - next;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      batch[i].sequence = next + i;
+      batch[i].check = checksum(next + i);
+    }
+    uint16_t pushed = 0;
+    do {
+      pushed += ring.pushBatch(batch + pushed, count - pushed);
+      if (pushed < count) {
+        std::this_thread::yield();
+      }
+    } while (lossless && pushed < count);
+    next += count;
+  }
+}
+
+// Returns the number of items received
+static uint32_t consumer(Ring& ring, bool lossless, const bool& producerDone) {
+  Item batch[CAPACITY];
+  Lcg rng(2);
+  uint32_t received = 0;
+  int64_t last = -1;
+  while (true) {
+    uint16_t count = ring.popBatch(batch, nextSize(rng, CAPACITY));
+    if (count == 0) {
+      if (__atomic_load_n(&producerDone, __ATOMIC_ACQUIRE) && ring.isEmpty()) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      const Item& item = batch[i];
+      EXPECT(item.check == checksum(item.sequence), "torn item %u", item.sequence);
+      if (lossless) {
+        EXPECT(item.sequence == (uint32_t)(last + 1), "expected %lld, got %u", (long long)(last + 1), item.sequence);
+      } else {
+        EXPECT(item.sequence > last, "out of order: %u after %lld", item.sequence, (long long)last);
+      }
+      last = item.sequence;
+      received++;
+    }
+    if (failures > 10) {
+      break;
+    }
+  }
+  return received;
+}
+
+static void run(bool lossless) {
+  static Ring ring;
+  ring.clear();
+  bool producerDone = false;
+  uint32_t received = 0;
+
+  std::thread consumerThread([&] { received = consumer(ring, lossless, producerDone); });
+  std::thread producerThread([&] {
+    producer(ring, lossless);
+    __atomic_store_n(&producerDone, true, __ATOMIC_RELEASE);
+  });
+  producerThread.join();
+  consumerThread.join();
+
+  printf("%s: %u received, %u overruns, high-water %u/%u\n", lossless ? "lossless" : "lossy",
+    received, ring.getOverruns(), ring.getHighWater(), ring.getCapacity());
+
+  EXPECT(ring.getHighWater() <= CAPACITY, "high-water %u exceeds capacity", ring.getHighWater());
+  if (lossless) {
+    // Overruns here only count rejected attempts that the producer retried
+    EXPECT(received == ITEMS, "received %u of %u", received, ITEMS);
+  } else {
+    EXPECT(received + ring.getOverruns() == ITEMS, "received %u + overruns %u != %u",
+      received, ring.getOverruns(), ITEMS);
+  }
+}
+
+// Single-threaded checks of the overrun and high-water accounting
+static void accounting() {
+  static Ring ring;
+  ring.clear();
+  Item items[CAPACITY + 8] = {};
+
+  EXPECT(ring.pushBatch(items, CAPACITY + 8) == CAPACITY, "full batch not truncated to capacity");
+  EXPECT(ring.getOverruns() == 8, "expected 8 overruns, got %u", ring.getOverruns());
+  EXPECT(ring.getHighWater() == CAPACITY, "expected high-water %u, got %u", CAPACITY, ring.getHighWater());
+  EXPECT(!ring.push(items[0]), "push into a full ring succeeded");
+  EXPECT(ring.getOverruns() == 9, "expected 9 overruns, got %u", ring.getOverruns());
+
+  EXPECT(ring.popBatch(items, 5) == 5, "pop of 5 failed");
+  EXPECT(ring.size() == CAPACITY - 5, "size %u after pop", ring.size());
+  EXPECT(ring.popBatch(items, CAPACITY + 8) == CAPACITY - 5, "drain returned the wrong count");
+  EXPECT(ring.isEmpty(), "ring not empty after drain");
+  EXPECT(ring.popBatch(items, 1) == 0, "pop from an empty ring returned items");
+  EXPECT(ring.getHighWater() == CAPACITY, "high-water not retained");
+
+  EXPECT(ring.pushBatch(items, 7) == 7 && ring.discard() == 7 && ring.isEmpty(), "discard left %u items", ring.size());
+  EXPECT(ring.push(items[0]) && ring.popBatch(items, CAPACITY) == 1, "ring unusable after discard");
+}
+
+int main() {
+  accounting();
+  run(true);
+  run(false);
+
+  return testResult();
+}
@@ -0,0 +1,158 @@
+// Resampling and spectral scale test for Tachogram (src/utils/Tachogram.hpp) and the MEM path
+// of HRVEngine.
+//
+// Checks that:
+//   - constant and linearly changing PPIs are resampled exactly, on a grid of TACHO_PERIOD_MS
+//     starting at the first beat, and each beat adds only the samples of the segment it completes
+//   - a smoothly modulated beat series is followed to within a few ms between the beats
+//   - LF and HF powers of a series with known 0.1 Hz and 0.25 Hz modulation come out in ms² near
+//     their true values, with both AR estimators
+//   - the bands do not move with the heart rate: the same modulation at 60 and 100 bpm gives the
+//     same LF/HF ratio
+//   - a beat longer than the tachogram history does not break the windows' lag sums
+
+#include "../src/core/Parameters.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+static void grid() {
+  Tachogram<256> tacho;
+  EXPECT(tacho.push(800) == 0 && tacho.push(800) == 0, "samples before the first segment is final");
+
+  // Beat k at 800·(k+1) ms; the third beat completes [800, 1600)
+  uint16_t added = tacho.push(800);
+  EXPECT(added == (800 + TACHO_PERIOD_MS - 1) / TACHO_PERIOD_MS, "%u samples for an 800 ms segment", added);
+  for (int i = 0; i < 20; i++) {
+    tacho.push(800);
+  }
+  bool constant = true;
+  for (uint16_t i = 0; i < tacho.history().size(); i++) {
+    constant &= tacho.history()[i] == 800;
+  }
+  EXPECT(constant, "constant PPIs not resampled to a constant");
+  EXPECT(tacho.total() == (tacho.now() - 800 - 800 + TACHO_PERIOD_MS - 1) / TACHO_PERIOD_MS, "%u samples after %u ms", tacho.total(), tacho.now());
+
+  // A linear ramp stays linear between the beats: PPI 600 + 10·k at times Σ PPI
+  tacho.reset();
+  std::vector<uint32_t> times;
+  uint32_t now = 0;
+  for (int k = 0; k < 40; k++) {
+    uint16_t ppi = 600 + 10 * k;
+    now += ppi;
+    times.push_back(now);
+    uint32_t before = tacho.total();
+    tacho.push(ppi);
+    if (k >= 2) {
+      // Samples of [T(k-2), T(k-1)) on the grid from T(0)
+      uint32_t expected = (times[k - 1] - times[0] + TACHO_PERIOD_MS - 1) / TACHO_PERIOD_MS;
+      EXPECT(tacho.total() == expected, "beat %d: %u samples, %u expected", k, tacho.total(), expected);
+      EXPECT(tacho.total() - before <= times[k - 1] - times[k - 2], "beat %d added samples outside its segment", k);
+    }
+  }
+  double worst = 0.0;
+  for (uint32_t s = 0; s < tacho.total(); s++) {
+    uint32_t t = times[0] + s * TACHO_PERIOD_MS;
+    size_t k = 0;
+    while (times[k + 1] <= t) {
+      k++;
+    }
+    double exact = (600 + 10 * k) + 10.0 * (t - times[k]) / (times[k + 1] - times[k]);
+    worst = fmax(worst, fabs(tacho.history()[s] - exact));
+  }
+  EXPECT(worst <= 0.5 + 1e-3, "linear ramp off by %.2f ms", worst);
+  EXPECT(tacho.sampleAt(times[0]) == 0 && tacho.sampleAt(times[0] + 1) == 1 && tacho.sampleAt(times[3]) == (times[3] - times[0] + TACHO_PERIOD_MS - 1) / TACHO_PERIOD_MS,
+    "sampleAt() off the grid");
+}
+
+static void smooth() {
+  Tachogram<TACHO_HISTORY_SIZE> tacho;
+  Modulated series(850.0f, 40.0f, 25.0f, 0.0f, 5);
+  uint32_t first = 0;
+  for (int k = 0; k < 300; k++) {
+    uint16_t ppi = series.next();
+    tacho.push(ppi);
+    if (k == 0) {
+      first = tacho.now();
+    }
+  }
+
+  // The knots sample the modulation at each beat time, about 3.4 per HF cycle; the spline should
+  // follow the curve between them closely
+  double worst = 0.0;
+  for (uint32_t s = 4; s < tacho.total(); s++) {
+    // Beat k's PPI ends at time T(k); the series value at T(k) is the PPI computed at T(k-1)
+    double t = (first + s * TACHO_PERIOD_MS) / 1000.0;
+    double ppi = series.at(t - 0.85);
+    worst = fmax(worst, fabs(tacho.history()[s] - ppi));
+  }
+  printf("smooth series: %u samples, max deviation %.1f ms\n", tacho.total(), worst);
+  EXPECT(worst < 8.0, "spline deviates %.1f ms from the modulation", worst);
+}
+
+// Band powers of the 5 minute window after the series settles
+static HRV_Metrics bands(Modulated series, uint8_t method, int beats) {
+  static DefaultHRVEngine engine;
+  engine.reset();
+  engine.setARMethod(method);
+  for (int i = 0; i < beats; i++) {
+    engine.push(series.next());
+  }
+  return engine.snapshot().window[HRV_NUM_WINDOWS - 1];
+}
+
+static void spectrum() {
+  // True powers: LF 40²/2 = 800 ms², HF 25²/2 = 312.5 ms², plus a few ms² of the white noise
+  for (uint8_t method : { MEM_AR_SLIDING, MEM_AR_BURG }) {
+    const char* name = method == MEM_AR_BURG ? "burg" : "sliding";
+    HRV_Metrics m = bands(Modulated(850.0f, 40.0f, 25.0f, 30.0f, 5), method, 800);
+    printf("%s: LF %.0f ms², HF %.0f ms², LF/HF %.2f\n", name, m.lf, m.hf, m.lf_hf_ratio);
+    EXPECT(m.lf > 650.0f && m.lf < 950.0f, "%s: LF %.0f ms²", name, m.lf);
+    EXPECT(m.hf > 250.0f && m.hf < 380.0f, "%s: HF %.0f ms²", name, m.hf);
+    EXPECT(m.lf_hf_ratio > 2.0f && m.lf_hf_ratio < 3.1f, "%s: LF/HF %.2f", name, m.lf_hf_ratio);
+
+    // Beats at 60 and 100 bpm sample the same modulation at different rates
+    HRV_Metrics slow = bands(Modulated(1000.0f, 40.0f, 25.0f, 30.0f, 5), method, 600);
+    HRV_Metrics fast = bands(Modulated(600.0f, 40.0f, 25.0f, 30.0f, 5), method, 1000);
+    float ratio = slow.lf_hf_ratio / fast.lf_hf_ratio;
+    printf("%s: LF/HF %.2f at 60 bpm, %.2f at 100 bpm\n", name, slow.lf_hf_ratio, fast.lf_hf_ratio);
+    EXPECT(ratio > 0.85f && ratio < 1.18f, "%s: LF/HF %.2f at 60 bpm but %.2f at 100 bpm", name, slow.lf_hf_ratio, fast.lf_hf_ratio);
+  }
+}
+
+static void longBeat() {
+  static DefaultHRVEngine engine;
+  engine.setArtifactCorrection(false);  // Let the long beats through
+  Modulated series(850.0f, 40.0f, 25.0f, 30.0f, 5);
+  for (int i = 0; i < 500; i++) {
+    engine.push(series.next());
+  }
+
+  // Five 65 s "beats" push more samples than the history holds, so every window restarts. While
+  // they fill the windows, the spectra of samples of over a minute stay finite and non-negative.
+  for (int i = 0; i < 5; i++) {
+    engine.push(65000);
+    for (int w = 0; w < HRV_NUM_WINDOWS; w++) {
+      const HRV_Metrics& m = engine.snapshot().window[w];
+      EXPECT(std::isfinite(m.total_power) && m.total_power >= 0.0f && std::isfinite(m.lf) && m.lf >= 0.0f &&
+               std::isfinite(m.hf) && m.hf >= 0.0f,
+        "window %d after long beat %d: total %g, LF %g, HF %g ms²", w, i, m.total_power, m.lf, m.hf);
+    }
+  }
+  Modulated again(850.0f, 40.0f, 25.0f, 4.0f, 5);
+  for (int i = 0; i < 500; i++) {
+    engine.push(again.next());
+  }
+  const HRV_Metrics& m = engine.snapshot().window[0];
+  EXPECT(m.lf > 0.0f && m.lf < 5000.0f && m.hf > 0.0f && m.hf < 5000.0f, "LF %.0f, HF %.0f ms² after a long gap", m.lf, m.hf);
+}
+
+int main() {
+  grid();
+  smooth();
+  spectrum();
+  longBeat();
+
+  return testResult();
+}
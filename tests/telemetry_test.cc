@@ -0,0 +1,263 @@
+// Binary telemetry test for src/core/Telemetry.cc, decoding the frames the way
+// scripts/decode_telemetry.py does.
+//
+// Checks that:
+//   - CRC-16/CCITT-FALSE matches its check value and COBS removes every 0x00, including runs of
+//     254 non-zero bytes
+//   - records of several sessions, sent through the TX ring and the serial port, decode back to
+//     their quantized values through the zigzag varint deltas, with a keyframe every
+//     TELEMETRY_KEYFRAME_INTERVAL records and per-session sequence numbers
+//   - a frame with a corrupted byte or CRC fails the CRC check
+//   - frames stay queued while the port has no room and drain on Telemetry_Service(), a dropped
+//     frame is counted and followed by a keyframe, and a requested switch to binary resets the stream
+
+#include "../src/core/Telemetry.h"
+#include "./test_util.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+static Lcg rng(53);
+
+#define FIELD_SCALE(name, scale) scale,
+static const double SCALES[TELEMETRY_NUM_FIELDS] = { TELEMETRY_SCHEMA(FIELD_SCALE) };
+#undef FIELD_SCALE
+
+static bool cobsDecode(const std::string& data, std::vector<uint8_t>& out) {
+  out.clear();
+  size_t i = 0;
+  while (i < data.size()) {
+    uint8_t code = data[i];
+    if (code == 0 || i + code > data.size()) {
+      return false;
+    }
+    out.insert(out.end(), data.begin() + i + 1, data.begin() + i + code);
+    i += code;
+    if (code < 0xFF && i < data.size()) {
+      out.push_back(0);
+    }
+  }
+  return true;
+}
+
+struct Record {
+  uint8_t flags, session;
+  uint16_t sequence;
+  int32_t values[TELEMETRY_NUM_FIELDS];  // Quantized
+};
+
+// Delta state of each session, as kept by the reference decoder
+struct Decoder {
+  int32_t previous[MAX_SENSORS][TELEMETRY_NUM_FIELDS] = {};
+  bool synced[MAX_SENSORS] = {};
+  int crcErrors = 0;
+
+  // Decode one frame without its delimiters. Returns false if it is corrupt or cannot be applied.
+  bool decode(const std::string& frame, Record& record) {
+    std::vector<uint8_t> payload;
+    if (!cobsDecode(frame, payload) || payload.size() < 7 ||
+        Telemetry_CRC16(payload.data(), payload.size() - 2) != (payload[payload.size() - 2] | payload[payload.size() - 1] << 8)) {
+      crcErrors++;
+      return false;
+    }
+    if (payload[0] != TELEMETRY_VERSION || payload[2] >= MAX_SENSORS) {
+      return false;
+    }
+    record.flags = payload[1];
+    record.session = payload[2];
+    record.sequence = payload[3] | payload[4] << 8;
+
+    size_t i = 5;
+    for (int f = 0; f < TELEMETRY_NUM_FIELDS; f++) {
+      uint32_t value = 0;
+      int shift = 0;
+      do {
+        if (i >= payload.size() - 2) {
+          return false;
+        }
+        value |= (uint32_t)(payload[i] & 0x7F) << shift;
+        shift += 7;
+      } while (payload[i++] & 0x80);
+      int32_t delta = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);  // Undo zigzag
+      record.values[f] = (record.flags & TELEMETRY_FLAG_KEYFRAME)
+        ? delta : (int32_t)((uint32_t)previous[record.session][f] + (uint32_t)delta);
+    }
+    if (i != payload.size() - 2 || (!(record.flags & TELEMETRY_FLAG_KEYFRAME) && !synced[record.session])) {
+      return false;
+    }
+    memcpy(previous[record.session], record.values, sizeof(record.values));
+    synced[record.session] = true;
+    return true;
+  }
+};
+
+// Split a captured stream on its 0x00 delimiters
+static std::vector<std::string> frames(const std::string& stream) {
+  std::vector<std::string> out;
+  size_t start = 0;
+  for (size_t end; (end = stream.find('\0', start)) != std::string::npos; start = end + 1) {
+    if (end > start) {
+      out.push_back(stream.substr(start, end - start));
+    }
+  }
+  return out;
+}
+
+// Values of a record: slowly drifting fields, some negative, with an occasional jump
+static void makeRecord(int n, double* values) {
+  for (int f = 0; f < TELEMETRY_NUM_FIELDS; f++) {
+    double base = (f % 3 == 0 ? -1.0 : 1.0) * (f * 37.0 + 0.5 * n);
+    values[f] = base + (rng.uniform() < 0.1 ? (rng.uniform() - 0.5) * 20000.0 : (rng.uniform() - 0.5) * 4.0) / SCALES[f];
+  }
+}
+
+static void buildingBlocks() {
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  EXPECT(Telemetry_CRC16(check, sizeof(check)) == 0x29B1, "CRC-16 check value 0x%04X", Telemetry_CRC16(check, sizeof(check)));
+
+  // Zeros at the ends and in a row, and a run long enough to need a 0xFF block
+  std::vector<uint8_t> input = { 0, 1, 0, 0, 2 };
+  for (int i = 0; i < 600; i++) {
+    input.push_back(i % 255 + 1);
+  }
+  input.push_back(0);
+  std::vector<uint8_t> encoded(input.size() + input.size() / 254 + 1);
+  uint16_t length = Telemetry_COBSEncode(input.data(), input.size(), encoded.data());
+  EXPECT(length <= encoded.size(), "COBS output of %u bytes exceeds its bound", length);
+  std::string stuffed((const char*)encoded.data(), length);
+  EXPECT(stuffed.find('\0') == std::string::npos, "COBS output contains 0x00");
+  std::vector<uint8_t> decoded;
+  EXPECT(cobsDecode(stuffed, decoded) && decoded == input, "COBS round trip of %zu bytes", input.size());
+}
+
+static void roundTrip() {
+  std::string stream;
+  Serial.capture = &stream;
+  Serial.txRoom = 4096;
+  Telemetry_Reset();
+
+  const int RECORDS = 3 * TELEMETRY_KEYFRAME_INTERVAL + 5;
+  std::vector<std::vector<int32_t>> sent[MAX_SENSORS];
+  double values[TELEMETRY_NUM_FIELDS];
+  for (int n = 0; n < RECORDS; n++) {
+    for (uint8_t session = 0; session < MAX_SENSORS; session++) {
+      makeRecord(n + 7 * session, values);
+      EXPECT(Telemetry_SendRecord(session, values), "record %d of session %u dropped", n, session);
+      std::vector<int32_t> quantized(TELEMETRY_NUM_FIELDS);
+      for (int f = 0; f < TELEMETRY_NUM_FIELDS; f++) {
+        quantized[f] = (int32_t)llround(values[f] * SCALES[f]);
+      }
+      sent[session].push_back(quantized);
+    }
+  }
+  EXPECT(!Telemetry_Pending(), "frames left in the TX ring");
+
+  Decoder decoder;
+  int received[MAX_SENSORS] = {};
+  for (const std::string& frame : frames(stream)) {
+    Record record;
+    if (!decoder.decode(frame, record)) {
+      EXPECT(false, "frame of %zu bytes not decoded", frame.size());
+      continue;
+    }
+    int n = received[record.session]++;
+    EXPECT(record.sequence == n, "session %u: sequence %u, expected %d", record.session, record.sequence, n);
+    bool keyframe = n % TELEMETRY_KEYFRAME_INTERVAL == 0;
+    EXPECT(!!(record.flags & TELEMETRY_FLAG_KEYFRAME) == keyframe, "session %u record %d: keyframe flag %u",
+      record.session, n, record.flags);
+    if (n < RECORDS) {
+      for (int f = 0; f < TELEMETRY_NUM_FIELDS; f++) {
+        EXPECT(record.values[f] == sent[record.session][n][f], "session %u record %d field %d: %d, sent %d",
+          record.session, n, f, record.values[f], sent[record.session][n][f]);
+      }
+    }
+  }
+  for (int session = 0; session < MAX_SENSORS; session++) {
+    EXPECT(received[session] == RECORDS, "session %d: %d records decoded of %d", session, received[session], RECORDS);
+  }
+
+  // Any flipped bit in the payload or the CRC is caught
+  std::string frame = frames(stream).back();
+  for (size_t i : { (size_t)3, frame.size() / 2, frame.size() - 2, frame.size() - 1 }) {
+    std::string corrupted = frame;
+    corrupted[i] ^= 0x10;
+    if (corrupted[i] == 0) {
+      corrupted[i] = 0x01;
+    }
+    Record record;
+    int before = decoder.crcErrors;
+    EXPECT(!decoder.decode(corrupted, record) && decoder.crcErrors == before + 1, "corrupted byte %zu accepted", i);
+  }
+
+  Serial.capture = nullptr;
+}
+
+static void backpressure() {
+  std::string stream;
+  Serial.capture = &stream;
+  Telemetry_Reset();
+  double values[TELEMETRY_NUM_FIELDS];
+
+  // A port without room keeps the frames queued until the compute task flushes them
+  Serial.txRoom = 0;
+  makeRecord(0, values);
+  EXPECT(Telemetry_SendRecord(0, values), "record dropped with room in the TX ring");
+  EXPECT(stream.empty() && Telemetry_Pending(), "%zu bytes written to a full port", stream.size());
+  Serial.txRoom = 10;
+  Telemetry_Service();
+  EXPECT(stream.size() == 10 && Telemetry_Pending(), "flush wrote %zu bytes into 10 bytes of room", stream.size());
+  Serial.txRoom = 4096;
+  Telemetry_Service();
+  EXPECT(!Telemetry_Pending() && frames(stream).size() == 1, "%zu frames after the flush", frames(stream).size());
+
+  // Fill the ring: the frame that does not fit is counted, leaving a gap in the sequence numbers,
+  // and the next one is a keyframe
+  Serial.txRoom = 0;
+  int sentRecords = 1;
+  while (telemetryDroppedFrames == 0 && sentRecords < 1000) {
+    makeRecord(sentRecords++, values);
+    Telemetry_SendRecord(0, values);
+  }
+  EXPECT(telemetryDroppedFrames == 1, "%u frames dropped", (unsigned)telemetryDroppedFrames);
+  Serial.txRoom = 4096;
+  Telemetry_Service();
+  makeRecord(sentRecords, values);
+  Telemetry_SendRecord(0, values);
+  Decoder decoder;
+  Record record = {};
+  std::vector<std::string> all = frames(stream);
+  for (const std::string& frame : all) {
+    decoder.decode(frame, record);
+  }
+  EXPECT(decoder.crcErrors == 0 && (record.flags & TELEMETRY_FLAG_KEYFRAME) && record.sequence == sentRecords,
+    "frame after the drop: flags %u, sequence %u", record.flags, record.sequence);
+
+  // A switch requested by another task takes effect on the next service and restarts the stream
+  EXPECT(telemetryMode == TELEMETRY_CSV, "default mode %u", telemetryMode);
+  Telemetry_RequestMode(TELEMETRY_BINARY);
+  EXPECT(telemetryMode == TELEMETRY_CSV, "mode switched before the request was serviced");
+  Telemetry_Service();
+  EXPECT(telemetryMode == TELEMETRY_BINARY && telemetryDroppedFrames == 0, "switch to binary: mode %u, %u drops",
+    telemetryMode, (unsigned)telemetryDroppedFrames);
+  stream.clear();
+  Telemetry_SendRecord(0, values);
+  decoder = Decoder();
+  all = frames(stream);
+  EXPECT(all.size() == 1 && decoder.decode(all[0], record) && record.sequence == 0 &&
+           (record.flags & TELEMETRY_FLAG_KEYFRAME),
+    "first frame after a switch to binary: sequence %u, flags %u", record.sequence, record.flags);
+  Telemetry_RequestMode(TELEMETRY_CSV);
+  Telemetry_Service();
+  EXPECT(telemetryMode == TELEMETRY_CSV, "mode %u after a switch to CSV", telemetryMode);
+
+  Serial.capture = nullptr;
+}
+
+int main() {
+  buildingBlocks();
+  roundTrip();
+  backpressure();
+
+  return testResult();
+}
@@ -0,0 +1,107 @@
+#ifndef _TEST_UTIL_H
+#define _TEST_UTIL_H
+
+// Shared by the host tests: failure counting and reporting, comparisons of engine results, and
+// the deterministic generators behind their random data, so every run sees the same values.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+[[maybe_unused]] static int failures = 0;
+
+// Report a failed check with a printf-style message and carry on, so one run lists every failure
+#define EXPECT(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      failures++; \
+    } \
+  } while (0)
+
+// Exit code of the test: prints the failure count, or OK
+static inline int testResult() {
+  if (failures > 0) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
+
+// Engine results compared bit for bit. Templates, so tests without an engine need not include
+// HRVEngine.hpp.
+
+// Same spectral values (HRV_Metrics): LF, HF, total power and LF/HF
+template <typename Metrics>
+static inline bool sameSpectrum(const Metrics& a, const Metrics& b) {
+  return a.lf == b.lf && a.hf == b.hf && a.total_power == b.total_power && a.lf_hf_ratio == b.lf_hf_ratio;
+}
+
+// Same results of every window (HRV_Snapshot)
+template <typename Snapshot>
+static inline bool sameSnapshot(const Snapshot& a, const Snapshot& b) {
+  return a.beats == b.beats && a.current_ppi == b.current_ppi && memcmp(a.window, b.window, sizeof(a.window)) == 0;
+}
+
+// Linear congruential generator (Numerical Recipes constants) for test signals and noise
+struct Lcg {
+  uint32_t state;
+
+  explicit Lcg(uint32_t seed) : state(seed) {}
+
+  // Top 24 bits of the next state
+  uint32_t next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  }
+
+  // Uniform in [0, 1)
+  double uniform() {
+    return next() / double(1 << 24);
+  }
+};
+
+// Xorshift32 generator, for tests that need all 32 bits (random frames and payloads)
+struct XorShift32 {
+  uint32_t state;  // Never 0
+
+  explicit XorShift32(uint32_t seed) : state(seed) {}
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+};
+
+// PPI series with sinusoidal LF (0.1 Hz) and HF (0.25 Hz) modulation in time and uniform noise of
+// the given width, amplitudes in ms. Each beat advances the time by its own PPI. vlf adds a
+// 0.02 Hz component below the LF band.
+struct Modulated {
+  float mean, lf, hf, noise;
+  float vlf;
+  double t;  // s
+  Lcg rng;
+
+  Modulated(float mean, float lf, float hf, float noise, uint32_t seed) :
+    mean(mean), lf(lf), hf(hf), noise(noise), vlf(0.0f), t(0.0), rng(seed) {}
+
+  // Modulation without noise at time s
+  double at(double time) const {
+    return mean + vlf * sin(2.0 * M_PI * 0.02 * time) + lf * sin(2.0 * M_PI * 0.1 * time) +
+           hf * sin(2.0 * M_PI * 0.25 * time);
+  }
+
+  uint16_t next() {
+    double ppi = at(t) + (rng.uniform() - 0.5) * noise;
+    t += ppi / 1000.0;
+    return (uint16_t)(ppi + 0.5);
+  }
+};
+
+#endif  // _TEST_UTIL_H